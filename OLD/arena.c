@@ -0,0 +1,199 @@
+#include "arena.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Chunk header rounded up so the data after it stays aligned */
+#define CHUNK_HEADER ((sizeof(arena_chunk_t) + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1))
+#define CHUNK_DATA (ARENA_CHUNK_SIZE - CHUNK_HEADER)
+
+static inline char *chunk_data(arena_chunk_t *chunk)
+{
+    return (char *)chunk + CHUNK_HEADER;
+}
+
+/* =============================
+ * Chunk cache
+ * ============================= */
+
+/*
+ * A spin lock is enough: it is held for a few pointer moves, and only
+ * when an arena runs out of room or resets past a chunk.
+ */
+static unsigned char cache_lock;
+static arena_chunk_t *cache_head;
+static uint64_t cache_count;
+static uint64_t cache_hits;
+static uint64_t cache_misses;
+
+static inline void cache_acquire(void)
+{
+    while (__atomic_test_and_set(&cache_lock, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(&cache_lock, __ATOMIC_RELAXED)) {
+        }
+    }
+}
+
+static inline void cache_release(void)
+{
+    __atomic_clear(&cache_lock, __ATOMIC_RELEASE);
+}
+
+static arena_chunk_t *chunk_get(arena_t *arena, size_t size)
+{
+    arena_chunk_t *chunk = NULL;
+
+    if (size <= CHUNK_DATA) {
+        cache_acquire();
+        if (cache_head) {
+            chunk = cache_head;
+            cache_head = chunk->prev;
+            cache_count--;
+            cache_hits++;
+        } else {
+            cache_misses++;
+        }
+        cache_release();
+        if (chunk) {
+            arena->chunks_reused++;
+            return chunk;
+        }
+        size = CHUNK_DATA;
+    }
+    chunk = (arena_chunk_t *)malloc(CHUNK_HEADER + size);
+    if (!chunk) return NULL;
+    chunk->size = size;
+    arena->chunks_new++;
+    return chunk;
+}
+
+/* Releases the chunks from `newest` back to, not including, `stop` */
+static void chunks_put(arena_chunk_t *newest, arena_chunk_t *stop)
+{
+    arena_chunk_t *keep = NULL, *keep_tail = NULL;
+    uint64_t kept = 0;
+
+    /* Gather the standard chunks into one list first, so the lock is taken once */
+    while (newest != stop) {
+        arena_chunk_t *prev = newest->prev;
+        if (newest->size == CHUNK_DATA) {
+            newest->prev = keep;
+            if (!keep) keep_tail = newest;
+            keep = newest;
+            kept++;
+        } else {
+            free(newest);
+        }
+        newest = prev;
+    }
+    if (!keep) return;
+
+    cache_acquire();
+    if (cache_count + kept <= ARENA_CACHE_MAX) {
+        keep_tail->prev = cache_head;
+        cache_head = keep;
+        cache_count += kept;
+        keep = NULL;
+    }
+    cache_release();
+
+    /* No room: this batch goes back to malloc */
+    while (keep) {
+        arena_chunk_t *prev = keep->prev;
+        free(keep);
+        keep = prev;
+    }
+}
+
+void arena_cache_trim(void)
+{
+    cache_acquire();
+    arena_chunk_t *chunk = cache_head;
+    cache_head = NULL;
+    cache_count = 0;
+    cache_release();
+
+    while (chunk) {
+        arena_chunk_t *prev = chunk->prev;
+        free(chunk);
+        chunk = prev;
+    }
+}
+
+void arena_cache_stats(arena_cache_stats_t *stats)
+{
+    cache_acquire();
+    stats->cached = cache_count;
+    stats->hits = cache_hits;
+    stats->misses = cache_misses;
+    cache_release();
+}
+
+/* =============================
+ * Arenas
+ * ============================= */
+
+void arena_init(arena_t *arena)
+{
+    memset(arena, 0, sizeof(*arena));
+}
+
+void arena_destroy(arena_t *arena)
+{
+    chunks_put(arena->chunk, NULL);
+    memset(arena, 0, sizeof(*arena));
+}
+
+void *arena_alloc_slow(arena_t *arena, size_t size)
+{
+    arena_chunk_t *chunk = chunk_get(arena, size);
+    if (!chunk) return NULL;
+
+    /* What was left in the old chunk is abandoned until the next reset */
+    chunk->prev = arena->chunk;
+    arena->chunk = chunk;
+    arena->ptr = chunk_data(chunk) + size;
+    arena->end = chunk_data(chunk) + chunk->size;
+    arena->allocations++;
+    return chunk_data(chunk);
+}
+
+void *arena_calloc(arena_t *arena, size_t count, size_t size)
+{
+    if (size && count > SIZE_MAX / size) return NULL;
+    void *p = arena_alloc(arena, count * size);
+    if (p) memset(p, 0, count * size);
+    return p;
+}
+
+char *arena_strdup(arena_t *arena, const char *s)
+{
+    size_t len = strlen(s) + 1;
+    char *copy = (char *)arena_alloc(arena, len);
+    if (copy) memcpy(copy, s, len);
+    return copy;
+}
+
+void arena_reset_to(arena_t *arena, arena_mark_t mark)
+{
+    chunks_put(arena->chunk, mark.chunk);
+    arena->chunk = mark.chunk;
+    if (mark.chunk) {
+        arena->ptr = mark.ptr;
+        arena->end = chunk_data(mark.chunk) + mark.chunk->size;
+    } else {
+        arena->ptr = arena->end = NULL;
+    }
+}
+
+void arena_reset(arena_t *arena)
+{
+    arena_chunk_t *first = arena->chunk;
+    if (!first) return;
+    while (first->prev) first = first->prev;
+
+    arena_mark_t mark;
+    mark.chunk = first;
+    mark.ptr = chunk_data(first);
+    arena_reset_to(arena, mark);
+}
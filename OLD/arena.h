@@ -0,0 +1,126 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Region allocator for memory that dies together.
+ *
+ * Allocation bumps a pointer through a chunk; there is no per-object
+ * free. Everything allocated after a mark is released at once by
+ * resetting to it, whatever the number of objects, and arena_reset()
+ * releases everything. An arena belongs to one thread at a time.
+ *
+ * Chunks are ARENA_CHUNK_SIZE bytes. Released chunks go to a process-wide
+ * cache (up to ARENA_CACHE_MAX of them) that every arena draws from, so
+ * a steady cycle of allocate and reset stops calling malloc once warm.
+ * A request too large for a chunk gets a chunk of its own, which is
+ * freed rather than cached.
+ *
+ * Pool workers each own one (see thread_pool_scratch()), reset after
+ * every task.
+ */
+
+#define ARENA_CHUNK_SIZE (64 * 1024)
+#define ARENA_ALIGN 16
+#define ARENA_CACHE_MAX 256
+
+typedef struct arena_chunk_t {
+    struct arena_chunk_t *prev;     /* the chunk filled before this one */
+    size_t size;                    /* usable bytes after the header */
+} arena_chunk_t;
+
+typedef struct arena_t {
+    arena_chunk_t *chunk;           /* newest chunk, NULL when empty */
+    char *ptr;                      /* next free byte in it */
+    char *end;
+    uint64_t allocations;
+    uint64_t chunks_new;            /* taken from malloc */
+    uint64_t chunks_reused;         /* taken from the cache */
+} arena_t;
+
+/**
+ * Position to reset back to. Marks must be used newest first.
+ */
+typedef struct arena_mark_t {
+    arena_chunk_t *chunk;
+    char *ptr;
+} arena_mark_t;
+
+void arena_init(arena_t *arena);
+
+/**
+ * Release every chunk, to the cache where there is room.
+ */
+void arena_destroy(arena_t *arena);
+
+void *arena_alloc_slow(arena_t *arena, size_t size);
+
+/**
+ * `size` bytes aligned to ARENA_ALIGN, valid until a reset past them.
+ * Returns NULL if memory ran out.
+ */
+static inline void *arena_alloc(arena_t *arena, size_t size)
+{
+    size = (size + ARENA_ALIGN - 1) & ~(size_t)(ARENA_ALIGN - 1);
+    if ((size_t)(arena->end - arena->ptr) >= size) {
+        void *p = arena->ptr;
+        arena->ptr += size;
+        arena->allocations++;
+        return p;
+    }
+    return arena_alloc_slow(arena, size);
+}
+
+/**
+ * Zeroed arena_alloc().
+ */
+void *arena_calloc(arena_t *arena, size_t count, size_t size);
+
+/**
+ * Copy of the string.
+ */
+char *arena_strdup(arena_t *arena, const char *s);
+
+static inline arena_mark_t arena_mark(const arena_t *arena)
+{
+    arena_mark_t mark;
+    mark.chunk = arena->chunk;
+    mark.ptr = arena->ptr;
+    return mark;
+}
+
+/**
+ * Free everything allocated since `mark`. Costs one step per chunk
+ * released, not per allocation.
+ */
+void arena_reset_to(arena_t *arena, arena_mark_t mark);
+
+/**
+ * Free everything, keeping the first chunk for reuse.
+ */
+void arena_reset(arena_t *arena);
+
+/**
+ * Free the chunks held in the process-wide cache.
+ */
+void arena_cache_trim(void);
+
+typedef struct arena_cache_stats_t {
+    uint64_t cached;                /* chunks in the cache now */
+    uint64_t hits;                  /* chunks handed out from it */
+    uint64_t misses;                /* chunk requests it could not serve */
+} arena_cache_stats_t;
+
+void arena_cache_stats(arena_cache_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ARENA_H
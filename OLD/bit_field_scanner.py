@@ -11,6 +11,25 @@ TYPE_SIZES: Dict[str, int] = {
     "long": 64    # 8 bytes
 }
 
+# Qualifiers kept apart from the type: "type" stays char/short/int/long and
+# the field's "signed" member says how to read it. A bare "signed" or
+# "unsigned" means int. Plain char is the one unqualified type whose
+# signedness depends on the target, see StructParser's char_signed.
+SIGN_QUALIFIERS = ("signed", "unsigned")
+
+
+def split_signedness(dtype: str, char_signed: bool = True) -> tuple:
+    """
+    Split a declared type such as "unsigned char" into ("char", False).
+    Unqualified short, int and long are signed. Plain char is signed on x86
+    but unsigned on ARM and PowerPC, so it takes `char_signed`.
+    """
+    words = dtype.split()
+    if words[0] in SIGN_QUALIFIERS:
+        return (words[1] if len(words) > 1 else "int"), words[0] == "signed"
+    return dtype, (char_signed if dtype == "char" else True)
+
+
 # Default endianness based on system.
 SYSTEM_ENDIANNESS: str = "little" if sys.byteorder == "little" else "big"
 
@@ -36,8 +55,15 @@ class StructParser:
              json_str = parser.to_json("my_t")
       6. You can later import a JSON layout with import_from_json().
     """
-    def __init__(self, endianness: str = SYSTEM_ENDIANNESS, definitions: Optional[Dict[str, Any]] = None):
+    def __init__(self, endianness: str = SYSTEM_ENDIANNESS, definitions: Optional[Dict[str, Any]] = None,
+                 char_signed: bool = True):
+        """
+        `char_signed` is whether plain char is signed on the target whose
+        structs are parsed: True for x86 (the default), False for ARM and
+        PowerPC. It goes into the "signed" member of plain char fields.
+        """
         self.endianness: str = endianness
+        self.char_signed: bool = char_signed
         self.preproc_defs: Dict[str, Any] = definitions.copy() if definitions else {}
         self.struct_registry: Dict[str, Dict[str, Any]] = {}  # Maps struct name to layout dictionary.
         self.field_symbols: Dict[str, Dict[int, str]] = {}  # Maps "struct_name.field_name" to symbolic values.
@@ -82,14 +108,16 @@ class StructParser:
         Returns a dictionary containing:
           - struct_name, endianness, total_bits, total_bytes.
           - A list of field descriptions.
-            * For bit-fields: name, type, bit_offset, bit_width, mask.
-            * For primitive fields: name, type, bit_offset, size (or element_size and total_bits if array).
+            * For bit-fields: name, type, signed, bit_offset, bit_width, mask.
+            * For primitive fields: name, type, signed, bit_offset, size (or element_size and total_bits
+              if array).
             * For nested struct fields: includes the nested layout or a placeholder if undefined.
         """
         layout: Dict[str, Any] = {}
         bit_masks: Dict[str, int] = {}      # Computed mask for each field.
         bit_shifts: Dict[str, int] = {}     # Bit offset for each field.
-        field_types: Dict[str, str] = {}    # Field types as declared.
+        field_types: Dict[str, str] = {}    # Field types as declared, without signed/unsigned.
+        field_signed: Dict[str, bool] = {}  # Signedness of primitive and bit-field types.
         field_sizes: Dict[str, int] = {}    # For bit-fields: width; for primitives: per-element size.
         field_array_lengths: Dict[str, Optional[int]] = {}  # None if not an array.
         nested_structs: Dict[str, Dict[str, Any]] = {}      # For nested struct fields.
@@ -101,14 +129,16 @@ class StructParser:
 
         # Regex for bit-fields (fields with colon), e.g.:
         #     int item_1: 4;
-        bit_field_pattern = re.compile(r'(\w+)\s+(\w+)\s*:\s*(\d+)\s*;')
+        #     unsigned char counter: 8;
+        bit_field_pattern = re.compile(r'((?:(?:un)?signed\s+)?\w+)\s+(\w+)\s*:\s*(\d+)\s*;')
         # Regex for normal fields (without colon) with optional array, e.g.:
         #     char values[5];
-        normal_field_pattern = re.compile(r'(\w+)\s+(\w+)(?!\s*:)\s*(\[[^]]+])?\s*;')
+        normal_field_pattern = re.compile(r'((?:(?:un)?signed\s+)?\w+)\s+(\w+)(?!\s*:)\s*(\[[^]]+])?\s*;')
 
         # Process bit-fields.
         for dtype, name, size_str in bit_field_pattern.findall(definition):
             size = int(size_str)
+            dtype, field_signed[name] = split_signedness(dtype, self.char_signed)
             field_types[name] = dtype
             field_sizes[name] = size
             field_array_lengths[name] = None  # Bit-fields are not arrays.
@@ -121,6 +151,7 @@ class StructParser:
         for dtype, name, array_part in normal_field_pattern.findall(definition):
             if name in field_types:
                 continue  # Already processed as bit-field.
+            dtype, is_signed = split_signedness(dtype, self.char_signed)
             # Check for nested struct.
             if dtype in self.struct_registry:
                 nested_layout = self.struct_registry[dtype]
@@ -165,6 +196,7 @@ class StructParser:
                         padding = base_size - (total_bits % base_size)
                         total_bits += padding
                     field_types[name] = dtype
+                    field_signed[name] = is_signed
                     field_sizes[name] = base_size
                     bit_shifts[name] = total_bits
                     bit_masks[name] = ((1 << total_field_bits) - 1) << total_bits
@@ -183,6 +215,8 @@ class StructParser:
                 "type": field_types[name],
                 "bit_offset": bit_shifts[name],
             }
+            if name in field_signed:
+                field_info["signed"] = field_signed[name]
             if name in nested_structs:
                 field_info["nested"] = nested_structs[name]
                 if field_array_lengths[name] is not None:
@@ -254,6 +288,13 @@ class StructParser:
             return self.field_symbols[key][value]
         raise StructParserError(f"No symbolic value found for field '{field_name}' in struct '{struct_name}' and value '{value}'.")
 
+    def symbols_to_json(self) -> str:
+        """
+        Return all field symbols as JSON ({"struct.field": {"value": "NAME"}}),
+        the input of the native symbol tables (symtab_main build).
+        """
+        return json.dumps(self.field_symbols, indent=4)
+
     def get_field(self, struct_name: str, field_name: str) -> Dict[str, Any]:
         """
         Retrieve field metadata from a specific struct by field name.
@@ -298,6 +339,27 @@ if __name__ == "__main__":
     # Expect: bit-fields for item_1, item_2, item_3 with masks; values field with array_length 5.
     # Since total_bits is 64 or less, all fields will have a mask.
 
+    # Test 1b: Unsigned fields, as in packet_header.py; "type" keeps the bare
+    # spelling and "signed" is false.
+    bit_fields = """
+    typedef struct {
+        unsigned char msg_type: 4;
+        unsigned char msg_source: 4;
+        unsigned char counter;
+        unsigned short length;
+        signed char delta;
+    } bit_fields_t;
+    """
+    parser.parse_struct(bit_fields)
+    print(parser.to_json("bit_fields_t"))
+
+    # Test 1c: Plain char takes the target's signedness; unsigned on ARM.
+    arm_parser = StructParser(char_signed=False)
+    arm_parser.parse_struct("typedef struct { char c; signed char s; int i; } plain_char_t;")
+    plain = arm_parser.get_field("plain_char_t", "c")["signed"], arm_parser.get_field("plain_char_t", "s")["signed"]
+    print("\nTest 1c - plain char signed on ARM:", plain[0], "signed char:", plain[1])
+    assert plain == (False, True)
+
     # Test 2: Struct with undefined preprocessor constants.
     my_struct_bad = """
     typedef struct {
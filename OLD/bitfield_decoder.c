@@ -0,0 +1,375 @@
+#include "bitfield_decoder.h"
+
+#include <stdlib.h>
+#include "json_reader.h"
+
+/* Records per block: ops loop over a block that stays in L1 */
+#define BITFIELD_BLOCK 512
+
+/* =============================
+ * Layout compilation
+ * ============================= */
+
+typedef struct compiler_t {
+    bitfield_layout_t *layout;
+    uint32_t capacity;
+    const char *struct_name;
+} compiler_t;
+
+/*
+ * StructParser spells every type char/short/int/long and exports the
+ * signedness apart, as "signed"; a field without it is raw wire data and
+ * read as unsigned.
+ */
+static int field_is_signed(const json_node_t *field)
+{
+    const json_node_t *is_signed = json_get(field, "signed");
+    return is_signed && (is_signed->type == JSON_BOOL || is_signed->type == JSON_NUMBER) && is_signed->number != 0;
+}
+
+static int add_op(compiler_t *c, const char *name, uint64_t bit_offset, uint32_t width, int is_signed)
+{
+    bitfield_layout_t *layout = c->layout;
+    uint32_t bit = (uint32_t)(bit_offset % 8);
+    uint32_t bytes = (bit + width + 7) / 8;
+
+    if (width == 0 || width > 64 || bytes > 8) {
+        fprintf(stderr, "bitfield_layout: %s.%s: %u bits at bit %llu cannot be loaded in one word\n",
+                c->struct_name, name, width, (unsigned long long)bit_offset);
+        return -1;
+    }
+    if (bit_offset + width > (uint64_t)layout->record_bytes * 8) {
+        fprintf(stderr, "bitfield_layout: %s.%s lies outside the %u byte record\n",
+                c->struct_name, name, layout->record_bytes);
+        return -1;
+    }
+
+    if (layout->num_ops == c->capacity) {
+        uint32_t grown = c->capacity ? c->capacity * 2 : 16;
+        bitfield_op_t *ops = (bitfield_op_t *)realloc(layout->ops, sizeof(*ops) * grown);
+        if (!ops) return -1;
+        layout->ops = ops;
+        char (*names)[BITFIELD_MAX_NAME] =
+            (char (*)[BITFIELD_MAX_NAME])realloc(layout->names, sizeof(*names) * grown);
+        if (!names) return -1;
+        layout->names = names;
+        c->capacity = grown;
+    }
+
+    bitfield_op_t *op = &layout->ops[layout->num_ops];
+    op->byte_offset = (uint32_t)(bit_offset / 8);
+    op->load_bytes = (uint8_t)bytes;
+    /* Big endian numbers bits from the top of the first byte */
+    op->shift = (uint8_t)(layout->endian == BITFIELD_BIG ? 8 * bytes - bit - width : bit);
+    op->width = (uint8_t)width;
+    op->is_signed = (uint8_t)is_signed;
+    op->mask = width == 64 ? ~0ULL : (1ULL << width) - 1;
+    op->sign_bit = is_signed ? 1ULL << (width - 1) : 0;
+    snprintf(layout->names[layout->num_ops], BITFIELD_MAX_NAME, "%s", name);
+    layout->num_ops++;
+    return 0;
+}
+
+static int compile_fields(compiler_t *c, const json_node_t *layout_node, uint64_t base_bit,
+                          const char *prefix, int depth)
+{
+    const json_node_t *fields = json_get(layout_node, "fields");
+    if (!fields || fields->type != JSON_ARRAY) {
+        fprintf(stderr, "bitfield_layout: %s: layout has no \"fields\" array\n", c->struct_name);
+        return -1;
+    }
+
+    for (const json_node_t *f = fields->child; f; f = f->next) {
+        const json_node_t *name_node = json_get(f, "name");
+        const json_node_t *nested = json_get(f, "nested");
+        const int is_signed = field_is_signed(f);
+        long long offset, width, length = 0, size;
+        char name[BITFIELD_MAX_NAME];
+
+        if (!name_node || name_node->type != JSON_STRING || json_get_int(f, "bit_offset", &offset) != 0) {
+            fprintf(stderr, "bitfield_layout: %s: field without name or bit_offset\n", c->struct_name);
+            return -1;
+        }
+        snprintf(name, sizeof(name), "%s%.*s", prefix, (int)name_node->str_len, name_node->str);
+        json_get_int(f, "array_length", &length);
+        const uint64_t bit = base_bit + (uint64_t)offset;
+
+        if (nested) {
+            const json_node_t *undefined = json_get(nested, "undefined");
+            if ((undefined && undefined->number) || json_get_int(nested, "total_bits", &size) != 0) {
+                fprintf(stderr, "bitfield_layout: %s: nested struct %s was undefined when exported\n",
+                        c->struct_name, name);
+                return -1;
+            }
+            if (depth >= JSON_MAX_DEPTH) return -1;
+            long long n = length > 0 ? length : 1;
+            for (long long i = 0; i < n; i++) {
+                char inner[BITFIELD_MAX_NAME + 24];
+                if (length > 0) snprintf(inner, sizeof(inner), "%s[%lld].", name, i);
+                else snprintf(inner, sizeof(inner), "%s.", name);
+                if (compile_fields(c, nested, bit + (uint64_t)(i * size), inner, depth + 1) != 0) return -1;
+            }
+        } else if (json_get_int(f, "bit_width", &width) == 0) {
+            if (add_op(c, name, bit, (uint32_t)width, is_signed) != 0) return -1;
+        } else if (length > 0 && json_get_int(f, "element_size", &size) == 0) {
+            for (long long i = 0; i < length; i++) {
+                char element[BITFIELD_MAX_NAME + 24];
+                snprintf(element, sizeof(element), "%s[%lld]", name, i);
+                if (add_op(c, element, bit + (uint64_t)(i * size), (uint32_t)size, is_signed) != 0) return -1;
+            }
+        } else if (json_get_int(f, "size", &size) == 0) {
+            if (add_op(c, name, bit, (uint32_t)size, is_signed) != 0) return -1;
+        } else {
+            fprintf(stderr, "bitfield_layout: %s: field %s has no width\n", c->struct_name, name);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+int bitfield_layout_load_json(bitfield_layout_t *layout, const char *json, size_t len,
+                              bitfield_endian_t endian)
+{
+    const char *error = NULL;
+    size_t error_offset = 0;
+    long long total_bits = 0, total_bytes = 0;
+
+    memset(layout, 0, sizeof(*layout));
+    json_node_t *root = json_parse(json, len, &error, &error_offset);
+    if (!root) {
+        fprintf(stderr, "bitfield_layout_load_json: %s at offset %zu\n", error, error_offset);
+        return -1;
+    }
+
+    const json_node_t *name = json_get(root, "struct_name");
+    if (!name || name->type != JSON_STRING ||
+        json_get_int(root, "total_bits", &total_bits) != 0 || total_bits <= 0) {
+        fprintf(stderr, "bitfield_layout_load_json: not a StructParser layout\n");
+        json_free(root);
+        return -1;
+    }
+    if (json_get_int(root, "total_bytes", &total_bytes) != 0) total_bytes = (total_bits + 7) / 8;
+
+    snprintf(layout->struct_name, sizeof(layout->struct_name), "%.*s", (int)name->str_len, name->str);
+    layout->endian = endian != BITFIELD_ENDIAN_LAYOUT ? endian
+                   : json_string_is(json_get(root, "endianness"), "big") ? BITFIELD_BIG : BITFIELD_LITTLE;
+    layout->total_bits = (uint32_t)total_bits;
+    layout->record_bytes = (uint32_t)total_bytes;
+
+    compiler_t compiler = { layout, 0, layout->struct_name };
+    int rc = compile_fields(&compiler, root, 0, "", 0);
+    json_free(root);
+    if (rc != 0) {
+        bitfield_layout_free(layout);
+        return -1;
+    }
+    return 0;
+}
+
+int bitfield_layout_load_file(bitfield_layout_t *layout, const char *path,
+                              bitfield_endian_t endian)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "bitfield_layout_load_file: cannot open %s\n", path);
+        return -1;
+    }
+
+    size_t cap = 1 << 14, len = 0, got;
+    char *text = (char *)malloc(cap);
+    while (text && (got = fread(text + len, 1, cap - len, f)) > 0) {
+        len += got;
+        if (len == cap) {
+            char *bigger = (char *)realloc(text, cap * 2);
+            if (!bigger) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = bigger;
+            cap *= 2;
+        }
+    }
+    fclose(f);
+    if (!text) {
+        fprintf(stderr, "bitfield_layout_load_file: out of memory reading %s\n", path);
+        return -1;
+    }
+
+    int rc = bitfield_layout_load_json(layout, text, len, endian);
+    free(text);
+    return rc;
+}
+
+void bitfield_layout_free(bitfield_layout_t *layout)
+{
+    free(layout->ops);
+    free(layout->names);
+    layout->ops = NULL;
+    layout->names = NULL;
+    layout->num_ops = 0;
+    layout->fast_path = NULL;
+}
+
+int bitfield_layout_find(const bitfield_layout_t *layout, const char *name)
+{
+    for (uint32_t i = 0; i < layout->num_ops; i++) {
+        if (strcmp(layout->names[i], name) == 0) return (int)i;
+    }
+    return -1;
+}
+
+/* FNV-1a, field by field so struct padding never leaks in */
+static uint64_t fnv_add(uint64_t h, uint64_t value)
+{
+    for (int i = 0; i < 8; i++) {
+        h ^= (value >> (8 * i)) & 0xFF;
+        h *= 0x100000001B3ULL;
+    }
+    return h;
+}
+
+uint64_t bitfield_layout_signature(const bitfield_layout_t *layout)
+{
+    uint64_t h = 0xCBF29CE484222325ULL;
+
+    h = fnv_add(h, (uint64_t)layout->endian);
+    h = fnv_add(h, layout->record_bytes);
+    h = fnv_add(h, layout->num_ops);
+    for (uint32_t i = 0; i < layout->num_ops; i++) {
+        const bitfield_op_t *op = &layout->ops[i];
+        h = fnv_add(h, op->byte_offset);
+        h = fnv_add(h, ((uint64_t)op->load_bytes << 8) | op->shift);
+        h = fnv_add(h, op->mask);
+        h = fnv_add(h, op->sign_bit);
+    }
+    return h;
+}
+
+int bitfield_layout_set_fast_path(bitfield_layout_t *layout, bitfield_batch_func_t func,
+                                  uint64_t signature)
+{
+    if (func && signature != bitfield_layout_signature(layout)) {
+        fprintf(stderr, "bitfield_layout_set_fast_path: %s was generated from a different layout\n",
+                layout->struct_name);
+        return -1;
+    }
+    layout->fast_path = func;
+    return 0;
+}
+
+/* =============================
+ * Decoding
+ * ============================= */
+
+void bitfield_decode_record(const bitfield_layout_t *layout, const uint8_t *record,
+                            uint64_t *values)
+{
+    const int big = layout->endian == BITFIELD_BIG;
+    for (uint32_t i = 0; i < layout->num_ops; i++) {
+        values[i] = bitfield_extract(&layout->ops[i], big, record);
+    }
+}
+
+/*
+ * One op over a block of records. Always inlined with constant `n` and
+ * `big`, so the load becomes a single fixed-size move (plus bswap).
+ */
+static inline __attribute__((always_inline))
+void decode_column(const bitfield_op_t *op, const uint8_t *records, size_t count, size_t stride,
+                   uint64_t *column, unsigned int n, int big)
+{
+    const uint8_t *p = records + op->byte_offset;
+    const unsigned int shift = op->shift;
+    const uint64_t mask = op->mask;
+    const uint64_t sign = op->sign_bit;
+
+    for (size_t i = 0; i < count; i++, p += stride) {
+        uint64_t v = (bitfield_load(p, n, big) >> shift) & mask;
+        column[i] = (v ^ sign) - sign;
+    }
+}
+
+#define COLUMN_CASE(n)                                                                        \
+    case n:                                                                                   \
+        if (big) decode_column(op, records, count, stride, column, n, 1);                     \
+        else decode_column(op, records, count, stride, column, n, 0);                         \
+        break
+
+static void decode_block(const bitfield_layout_t *layout, const uint8_t *records, size_t count,
+                         size_t stride, uint64_t *const *columns, size_t first)
+{
+    const int big = layout->endian == BITFIELD_BIG;
+
+    for (uint32_t c = 0; c < layout->num_ops; c++) {
+        const bitfield_op_t *op = &layout->ops[c];
+        uint64_t *column = columns[c] + first;
+        switch (op->load_bytes) {
+            COLUMN_CASE(1);
+            COLUMN_CASE(2);
+            COLUMN_CASE(3);
+            COLUMN_CASE(4);
+            COLUMN_CASE(5);
+            COLUMN_CASE(6);
+            COLUMN_CASE(7);
+            COLUMN_CASE(8);
+        }
+    }
+}
+
+size_t bitfield_decode_batch(const bitfield_layout_t *layout, const uint8_t *records,
+                             size_t count, size_t stride, uint64_t *const *columns)
+{
+    if (stride == 0) stride = layout->record_bytes;
+    if (stride < layout->record_bytes) return 0;
+
+    if (layout->fast_path) {
+        layout->fast_path(records, count, stride, columns);
+        return count;
+    }
+    for (size_t first = 0; first < count; first += BITFIELD_BLOCK) {
+        size_t n = count - first < BITFIELD_BLOCK ? count - first : BITFIELD_BLOCK;
+        decode_block(layout, records + first * stride, n, stride, columns, first);
+    }
+    return count;
+}
+
+/* =============================
+ * Fast path generation
+ * ============================= */
+
+int bitfield_emit_c(const bitfield_layout_t *layout, const char *function, FILE *out)
+{
+    const int big = layout->endian == BITFIELD_BIG;
+
+    fprintf(out, "/* Generated by bitfield_emit_c() from %s (%s endian, %u byte records). Do not edit. */\n",
+            layout->struct_name, big ? "big" : "little", layout->record_bytes);
+    fprintf(out, "#include \"bitfield_decoder.h\"\n\n");
+    fprintf(out, "const uint64_t %s_signature = 0x%016llXULL;\n\n", function,
+            (unsigned long long)bitfield_layout_signature(layout));
+    fprintf(out, "void %s(const uint8_t *records, size_t count, size_t stride, uint64_t *const *columns)\n{\n",
+            function);
+    fprintf(out, "    for (size_t i = 0; i < count; i++) {\n");
+    fprintf(out, "        const uint8_t *r = records + i * stride;\n");
+    fprintf(out, "        uint64_t v;\n\n");
+
+    for (uint32_t c = 0; c < layout->num_ops; c++) {
+        const bitfield_op_t *op = &layout->ops[c];
+        fprintf(out, "        /* %s */\n", layout->names[c]);
+        fprintf(out, "        v = bitfield_load(r + %u, %u, %d)", op->byte_offset, op->load_bytes, big);
+        if (op->shift) fprintf(out, " >> %u", op->shift);
+        /* The mask is a no-op when the field reaches the top of the load */
+        if (op->shift + op->width < 8u * op->load_bytes) {
+            fprintf(out, " & 0x%llXULL", (unsigned long long)op->mask);
+        }
+        fprintf(out, ";\n");
+        if (op->sign_bit) {
+            fprintf(out, "        columns[%u][i] = (v ^ 0x%llXULL) - 0x%llXULL;\n", c,
+                    (unsigned long long)op->sign_bit, (unsigned long long)op->sign_bit);
+        } else {
+            fprintf(out, "        columns[%u][i] = v;\n", c);
+        }
+    }
+    fprintf(out, "    }\n}\n");
+    return ferror(out) ? -1 : 0;
+}
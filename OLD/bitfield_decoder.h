@@ -0,0 +1,170 @@
+#ifndef BITFIELD_DECODER_H
+#define BITFIELD_DECODER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+/**
+ * Native decoder for the layouts StructParser (bit_field_scanner.py)
+ * exports with to_json().
+ *
+ * A layout is compiled once into a flat table of extraction ops, one per
+ * output column: bit-fields and scalars map to one op, arrays to one op
+ * per element, nested structs are flattened with "outer.inner" names.
+ * Batches of fixed-size records are then decoded column by column, so
+ * each inner loop runs a single op with loop-invariant offsets.
+ *
+ * Byte order follows the rules endian.c demonstrates for GCC:
+ *  - little: bit offset 0 is the least significant bit of byte 0 and
+ *    multi-byte fields are little-endian (x86, ARM).
+ *  - big: bit offset 0 is the most significant bit of byte 0 and
+ *    multi-byte fields are big-endian (network order, PowerPC).
+ *
+ * Hot struct types can skip the table entirely: bitfield_emit_c() writes a
+ * C function with every offset folded to a constant, and
+ * bitfield_layout_set_fast_path() installs it after checking it was
+ * generated from the same layout.
+ */
+
+#define BITFIELD_MAX_NAME 96
+
+typedef enum bitfield_endian_t {
+    BITFIELD_ENDIAN_LAYOUT = -1,    /* use the layout's "endianness" */
+    BITFIELD_LITTLE = 0,
+    BITFIELD_BIG = 1
+} bitfield_endian_t;
+
+/**
+ * One column: load `load_bytes` bytes at `byte_offset` in the layout's
+ * byte order, shift right by `shift`, apply `mask` and sign-extend from
+ * `sign_bit` (0 for unsigned fields).
+ */
+typedef struct bitfield_op_t {
+    uint32_t byte_offset;
+    uint8_t load_bytes;             /* 1..8 */
+    uint8_t shift;
+    uint8_t width;
+    uint8_t is_signed;
+    uint64_t mask;
+    uint64_t sign_bit;
+} bitfield_op_t;
+
+/**
+ * Batch decoder signature shared by the generic path and generated fast
+ * paths. Record i starts at records + i * stride; column c of record i is
+ * written to columns[c][i].
+ */
+typedef void (*bitfield_batch_func_t)(const uint8_t *records, size_t count, size_t stride,
+                                      uint64_t *const *columns);
+
+typedef struct bitfield_layout_t {
+    char struct_name[BITFIELD_MAX_NAME];
+    bitfield_endian_t endian;
+    uint32_t total_bits;
+    uint32_t record_bytes;
+
+    uint32_t num_ops;
+    bitfield_op_t *ops;
+    char (*names)[BITFIELD_MAX_NAME];   /* column names, parallel to ops */
+
+    bitfield_batch_func_t fast_path;    /* NULL: decode through the op table */
+} bitfield_layout_t;
+
+/**
+ * Compile a layout from StructParser JSON. `endian` overrides the
+ * layout's "endianness" unless it is BITFIELD_ENDIAN_LAYOUT. A field is
+ * signed only if the layout marks it "signed": true; its "type" is not
+ * looked at, since StructParser writes "char" for unsigned char too.
+ * Returns 0 on success, -1 on malformed or unsupported layouts.
+ */
+int bitfield_layout_load_json(bitfield_layout_t *layout, const char *json, size_t len,
+                              bitfield_endian_t endian);
+
+/**
+ * Same as bitfield_layout_load_json() for a file written with to_json().
+ */
+int bitfield_layout_load_file(bitfield_layout_t *layout, const char *path,
+                              bitfield_endian_t endian);
+
+/**
+ * Release the op table and names.
+ */
+void bitfield_layout_free(bitfield_layout_t *layout);
+
+/**
+ * Column index of `name` (e.g. "item_3", "values[2]", "arr[1].a.x"), or -1.
+ */
+int bitfield_layout_find(const bitfield_layout_t *layout, const char *name);
+
+/**
+ * Hash of everything that affects decoding: byte order, record size and
+ * the op table. Generated fast paths embed it.
+ */
+uint64_t bitfield_layout_signature(const bitfield_layout_t *layout);
+
+/**
+ * Use `func` for batch decodes. `signature` must be the one emitted with
+ * it; returns -1 and leaves the layout unchanged if it does not match.
+ */
+int bitfield_layout_set_fast_path(bitfield_layout_t *layout, bitfield_batch_func_t func,
+                                  uint64_t signature);
+
+/**
+ * Load up to 8 bytes as an integer of the given byte order.
+ */
+static inline uint64_t bitfield_load(const uint8_t *p, unsigned int n, int big)
+{
+    uint64_t v = 0;
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+    memcpy(&v, p, n);
+    if (big) v = n == 8 ? __builtin_bswap64(v) : __builtin_bswap64(v) >> (64 - 8 * n);
+#else
+    for (unsigned int i = 0; i < n; i++) {
+        v |= (uint64_t)p[i] << (big ? 8 * (n - 1 - i) : 8 * i);
+    }
+#endif
+    return v;
+}
+
+/**
+ * Extract one column from one record. Signed values are returned
+ * sign-extended to 64 bits; read them back through int64_t.
+ */
+static inline uint64_t bitfield_extract(const bitfield_op_t *op, int big, const uint8_t *record)
+{
+    uint64_t v = (bitfield_load(record + op->byte_offset, op->load_bytes, big) >> op->shift) & op->mask;
+    return (v ^ op->sign_bit) - op->sign_bit;
+}
+
+/**
+ * Decode one record into `values` (num_ops entries).
+ */
+void bitfield_decode_record(const bitfield_layout_t *layout, const uint8_t *record,
+                            uint64_t *values);
+
+/**
+ * Decode `count` records spaced `stride` bytes apart (0 for record_bytes)
+ * into columns[0..num_ops-1], each with room for `count` values.
+ * Returns the number of records decoded (0 if stride < record_bytes).
+ */
+size_t bitfield_decode_batch(const bitfield_layout_t *layout, const uint8_t *records,
+                             size_t count, size_t stride, uint64_t *const *columns);
+
+/**
+ * Write a C source file defining `void <function>(...)` with the
+ * bitfield_batch_func_t signature and `const uint64_t <function>_signature`.
+ * Returns 0 on success.
+ */
+int bitfield_emit_c(const bitfield_layout_t *layout, const char *function, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // BITFIELD_DECODER_H
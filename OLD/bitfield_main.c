@@ -0,0 +1,210 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "bitfield_decoder.h"
+#include "platform.h"
+#include "record_emitter.h"
+
+/**
+ * Decode raw records with a layout exported by StructParser.to_json():
+ *
+ *   bitfield_main decode <layout.json> <records|-> [le|be] [max_rows] [csv|json]
+ *   bitfield_main gen <layout.json> <function> [le|be]
+ *   bitfield_main check
+ *
+ * "decode" writes one CSV row or JSON object per record (signed fields
+ * as signed) and the decode and emit rates on stderr; pass "-" for the
+ * byte order and 0 for max_rows to keep the defaults. "gen" writes a
+ * fast path for the layout to stdout; compile it in and install it with
+ * bitfield_layout_set_fast_path(layout, function, function_signature).
+ * "check" decodes a known record with a layout exported by
+ * bit_field_scanner.py and exits nonzero on a mismatch.
+ */
+
+/*
+ * StructParser.to_json("bit_fields_t") for
+ *   typedef struct {
+ *       unsigned char msg_type: 4;
+ *       unsigned char msg_source: 4;
+ *       unsigned char counter;
+ *       unsigned short length;
+ *       signed char delta;
+ *   } bit_fields_t;
+ * with "fields_by_name", which repeats "fields", left out.
+ */
+static const char check_layout[] =
+    "{\"struct_name\": \"bit_fields_t\", \"endianness\": \"little\", \"total_bits\": 40, \"total_bytes\": 5, "
+    "\"fields\": ["
+    "{\"name\": \"msg_type\", \"type\": \"char\", \"bit_offset\": 0, \"signed\": false, \"bit_width\": 4, "
+    "\"mask\": \"0xf\"}, "
+    "{\"name\": \"msg_source\", \"type\": \"char\", \"bit_offset\": 4, \"signed\": false, \"bit_width\": 4, "
+    "\"mask\": \"0xf0\"}, "
+    "{\"name\": \"counter\", \"type\": \"char\", \"bit_offset\": 8, \"signed\": false, \"size\": 8, "
+    "\"mask\": \"0xff00\"}, "
+    "{\"name\": \"length\", \"type\": \"short\", \"bit_offset\": 16, \"signed\": false, \"size\": 16, "
+    "\"mask\": \"0xffff0000\"}, "
+    "{\"name\": \"delta\", \"type\": \"char\", \"bit_offset\": 32, \"signed\": true, \"size\": 8, "
+    "\"mask\": \"0xff00000000\"}]}";
+
+/* The same layout from an exporter that predates "signed": all unsigned */
+static const char check_layout_unmarked[] =
+    "{\"struct_name\": \"bit_fields_t\", \"endianness\": \"little\", \"total_bits\": 40, \"total_bytes\": 5, "
+    "\"fields\": ["
+    "{\"name\": \"msg_type\", \"type\": \"char\", \"bit_offset\": 0, \"bit_width\": 4}, "
+    "{\"name\": \"msg_source\", \"type\": \"char\", \"bit_offset\": 4, \"bit_width\": 4}, "
+    "{\"name\": \"counter\", \"type\": \"char\", \"bit_offset\": 8, \"size\": 8}, "
+    "{\"name\": \"length\", \"type\": \"short\", \"bit_offset\": 16, \"size\": 16}, "
+    "{\"name\": \"delta\", \"type\": \"char\", \"bit_offset\": 32, \"size\": 8}]}";
+
+static int check_layout_values(const char *label, const char *json, const int64_t *expected)
+{
+    /* msg_type 3, msg_source 6, counter 0xF8, length 0xABCD, delta 0xF8 */
+    static const uint8_t record[5] = { 0x63, 0xF8, 0xCD, 0xAB, 0xF8 };
+    static const char *const names[5] = { "msg_type", "msg_source", "counter", "length", "delta" };
+    bitfield_layout_t layout;
+    uint64_t values[5];
+    int failures = 0;
+
+    if (bitfield_layout_load_json(&layout, json, strlen(json), BITFIELD_ENDIAN_LAYOUT) != 0) return 1;
+    if (layout.num_ops != 5) {
+        fprintf(stderr, "[Check] %s: %u columns, expected 5\n", label, layout.num_ops);
+        bitfield_layout_free(&layout);
+        return 1;
+    }
+    bitfield_decode_record(&layout, record, values);
+    for (int i = 0; i < 5; i++) {
+        int c = bitfield_layout_find(&layout, names[i]);
+        int64_t got = c < 0 ? INT64_MIN : (int64_t)values[c];
+        if (got != expected[i]) {
+            fprintf(stderr, "[Check] %s: %s decoded as %lld, expected %lld\n", label, names[i], (long long)got,
+                    (long long)expected[i]);
+            failures++;
+        }
+    }
+    bitfield_layout_free(&layout);
+    printf("[Check] %s: %s\n", label, failures ? "FAILED" : "ok");
+    return failures ? 1 : 0;
+}
+
+static int run_check(void)
+{
+    static const int64_t marked[5] = { 3, 6, 0xF8, 0xABCD, -8 };
+    static const int64_t unmarked[5] = { 3, 6, 0xF8, 0xABCD, 0xF8 };
+    int rc = check_layout_values("exported layout", check_layout, marked);
+    rc |= check_layout_values("layout without \"signed\"", check_layout_unmarked, unmarked);
+    return rc;
+}
+
+static unsigned char *read_all(FILE *in, size_t *len)
+{
+    size_t cap = 1 << 16, n = 0;
+    unsigned char *buf = (unsigned char *)malloc(cap);
+
+    while (buf) {
+        size_t got = fread(buf + n, 1, cap - n, in);
+        n += got;
+        if (got == 0) break;
+        if (n == cap) {
+            unsigned char *bigger = (unsigned char *)realloc(buf, cap * 2);
+            if (!bigger) {
+                free(buf);
+                return NULL;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+    }
+    *len = n;
+    return buf;
+}
+
+static bitfield_endian_t parse_endian(const char *arg)
+{
+    if (arg && strcmp(arg, "le") == 0) return BITFIELD_LITTLE;
+    if (arg && strcmp(arg, "be") == 0) return BITFIELD_BIG;
+    return BITFIELD_ENDIAN_LAYOUT;
+}
+
+static int run_decode(const bitfield_layout_t *layout, const char *path, size_t max_rows,
+                      record_format_t format)
+{
+    FILE *in = strcmp(path, "-") == 0 ? stdin : fopen(path, "rb");
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return 1;
+    }
+    size_t len = 0;
+    unsigned char *data = read_all(in, &len);
+    if (in != stdin) fclose(in);
+    if (!data) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    size_t count = len / layout->record_bytes;
+    uint64_t *storage = (uint64_t *)malloc(sizeof(uint64_t) * (count ? count : 1) * layout->num_ops);
+    uint64_t **columns = (uint64_t **)malloc(sizeof(uint64_t *) * layout->num_ops);
+    if (!storage || !columns) {
+        fprintf(stderr, "Out of memory\n");
+        free(storage);
+        free(columns);
+        free(data);
+        return 1;
+    }
+    for (uint32_t c = 0; c < layout->num_ops; c++) columns[c] = storage + (size_t)c * count;
+
+    unsigned long long start = platform_time_ns();
+    bitfield_decode_batch(layout, data, count, 0, columns);
+    unsigned long long elapsed = platform_time_ns() - start;
+
+    size_t rows = max_rows && max_rows < count ? max_rows : count;
+    record_emitter_t emitter;
+    int rc = record_emitter_init(&emitter, layout, format, stdout, 0);
+    if (rc == 0) {
+        start = platform_time_ns();
+        rc = record_emitter_header(&emitter);
+        if (rc == 0) rc = record_emitter_write_batch(&emitter, columns, rows);
+        if (rc == 0) rc = record_emitter_flush(&emitter);
+        unsigned long long emitted = platform_time_ns() - start;
+        fprintf(stderr, "[Main] %zu records emitted as %s: %llu bytes in %.3f ms (%.1f MB/s)\n",
+                rows, format == RECORD_JSON ? "JSON" : "CSV", (unsigned long long)emitter.bytes_written,
+                (double)emitted / 1e6, emitted ? (double)emitter.bytes_written * 1e3 / (double)emitted : 0.0);
+        record_emitter_destroy(&emitter);
+    }
+
+    fprintf(stderr, "[Main] %zu records of %u bytes, %u columns in %.3f ms (%.1f M records/s)%s\n",
+            count, layout->record_bytes, layout->num_ops, (double)elapsed / 1e6,
+            elapsed ? (double)count * 1e3 / (double)elapsed : 0.0,
+            len % layout->record_bytes ? ", trailing partial record ignored" : "");
+
+    free(columns);
+    free(storage);
+    free(data);
+    return rc == 0 ? 0 : 1;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 2 && strcmp(argv[1], "check") == 0) return run_check();
+    if (argc < 4 || (strcmp(argv[1], "decode") != 0 && strcmp(argv[1], "gen") != 0)) {
+        fprintf(stderr, "usage: %s decode <layout.json> <records|-> [le|be] [max_rows] [csv|json]\n", argv[0]);
+        fprintf(stderr, "       %s gen <layout.json> <function> [le|be]\n", argv[0]);
+        fprintf(stderr, "       %s check\n", argv[0]);
+        return 1;
+    }
+
+    bitfield_layout_t layout;
+    if (bitfield_layout_load_file(&layout, argv[2], parse_endian(argc > 4 ? argv[4] : NULL)) != 0) {
+        return 1;
+    }
+
+    int rc;
+    if (strcmp(argv[1], "gen") == 0) {
+        rc = bitfield_emit_c(&layout, argv[3], stdout) == 0 ? 0 : 1;
+    } else {
+        record_format_t format = argc > 6 && strcmp(argv[6], "json") == 0 ? RECORD_JSON : RECORD_CSV;
+        rc = run_decode(&layout, argv[3], argc > 5 ? strtoull(argv[5], NULL, 0) : 0, format);
+    }
+    bitfield_layout_free(&layout);
+    return rc;
+}
@@ -0,0 +1,101 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "packet_capture.h"
+
+/**
+ * Print a VLAN histogram of raw traffic on an interface:
+ *
+ *   capture_main <ifname> [sockets] [pool_threads]
+ *
+ * No special hardware is needed; a veth pair is enough (as root):
+ *
+ *   ip link add cap0 type veth peer name cap1
+ *   ip link add link cap1 name cap1.100 type vlan id 100 egress-qos-map 0:5
+ *   ip link set cap0 up; ip link set cap1 up; ip link set cap1.100 up
+ *   ip addr add 10.99.0.1/24 dev cap1.100
+ *   ./capture_main cap0 2 2 &
+ *   ping -c 100 -i 0.01 10.99.0.2     # ARP on VLAN 100, PCP 5
+ *   ip link del cap0
+ *
+ * The capture side sees frames tagged 0x8100 with VID 100 and PCP 5.
+ */
+
+static volatile sig_atomic_t g_keepRunning = 1;
+
+void handle_sigint(int sig)
+{
+    (void)sig; // unused
+    g_keepRunning = 0;
+}
+
+/* Shared by all pool threads; updated with atomics */
+static unsigned long g_by_vid[4096];
+static unsigned long g_untagged;
+static unsigned long g_by_pcp[8];
+
+static void on_frame(void *ctx, const eth_frame_view_t *frame)
+{
+    (void)ctx;
+    if (frame->vlan_count == 0) {
+        __atomic_fetch_add(&g_untagged, 1, __ATOMIC_RELAXED);
+        return;
+    }
+    uint16_t tci = frame->vlan_tci[0];
+    __atomic_fetch_add(&g_by_vid[ETH_TCI_VID(tci)], 1, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&g_by_pcp[ETH_TCI_PCP(tci)], 1, __ATOMIC_RELAXED);
+}
+
+/**
+ * Pool task body: one call per retired ring block.
+ */
+static void on_block(void *ctx, const capture_block_t *block)
+{
+    capture_block_foreach(block, on_frame, ctx);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <ifname> [sockets] [pool_threads]\n", argv[0]);
+        return 1;
+    }
+    signal(SIGINT, handle_sigint);
+
+    capture_config_t config;
+    capture_config_default(&config, argv[1]);
+    if (argc > 2) config.num_sockets = atoi(argv[2]);
+    int threads = argc > 3 ? atoi(argv[3]) : 4;
+
+    thread_pool_t pool;
+    thread_pool_init(&pool, threads);
+
+    capture_t cap;
+    if (capture_start(&cap, &config, &pool, on_block, NULL) != 0) {
+        thread_pool_shutdown(&pool);
+        return 1;
+    }
+    printf("[Main] Capturing on %s with %d sockets. Press Ctrl + C to stop.\n",
+           argv[1], cap.num_rings);
+
+    while (g_keepRunning) {
+        platform_sleep_ms(1000);
+        capture_stats_t s;
+        capture_get_stats(&cap, &s);
+        printf("[Main] packets=%llu blocks=%llu drops=%llu untagged=%lu\n",
+               (unsigned long long)s.packets, (unsigned long long)s.blocks,
+               (unsigned long long)s.kernel_drops, g_untagged);
+    }
+
+    capture_stop(&cap);
+    thread_pool_shutdown(&pool);
+
+    for (int vid = 0; vid < 4096; vid++) {
+        if (g_by_vid[vid]) printf("  VID %4d: %lu frames\n", vid, g_by_vid[vid]);
+    }
+    for (int pcp = 0; pcp < 8; pcp++) {
+        if (g_by_pcp[pcp]) printf("  PCP %d: %lu frames\n", pcp, g_by_pcp[pcp]);
+    }
+    return 0;
+}
@@ -0,0 +1,58 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <signal.h>
+#include "command_server.h"
+
+/**
+ * Drop-in for command_interface.py:
+ *
+ *   command_main [port] [loops]
+ *
+ * Commands are printed from the thread pool; ACKs go out from the loops.
+ */
+
+static volatile sig_atomic_t g_keepRunning = 1;
+
+void handle_sigint(int sig)
+{
+    (void)sig; // unused
+    g_keepRunning = 0;
+}
+
+static void print_command(void *ctx, uint32_t index, const char *message, size_t len)
+{
+    (void)ctx;
+    (void)len;
+    printf("Received command (index %u): %s\n", index, message);
+}
+
+int main(int argc, char **argv)
+{
+    signal(SIGINT, handle_sigint);
+
+    thread_pool_t pool;
+    thread_pool_init(&pool, 2);
+
+    command_server_config_t config = { 0 };
+    config.port = argc > 1 ? (unsigned short)atoi(argv[1]) : COMMAND_DEFAULT_PORT;
+    config.num_loops = argc > 2 ? atoi(argv[2]) : 1;
+    config.pool = &pool;
+    config.handler = print_command;
+
+    command_server_t server;
+    if (command_server_start(&server, &config) != 0) {
+        thread_pool_shutdown(&pool);
+        return 1;
+    }
+    printf("Server listening on port %u...\n", config.port);
+
+    while (g_keepRunning) {
+        platform_sleep_ms(500);
+    }
+
+    command_server_stop(&server);
+    thread_pool_shutdown(&pool);
+    printf("Sent %u ACKs in %llu writev calls\n", command_server_ack_count(),
+           (unsigned long long)command_server_writev_count());
+    return 0;
+}
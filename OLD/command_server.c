@@ -0,0 +1,217 @@
+#include "command_server.h"
+
+#include <errno.h>
+#include <limits.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <sys/uio.h>
+
+#ifndef IOV_MAX
+#define IOV_MAX 1024
+#endif
+
+/* "ACK " + up to 10 digits, plus the 12-byte header and 4-byte end marker */
+#define ACK_SLOT_SIZE 32
+
+/* Global ACK index, shared by every loop thread */
+static uint32_t g_ack_counter = 0;
+static uint64_t g_writev_calls = 0;
+
+/* =============================
+ * Per-connection state
+ * ============================= */
+
+/* ACKs built during the current iteration, each in its own fixed slot */
+typedef struct command_conn_t {
+    uint8_t (*slots)[ACK_SLOT_SIZE];
+    uint8_t *lengths;
+    int count;
+    int capacity;
+} command_conn_t;
+
+typedef struct command_job_t {
+    command_server_t *server;
+    uint32_t index;
+    size_t len;
+    char message[];
+} command_job_t;
+
+static uint8_t *next_slot(command_conn_t *state, uint8_t **length_out)
+{
+    if (state->count == state->capacity) {
+        int cap = state->capacity ? state->capacity * 2 : 64;
+        uint8_t (*slots)[ACK_SLOT_SIZE] = realloc(state->slots, sizeof(*slots) * cap);
+        if (!slots) return NULL;
+        state->slots = slots;
+        uint8_t *lengths = (uint8_t *)realloc(state->lengths, cap);
+        if (!lengths) return NULL;
+        state->lengths = lengths;
+        state->capacity = cap;
+    }
+    *length_out = &state->lengths[state->count];
+    return state->slots[state->count++];
+}
+
+/* =============================
+ * Relay callbacks
+ * ============================= */
+
+static void command_task(void *arg)
+{
+    command_job_t *job = (command_job_t *)arg;
+    command_server_config_t *cfg = &job->server->config;
+
+    cfg->handler(cfg->handler_ctx, job->index, job->message, job->len);
+    free(job);
+}
+
+static void on_open(relay_conn_t *conn, void *user)
+{
+    (void)user;
+    command_conn_t *state = (command_conn_t *)calloc(1, sizeof(*state));
+    if (!state) {
+        relay_conn_close(conn);
+        return;
+    }
+    relay_conn_set_user(conn, state);
+}
+
+static void on_close(relay_conn_t *conn, void *user)
+{
+    (void)user;
+    command_conn_t *state = (command_conn_t *)relay_conn_get_user(conn);
+    if (!state) return;
+    free(state->slots);
+    free(state->lengths);
+    free(state);
+    relay_conn_set_user(conn, NULL);
+}
+
+static void on_frame(relay_conn_t *conn, const frame_view_t *frame, void *user)
+{
+    command_server_t *server = (command_server_t *)user;
+    command_conn_t *state = (command_conn_t *)relay_conn_get_user(conn);
+    if (!state) return;
+
+    /* Build the ACK in place; it is written in on_flush() */
+    uint8_t *length;
+    uint8_t *slot = next_slot(state, &length);
+    if (!slot) {
+        relay_conn_close(conn);
+        return;
+    }
+    frame_format_t format = frame_format_command();
+    uint32_t ack_index = __atomic_add_fetch(&g_ack_counter, 1, __ATOMIC_RELAXED);
+    int text = snprintf((char *)slot + 12, ACK_SLOT_SIZE - 12, "ACK %u", frame->sequence);
+    *length = (uint8_t)frame_encode(&format, slot, ACK_SLOT_SIZE, ack_index,
+                                    slot + 12, (uint32_t)text);
+
+    if (server->config.pool && server->config.handler) {
+        command_job_t *job = (command_job_t *)malloc(sizeof(*job) + frame->body_length + 1);
+        if (!job) return;
+        job->server = server;
+        job->index = frame->sequence;
+        job->len = frame->body_length;
+        memcpy(job->message, frame->body, frame->body_length);
+        job->message[frame->body_length] = '\0';
+        if (thread_pool_add_task(server->config.pool, command_task, job) != 0) command_task(job);
+    }
+}
+
+static void on_flush(relay_conn_t *conn, void *user)
+{
+    (void)user;
+    command_conn_t *state = (command_conn_t *)relay_conn_get_user(conn);
+    if (!state || state->count == 0) return;
+
+    int done = 0;
+    size_t partial = 0;
+
+    /* Earlier output still queued: append behind it to keep ACKs in order */
+    if (relay_conn_pending_output(conn) == 0) {
+        struct iovec iov[IOV_MAX < 1024 ? IOV_MAX : 1024];
+        int fd = relay_conn_fd(conn);
+
+        while (done < state->count) {
+            int n = state->count - done;
+            if (n > (int)(sizeof(iov) / sizeof(iov[0]))) n = (int)(sizeof(iov) / sizeof(iov[0]));
+            size_t total = 0;
+            for (int i = 0; i < n; i++) {
+                iov[i].iov_base = state->slots[done + i];
+                iov[i].iov_len = state->lengths[done + i];
+                total += iov[i].iov_len;
+            }
+
+            /* sendmsg rather than writev, for MSG_NOSIGNAL: a vanished peer must not raise SIGPIPE */
+            struct msghdr msg;
+            memset(&msg, 0, sizeof(msg));
+            msg.msg_iov = iov;
+            msg.msg_iovlen = (size_t)n;
+            ssize_t rc = sendmsg(fd, &msg, MSG_NOSIGNAL);
+            if (rc < 0 && errno == EINTR) continue;
+            __atomic_add_fetch(&g_writev_calls, 1, __ATOMIC_RELAXED);
+            if (rc <= 0) break;
+            relay_conn_note_output(conn, (size_t)rc);
+
+            /* Advance past whole ACKs, remember how far into a split one we got */
+            size_t left = (size_t)rc;
+            while (done < state->count && left >= state->lengths[done]) {
+                left -= state->lengths[done];
+                done++;
+            }
+            partial = left;
+            if ((size_t)rc < total) break;
+        }
+    }
+
+    /* Socket full (or output already queued): let the relay buffer the rest */
+    for (int i = done; i < state->count; i++) {
+        relay_conn_send(conn, state->slots[i] + partial, state->lengths[i] - partial);
+        partial = 0;
+    }
+    relay_conn_note_frames(conn, (uint32_t)state->count);
+    state->count = 0;
+}
+
+/* =============================
+ * Public API
+ * ============================= */
+
+int command_server_start(command_server_t *server, const command_server_config_t *config)
+{
+    if (!server || !config) return -1;
+
+    memset(server, 0, sizeof(*server));
+    server->config = *config;
+
+    relay_server_config_t relay;
+    relay_server_config_default(&relay, config->port ? config->port : COMMAND_DEFAULT_PORT);
+    relay.num_loops = config->num_loops;
+    relay.format = frame_format_command();
+    if (config->max_frame_length) relay.format.max_length = config->max_frame_length;
+    relay.on_open = on_open;
+    relay.on_close = on_close;
+    relay.on_frame = on_frame;
+    relay.on_flush = on_flush;
+    relay.user = server;
+    relay.pool = config->pool;
+    return relay_server_start(&server->relay, &relay);
+}
+
+void command_server_stop(command_server_t *server)
+{
+    if (!server) return;
+    relay_server_stop(&server->relay);
+}
+
+uint32_t command_server_ack_count(void)
+{
+    return __atomic_load_n(&g_ack_counter, __ATOMIC_RELAXED);
+}
+
+uint64_t command_server_writev_count(void)
+{
+    return __atomic_load_n(&g_writev_calls, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,72 @@
+#ifndef COMMAND_SERVER_H
+#define COMMAND_SERVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "relay_server.h"
+
+/**
+ * Native implementation of the command/ACK protocol from command_interface.py,
+ * built on relay_server (loops, frame parser) and thread_pool_t.
+ *
+ * Command:  START | length (16 + N) | index | N bytes ASCII | END
+ * ACK:      START | length (16 + M) | ack counter | "ACK <index>" | END
+ *
+ * Unlike the Python server, clients may pipeline: every complete command in
+ * a read is acknowledged, and all ACKs produced for a connection during one
+ * loop iteration leave in a single writev(). The ACK counter is one global
+ * atomic shared by all loops, so ACK indices stay unique without a lock.
+ */
+
+#define COMMAND_DEFAULT_PORT 4100
+
+/**
+ * Called on a pool thread with a copy of the command text (NUL-terminated).
+ * The ACK has already been queued; commands are acknowledged on receipt.
+ */
+typedef void (*command_handler_t)(void *ctx, uint32_t index, const char *message, size_t len);
+
+typedef struct command_server_config_t {
+    unsigned short port;
+    int num_loops;
+    uint32_t max_frame_length;      /* 0: frame_format_command()'s */
+    thread_pool_t *pool;
+    command_handler_t handler;
+    void *handler_ctx;
+} command_server_config_t;
+
+typedef struct command_server_t {
+    relay_server_t relay;
+    command_server_config_t config;
+} command_server_t;
+
+/**
+ * Start listening. Returns 0 on success.
+ */
+int command_server_start(command_server_t *server, const command_server_config_t *config);
+
+/**
+ * Stop the loops and close every connection. Stop before the pool.
+ */
+void command_server_stop(command_server_t *server);
+
+/**
+ * Total ACKs sent so far (the next ACK index is this plus one).
+ */
+uint32_t command_server_ack_count(void);
+
+/**
+ * Number of writev() calls used to send them, for checking coalescing.
+ */
+uint64_t command_server_writev_count(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMMAND_SERVER_H
@@ -0,0 +1,155 @@
+#include <ctype.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "file_compare.h"
+#include "platform.h"
+#include "threadpool.h"
+
+/**
+ * Compare the files listed (one path per line) in a list file:
+ *
+ *   compare_main <file_list> [exact] [threads]
+ *
+ * Prints the sets of identical files and the unique files in the same
+ * form as compare_files.py, which ignores a UTF-8 BOM and line-ending
+ * differences. "exact" compares raw bytes instead, which lets files of a
+ * unique size be skipped without being read. Pass "-" to keep the
+ * default mode and 0 threads for one per CPU.
+ */
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    size_t cap = 1 << 16, n = 0, got;
+    char *buf;
+
+    if (!f) return NULL;
+    buf = (char *)malloc(cap + 1);
+    while (buf && (got = fread(buf + n, 1, cap - n, f)) > 0) {
+        n += got;
+        if (n == cap) {
+            char *bigger = (char *)realloc(buf, cap * 2 + 1);
+            if (!bigger) {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+    }
+    fclose(f);
+    if (buf) buf[n] = '\0';
+    *len = n;
+    return buf;
+}
+
+/* Splits `text` in place into stripped, non-empty lines */
+static const char **split_lines(char *text, size_t len, size_t *count)
+{
+    size_t cap = 64, n = 0;
+    const char **lines = (const char **)malloc(sizeof(char *) * cap);
+    char *p = text, *end = text + len;
+
+    while (lines && p < end) {
+        char *eol = (char *)memchr(p, '\n', (size_t)(end - p));
+        char *stop = eol ? eol : end;
+        while (p < stop && isspace((unsigned char)*p)) p++;
+        char *q = stop;
+        while (q > p && isspace((unsigned char)q[-1])) q--;
+        *q = '\0';
+        if (q > p) {
+            if (n == cap) {
+                const char **bigger = (const char **)realloc(lines, sizeof(char *) * cap * 2);
+                if (!bigger) {
+                    free(lines);
+                    return NULL;
+                }
+                lines = bigger;
+                cap *= 2;
+            }
+            lines[n++] = p;
+        }
+        p = stop + 1;
+    }
+    *count = n;
+    return lines;
+}
+
+static void print_results(const file_compare_t *fc)
+{
+    for (size_t i = 0; i < fc->num_files; i++) {
+        const file_entry_t *file = &fc->files[i];
+        if (file->error == ENOENT) printf("Error: File not found: %s\n", file->path);
+        else if (file->error == EACCES) printf("Error: Permission denied: %s\n", file->path);
+        else if (file->error) printf("Error: %s: %s\n", strerror(file->error), file->path);
+    }
+
+    printf("\nIdentical Files:\n");
+    if (fc->num_groups == 0) printf("  None\n");
+    for (uint32_t g = 0; g < fc->num_groups; g++) {
+        printf("  ");
+        for (uint32_t m = fc->group_start[g]; m < fc->group_start[g + 1]; m++) {
+            printf("%s%s", m > fc->group_start[g] ? ", " : "", fc->files[fc->group_members[m]].path);
+        }
+        printf("\n");
+    }
+
+    size_t unique = 0;
+    printf("\nUnique Files:\n");
+    for (size_t i = 0; i < fc->num_files; i++) {
+        const file_entry_t *file = &fc->files[i];
+        if (file->error || file->group != FILE_COMPARE_UNIQUE) continue;
+        printf("  %s\n", file->path);
+        unique++;
+    }
+    if (unique == 0) printf("  None\n");
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file_list> [exact|-] [threads]\n", argv[0]);
+        return 1;
+    }
+    file_compare_mode_t mode = argc > 2 && strcmp(argv[2], "exact") == 0 ? FILE_COMPARE_EXACT
+                                                                          : FILE_COMPARE_NORMALIZED;
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+    if (threads <= 0) threads = platform_cpu_count();
+
+    size_t len = 0, count = 0;
+    char *text = read_file(argv[1], &len);
+    if (!text) {
+        printf("Error: File list not found: %s\n", argv[1]);
+        return 1;
+    }
+    const char **paths = split_lines(text, len, &count);
+    if (!paths) {
+        fprintf(stderr, "Out of memory\n");
+        free(text);
+        return 1;
+    }
+
+    thread_pool_t pool;
+    thread_pool_init(&pool, threads);
+
+    file_compare_t fc;
+    unsigned long long start = platform_time_ns();
+    int rc = file_compare_run(&fc, paths, count, mode, &pool);
+    unsigned long long elapsed = platform_time_ns() - start;
+    if (rc == 0) {
+        print_results(&fc);
+        fprintf(stderr, "[Main] %zu files (%s) on %d threads: %u identical sets, %llu skipped unread, "
+                "%.1f MB read in %.3f ms\n", fc.num_files, mode == FILE_COMPARE_EXACT ? "exact" : "normalised",
+                threads, fc.num_groups, (unsigned long long)fc.files_skipped, (double)fc.bytes_read / 1e6,
+                (double)elapsed / 1e6);
+    }
+
+    file_compare_free(&fc);
+    thread_pool_shutdown(&pool);
+    free(paths);
+    free(text);
+    return rc == 0 ? 0 : 1;
+}
@@ -0,0 +1,141 @@
+#include "compress_controller.h"
+
+#include <string.h>
+
+/* Ladder, fastest first, with rough zlib throughput and ratio on logs to start from */
+static const int ladder_levels[COMPRESS_CONTROLLER_RUNGS] = { 1, 2, 4, 6, 9 };
+static const double seed_mb_per_s[COMPRESS_CONTROLLER_RUNGS] = { 90.0, 80.0, 50.0, 30.0, 10.0 };
+static const double seed_ratio[COMPRESS_CONTROLLER_RUNGS] = { 5.0, 5.2, 5.8, 6.2, 6.4 };
+
+/* Rung of Z_DEFAULT_COMPRESSION, where the controller starts */
+#define DEFAULT_RUNG 3
+#define TOP_RUNG (COMPRESS_CONTROLLER_RUNGS - 1)
+
+void compress_controller_init(compress_controller_t *ctl, double drain_target_s)
+{
+    memset(ctl, 0, sizeof(*ctl));
+    for (int i = 0; i < COMPRESS_CONTROLLER_RUNGS; i++) {
+        ctl->rungs[i].level = ladder_levels[i];
+        ctl->rungs[i].mb_per_s = seed_mb_per_s[i];
+        ctl->rungs[i].ratio = seed_ratio[i];
+    }
+    ctl->rung = DEFAULT_RUNG;
+    ctl->drain_target_s = drain_target_s > 0.0 ? drain_target_s : COMPRESS_CONTROLLER_DRAIN_S;
+    ctl->busy_load = COMPRESS_CONTROLLER_BUSY_LOAD;
+    ctl->idle_load = COMPRESS_CONTROLLER_IDLE_LOAD;
+}
+
+void compress_controller_set_policy(compress_controller_t *ctl, double drain_target_s, double busy_load,
+                                    double idle_load)
+{
+    ctl->drain_target_s = drain_target_s > 0.0 ? drain_target_s : COMPRESS_CONTROLLER_DRAIN_S;
+    ctl->busy_load = busy_load;
+    ctl->idle_load = idle_load;
+}
+
+void compress_controller_publish(compress_controller_t *ctl, stats_shard_t *shard)
+{
+    ctl->stats = shard;
+}
+
+static void count(compress_controller_t *ctl, stat_id_t id, uint64_t n)
+{
+    if (ctl->stats) stats_add(ctl->stats, id, n);
+}
+
+static int rung_of(int level)
+{
+    for (int i = 0; i < COMPRESS_CONTROLLER_RUNGS; i++) {
+        if (ladder_levels[i] == level) return i;
+    }
+    return -1;
+}
+
+int compress_controller_choose(compress_controller_t *ctl, uint64_t backlog_bytes, double load)
+{
+    /* Highest rung below the top that drains the backlog in time; rung 0 if none does */
+    int target = 0;
+    for (int i = TOP_RUNG - 1; i > 0; i--) {
+        const double seconds = (double)backlog_bytes / (ctl->rungs[i].mb_per_s * 1e6);
+        if (seconds <= ctl->drain_target_s) {
+            target = i;
+            break;
+        }
+    }
+    if (load > ctl->busy_load && target > 0) {
+        target--;
+        ctl->busy_decisions++;
+        count(ctl, STAT_COMPRESS_BUSY_DECISIONS, 1);
+    }
+
+    /* Down at once; up one rung at a time and only while the backlog shrinks or holds */
+    if (target < ctl->rung) {
+        ctl->rung = target;
+        ctl->step_downs++;
+        count(ctl, STAT_COMPRESS_STEP_DOWNS, 1);
+    } else if (target > ctl->rung && backlog_bytes <= ctl->last_backlog) {
+        ctl->rung++;
+        ctl->step_ups++;
+        count(ctl, STAT_COMPRESS_STEP_UPS, 1);
+    }
+    ctl->last_backlog = backlog_bytes;
+    ctl->decisions++;
+    ctl->rungs[ctl->rung].chosen++;
+    count(ctl, STAT_COMPRESS_DECISIONS, 1);
+    return ctl->rungs[ctl->rung].level;
+}
+
+void compress_controller_record(compress_controller_t *ctl, int level, uint64_t bytes_in, uint64_t bytes_out,
+                                unsigned long long elapsed_ns)
+{
+    const int i = rung_of(level);
+    if (i < 0 || bytes_in == 0 || bytes_out == 0 || elapsed_ns == 0) return;
+
+    compress_rung_t *rung = &ctl->rungs[i];
+    const double mb_per_s = (double)bytes_in / 1e6 / ((double)elapsed_ns / 1e9);
+    const double ratio = (double)bytes_in / (double)bytes_out;
+    if (rung->measured) {
+        rung->mb_per_s += COMPRESS_CONTROLLER_ALPHA * (mb_per_s - rung->mb_per_s);
+        rung->ratio += COMPRESS_CONTROLLER_ALPHA * (ratio - rung->ratio);
+    } else {
+        rung->mb_per_s = mb_per_s;
+        rung->ratio = ratio;
+        rung->measured = 1;
+    }
+    rung->files++;
+    rung->bytes_in += bytes_in;
+    rung->bytes_out += bytes_out;
+    rung->busy_ns += elapsed_ns;
+    count(ctl, STAT_COMPRESS_LEVEL(i, STAT_LEVEL_FILES), 1);
+    count(ctl, STAT_COMPRESS_LEVEL(i, STAT_LEVEL_BYTES_IN), bytes_in);
+    count(ctl, STAT_COMPRESS_LEVEL(i, STAT_LEVEL_BYTES_OUT), bytes_out);
+    count(ctl, STAT_COMPRESS_LEVEL(i, STAT_LEVEL_BUSY_US), elapsed_ns / 1000);
+}
+
+int compress_controller_idle(const compress_controller_t *ctl, uint64_t backlog_bytes, double load)
+{
+    /* An unknown load is not an idle one */
+    if (backlog_bytes > 0 || load < 0.0 || load > ctl->idle_load) return 0;
+    return ctl->rungs[TOP_RUNG].level;
+}
+
+void compress_controller_recompressed(compress_controller_t *ctl, uint64_t old_size, uint64_t new_size)
+{
+    ctl->recompressions++;
+    count(ctl, STAT_COMPRESS_RECOMPRESSIONS, 1);
+    if (new_size < old_size) ctl->recompress_saved += old_size - new_size;
+}
+
+void compress_controller_print(const compress_controller_t *ctl, FILE *out)
+{
+    fprintf(out, "level %d: %llu decisions, %llu down, %llu up, %llu for CPU load; %llu recompressed, %llu bytes saved\n",
+            ctl->rungs[ctl->rung].level, (unsigned long long)ctl->decisions, (unsigned long long)ctl->step_downs,
+            (unsigned long long)ctl->step_ups, (unsigned long long)ctl->busy_decisions,
+            (unsigned long long)ctl->recompressions, (unsigned long long)ctl->recompress_saved);
+    for (int i = 0; i < COMPRESS_CONTROLLER_RUNGS; i++) {
+        const compress_rung_t *rung = &ctl->rungs[i];
+        fprintf(out, "  level %d: chosen %-6llu files %-6llu %8.1f MB/s %5.2fx%s\n", rung->level,
+                (unsigned long long)rung->chosen, (unsigned long long)rung->files, rung->mb_per_s, rung->ratio,
+                rung->measured ? "" : " (seed)");
+    }
+}
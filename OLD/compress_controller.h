@@ -0,0 +1,130 @@
+#ifndef COMPRESS_CONTROLLER_H
+#define COMPRESS_CONTROLLER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "stats_counters.h"
+
+/**
+ * Picks the compression level for each log from the backlog waiting
+ * behind it.
+ *
+ * The levels form a ladder from fastest to smallest. Each rung keeps a
+ * moving average of the throughput and ratio measured on the logs it
+ * compressed, seeded with typical zlib figures until it has some. For
+ * every log the controller takes the highest rung whose throughput
+ * clears the backlog within `drain_target_s`, so a growing backlog
+ * pushes it down the ladder at once. It climbs back one rung per log,
+ * and only while the backlog is not growing, so it does not oscillate.
+ * When the CPUs are already busy (load per CPU above `busy_load`) it
+ * steps one rung further down.
+ *
+ * The top rung is not used for fresh logs. When the backlog is empty
+ * and the system idle, compress_controller_idle() allows logs written at
+ * lower levels to be recompressed at the top level in the background.
+ *
+ * With a stats shard attached (compress_controller_publish()) every
+ * decision, step and measurement is also counted there, for the
+ * exporter: STAT_COMPRESS_* and, per rung, STAT_COMPRESS_LEVEL().
+ */
+
+#define COMPRESS_CONTROLLER_RUNGS STATS_COMPRESS_LEVELS
+#define COMPRESS_CONTROLLER_DRAIN_S 60.0
+#define COMPRESS_CONTROLLER_BUSY_LOAD 0.9
+#define COMPRESS_CONTROLLER_IDLE_LOAD 0.3
+
+/* Weight of the newest measurement in the moving averages */
+#define COMPRESS_CONTROLLER_ALPHA 0.3
+
+typedef struct compress_rung_t {
+    int level;                      /* zlib level */
+    double mb_per_s;                /* uncompressed MB per second, moving average */
+    double ratio;                   /* uncompressed / compressed, moving average */
+    int measured;                   /* the averages come from real logs, not the seed */
+    uint64_t files;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t busy_ns;
+    uint64_t chosen;                /* times picked for a fresh log */
+} compress_rung_t;
+
+typedef struct compress_controller_t {
+    compress_rung_t rungs[COMPRESS_CONTROLLER_RUNGS];
+    int rung;                       /* current, below the top one */
+    double drain_target_s;
+    double busy_load;
+    double idle_load;
+    uint64_t last_backlog;
+
+    uint64_t decisions;
+    uint64_t step_downs;
+    uint64_t step_ups;
+    uint64_t busy_decisions;        /* decisions that stepped down for CPU load */
+    uint64_t recompressions;
+    uint64_t recompress_saved;      /* compressed bytes saved by recompression */
+
+    stats_shard_t *stats;           /* counted here too, if set */
+} compress_controller_t;
+
+/**
+ * Start at zlib's default level. `drain_target_s` 0 selects
+ * COMPRESS_CONTROLLER_DRAIN_S.
+ */
+void compress_controller_init(compress_controller_t *ctl, double drain_target_s);
+
+/**
+ * Replace the drain target and load thresholds, e.g. from a reloaded
+ * config; the measurements are kept. `drain_target_s` 0 selects
+ * COMPRESS_CONTROLLER_DRAIN_S.
+ */
+void compress_controller_set_policy(compress_controller_t *ctl, double drain_target_s, double busy_load,
+                                    double idle_load);
+
+/**
+ * Count into `shard` from now on, or stop counting if NULL. The shard
+ * belongs to the thread that calls the controller.
+ */
+void compress_controller_publish(compress_controller_t *ctl, stats_shard_t *shard);
+
+/**
+ * Level for the next log, given the uncompressed bytes waiting
+ * (including that log) and platform_cpu_load() (negative: unknown).
+ */
+int compress_controller_choose(compress_controller_t *ctl, uint64_t backlog_bytes, double load);
+
+/**
+ * Feed back one compression at `level`: its input and output sizes and
+ * the time it took.
+ */
+void compress_controller_record(compress_controller_t *ctl, int level, uint64_t bytes_in, uint64_t bytes_out,
+                                unsigned long long elapsed_ns);
+
+/**
+ * Level to recompress older logs at when nothing is waiting and the
+ * CPUs are known to be idle, or 0 if now is not the time (including
+ * when `load` is negative: unknown).
+ */
+int compress_controller_idle(const compress_controller_t *ctl, uint64_t backlog_bytes, double load);
+
+/**
+ * Count a background recompression that took a log from `old_size` to
+ * `new_size` compressed bytes.
+ */
+void compress_controller_recompressed(compress_controller_t *ctl, uint64_t old_size, uint64_t new_size);
+
+/**
+ * Decisions and per-level measurements, one line per level.
+ */
+void compress_controller_print(const compress_controller_t *ctl, FILE *out);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // COMPRESS_CONTROLLER_H
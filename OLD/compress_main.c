@@ -0,0 +1,110 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "compress_controller.h"
+#include "platform.h"
+#include "stats_counters.h"
+#include "xoshiro.h"
+
+/**
+ * Compression level controller demo:
+ *
+ *   compress_main [log_kb] [arrivals_per_step] [growing_steps] [drain_s]
+ *
+ * Logs of `log_kb` of generated text arrive `arrivals_per_step` at a time
+ * for `growing_steps` steps, then stop. Each step compresses one log for
+ * real with zlib at the level the controller picks and feeds the time
+ * back, so the backlog first grows, pushing the level down, and then
+ * drains, letting it climb again. The decisions are counted in a stats
+ * registry, as log_compression_thread() does, and its snapshot is printed
+ * at the end next to the controller's own summary.
+ */
+
+static const char *const words[] = { "GET", "POST", "/api/v1/items", "/health", "200", "404", "500",
+                                     "client", "timeout", "retry", "user=42", "ok", "cache", "miss" };
+
+/* Log-like lines: a timestamp, then a few words picked at random */
+static size_t fill_log(char *buf, size_t size, xoshiro_t *rng)
+{
+    size_t len = 0;
+    unsigned int second = 0;
+    while (len + 128 < size) {
+        len += (size_t)snprintf(buf + len, size - len, "2024-05-01 10:%02u:%02u.%03u INFO", second / 60 % 60,
+                                second % 60, (unsigned int)xoshiro_range(rng, 0, 999));
+        uint32_t n = xoshiro_range(rng, 3, 8);
+        for (uint32_t i = 0; i < n; i++) {
+            len += (size_t)snprintf(buf + len, size - len, " %s",
+                                    words[xoshiro_range(rng, 0, sizeof(words) / sizeof(words[0]) - 1)]);
+        }
+        buf[len++] = '\n';
+        second++;
+    }
+    return len;
+}
+
+int main(int argc, char **argv)
+{
+    size_t log_bytes = (size_t)(argc > 1 ? atoi(argv[1]) : 1024) * 1024;
+    int arrivals = argc > 2 ? atoi(argv[2]) : 2;
+    int growing_steps = argc > 3 ? atoi(argv[3]) : 20;
+    double drain_s = argc > 4 ? atof(argv[4]) : 0.2;
+    if (log_bytes == 0 || arrivals < 0 || growing_steps < 0) {
+        fprintf(stderr, "Usage: %s [log_kb] [arrivals_per_step] [growing_steps] [drain_s]\n", argv[0]);
+        return 1;
+    }
+
+    xoshiro_t rng;
+    xoshiro_seed(&rng, 0x5EEDF00DULL);
+    char *log = (char *)malloc(log_bytes);
+    uLongf out_cap = compressBound((uLong)log_bytes);
+    Bytef *out = (Bytef *)malloc(out_cap);
+    if (!log || !out) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    size_t len = fill_log(log, log_bytes, &rng);
+
+    stats_registry_t registry;
+    if (stats_registry_init(&registry) != 0) return 1;
+    compress_controller_t ctl;
+    compress_controller_init(&ctl, drain_s);
+    compress_controller_publish(&ctl, stats_register_shard(&registry));
+
+    /* One log arrives as a step starts; the backlog counts it until compressed */
+    int waiting = 0;
+    for (int step = 0; step < growing_steps || waiting > 0; step++) {
+        if (step < growing_steps) waiting += arrivals;
+        if (waiting == 0) continue;
+
+        uint64_t backlog = (uint64_t)waiting * len;
+        int level = compress_controller_choose(&ctl, backlog, platform_cpu_load());
+
+        uLongf out_len = out_cap;
+        unsigned long long start = platform_time_ns();
+        if (compress2(out, &out_len, (const Bytef *)log, (uLong)len, level) != Z_OK) {
+            fprintf(stderr, "compress2 failed at level %d\n", level);
+            return 1;
+        }
+        unsigned long long elapsed = platform_time_ns() - start;
+        compress_controller_record(&ctl, level, len, out_len, elapsed);
+        waiting--;
+
+        printf("[Step %3d] backlog %3d logs (%6.1f MB) -> level %d, %6.1f MB/s, %.2fx\n", step, waiting + 1,
+               (double)backlog / 1e6, level, (double)len / 1e3 / ((double)elapsed / 1e6),
+               (double)len / (double)out_len);
+    }
+
+    /* Nothing waiting now: the top level is for recompression, if the CPUs are idle */
+    printf("[Main] idle level: %d\n", compress_controller_idle(&ctl, 0, platform_cpu_load()));
+
+    stats_snapshot_t snapshot;
+    stats_snapshot(&registry, &snapshot);
+    stats_snapshot_print(&snapshot, NULL, stdout);
+    compress_controller_print(&ctl, stdout);
+
+    stats_registry_destroy(&registry);
+    free(log);
+    free(out);
+    return 0;
+}
@@ -0,0 +1,212 @@
+#include "config.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "compress_controller.h"
+#include "json_reader.h"
+
+static const char *const level_names[] = { "error", "warn", "info", "debug" };
+
+void config_defaults(config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->version = 1;
+    config->pool_threads = 4;
+    config->log_level = CONFIG_LOG_INFO;
+    config->compress_drain_s = COMPRESS_CONTROLLER_DRAIN_S;
+    config->compress_busy_load = COMPRESS_CONTROLLER_BUSY_LOAD;
+    config->compress_idle_load = COMPRESS_CONTROLLER_IDLE_LOAD;
+    config->command_port = 4100;
+    config->max_frame_length = 64 * 1024;
+}
+
+const char *config_log_level_name(config_log_level_t level)
+{
+    return (unsigned)level < sizeof(level_names) / sizeof(level_names[0]) ? level_names[level] : "?";
+}
+
+/* Integer member `key` within [lo, hi]; a missing member leaves `*value` alone */
+static int get_int(const json_node_t *object, const char *section, const char *key, long long lo, long long hi,
+                   long long *value)
+{
+    const json_node_t *n = json_get(object, key);
+    if (!n) return 0;
+    if (n->type != JSON_NUMBER || n->number < lo || n->number > hi) {
+        fprintf(stderr, "config_parse: %s%s%s must be a number from %lld to %lld\n", section, *section ? "." : "",
+                key, lo, hi);
+        return -1;
+    }
+    *value = n->number;
+    return 0;
+}
+
+int config_parse(config_t *config, const char *json, size_t len)
+{
+    const char *error = NULL;
+    size_t error_offset = 0;
+    int rc = -1;
+
+    config_defaults(config);
+    json_node_t *root = json_parse(json, len, &error, &error_offset);
+    if (!root) {
+        fprintf(stderr, "config_parse: %s at offset %zu\n", error, error_offset);
+        return -1;
+    }
+    if (root->type != JSON_OBJECT) {
+        fprintf(stderr, "config_parse: not a JSON object\n");
+        goto cleanup;
+    }
+
+    long long v = config->pool_threads;
+    if (get_int(root, "", "pool_threads", 1, 1024, &v) != 0) goto cleanup;
+    config->pool_threads = (int)v;
+
+    const json_node_t *level = json_get(root, "log_level");
+    if (level) {
+        int found = 0;
+        for (int i = 0; i <= CONFIG_LOG_DEBUG; i++) {
+            if (json_string_is(level, level_names[i])) {
+                config->log_level = (config_log_level_t)i;
+                found = 1;
+            }
+        }
+        if (!found) {
+            fprintf(stderr, "config_parse: log_level must be error, warn, info or debug\n");
+            goto cleanup;
+        }
+    }
+
+    /* Loads are given in percent, since the reader only takes integers */
+    const json_node_t *compression = json_get(root, "compression");
+    v = (long long)config->compress_drain_s;
+    if (get_int(compression, "compression", "drain_s", 1, 86400, &v) != 0) goto cleanup;
+    config->compress_drain_s = (double)v;
+    v = (long long)(config->compress_busy_load * 100.0 + 0.5);
+    if (get_int(compression, "compression", "busy_load_pct", 1, 1000, &v) != 0) goto cleanup;
+    config->compress_busy_load = (double)v / 100.0;
+    v = (long long)(config->compress_idle_load * 100.0 + 0.5);
+    if (get_int(compression, "compression", "idle_load_pct", 0, 1000, &v) != 0) goto cleanup;
+    config->compress_idle_load = (double)v / 100.0;
+    if (config->compress_idle_load >= config->compress_busy_load) {
+        fprintf(stderr, "config_parse: compression.idle_load_pct must be below busy_load_pct\n");
+        goto cleanup;
+    }
+
+    const json_node_t *protocol = json_get(root, "protocol");
+    v = config->command_port;
+    if (get_int(protocol, "protocol", "command_port", 1, 65535, &v) != 0) goto cleanup;
+    config->command_port = (int)v;
+    v = config->max_frame_length;
+    if (get_int(protocol, "protocol", "max_frame_length", 16, 16 << 20, &v) != 0) goto cleanup;
+    config->max_frame_length = (uint32_t)v;
+
+    rc = 0;
+
+cleanup:
+    json_free(root);
+    return rc;
+}
+
+config_t *config_load(const char *path)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "config_load: cannot open %s\n", path);
+        return NULL;
+    }
+
+    size_t cap = 1 << 12, len = 0, got;
+    char *text = (char *)malloc(cap);
+    while (text && (got = fread(text + len, 1, cap - len, f)) > 0) {
+        len += got;
+        if (len == cap) {
+            char *bigger = (char *)realloc(text, cap * 2);
+            if (!bigger) {
+                free(text);
+                text = NULL;
+                break;
+            }
+            text = bigger;
+            cap *= 2;
+        }
+    }
+    fclose(f);
+    if (!text) {
+        fprintf(stderr, "config_load: out of memory reading %s\n", path);
+        return NULL;
+    }
+
+    config_t *config = (config_t *)malloc(sizeof(config_t));
+    if (!config || config_parse(config, text, len) != 0) {
+        fprintf(stderr, "config_load: %s not loaded\n", path);
+        free(config);
+        config = NULL;
+    }
+    free(text);
+    return config;
+}
+
+void config_free(config_t *config)
+{
+    free(config);
+}
+
+/* =============================
+ * Store
+ * ============================= */
+
+static void free_snapshot(void *ptr, void *ctx)
+{
+    (void)ctx;
+    config_free((config_t *)ptr);
+}
+
+void config_store_init(config_store_t *store, const char *path, config_t *initial, ebr_t *ebr)
+{
+    memset(store, 0, sizeof(*store));
+    snprintf(store->path, sizeof(store->path), "%s", path);
+    store->ebr = ebr;
+    platform_mutex_init(&store->reload_lock);
+    __atomic_store_n(&store->current, initial, __ATOMIC_RELEASE);
+}
+
+void config_store_destroy(config_store_t *store)
+{
+    config_free(__atomic_exchange_n(&store->current, NULL, __ATOMIC_ACQ_REL));
+    platform_mutex_destroy(&store->reload_lock);
+}
+
+int config_store_reload(config_store_t *store, ebr_thread_t *self)
+{
+    platform_mutex_lock(&store->reload_lock);
+
+    /* Parsed before the swap, so readers only ever see a complete snapshot */
+    config_t *next = config_load(store->path);
+    if (!next) {
+        store->failures++;
+        platform_mutex_unlock(&store->reload_lock);
+        return -1;
+    }
+    next->version = store->current->version + 1;
+    config_t *old = __atomic_exchange_n(&store->current, next, __ATOMIC_ACQ_REL);
+    store->reloads++;
+    platform_mutex_unlock(&store->reload_lock);
+
+    /* Readers may still hold the old one; it goes once they have all moved on */
+    ebr_retire(self, old, free_snapshot, NULL);
+    ebr_flush(self);
+    return 0;
+}
+
+void config_print(const config_t *config, const char *prefix)
+{
+    printf("%s version %llu\n", prefix, (unsigned long long)config->version);
+    printf("%s pool_threads %d\n", prefix, config->pool_threads);
+    printf("%s log_level %s\n", prefix, config_log_level_name(config->log_level));
+    printf("%s compression drain %.0f s, busy load %.2f, idle load %.2f\n", prefix, config->compress_drain_s,
+           config->compress_busy_load, config->compress_idle_load);
+    printf("%s protocol command_port %d, max_frame_length %u\n", prefix, config->command_port,
+           config->max_frame_length);
+}
@@ -0,0 +1,138 @@
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+#include "reclaim.h"
+
+/**
+ * Run-time settings, reloadable without stopping the data path.
+ *
+ * A config file is parsed into an immutable snapshot (config_t). The
+ * store publishes the current snapshot through one pointer: readers load
+ * it with config_current(), a single acquire load, and never lock. A
+ * reload parses the file into a new snapshot off to the side, swaps the
+ * pointer, and retires the old snapshot through an epoch domain, so it is
+ * freed only once every reader that could have loaded it has passed a
+ * quiescent state. A file that fails to parse leaves the current snapshot
+ * in place.
+ *
+ * Readers must be inside a critical region of the store's domain while
+ * they use a snapshot. Pool workers always are during a task when the
+ * store uses the pool's domain (thread_pool_t.reclaim); other threads
+ * bracket their reads with ebr_enter()/ebr_exit(). Values read from a
+ * snapshot stay consistent with each other, whatever reloads happen
+ * meanwhile.
+ *
+ * The file is JSON; every member is optional:
+ *
+ *   {
+ *     "pool_threads": 4,
+ *     "log_level": "info",
+ *     "compression": { "drain_s": 60, "busy_load_pct": 90, "idle_load_pct": 30 },
+ *     "protocol": { "command_port": 4100, "max_frame_length": 65536 }
+ *   }
+ */
+
+#define CONFIG_MAX_PATH 1024
+
+typedef enum config_log_level_t {
+    CONFIG_LOG_ERROR = 0,
+    CONFIG_LOG_WARN,
+    CONFIG_LOG_INFO,
+    CONFIG_LOG_DEBUG
+} config_log_level_t;
+
+typedef struct config_t {
+    uint64_t version;               /* 1 for the first snapshot, +1 per reload */
+
+    int pool_threads;
+    config_log_level_t log_level;
+
+    /* Compression policy; log_compression_thread() reads it before every log */
+    double compress_drain_s;
+    double compress_busy_load;
+    double compress_idle_load;
+
+    /* Command protocol (command_server_config_t), read when the server starts */
+    int command_port;
+    uint32_t max_frame_length;
+} config_t;
+
+/**
+ * The settings used when a member is missing from the file.
+ */
+void config_defaults(config_t *config);
+
+/**
+ * Parse `len` bytes of JSON over the defaults. Returns 0, or -1 if the
+ * text is not valid JSON or a value is out of range.
+ */
+int config_parse(config_t *config, const char *json, size_t len);
+
+/**
+ * A new snapshot read from `path`, or NULL if it cannot be read or
+ * parsed. Free it with config_free() unless a store takes it.
+ */
+config_t *config_load(const char *path);
+
+void config_free(config_t *config);
+
+const char *config_log_level_name(config_log_level_t level);
+
+typedef struct config_store_t {
+    config_t *current;
+    ebr_t *ebr;
+    char path[CONFIG_MAX_PATH];
+
+    platform_mutex_t reload_lock;   /* one reload at a time */
+    uint64_t reloads;
+    uint64_t failures;
+} config_store_t;
+
+/**
+ * Publish `initial`, which the store takes over, and reload from `path`
+ * later on. Old snapshots are retired through `ebr`.
+ */
+void config_store_init(config_store_t *store, const char *path, config_t *initial, ebr_t *ebr);
+
+/**
+ * Free the current snapshot. No reader may still be using it, and the
+ * domain must be destroyed (or flushed) afterwards to free retired ones.
+ */
+void config_store_destroy(config_store_t *store);
+
+/**
+ * The current snapshot. The caller must be inside a critical region of
+ * the store's domain, and may use the snapshot until it leaves it.
+ */
+static inline const config_t *config_current(config_store_t *store)
+{
+    return __atomic_load_n(&store->current, __ATOMIC_ACQUIRE);
+}
+
+/**
+ * Read the file again and publish the result. `self` is the caller's
+ * registration with the store's domain, used to retire the old snapshot;
+ * the caller must be outside a critical region. Returns 0, or -1 if the
+ * file could not be loaded, in which case the current snapshot stays.
+ * Never blocks readers; concurrent reloads wait for each other.
+ */
+int config_store_reload(config_store_t *store, ebr_thread_t *self);
+
+/**
+ * Print a snapshot, one setting per line with `prefix`.
+ */
+void config_print(const config_t *config, const char *prefix);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONFIG_H
@@ -0,0 +1,257 @@
+#include "conn_table.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* =============================
+ * Hashing
+ * ============================= */
+
+/* splitmix64 finaliser: fd keys are small and sequential, spread them out */
+static inline uint64_t mix64(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+uint64_t conn_key_tuple(const uint8_t *local_addr, uint16_t local_port,
+                        const uint8_t *peer_addr, uint16_t peer_port,
+                        int addr_len, uint8_t protocol)
+{
+    uint64_t h = mix64(((uint64_t)protocol << 32) | ((uint64_t)local_port << 16) | peer_port);
+
+    for (int i = 0; i < addr_len; i += 8) {
+        uint64_t a = 0, b = 0;
+        int n = addr_len - i < 8 ? addr_len - i : 8;
+        memcpy(&a, local_addr + i, (size_t)n);
+        memcpy(&b, peer_addr + i, (size_t)n);
+        h = mix64(h ^ a) + mix64(b ^ (h >> 17));
+    }
+    return h;
+}
+
+/* =============================
+ * Slabs and entries
+ * ============================= */
+
+static inline conn_entry_t *entry_at(const conn_table_t *t, uint32_t index)
+{
+    return &t->slabs[index / CONN_SLAB_ENTRIES]->entries[index % CONN_SLAB_ENTRIES];
+}
+
+static int add_slab(conn_table_t *t)
+{
+    conn_slab_t **grown = (conn_slab_t **)realloc(t->slabs, sizeof(*grown) * (t->num_slabs + 1));
+    if (!grown) return -1;
+    t->slabs = grown;
+
+    /* Cache-line aligned so each conn_stats_t sits on a line of its own */
+    conn_slab_t *slab = (conn_slab_t *)aligned_alloc(64, sizeof(conn_slab_t));
+    if (!slab) return -1;
+    memset(slab, 0, sizeof(*slab));
+
+    uint32_t base = t->num_slabs * CONN_SLAB_ENTRIES;
+    t->slabs[t->num_slabs++] = slab;
+
+    /* Push in reverse so the lowest index is handed out first */
+    for (int i = CONN_SLAB_ENTRIES - 1; i >= 0; i--) {
+        slab->entries[i].index = base + (uint32_t)i;
+        slab->entries[i].lru_next = t->free_head;
+        t->free_head = base + (uint32_t)i;
+    }
+    return 0;
+}
+
+static void lru_unlink(conn_table_t *t, conn_entry_t *e)
+{
+    if (!e->on_lru) return;
+    if (e->lru_prev != CONN_NONE) entry_at(t, e->lru_prev)->lru_next = e->lru_next;
+    else t->lru_head = e->lru_next;
+    if (e->lru_next != CONN_NONE) entry_at(t, e->lru_next)->lru_prev = e->lru_prev;
+    else t->lru_tail = e->lru_prev;
+    e->lru_prev = e->lru_next = CONN_NONE;
+    e->on_lru = 0;
+}
+
+static void lru_push_front(conn_table_t *t, conn_entry_t *e)
+{
+    e->lru_prev = CONN_NONE;
+    e->lru_next = t->lru_head;
+    if (t->lru_head != CONN_NONE) entry_at(t, t->lru_head)->lru_prev = e->index;
+    else t->lru_tail = e->index;
+    t->lru_head = e->index;
+    e->on_lru = 1;
+}
+
+/* =============================
+ * Open-addressing index
+ * ============================= */
+
+static uint32_t find_slot(const conn_table_t *t, uint64_t key)
+{
+    uint32_t i = (uint32_t)mix64(key) & t->slot_mask;
+    for (;;) {
+        const conn_slot_t *s = &t->slots[i];
+        if (s->index == CONN_NONE || s->key == key) return i;
+        i = (i + 1) & t->slot_mask;
+    }
+}
+
+static int alloc_slots(conn_table_t *t, uint32_t size)
+{
+    conn_slot_t *slots = (conn_slot_t *)malloc(sizeof(*slots) * size);
+    if (!slots) return -1;
+    for (uint32_t i = 0; i < size; i++) slots[i].index = CONN_NONE;
+    t->slots = slots;
+    t->slot_mask = size - 1;
+    return 0;
+}
+
+static int grow_index(conn_table_t *t)
+{
+    conn_slot_t *old = t->slots;
+    uint32_t old_size = t->slot_mask + 1;
+
+    if (alloc_slots(t, old_size * 2) != 0) {
+        t->slots = old;
+        return -1;
+    }
+    for (uint32_t i = 0; i < old_size; i++) {
+        if (old[i].index != CONN_NONE) t->slots[find_slot(t, old[i].key)] = old[i];
+    }
+    free(old);
+    return 0;
+}
+
+/* Backward-shift deletion keeps probe chains intact without tombstones */
+static void erase_slot(conn_table_t *t, uint32_t hole)
+{
+    uint32_t i = hole;
+    for (;;) {
+        i = (i + 1) & t->slot_mask;
+        conn_slot_t *s = &t->slots[i];
+        if (s->index == CONN_NONE) break;
+
+        uint32_t home = (uint32_t)mix64(s->key) & t->slot_mask;
+        /* Move s back unless its home lies cyclically in (hole, i] */
+        if (((i - home) & t->slot_mask) >= ((i - hole) & t->slot_mask)) {
+            t->slots[hole] = *s;
+            hole = i;
+        }
+    }
+    t->slots[hole].index = CONN_NONE;
+}
+
+/* =============================
+ * Public API
+ * ============================= */
+
+int conn_table_init(conn_table_t *table, uint32_t expected)
+{
+    uint32_t size = 64;
+
+    memset(table, 0, sizeof(*table));
+    table->free_head = table->lru_head = table->lru_tail = CONN_NONE;
+    while (size < expected * 2) size <<= 1;
+    if (alloc_slots(table, size) != 0) {
+        fprintf(stderr, "conn_table_init: failed to allocate %u slots\n", size);
+        return -1;
+    }
+    return 0;
+}
+
+void conn_table_destroy(conn_table_t *table)
+{
+    for (uint32_t i = 0; i < table->num_slabs; i++) free(table->slabs[i]);
+    free(table->slabs);
+    free(table->slots);
+    memset(table, 0, sizeof(*table));
+}
+
+conn_entry_t *conn_table_insert(conn_table_t *table, uint64_t key, uint64_t now_ns)
+{
+    /* Keep the load factor under 70% so probe chains stay short */
+    if ((uint64_t)(table->count + 1) * 10 > (uint64_t)(table->slot_mask + 1) * 7) {
+        if (grow_index(table) != 0) return NULL;
+    }
+
+    uint32_t slot = find_slot(table, key);
+    if (table->slots[slot].index != CONN_NONE) return NULL;
+
+    if (table->free_head == CONN_NONE && add_slab(table) != 0) return NULL;
+    conn_entry_t *e = entry_at(table, table->free_head);
+    table->free_head = e->lru_next;
+
+    e->key = key;
+    e->last_active_ns = now_ns;
+    e->in_use = 1;
+    e->user = NULL;
+    memset(conn_table_stats(table, e), 0, sizeof(conn_stats_t));
+    conn_table_stats(table, e)->opened_ns = now_ns;
+    lru_push_front(table, e);
+
+    table->slots[slot].key = key;
+    table->slots[slot].index = e->index;
+    table->count++;
+    return e;
+}
+
+conn_entry_t *conn_table_find(const conn_table_t *table, uint64_t key)
+{
+    uint32_t slot = find_slot(table, key);
+    if (table->slots[slot].index == CONN_NONE) return NULL;
+    return entry_at(table, table->slots[slot].index);
+}
+
+conn_entry_t *conn_table_get(const conn_table_t *table, uint32_t index)
+{
+    if (index / CONN_SLAB_ENTRIES >= table->num_slabs) return NULL;
+    conn_entry_t *e = entry_at(table, index);
+    return e->in_use ? e : NULL;
+}
+
+void conn_table_touch(conn_table_t *table, conn_entry_t *entry, uint64_t now_ns)
+{
+    entry->last_active_ns = now_ns;
+    if (table->lru_head == entry->index) return;
+    lru_unlink(table, entry);
+    lru_push_front(table, entry);
+}
+
+void conn_table_remove(conn_table_t *table, conn_entry_t *entry)
+{
+    if (!entry || !entry->in_use) return;
+
+    uint32_t slot = find_slot(table, entry->key);
+    if (table->slots[slot].index == entry->index) erase_slot(table, slot);
+
+    lru_unlink(table, entry);
+    entry->in_use = 0;
+    entry->user = NULL;
+    entry->lru_next = table->free_head;
+    table->free_head = entry->index;
+    table->count--;
+}
+
+size_t conn_table_expire(conn_table_t *table, uint64_t now_ns, uint64_t idle_ns,
+                         conn_expire_func_t callback, void *ctx, size_t max_entries)
+{
+    size_t expired = 0;
+
+    if (idle_ns == 0) return 0;
+    while (table->lru_tail != CONN_NONE && (max_entries == 0 || expired < max_entries)) {
+        conn_entry_t *e = entry_at(table, table->lru_tail);
+        /* The tail is the oldest: once it is live, everything is */
+        if (now_ns - e->last_active_ns < idle_ns) break;
+
+        lru_unlink(table, e);
+        expired++;
+        if (callback) callback(ctx, e);
+    }
+    return expired;
+}
@@ -0,0 +1,167 @@
+#ifndef CONN_TABLE_H
+#define CONN_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Connection state table: O(1) lookup by key and O(expired) idle eviction.
+ *
+ * Replaces the linear scans of ServerConnection._cleanup_inactive_clients.
+ *  - Keys are 64-bit: conn_key_fd() for sockets owned by one process,
+ *    conn_key_tuple() for a fingerprint of the 5-tuple.
+ *  - The index is an open-addressing hash with linear probing and
+ *    backward-shift deletion, so there are no tombstones to clean up.
+ *  - Entries sit on an intrusive LRU list. With one idle timeout for all
+ *    connections the least recently active entry expires first, so an
+ *    eviction pass stops at the first entry that is still live.
+ *  - Entries and their counters live in fixed slabs of CONN_SLAB_ENTRIES.
+ *    Counters are kept apart from the lookup/LRU fields so updating them
+ *    does not pull the index's cache lines in and out.
+ *
+ * Not thread-safe: each relay loop owns its own table.
+ */
+
+#define CONN_SLAB_ENTRIES 64
+#define CONN_NONE         0xFFFFFFFFU
+
+/**
+ * Per-connection counters.
+ */
+typedef struct conn_stats_t {
+    uint64_t frames_in;
+    uint64_t bytes_in;
+    uint64_t frames_out;
+    uint64_t bytes_out;
+    uint64_t invalid_frames;
+    uint64_t opened_ns;
+    uint64_t reserved[2];           /* pad to one cache line */
+} conn_stats_t;
+
+typedef struct conn_entry_t {
+    uint64_t key;
+    uint64_t last_active_ns;
+    uint32_t index;                 /* stable handle, slab * CONN_SLAB_ENTRIES + slot */
+    uint32_t lru_prev;
+    uint32_t lru_next;
+    uint8_t in_use;
+    uint8_t on_lru;
+    void *user;
+} conn_entry_t;
+
+typedef struct conn_slab_t {
+    conn_entry_t entries[CONN_SLAB_ENTRIES];
+    conn_stats_t stats[CONN_SLAB_ENTRIES];
+} conn_slab_t;
+
+typedef struct conn_slot_t {
+    uint64_t key;
+    uint32_t index;                 /* CONN_NONE when empty */
+} conn_slot_t;
+
+typedef struct conn_table_t {
+    conn_slot_t *slots;
+    uint32_t slot_mask;
+
+    conn_slab_t **slabs;
+    uint32_t num_slabs;
+    uint32_t free_head;             /* free entries chained through lru_next */
+
+    uint32_t lru_head;              /* most recently active */
+    uint32_t lru_tail;              /* least recently active */
+    uint32_t count;
+} conn_table_t;
+
+/**
+ * Called by conn_table_expire() for every idle entry. The entry has been
+ * taken off the LRU list but is still in the table: the callback must
+ * eventually conn_table_remove() it (or touch it to keep it).
+ */
+typedef void (*conn_expire_func_t)(void *ctx, conn_entry_t *entry);
+
+/**
+ * Key for a socket of this process. The generation distinguishes a
+ * recycled descriptor from the connection that used it before.
+ */
+static inline uint64_t conn_key_fd(int fd, uint32_t generation)
+{
+    return ((uint64_t)generation << 32) | (uint32_t)fd;
+}
+
+/**
+ * Fingerprint of a TCP/UDP 5-tuple. `addr_len` is 4 or 16.
+ */
+uint64_t conn_key_tuple(const uint8_t *local_addr, uint16_t local_port,
+                        const uint8_t *peer_addr, uint16_t peer_port,
+                        int addr_len, uint8_t protocol);
+
+/**
+ * Initialise a table sized for about `expected` connections.
+ * Returns 0 on success, nonzero on failure.
+ */
+int conn_table_init(conn_table_t *table, uint32_t expected);
+
+/**
+ * Free the table and its slabs (user pointers are not touched).
+ */
+void conn_table_destroy(conn_table_t *table);
+
+/**
+ * Add `key` as the most recently active entry. Returns NULL if the key is
+ * already present or memory runs out.
+ */
+conn_entry_t *conn_table_insert(conn_table_t *table, uint64_t key, uint64_t now_ns);
+
+/**
+ * Entry for `key`, or NULL.
+ */
+conn_entry_t *conn_table_find(const conn_table_t *table, uint64_t key);
+
+/**
+ * Entry by its stable index, or NULL if that slot is free.
+ */
+conn_entry_t *conn_table_get(const conn_table_t *table, uint32_t index);
+
+/**
+ * Record activity: move the entry to the front of the LRU list.
+ */
+void conn_table_touch(conn_table_t *table, conn_entry_t *entry, uint64_t now_ns);
+
+/**
+ * Remove an entry. The pointer is invalid afterwards.
+ */
+void conn_table_remove(conn_table_t *table, conn_entry_t *entry);
+
+/**
+ * Hand every entry idle for at least `idle_ns` to `callback`, oldest
+ * first, stopping after `max_entries` (0 for no limit). Only expired
+ * entries are visited. Returns the number handed over.
+ */
+size_t conn_table_expire(conn_table_t *table, uint64_t now_ns, uint64_t idle_ns,
+                         conn_expire_func_t callback, void *ctx, size_t max_entries);
+
+/**
+ * Counters of an entry.
+ */
+static inline conn_stats_t *conn_table_stats(const conn_table_t *table, const conn_entry_t *entry)
+{
+    return &table->slabs[entry->index / CONN_SLAB_ENTRIES]->stats[entry->index % CONN_SLAB_ENTRIES];
+}
+
+/**
+ * Number of entries.
+ */
+static inline uint32_t conn_table_count(const conn_table_t *table)
+{
+    return table->count;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // CONN_TABLE_H
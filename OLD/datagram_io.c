@@ -0,0 +1,470 @@
+#define _GNU_SOURCE  // recvmmsg, sendmmsg
+
+#include "datagram_io.h"
+
+#if !defined(__linux__)
+#error "datagram_io requires Linux (recvmmsg, sendmmsg, UDP GSO/GRO)"
+#endif
+
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/udp.h>
+#include <sys/time.h>
+
+/* Older libc headers lack the GSO/GRO socket options */
+#ifndef SOL_UDP
+#define SOL_UDP 17
+#endif
+#ifndef UDP_SEGMENT
+#define UDP_SEGMENT 103
+#endif
+#ifndef UDP_GRO
+#define UDP_GRO 104
+#endif
+
+/* Kernel limit on segments per GSO send (UDP_MAX_SEGMENTS in older kernels) */
+#define DGRAM_GSO_MAX_SEGMENTS 64
+#define DGRAM_GSO_MAX_BYTES    65000
+
+#define DGRAM_CONTROL_SIZE CMSG_SPACE(sizeof(int))
+
+static void *receiver_thread(void *arg);
+
+/* =============================
+ * Configuration
+ * ============================= */
+
+void dgram_config_default(dgram_config_t *config, unsigned short port)
+{
+    memset(config, 0, sizeof(*config));
+    config->port = port;
+    config->batch_size = 64;
+    config->slot_size = 2048;
+    config->num_batches = 16;
+    config->enable_gro = 0;
+    config->rcvbuf_bytes = 8 * 1024 * 1024;
+}
+
+/* =============================
+ * Batch allocation
+ * ============================= */
+
+static int batch_alloc(dgram_socket_t *sock, dgram_batch_t *batch)
+{
+    int n = sock->config.batch_size;
+    size_t slot = sock->config.slot_size;
+
+    memset(batch, 0, sizeof(*batch));
+    batch->owner = sock;
+    batch->capacity = n;
+    batch->slot_size = slot;
+    batch->data = (uint8_t *)malloc(slot * n);
+    batch->lengths = (uint32_t *)calloc(n, sizeof(uint32_t));
+    batch->segment_sizes = (uint16_t *)calloc(n, sizeof(uint16_t));
+    batch->addrs = (struct sockaddr_storage *)calloc(n, sizeof(struct sockaddr_storage));
+    batch->msgs = (struct mmsghdr *)calloc(n, sizeof(struct mmsghdr));
+    batch->iovs = (struct iovec *)calloc(n, sizeof(struct iovec));
+    batch->control = (char *)calloc(n, DGRAM_CONTROL_SIZE);
+    if (!batch->data || !batch->lengths || !batch->segment_sizes || !batch->addrs ||
+        !batch->msgs || !batch->iovs || !batch->control) {
+        return -1;
+    }
+
+    /* Wire the vectors up once; recv only resets the in/out lengths */
+    for (int i = 0; i < n; i++) {
+        batch->iovs[i].iov_base = batch->data + slot * i;
+        batch->iovs[i].iov_len = slot;
+        batch->msgs[i].msg_hdr.msg_iov = &batch->iovs[i];
+        batch->msgs[i].msg_hdr.msg_iovlen = 1;
+        batch->msgs[i].msg_hdr.msg_name = &batch->addrs[i];
+    }
+    return 0;
+}
+
+static void batch_free(dgram_batch_t *batch)
+{
+    free(batch->data);
+    free(batch->lengths);
+    free(batch->segment_sizes);
+    free(batch->addrs);
+    free(batch->msgs);
+    free(batch->iovs);
+    free(batch->control);
+}
+
+dgram_batch_t *dgram_batch_acquire(dgram_socket_t *sock)
+{
+    platform_mutex_lock(&sock->free_lock);
+    if (!sock->free_list && sock->keep_running) {
+        sock->stats.batch_waits++;
+    }
+    while (!sock->free_list && sock->keep_running) {
+        platform_cond_wait(&sock->free_cond, &sock->free_lock);
+    }
+    dgram_batch_t *batch = sock->free_list;
+    if (batch) {
+        sock->free_list = batch->next;
+        batch->next = NULL;
+        batch->count = 0;
+        sock->batches_out++;
+    }
+    platform_mutex_unlock(&sock->free_lock);
+    return batch;
+}
+
+void dgram_batch_release(dgram_batch_t *batch)
+{
+    dgram_socket_t *sock = batch->owner;
+
+    platform_mutex_lock(&sock->free_lock);
+    batch->next = sock->free_list;
+    sock->free_list = batch;
+    sock->batches_out--;
+    platform_cond_signal(&sock->free_cond);
+    platform_mutex_unlock(&sock->free_lock);
+}
+
+/* =============================
+ * Socket lifecycle
+ * ============================= */
+
+int dgram_socket_open(dgram_socket_t *sock, const dgram_config_t *config)
+{
+    if (!sock || !config) return -1;
+
+    memset(sock, 0, sizeof(*sock));
+    sock->config = *config;
+    if (sock->config.batch_size <= 0 || sock->config.batch_size > DGRAM_MAX_BATCH) {
+        sock->config.batch_size = DGRAM_MAX_BATCH;
+    }
+    if (sock->config.num_batches <= 0) sock->config.num_batches = 1;
+    platform_mutex_init(&sock->free_lock);
+    platform_cond_init(&sock->free_cond);
+    sock->keep_running = 1;
+
+    sock->fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, IPPROTO_UDP);
+    if (sock->fd < 0) {
+        perror("dgram_socket_open: socket");
+        goto fail;
+    }
+
+    if (config->rcvbuf_bytes > 0) {
+        setsockopt(sock->fd, SOL_SOCKET, SO_RCVBUF, &config->rcvbuf_bytes, sizeof(int));
+    }
+
+    /* Receive timeout so the receiver thread notices shutdown */
+    struct timeval tv = { 0, 100 * 1000 };
+    setsockopt(sock->fd, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+    /* Probe GSO: setting a zero segment size is accepted only if supported */
+    int zero = 0;
+    sock->gso_supported = setsockopt(sock->fd, SOL_UDP, UDP_SEGMENT, &zero, sizeof(zero)) == 0;
+
+    if (config->enable_gro) {
+        int one = 1;
+        sock->gro_enabled = setsockopt(sock->fd, SOL_UDP, UDP_GRO, &one, sizeof(one)) == 0;
+    }
+
+    if (config->port != 0) {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(config->port);
+        if (bind(sock->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+            perror("dgram_socket_open: bind");
+            goto fail;
+        }
+    }
+
+    sock->batches = (dgram_batch_t *)calloc(sock->config.num_batches, sizeof(dgram_batch_t));
+    if (!sock->batches) goto fail;
+    for (int i = 0; i < sock->config.num_batches; i++) {
+        if (batch_alloc(sock, &sock->batches[i]) != 0) {
+            fprintf(stderr, "dgram_socket_open: failed to allocate batch %d\n", i);
+            /* None has been handed out yet: free them here */
+            for (int j = 0; j <= i; j++) batch_free(&sock->batches[j]);
+            free(sock->batches);
+            sock->batches = NULL;
+            sock->free_list = NULL;
+            goto fail;
+        }
+        sock->batches[i].next = sock->free_list;
+        sock->free_list = &sock->batches[i];
+    }
+    return 0;
+
+fail:
+    dgram_socket_close(sock);
+    return -1;
+}
+
+void dgram_socket_close(dgram_socket_t *sock)
+{
+    if (!sock) return;
+
+    platform_mutex_lock(&sock->free_lock);
+    sock->keep_running = 0;
+    platform_cond_broadcast(&sock->free_cond);
+    platform_mutex_unlock(&sock->free_lock);
+
+    if (sock->thread_started) {
+        platform_thread_join(sock->thread);
+        sock->thread_started = 0;
+    }
+
+    /*
+     * Every batch handed out must come back before they are freed. Count
+     * them rather than walk the free list, which holds fewer than
+     * num_batches when open failed part way.
+     */
+    platform_mutex_lock(&sock->free_lock);
+    while (sock->batches_out > 0) platform_cond_wait(&sock->free_cond, &sock->free_lock);
+    platform_mutex_unlock(&sock->free_lock);
+
+    if (sock->batches) {
+        for (int i = 0; i < sock->config.num_batches; i++) batch_free(&sock->batches[i]);
+        free(sock->batches);
+        sock->batches = NULL;
+    }
+
+    if (sock->fd >= 0) close(sock->fd);
+    sock->fd = -1;
+    platform_mutex_destroy(&sock->free_lock);
+    platform_cond_destroy(&sock->free_cond);
+}
+
+/* =============================
+ * Receive path
+ * ============================= */
+
+int dgram_recv_batch(dgram_socket_t *sock, dgram_batch_t *batch)
+{
+    int n = batch->capacity;
+
+    for (int i = 0; i < n; i++) {
+        struct msghdr *h = &batch->msgs[i].msg_hdr;
+        h->msg_namelen = sizeof(struct sockaddr_storage);
+        h->msg_control = sock->gro_enabled ? batch->control + i * DGRAM_CONTROL_SIZE : NULL;
+        h->msg_controllen = sock->gro_enabled ? DGRAM_CONTROL_SIZE : 0;
+        h->msg_flags = 0;
+    }
+
+    /* Block for the first datagram, then take whatever else is queued */
+    int got = recvmmsg(sock->fd, batch->msgs, n, MSG_WAITFORONE, NULL);
+    if (got < 0) {
+        batch->count = 0;
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR) return 0;
+        return -1;
+    }
+
+    uint64_t datagrams = 0;
+    uint64_t bytes = 0;
+    for (int i = 0; i < got; i++) {
+        uint32_t len = batch->msgs[i].msg_len;
+        uint16_t seg = 0;
+
+        if (sock->gro_enabled) {
+            struct msghdr *h = &batch->msgs[i].msg_hdr;
+            for (struct cmsghdr *c = CMSG_FIRSTHDR(h); c; c = CMSG_NXTHDR(h, c)) {
+                if (c->cmsg_level == SOL_UDP && c->cmsg_type == UDP_GRO) {
+                    int gso_size;
+                    memcpy(&gso_size, CMSG_DATA(c), sizeof(gso_size));
+                    seg = (uint16_t)gso_size;
+                }
+            }
+        }
+
+        batch->lengths[i] = len;
+        batch->segment_sizes[i] = (seg > 0 && seg < len) ? seg : 0;
+        datagrams += batch->segment_sizes[i] ? (len + seg - 1) / seg : 1;
+        bytes += len;
+    }
+    batch->count = got;
+
+    sock->stats.batches++;
+    sock->stats.slots += (uint64_t)got;
+    sock->stats.datagrams += datagrams;
+    sock->stats.bytes += bytes;
+    return got;
+}
+
+void dgram_batch_foreach(const dgram_batch_t *batch, dgram_datagram_func_t func, void *ctx)
+{
+    for (int i = 0; i < batch->count; i++) {
+        const uint8_t *p = batch->data + batch->slot_size * i;
+        size_t len = batch->lengths[i];
+        size_t seg = batch->segment_sizes[i];
+
+        if (seg == 0) {
+            func(ctx, p, len, &batch->addrs[i]);
+            continue;
+        }
+        for (size_t off = 0; off < len; off += seg) {
+            size_t part = (len - off) < seg ? (len - off) : seg;
+            func(ctx, p + off, part, &batch->addrs[i]);
+        }
+    }
+}
+
+static void batch_task(void *arg)
+{
+    dgram_batch_t *batch = (dgram_batch_t *)arg;
+    dgram_socket_t *sock = batch->owner;
+
+    sock->handler(sock->handler_ctx, batch);
+    dgram_batch_release(batch);
+}
+
+static void *receiver_thread(void *arg)
+{
+    dgram_socket_t *sock = (dgram_socket_t *)arg;
+
+    while (sock->keep_running) {
+        dgram_batch_t *batch = dgram_batch_acquire(sock);
+        if (!batch) break;
+
+        int got = dgram_recv_batch(sock, batch);
+        if (got <= 0) {
+            if (got < 0) perror("dgram receiver: recvmmsg");
+            dgram_batch_release(batch);
+            continue;
+        }
+        if (thread_pool_add_task(sock->pool, batch_task, batch) != 0) batch_task(batch);
+    }
+    return NULL;
+}
+
+int dgram_receiver_start(dgram_socket_t *sock, thread_pool_t *pool,
+                         dgram_batch_handler_t handler, void *ctx)
+{
+    if (!sock || !pool || !handler || sock->thread_started) return -1;
+
+    sock->pool = pool;
+    sock->handler = handler;
+    sock->handler_ctx = ctx;
+    if (platform_thread_create(&sock->thread, receiver_thread, sock) != 0) {
+        fprintf(stderr, "dgram_receiver_start: error creating receiver thread\n");
+        return -1;
+    }
+    sock->thread_started = 1;
+    return 0;
+}
+
+/* =============================
+ * Send path
+ * ============================= */
+
+int dgram_send_many(dgram_socket_t *sock, const dgram_msg_t *msgs, int count)
+{
+    struct mmsghdr hdrs[DGRAM_MAX_BATCH];
+    struct iovec iovs[DGRAM_MAX_BATCH];
+    int sent = 0;
+
+    while (sent < count) {
+        int n = count - sent;
+        if (n > DGRAM_MAX_BATCH) n = DGRAM_MAX_BATCH;
+
+        memset(hdrs, 0, sizeof(hdrs[0]) * n);
+        for (int i = 0; i < n; i++) {
+            const dgram_msg_t *m = &msgs[sent + i];
+            iovs[i].iov_base = (void *)m->data;
+            iovs[i].iov_len = m->len;
+            hdrs[i].msg_hdr.msg_iov = &iovs[i];
+            hdrs[i].msg_hdr.msg_iovlen = 1;
+            hdrs[i].msg_hdr.msg_name = (void *)m->to;
+            hdrs[i].msg_hdr.msg_namelen = m->to_len;
+        }
+
+        int rc = sendmmsg(sock->fd, hdrs, n, 0);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            return sent > 0 ? sent : -1;
+        }
+        sock->stats.send_calls++;
+        sock->stats.sent_datagrams += (uint64_t)rc;
+        sent += rc;
+        if (rc < n) break;  // socket buffer full; let the caller retry the rest
+    }
+    return sent;
+}
+
+int dgram_send_segmented(dgram_socket_t *sock, const struct sockaddr *to, socklen_t to_len,
+                         const void *data, size_t len, uint16_t segment_size)
+{
+    const uint8_t *p = (const uint8_t *)data;
+    if (segment_size == 0) return -1;
+
+    if (!sock->gso_supported) {
+        /* Fallback: same datagrams, one sendmmsg() per DGRAM_MAX_BATCH */
+        dgram_msg_t msgs[DGRAM_MAX_BATCH];
+        int total = 0;
+        size_t off = 0;
+        while (off < len) {
+            int n = 0;
+            while (off < len && n < DGRAM_MAX_BATCH) {
+                size_t part = (len - off) < segment_size ? (len - off) : segment_size;
+                msgs[n].data = p + off;
+                msgs[n].len = part;
+                msgs[n].to = to;
+                msgs[n].to_len = to_len;
+                off += part;
+                n++;
+            }
+            int rc = dgram_send_many(sock, msgs, n);
+            if (rc < 0) return total > 0 ? total : -1;
+            total += rc;
+            if (rc < n) break;
+        }
+        return total;
+    }
+
+    /* GSO: hand the kernel up to DGRAM_GSO_MAX_SEGMENTS segments per call */
+    size_t per_call = (size_t)segment_size * DGRAM_GSO_MAX_SEGMENTS;
+    size_t max_bytes = DGRAM_GSO_MAX_BYTES - (DGRAM_GSO_MAX_BYTES % segment_size);
+    if (per_call > max_bytes) per_call = max_bytes;
+    if (per_call == 0) per_call = segment_size;
+
+    int total = 0;
+    size_t off = 0;
+    while (off < len) {
+        size_t chunk = (len - off) < per_call ? (len - off) : per_call;
+
+        char control[CMSG_SPACE(sizeof(uint16_t))];
+        memset(control, 0, sizeof(control));
+        struct iovec iov = { (void *)(p + off), chunk };
+        struct msghdr msg;
+        memset(&msg, 0, sizeof(msg));
+        msg.msg_name = (void *)to;
+        msg.msg_namelen = to_len;
+        msg.msg_iov = &iov;
+        msg.msg_iovlen = 1;
+
+        /* A single short datagram needs no segmentation hint */
+        if (chunk > segment_size) {
+            msg.msg_control = control;
+            msg.msg_controllen = sizeof(control);
+            struct cmsghdr *c = CMSG_FIRSTHDR(&msg);
+            c->cmsg_level = SOL_UDP;
+            c->cmsg_type = UDP_SEGMENT;
+            c->cmsg_len = CMSG_LEN(sizeof(uint16_t));
+            memcpy(CMSG_DATA(c), &segment_size, sizeof(segment_size));
+        }
+
+        ssize_t rc = sendmsg(sock->fd, &msg, 0);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            return total > 0 ? total : -1;
+        }
+        int segments = (int)((chunk + segment_size - 1) / segment_size);
+        sock->stats.send_calls++;
+        sock->stats.sent_datagrams += (uint64_t)segments;
+        total += segments;
+        off += chunk;
+    }
+    return total;
+}
@@ -0,0 +1,195 @@
+#ifndef DATAGRAM_IO_H
+#define DATAGRAM_IO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <sys/socket.h>
+
+#include "platform.h"
+#include "threadpool.h"
+
+/**
+ * Batched UDP I/O for high packet rates (Linux only).
+ *
+ * Receiving uses recvmmsg() into preallocated batches: every batch owns its
+ * mmsghdr/iovec/address/control arrays and one contiguous slab of slot
+ * buffers, so the receive path never allocates. With UDP GRO the kernel
+ * may hand several same-sized datagrams back as one coalesced slot; the
+ * segment size is recorded and dgram_batch_foreach() splits them again.
+ *
+ * Sending uses sendmmsg() from a preallocated queue, or a single sendmsg()
+ * with UDP_SEGMENT (GSO) when a run of equal-sized datagrams goes to one
+ * destination.
+ */
+
+#define DGRAM_MAX_BATCH 256
+
+/**
+ * Socket configuration.
+ *  - `batch_size` datagrams per recvmmsg() (<= DGRAM_MAX_BATCH).
+ *  - `slot_size` bytes per receive slot; with GRO enabled use 64KB so a
+ *    coalesced super-datagram fits.
+ *  - `num_batches` preallocated batches; when all are in flight on the
+ *    pool the receiver waits instead of allocating more.
+ */
+typedef struct dgram_config_t {
+    unsigned short port;
+    int batch_size;
+    size_t slot_size;
+    int num_batches;
+    int enable_gro;
+    int rcvbuf_bytes;
+} dgram_config_t;
+
+typedef struct dgram_socket_t dgram_socket_t;
+
+/**
+ * One received batch. Slot i holds `lengths[i]` bytes at
+ * `data + i * slot_size`; if `segment_sizes[i]` is nonzero the slot is a
+ * GRO super-datagram made of segments of that size (the last may be short).
+ */
+typedef struct dgram_batch_t {
+    dgram_socket_t *owner;
+    int count;
+    int capacity;
+    size_t slot_size;
+
+    uint8_t *data;
+    uint32_t *lengths;
+    uint16_t *segment_sizes;
+    struct sockaddr_storage *addrs;
+
+    /* Preallocated recvmmsg() vectors */
+    struct mmsghdr *msgs;
+    struct iovec *iovs;
+    char *control;
+
+    struct dgram_batch_t *next;
+} dgram_batch_t;
+
+/**
+ * Called once per datagram by dgram_batch_foreach().
+ */
+typedef void (*dgram_datagram_func_t)(void *ctx, const uint8_t *data, size_t len,
+                                      const struct sockaddr_storage *from);
+
+/**
+ * Called on a pool thread once per received batch.
+ */
+typedef void (*dgram_batch_handler_t)(void *ctx, const dgram_batch_t *batch);
+
+typedef struct dgram_stats_t {
+    uint64_t batches;
+    uint64_t slots;
+    uint64_t datagrams;
+    uint64_t bytes;
+    uint64_t batch_waits;
+    uint64_t sent_datagrams;
+    uint64_t send_calls;
+} dgram_stats_t;
+
+struct dgram_socket_t {
+    int fd;
+    dgram_config_t config;
+    int gro_enabled;
+    int gso_supported;
+
+    dgram_batch_t *batches;
+    dgram_batch_t *free_list;
+    int batches_out;                /* acquired and not yet released */
+    platform_mutex_t free_lock;
+    platform_cond_t free_cond;
+
+    /* Receiver thread state */
+    platform_thread_t thread;
+    int thread_started;
+    volatile int keep_running;
+    thread_pool_t *pool;
+    dgram_batch_handler_t handler;
+    void *handler_ctx;
+
+    dgram_stats_t stats;
+};
+
+/**
+ * Defaults: 64 datagrams per batch, 2KB slots, 16 batches, no GRO.
+ */
+void dgram_config_default(dgram_config_t *config, unsigned short port);
+
+/**
+ * Open and bind a UDP socket and preallocate its batches. A port of 0
+ * leaves the socket unbound (send only). Returns 0 on success.
+ */
+int dgram_socket_open(dgram_socket_t *sock, const dgram_config_t *config);
+
+/**
+ * Stop the receiver (if running), wait for batches still on the pool to be
+ * released, then close the socket. Call this before shutting the pool down.
+ */
+void dgram_socket_close(dgram_socket_t *sock);
+
+/**
+ * Take a free batch, waiting while all are in flight. Returns NULL only
+ * when the socket is shutting down.
+ */
+dgram_batch_t *dgram_batch_acquire(dgram_socket_t *sock);
+
+/**
+ * Return a batch to its socket's free list.
+ */
+void dgram_batch_release(dgram_batch_t *batch);
+
+/**
+ * One recvmmsg() into `batch`, blocking until at least one datagram arrives
+ * or the socket's receive timeout expires. Returns the number of slots
+ * filled, 0 on timeout, or -1 on error.
+ */
+int dgram_recv_batch(dgram_socket_t *sock, dgram_batch_t *batch);
+
+/**
+ * Visit every datagram in a batch, splitting GRO super-datagrams.
+ */
+void dgram_batch_foreach(const dgram_batch_t *batch, dgram_datagram_func_t func, void *ctx);
+
+/**
+ * Start a receiver thread that fills batches and submits each as one task
+ * to `pool`; the batch is released after `handler` returns.
+ * Returns 0 on success.
+ */
+int dgram_receiver_start(dgram_socket_t *sock, thread_pool_t *pool,
+                         dgram_batch_handler_t handler, void *ctx);
+
+/**
+ * Outgoing datagram for dgram_send_many().
+ */
+typedef struct dgram_msg_t {
+    const void *data;
+    size_t len;
+    const struct sockaddr *to;
+    socklen_t to_len;
+} dgram_msg_t;
+
+/**
+ * Send `count` datagrams with as few sendmmsg() calls as possible.
+ * Returns the number sent, or -1 if none could be sent.
+ */
+int dgram_send_many(dgram_socket_t *sock, const dgram_msg_t *msgs, int count);
+
+/**
+ * Send `len` bytes to one destination as datagrams of `segment_size`
+ * bytes. Uses a single UDP_SEGMENT sendmsg() when the kernel supports GSO
+ * and falls back to sendmmsg() otherwise. Returns the number of datagrams
+ * sent, or -1 on error.
+ */
+int dgram_send_segmented(dgram_socket_t *sock, const struct sockaddr *to, socklen_t to_len,
+                         const void *data, size_t len, uint16_t segment_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DATAGRAM_IO_H
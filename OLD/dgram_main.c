@@ -0,0 +1,126 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <arpa/inet.h>
+#include "datagram_io.h"
+
+/**
+ * Batched UDP sink / blaster:
+ *
+ *   dgram_main recv [port] [pool_threads]     count datagrams per second
+ *   dgram_main send host port [size] [count]  send with GSO where available
+ *
+ * Pointing the receiver at the trap port used by minimal_send_trap.py shows
+ * the rate the batched path sustains.
+ */
+
+static volatile sig_atomic_t g_keepRunning = 1;
+
+void handle_sigint(int sig)
+{
+    (void)sig; // unused
+    g_keepRunning = 0;
+}
+
+static void count_datagram(void *ctx, const uint8_t *data, size_t len,
+                           const struct sockaddr_storage *from)
+{
+    (void)data;
+    (void)len;
+    (void)from;
+    (*(unsigned long *)ctx)++;
+}
+
+/**
+ * Pool task body: one call per received batch.
+ */
+static void on_batch(void *ctx, const dgram_batch_t *batch)
+{
+    (void)ctx;
+    unsigned long n = 0;
+    dgram_batch_foreach(batch, count_datagram, &n);
+}
+
+static int run_receiver(unsigned short port, int pool_threads)
+{
+    dgram_config_t config;
+    dgram_config_default(&config, port);
+    config.enable_gro = 1;
+    config.slot_size = 65536;
+
+    dgram_socket_t sock;
+    if (dgram_socket_open(&sock, &config) != 0) return 1;
+
+    thread_pool_t pool;
+    thread_pool_init(&pool, pool_threads);
+    dgram_receiver_start(&sock, &pool, on_batch, NULL);
+    printf("[Main] Receiving on UDP port %u (GRO %s). Press Ctrl + C to stop.\n",
+           port, sock.gro_enabled ? "on" : "off");
+
+    unsigned long long last = 0;
+    while (g_keepRunning) {
+        platform_sleep_ms(1000);
+        unsigned long long now = sock.stats.datagrams;
+        printf("[Main] %llu datagrams/s, %llu batches total, %llu waits\n",
+               now - last, (unsigned long long)sock.stats.batches,
+               (unsigned long long)sock.stats.batch_waits);
+        last = now;
+    }
+
+    dgram_socket_close(&sock);
+    thread_pool_shutdown(&pool);
+    return 0;
+}
+
+static int run_sender(const char *host, unsigned short port, int size, long count)
+{
+    dgram_config_t config;
+    dgram_config_default(&config, 0);
+    config.num_batches = 1;
+
+    dgram_socket_t sock;
+    if (dgram_socket_open(&sock, &config) != 0) return 1;
+
+    struct sockaddr_in to;
+    memset(&to, 0, sizeof(to));
+    to.sin_family = AF_INET;
+    to.sin_port = htons(port);
+    inet_pton(AF_INET, host, &to.sin_addr);
+
+    /* 64 datagrams per call, the same buffer every time */
+    size_t burst = (size_t)size * 64;
+    unsigned char *buf = (unsigned char *)calloc(1, burst);
+    if (!buf) return 1;
+
+    unsigned long long start = platform_time_ns();
+    long sent = 0;
+    while (g_keepRunning && sent < count) {
+        int rc = dgram_send_segmented(&sock, (struct sockaddr *)&to, sizeof(to),
+                                      buf, burst, (uint16_t)size);
+        if (rc < 0) break;
+        sent += rc;
+    }
+    double secs = (platform_time_ns() - start) / 1e9;
+    printf("[Main] Sent %ld datagrams in %.3fs (%.0f/s, GSO %s, %llu calls)\n",
+           sent, secs, sent / (secs > 0 ? secs : 1), sock.gso_supported ? "on" : "off",
+           (unsigned long long)sock.stats.send_calls);
+
+    free(buf);
+    dgram_socket_close(&sock);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    signal(SIGINT, handle_sigint);
+
+    if (argc > 1 && strcmp(argv[1], "send") == 0 && argc > 3) {
+        int size = argc > 4 ? atoi(argv[4]) : 512;
+        long count = argc > 5 ? atol(argv[5]) : 1000000;
+        return run_sender(argv[2], (unsigned short)atoi(argv[3]), size, count);
+    }
+    unsigned short port = argc > 2 ? (unsigned short)atoi(argv[2]) : 1162;
+    int threads = argc > 3 ? atoi(argv[3]) : 4;
+    return run_receiver(port, threads);
+}
@@ -0,0 +1,394 @@
+#define _GNU_SOURCE  // statx, O_DIRECTORY
+#include "dir_walker.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <regex.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+/* getdents64 buffer: one call returns a few thousand entries */
+#define DIRENT_BUFFER (256 * 1024)
+
+/* Matches handed to the sink at a time, and the bytes of path text behind them */
+#define BATCH_ENTRIES 512
+#define BATCH_PATHS (128 * 1024)
+
+#define STATX_FLAGS AT_STATX_DONT_SYNC
+
+typedef struct linux_dirent64_t {
+    uint64_t d_ino;
+    int64_t d_off;
+    unsigned short d_reclen;
+    unsigned char d_type;
+    char d_name[];
+} linux_dirent64_t;
+
+/* One directory still to be read; children are queued as these */
+typedef struct walk_dir_t {
+    struct walk_dir_t *next;
+    struct dir_walker_t *walker;
+    int depth;
+    size_t len;
+    char path[];
+} walk_dir_t;
+
+/* Per-task scratch, one per thread that can run a task at once */
+typedef struct walk_slot_t {
+    struct walk_slot_t *next_free;
+    char *dirents;
+    dir_walk_entry_t batch[BATCH_ENTRIES];
+    size_t batch_count;
+    char *paths;
+    size_t paths_used;
+    regex_t regex;                  /* regexec on a shared regex_t takes a lock */
+    int has_regex;
+} walk_slot_t;
+
+typedef struct dir_walker_t {
+    dir_walk_config_t config;
+    thread_pool_t *pool;
+    dir_walk_sink_t sink;
+    void *ctx;
+    unsigned int stat_mask;         /* statx fields the filters read, 0 if none */
+
+    platform_mutex_t lock;          /* outstanding, free_slots, pending */
+    platform_cond_t idle;
+    size_t outstanding;
+    walk_slot_t *slots;
+    int num_slots;
+    walk_slot_t *free_slots;
+    walk_dir_t *pending;            /* without a pool: directories not yet read */
+
+    platform_mutex_t sink_lock;
+    volatile int stop;
+    dir_walk_stats_t stats;
+} dir_walker_t;
+
+/* =============================
+ * Helpers
+ * ============================= */
+
+static inline int64_t statx_ns(const struct statx_timestamp *t)
+{
+    return (int64_t)t->tv_sec * 1000000000LL + t->tv_nsec;
+}
+
+static inline int in_range(int64_t value, int64_t min, int64_t max)
+{
+    return (!min || value >= min) && (!max || value <= max);
+}
+
+/* `parent` + "/" + `name` at out, as os.path.join() would; returns the length */
+static size_t join_path(char *out, const char *parent, size_t parent_len, const char *name, size_t name_len)
+{
+    size_t n = parent_len;
+    memcpy(out, parent, parent_len);
+    if (n == 0 || out[n - 1] != '/') out[n++] = '/';
+    memcpy(out + n, name, name_len + 1);
+    return n + name_len;
+}
+
+static walk_dir_t *new_dir(dir_walker_t *walker, const char *parent, size_t parent_len,
+                           const char *name, size_t name_len, int depth)
+{
+    walk_dir_t *dir = (walk_dir_t *)malloc(sizeof(walk_dir_t) + parent_len + name_len + 2);
+    if (!dir) return NULL;
+    dir->next = NULL;
+    dir->walker = walker;
+    dir->depth = depth;
+    dir->len = name ? join_path(dir->path, parent, parent_len, name, name_len) : parent_len;
+    if (!name) memcpy(dir->path, parent, parent_len + 1);
+    return dir;
+}
+
+static walk_slot_t *acquire_slot(dir_walker_t *walker)
+{
+    platform_mutex_lock(&walker->lock);
+    walk_slot_t *slot = walker->free_slots;
+    walker->free_slots = slot->next_free;
+    platform_mutex_unlock(&walker->lock);
+    return slot;
+}
+
+static void release_slot(dir_walker_t *walker, walk_slot_t *slot)
+{
+    platform_mutex_lock(&walker->lock);
+    slot->next_free = walker->free_slots;
+    walker->free_slots = slot;
+    platform_mutex_unlock(&walker->lock);
+}
+
+static void flush_batch(dir_walker_t *walker, walk_slot_t *slot)
+{
+    if (slot->batch_count == 0) return;
+    platform_mutex_lock(&walker->sink_lock);
+    if (!walker->stop && walker->sink(walker->ctx, slot->batch, slot->batch_count) != 0) walker->stop = 1;
+    platform_mutex_unlock(&walker->sink_lock);
+    __atomic_fetch_add(&walker->stats.matches, slot->batch_count, __ATOMIC_RELAXED);
+    slot->batch_count = 0;
+    slot->paths_used = 0;
+}
+
+/* =============================
+ * Directory task
+ * ============================= */
+
+static void walk_directory(walk_dir_t *dir);
+
+static void dir_task(void *arg)
+{
+    walk_directory((walk_dir_t *)arg);
+}
+
+static void submit(dir_walker_t *walker, walk_dir_t *dir)
+{
+    if (walker->pool) {
+        /* Read on this thread if it cannot be queued; depth bounds the recursion */
+        if (thread_pool_add_task(walker->pool, dir_task, dir) != 0) walk_directory(dir);
+        return;
+    }
+    dir->next = walker->pending;
+    walker->pending = dir;
+}
+
+/*
+ * Applies the filters to one non-directory entry. Returns 1 to report it,
+ * 0 to skip it, 2 if it turned out to be a directory (DT_UNKNOWN) and -1
+ * if it could not be stat'ed.
+ */
+static int check_entry(dir_walker_t *walker, walk_slot_t *slot, int fd, const linux_dirent64_t *d,
+                       unsigned char *type, struct statx *stx, int *has_stat, uint64_t *stat_calls)
+{
+    const dir_walk_config_t *config = &walker->config;
+    unsigned int mask = walker->stat_mask;
+    int flags = STATX_FLAGS | AT_SYMLINK_NOFOLLOW;
+
+    *has_stat = 0;
+    if (*type == DT_UNKNOWN) {
+        /* Some filesystems do not fill d_type; the type costs a statx */
+        (*stat_calls)++;
+        if (statx(fd, d->d_name, flags, STATX_TYPE | mask, stx) != 0) return -1;
+        if (S_ISDIR(stx->stx_mode)) return 2;
+        *type = S_ISLNK(stx->stx_mode) ? DT_LNK : S_ISREG(stx->stx_mode) ? DT_REG : DT_UNKNOWN;
+        *has_stat = *type != DT_LNK && mask != 0;
+    }
+    if (slot->has_regex && regexec(&slot->regex, d->d_name, 0, NULL, 0) != 0) return 0;
+
+    if (*type == DT_LNK) {
+        /* Links are judged by their target; links to directories are not files to os.walk */
+        (*stat_calls)++;
+        if (statx(fd, d->d_name, STATX_FLAGS, STATX_TYPE | mask, stx) != 0) return -1;
+        if (S_ISDIR(stx->stx_mode)) return 0;
+        *has_stat = mask != 0;
+    } else if (mask && !*has_stat) {
+        (*stat_calls)++;
+        if (statx(fd, d->d_name, flags, mask, stx) != 0) return -1;
+        *has_stat = 1;
+    }
+    if (!*has_stat) return 1;
+
+    if (stx->stx_size < config->min_size || (config->max_size && stx->stx_size > config->max_size)) return 0;
+    if (!in_range(statx_ns(&stx->stx_ctime), config->min_ctime_ns, config->max_ctime_ns)) return 0;
+    if (!in_range(statx_ns(&stx->stx_mtime), config->min_mtime_ns, config->max_mtime_ns)) return 0;
+    return 1;
+}
+
+static void add_match(dir_walker_t *walker, walk_slot_t *slot, const walk_dir_t *dir,
+                      const linux_dirent64_t *d, unsigned char type, const struct statx *stx, int has_stat)
+{
+    size_t name_len = strlen(d->d_name);
+
+    if (slot->batch_count == BATCH_ENTRIES || BATCH_PATHS - slot->paths_used < dir->len + name_len + 2) {
+        flush_batch(walker, slot);
+    }
+    dir_walk_entry_t *entry = &slot->batch[slot->batch_count++];
+    char *path = slot->paths + slot->paths_used;
+
+    entry->path = path;
+    entry->path_len = (uint32_t)join_path(path, dir->path, dir->len, d->d_name, name_len);
+    entry->name_offset = entry->path_len - (uint32_t)name_len;
+    entry->type = type;
+    entry->has_stat = has_stat;
+    entry->size = has_stat ? stx->stx_size : 0;
+    entry->mtime_ns = has_stat ? statx_ns(&stx->stx_mtime) : 0;
+    entry->ctime_ns = has_stat ? statx_ns(&stx->stx_ctime) : 0;
+    slot->paths_used += entry->path_len + 1;
+}
+
+static void walk_directory(walk_dir_t *dir)
+{
+    dir_walker_t *walker = dir->walker;
+    const int max_depth = walker->config.max_depth;
+    walk_dir_t *children = NULL, *child;
+    uint64_t entries = 0, stat_calls = 0, errors = 0;
+
+    int fd = walker->stop ? -1 : open(dir->path, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        errors += !walker->stop;
+    } else {
+        walk_slot_t *slot = acquire_slot(walker);
+        long n;
+
+        while ((n = syscall(SYS_getdents64, fd, slot->dirents, DIRENT_BUFFER)) > 0 && !walker->stop) {
+            for (long offset = 0; offset < n;) {
+                const linux_dirent64_t *d = (const linux_dirent64_t *)(slot->dirents + offset);
+                unsigned char type = d->d_type;
+                struct statx stx;
+                int has_stat, rc = 2;
+
+                offset += d->d_reclen;
+                if (d->d_name[0] == '.' && (d->d_name[1] == '\0' || (d->d_name[1] == '.' && d->d_name[2] == '\0'))) {
+                    continue;
+                }
+                entries++;
+                if (type != DT_DIR) rc = check_entry(walker, slot, fd, d, &type, &stx, &has_stat, &stat_calls);
+                if (rc == 1) {
+                    add_match(walker, slot, dir, d, type, &stx, has_stat);
+                } else if (rc == 2 && (!max_depth || dir->depth < max_depth)) {
+                    child = new_dir(walker, dir->path, dir->len, d->d_name, strlen(d->d_name), dir->depth + 1);
+                    if (!child) {
+                        errors++;
+                        continue;
+                    }
+                    child->next = children;
+                    children = child;
+                } else if (rc < 0) {
+                    errors++;
+                }
+            }
+        }
+        if (n < 0) errors++;
+        close(fd);
+        flush_batch(walker, slot);
+        release_slot(walker, slot);
+        __atomic_fetch_add(&walker->stats.directories, 1, __ATOMIC_RELAXED);
+    }
+
+    __atomic_fetch_add(&walker->stats.entries, entries, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&walker->stats.stat_calls, stat_calls, __ATOMIC_RELAXED);
+    __atomic_fetch_add(&walker->stats.errors, errors, __ATOMIC_RELAXED);
+
+    /* Children count as outstanding before this directory stops counting */
+    size_t queued = 0;
+    for (child = children; child; child = child->next) queued++;
+    if (queued) {
+        platform_mutex_lock(&walker->lock);
+        walker->outstanding += queued;
+        platform_mutex_unlock(&walker->lock);
+    }
+    while ((child = children) != NULL) {
+        children = child->next;
+        submit(walker, child);
+    }
+    free(dir);
+
+    platform_mutex_lock(&walker->lock);
+    if (--walker->outstanding == 0) platform_cond_broadcast(&walker->idle);
+    platform_mutex_unlock(&walker->lock);
+}
+
+/* =============================
+ * Public API
+ * ============================= */
+
+static void free_slots(dir_walker_t *walker)
+{
+    for (int i = 0; i < walker->num_slots; i++) {
+        free(walker->slots[i].dirents);
+        free(walker->slots[i].paths);
+        if (walker->slots[i].has_regex) regfree(&walker->slots[i].regex);
+    }
+    free(walker->slots);
+}
+
+static int init_slots(dir_walker_t *walker)
+{
+    const char *pattern = walker->config.name_pattern;
+
+    walker->num_slots = (walker->pool ? walker->pool->num_threads : 0) + 1;
+    walker->slots = (walk_slot_t *)calloc((size_t)walker->num_slots, sizeof(walk_slot_t));
+    if (!walker->slots) return -1;
+
+    for (int i = 0; i < walker->num_slots; i++) {
+        walk_slot_t *slot = &walker->slots[i];
+        slot->dirents = (char *)malloc(DIRENT_BUFFER);
+        slot->paths = (char *)malloc(BATCH_PATHS);
+        if (!slot->dirents || !slot->paths) return -1;
+        if (pattern) {
+            int rc = regcomp(&slot->regex, pattern, REG_EXTENDED | REG_NOSUB);
+            if (rc != 0) {
+                char message[256];
+                regerror(rc, &slot->regex, message, sizeof(message));
+                fprintf(stderr, "dir_walk_run: bad name pattern '%s': %s\n", pattern, message);
+                return -1;
+            }
+            slot->has_regex = 1;
+        }
+        slot->next_free = walker->free_slots;
+        walker->free_slots = slot;
+    }
+    return 0;
+}
+
+int dir_walk_run(const dir_walk_config_t *config, thread_pool_t *pool,
+                 dir_walk_sink_t sink, void *ctx, dir_walk_stats_t *stats)
+{
+    if (!config || !config->root || !sink) return -1;
+
+    /* Fail on an unreadable root here rather than as one error in the stats */
+    int fd = open(config->root, O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "dir_walk_run: cannot open %s: %s\n", config->root, strerror(errno));
+        return -1;
+    }
+    close(fd);
+
+    dir_walker_t *walker = (dir_walker_t *)calloc(1, sizeof(dir_walker_t));
+    if (!walker) return -1;
+    walker->config = *config;
+    walker->pool = pool && pool->num_threads > 0 ? pool : NULL;
+    walker->sink = sink;
+    walker->ctx = ctx;
+    if (config->min_size || config->max_size) walker->stat_mask |= STATX_SIZE;
+    if (config->min_ctime_ns || config->max_ctime_ns) walker->stat_mask |= STATX_CTIME;
+    if (config->min_mtime_ns || config->max_mtime_ns) walker->stat_mask |= STATX_MTIME;
+
+    walk_dir_t *root = new_dir(walker, config->root, strlen(config->root), NULL, 0, 1);
+    if (!root || init_slots(walker) != 0) {
+        free(root);
+        free_slots(walker);
+        free(walker);
+        return -1;
+    }
+    platform_mutex_init(&walker->lock);
+    platform_mutex_init(&walker->sink_lock);
+    platform_cond_init(&walker->idle);
+    walker->outstanding = 1;
+
+    submit(walker, root);
+    if (walker->pool) {
+        platform_mutex_lock(&walker->lock);
+        while (walker->outstanding > 0) platform_cond_wait(&walker->idle, &walker->lock);
+        platform_mutex_unlock(&walker->lock);
+    } else {
+        walk_dir_t *dir;
+        while ((dir = walker->pending) != NULL) {
+            walker->pending = dir->next;
+            walk_directory(dir);
+        }
+    }
+
+    if (stats) *stats = walker->stats;
+    platform_cond_destroy(&walker->idle);
+    platform_mutex_destroy(&walker->sink_lock);
+    platform_mutex_destroy(&walker->lock);
+    free_slots(walker);
+    free(walker);
+    return 0;
+}
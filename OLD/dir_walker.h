@@ -0,0 +1,82 @@
+#ifndef DIR_WALKER_H
+#define DIR_WALKER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "threadpool.h"
+
+/**
+ * Parallel directory walker (find_files.py). Linux only.
+ *
+ * Every directory is one pool task: it is read with getdents64 into a
+ * large buffer and its subdirectories are queued as new tasks, so the
+ * tree fans out across the pool instead of being walked on one thread.
+ * The entry type from getdents64 tells files from directories without a
+ * stat. The filters are applied per entry, cheapest first: the name
+ * pattern before any syscall, then one statx asking for only the fields
+ * the time and size filters need. With no time or size filter no file
+ * is stat'ed at all.
+ *
+ * As with os.walk, symbolic links to directories are not followed and
+ * are not reported. Links to files are reported and their target is
+ * checked against the filters, like os.path.getctime() would. Matches
+ * reach the sink in batches while the walk is still running.
+ */
+
+typedef struct dir_walk_config_t {
+    const char *root;
+    const char *name_pattern;       /* POSIX ERE matched against the base name, or NULL */
+    uint64_t min_size;
+    uint64_t max_size;              /* 0: no upper bound */
+    int64_t min_ctime_ns;           /* time bounds are ns since the epoch, 0: open */
+    int64_t max_ctime_ns;
+    int64_t min_mtime_ns;
+    int64_t max_mtime_ns;
+    int max_depth;                  /* 0: unlimited; 1 is the root's own files */
+} dir_walk_config_t;
+
+typedef struct dir_walk_entry_t {
+    const char *path;               /* root joined with the relative path */
+    uint32_t path_len;
+    uint32_t name_offset;           /* base name at path + name_offset */
+    unsigned char type;             /* DT_* of the entry, never DT_DIR */
+    int has_stat;                   /* the fields below were filled by statx */
+    uint64_t size;
+    int64_t mtime_ns;
+    int64_t ctime_ns;
+} dir_walk_entry_t;
+
+/**
+ * Receives matches, `count` at a time; the entries are only valid for
+ * the call. Calls are serialised, so the sink needs no locking. A nonzero
+ * return stops the walk as soon as the running tasks notice.
+ */
+typedef int (*dir_walk_sink_t)(void *ctx, const dir_walk_entry_t *entries, size_t count);
+
+typedef struct dir_walk_stats_t {
+    uint64_t directories;           /* directories read */
+    uint64_t entries;               /* names seen, excluding . and .. */
+    uint64_t stat_calls;
+    uint64_t matches;
+    uint64_t errors;                /* directories or files that could not be read */
+} dir_walk_stats_t;
+
+/**
+ * Walk `config->root`, using `pool` (or only the calling thread when it is
+ * NULL), passing matching files to `sink`. Blocks until the walk is done.
+ * Returns 0, or -1 if the root cannot be opened, the pattern does not
+ * compile or memory ran out. `stats` may be NULL.
+ */
+int dir_walk_run(const dir_walk_config_t *config, thread_pool_t *pool,
+                 dir_walk_sink_t sink, void *ctx, dir_walk_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // DIR_WALKER_H
@@ -0,0 +1,626 @@
+#include "file_compare.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+/* Same-size sets at least this large are hashed before comparing */
+#define HASH_MIN_SET 3
+
+/* Work items per pool task, per thread: enough slack to even out file sizes */
+#define TASKS_PER_THREAD 8
+
+/* =============================
+ * Content hash
+ * ============================= */
+
+#define PRIME32_1 0x9E3779B1U
+#define PRIME32_2 0x85EBCA77U
+#define PRIME32_3 0xC2B2AE3DU
+#define PRIME64_1 0x9E3779B185EBCA87ULL
+#define PRIME64_2 0xC2B2AE3D27D4EB4FULL
+#define PRIME64_3 0x165667B19E3779F9ULL
+#define PRIME64_4 0x85EBCA77C2B2AE63ULL
+#define PRIME64_5 0x27D4EB2F165667C5ULL
+
+/* Stripe s of a block uses keys [s, s + 8); the scramble uses [16, 24) */
+#define STRIPES_PER_BLOCK 16
+
+static const uint64_t g_secret[24] = {
+    0xB4EDA145459CE647ULL, 0xDF76E3933260D7DAULL, 0x1B15856EB85B3B91ULL, 0x93D2EB0826C5F145ULL,
+    0xB076630D4F977F61ULL, 0xBBF079F7CB180168ULL, 0xDF1FD1E30572503AULL, 0xAB6DACFA8DFB6A9BULL,
+    0xE065FA893A2F00FEULL, 0xDD599B05F612ABF1ULL, 0x8386345D85942561ULL, 0xDD2307E74B45B486ULL,
+    0x3F19CE732C082CCCULL, 0x75B07DDD0DD5366EULL, 0x92775F5119FE4A34ULL, 0x10B15FEF2710273EULL,
+    0xCA084DAFD91B08FDULL, 0x21A8976B00B83BEAULL, 0xBAF0F4C8B98924BCULL, 0x7EC97ACD1B2086BDULL,
+    0x282F38F9D9B4DC28ULL, 0xEE9A96F3D04FD312ULL, 0x0AD7F54B7F74A050ULL, 0x453BB24D668EC3CBULL,
+};
+
+/* Lane i takes lo32 * hi32 of (data ^ key), lane i ^ 1 takes the data itself */
+static inline void accumulate(uint64_t *acc, const unsigned char *p, const uint64_t *key)
+{
+#if defined(__SSE2__)
+    for (int i = 0; i < 4; i++) {
+        __m128i a = _mm_loadu_si128((const __m128i *)(acc + 2 * i));
+        __m128i d = _mm_loadu_si128((const __m128i *)(p + 16 * i));
+        __m128i dk = _mm_xor_si128(d, _mm_loadu_si128((const __m128i *)(key + 2 * i)));
+        __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+        a = _mm_add_epi64(a, _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2)));
+        _mm_storeu_si128((__m128i *)(acc + 2 * i), _mm_add_epi64(a, product));
+    }
+#else
+    for (int i = 0; i < 8; i++) {
+        uint64_t d, dk;
+        memcpy(&d, p + 8 * i, 8);
+        dk = d ^ key[i];
+        acc[i ^ 1] += d;
+        acc[i] += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+    }
+#endif
+}
+
+static inline void scramble(uint64_t *acc)
+{
+    for (int i = 0; i < 8; i++) {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= g_secret[STRIPES_PER_BLOCK + i];
+        acc[i] = a * PRIME32_1;
+    }
+}
+
+static void hash_stripes(file_hash_t *h, const unsigned char *p, size_t stripes)
+{
+    for (size_t s = 0; s < stripes; s++, p += FILE_HASH_STRIPE) {
+        accumulate(h->acc, p, g_secret + h->stripe);
+        if (++h->stripe == STRIPES_PER_BLOCK) {
+            scramble(h->acc);
+            h->stripe = 0;
+        }
+    }
+}
+
+static inline uint64_t mul128_fold64(uint64_t a, uint64_t b)
+{
+    __uint128_t product = (__uint128_t)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+}
+
+void file_hash_init(file_hash_t *h)
+{
+    static const uint64_t init[8] = {
+        PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3, PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1
+    };
+    memcpy(h->acc, init, sizeof(init));
+    h->buffered = 0;
+    h->stripe = 0;
+    h->total = 0;
+}
+
+void file_hash_update(file_hash_t *h, const void *data, size_t len)
+{
+    const unsigned char *p = (const unsigned char *)data;
+
+    h->total += len;
+    if (h->buffered) {
+        size_t take = FILE_HASH_STRIPE - h->buffered;
+        if (take > len) take = len;
+        memcpy(h->buffer + h->buffered, p, take);
+        h->buffered += (uint32_t)take;
+        p += take;
+        len -= take;
+        if (h->buffered < FILE_HASH_STRIPE) return;
+        hash_stripes(h, h->buffer, 1);
+        h->buffered = 0;
+    }
+
+    size_t stripes = len / FILE_HASH_STRIPE;
+    hash_stripes(h, p, stripes);
+    p += stripes * FILE_HASH_STRIPE;
+    len -= stripes * FILE_HASH_STRIPE;
+
+    memcpy(h->buffer, p, len);
+    h->buffered = (uint32_t)len;
+}
+
+uint64_t file_hash_final(const file_hash_t *h)
+{
+    uint64_t acc[8];
+    memcpy(acc, h->acc, sizeof(acc));
+
+    /* The zero padding is told apart by the length folded in below */
+    if (h->buffered) {
+        unsigned char last[FILE_HASH_STRIPE] = {0};
+        memcpy(last, h->buffer, h->buffered);
+        accumulate(acc, last, g_secret + h->stripe);
+    }
+
+    uint64_t result = h->total * PRIME64_1;
+    for (int i = 0; i < 4; i++) {
+        result += mul128_fold64(acc[2 * i] ^ g_secret[2 * i + 3], acc[2 * i + 1] ^ g_secret[2 * i + 4]);
+    }
+    result ^= result >> 37;
+    result *= 0x165667919E3779F9ULL;
+    return result ^ (result >> 32);
+}
+
+uint64_t file_hash64(const void *data, size_t len)
+{
+    file_hash_t h;
+    file_hash_init(&h);
+    file_hash_update(&h, data, len);
+    return file_hash_final(&h);
+}
+
+/* =============================
+ * Reading and normalising
+ * ============================= */
+
+/* Maps `path` read-only. Returns 0 or an errno; an empty file maps to NULL */
+static int map_file(const char *path, const unsigned char **data, size_t *size)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY);
+
+    *data = NULL;
+    *size = 0;
+    if (fd < 0) return errno;
+    if (fstat(fd, &st) != 0) {
+        int err = errno;
+        close(fd);
+        return err;
+    }
+    if (!S_ISREG(st.st_mode)) {
+        close(fd);
+        return S_ISDIR(st.st_mode) ? EISDIR : EINVAL;
+    }
+    if (st.st_size > 0) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map == MAP_FAILED) {
+            int err = errno;
+            close(fd);
+            return err;
+        }
+        madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+        *data = (const unsigned char *)map;
+        *size = (size_t)st.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+static void unmap_file(const unsigned char *data, size_t size)
+{
+    if (data) munmap((void *)data, size);
+}
+
+static inline size_t bom_length(const unsigned char *p, size_t n)
+{
+    return n >= 3 && p[0] == 0xEF && p[1] == 0xBB && p[2] == 0xBF ? 3 : 0;
+}
+
+/* Hashes the normalised stream straight from the mapping, one run per line ending */
+static uint64_t hash_normalized(const unsigned char *p, size_t n, uint64_t *length)
+{
+    const unsigned char *end = p + n;
+    file_hash_t h;
+
+    file_hash_init(&h);
+    p += bom_length(p, n);
+    while (p < end) {
+        /* memchr is vectorised in libc; plain LF text is a single run */
+        const unsigned char *cr = (const unsigned char *)memchr(p, '\r', (size_t)(end - p));
+        if (!cr) {
+            file_hash_update(&h, p, (size_t)(end - p));
+            break;
+        }
+        file_hash_update(&h, p, (size_t)(cr - p));
+        file_hash_update(&h, "\n", 1);
+        p = cr + 1;
+        if (p < end && *p == '\n') p++;
+    }
+    *length = h.total;
+    return file_hash_final(&h);
+}
+
+/* Next normalised byte of p[*i..n), advancing past a CRLF as one */
+static inline int next_normalized(const unsigned char *p, size_t n, size_t *i)
+{
+    unsigned char c = p[(*i)++];
+    if (c != '\r') return c;
+    if (*i < n && p[*i] == '\n') (*i)++;
+    return '\n';
+}
+
+/*
+ * Compares two files as normalised streams without copying either. While
+ * neither side has a CR, sixteen bytes are checked per step; a mismatch or
+ * CR drops to one normalised byte at a time until both are clear again.
+ */
+static int normalized_equal(const unsigned char *a, size_t an, const unsigned char *b, size_t bn)
+{
+    size_t i = bom_length(a, an), j = bom_length(b, bn);
+
+    while (i < an && j < bn) {
+#if defined(__SSE2__)
+        const __m128i cr = _mm_set1_epi8('\r');
+        while (i + 16 <= an && j + 16 <= bn) {
+            __m128i va = _mm_loadu_si128((const __m128i *)(a + i));
+            __m128i vb = _mm_loadu_si128((const __m128i *)(b + j));
+            unsigned int differ = ~(unsigned int)_mm_movemask_epi8(_mm_cmpeq_epi8(va, vb)) & 0xFFFF;
+            unsigned int special = (unsigned int)_mm_movemask_epi8(
+                _mm_or_si128(_mm_cmpeq_epi8(va, cr), _mm_cmpeq_epi8(vb, cr)));
+            unsigned int stop = differ | special;
+            if (stop) {
+                unsigned int k = (unsigned int)__builtin_ctz(stop);
+                i += k;
+                j += k;
+                break;
+            }
+            i += 16;
+            j += 16;
+        }
+        if (i >= an || j >= bn) break;
+#endif
+        if (next_normalized(a, an, &i) != next_normalized(b, bn, &j)) return 0;
+    }
+    /* Any byte left over normalises to at least one byte */
+    return i == an && j == bn;
+}
+
+/* =============================
+ * Parallel passes
+ * ============================= */
+
+typedef struct compare_key_t {
+    uint64_t length;
+    uint64_t hash;
+    uint32_t index;
+} compare_key_t;
+
+typedef struct compare_job_t {
+    file_compare_t *fc;
+    const uint32_t *items;          /* file indices (stat, hash) */
+    const compare_key_t *keys;      /* sorted keys (verify) */
+    const size_t *buckets;          /* key ranges: bucket b is [buckets[2b], buckets[2b + 1]) */
+} compare_job_t;
+
+typedef void (*compare_work_t)(const compare_job_t *job, size_t begin, size_t end);
+
+typedef struct compare_batch_t {
+    platform_mutex_t lock;
+    platform_cond_t idle;
+    size_t outstanding;
+} compare_batch_t;
+
+typedef struct compare_task_t {
+    compare_batch_t *batch;
+    const compare_job_t *job;
+    compare_work_t work;
+    size_t begin;
+    size_t end;
+} compare_task_t;
+
+static void compare_task(void *arg)
+{
+    compare_task_t *task = (compare_task_t *)arg;
+    compare_batch_t *batch = task->batch;
+
+    task->work(task->job, task->begin, task->end);
+
+    platform_mutex_lock(&batch->lock);
+    if (--batch->outstanding == 0) platform_cond_broadcast(&batch->idle);
+    platform_mutex_unlock(&batch->lock);
+}
+
+/* Runs work over [0, count) in chunks on the pool and waits for all of them */
+static int run_parallel(thread_pool_t *pool, const compare_job_t *job, compare_work_t work, size_t count)
+{
+    if (count == 0) return 0;
+    if (!pool || pool->num_threads <= 1 || count == 1) {
+        work(job, 0, count);
+        return 0;
+    }
+
+    size_t chunks = (size_t)pool->num_threads * TASKS_PER_THREAD;
+    if (chunks > count) chunks = count;
+    size_t per_chunk = (count + chunks - 1) / chunks;
+    chunks = (count + per_chunk - 1) / per_chunk;
+
+    compare_task_t *tasks = (compare_task_t *)calloc(chunks, sizeof(compare_task_t));
+    if (!tasks) return -1;
+
+    compare_batch_t batch;
+    platform_mutex_init(&batch.lock);
+    platform_cond_init(&batch.idle);
+    batch.outstanding = chunks;
+
+    for (size_t c = 0; c < chunks; c++) {
+        tasks[c].batch = &batch;
+        tasks[c].job = job;
+        tasks[c].work = work;
+        tasks[c].begin = c * per_chunk;
+        tasks[c].end = c + 1 == chunks ? count : (c + 1) * per_chunk;
+        if (thread_pool_add_task(pool, compare_task, &tasks[c]) != 0) compare_task(&tasks[c]);
+    }
+
+    platform_mutex_lock(&batch.lock);
+    while (batch.outstanding > 0) platform_cond_wait(&batch.idle, &batch.lock);
+    platform_mutex_unlock(&batch.lock);
+
+    platform_cond_destroy(&batch.idle);
+    platform_mutex_destroy(&batch.lock);
+    free(tasks);
+    return 0;
+}
+
+static void note_read(file_compare_t *fc, size_t bytes)
+{
+    __atomic_fetch_add(&fc->bytes_read, (uint64_t)bytes, __ATOMIC_RELAXED);
+}
+
+static void stat_work(const compare_job_t *job, size_t begin, size_t end)
+{
+    for (size_t i = begin; i < end; i++) {
+        file_entry_t *file = &job->fc->files[job->items[i]];
+        struct stat st;
+
+        if (stat(file->path, &st) != 0) {
+            file->error = errno;
+        } else if (!S_ISREG(st.st_mode)) {
+            file->error = S_ISDIR(st.st_mode) ? EISDIR : EINVAL;
+        } else {
+            file->size = (uint64_t)st.st_size;
+            file->length = file->size;
+        }
+    }
+}
+
+static void hash_work(const compare_job_t *job, size_t begin, size_t end)
+{
+    file_compare_t *fc = job->fc;
+
+    for (size_t i = begin; i < end; i++) {
+        file_entry_t *file = &fc->files[job->items[i]];
+        const unsigned char *data;
+        size_t size;
+
+        file->error = map_file(file->path, &data, &size);
+        if (file->error) continue;
+        file->size = size;
+        if (fc->mode == FILE_COMPARE_NORMALIZED) {
+            file->hash = hash_normalized(data, size, &file->length);
+        } else {
+            file->length = size;
+            file->hash = file_hash64(data, size);
+        }
+        note_read(fc, size);
+        unmap_file(data, size);
+    }
+}
+
+/* Full compare of two files with equal keys; a file that fails to map gets its error set */
+static int same_content(file_compare_t *fc, uint32_t x, uint32_t y)
+{
+    file_entry_t *a = &fc->files[x], *b = &fc->files[y];
+    const unsigned char *da, *db;
+    size_t na, nb;
+    int equal = 0;
+
+    if ((a->error = map_file(a->path, &da, &na)) != 0) return 0;
+    if ((b->error = map_file(b->path, &db, &nb)) != 0) {
+        unmap_file(da, na);
+        return 0;
+    }
+    if (fc->mode == FILE_COMPARE_NORMALIZED) {
+        equal = normalized_equal(da, na, db, nb);
+    } else {
+        /* glibc's memcmp is already vectorised for this */
+        equal = na == nb && (na == 0 || memcmp(da, db, na) == 0);
+    }
+    note_read(fc, na + nb);
+    unmap_file(da, na);
+    unmap_file(db, nb);
+    return equal;
+}
+
+/*
+ * Each bucket holds files with equal (length, hash), in input order. A file
+ * joins the first earlier representative it really matches, or becomes one;
+ * apart from collisions that is always the bucket's first file.
+ */
+static void verify_work(const compare_job_t *job, size_t begin, size_t end)
+{
+    file_compare_t *fc = job->fc;
+
+    for (size_t b = begin; b < end; b++) {
+        const compare_key_t *first = job->keys + job->buckets[2 * b];
+        const compare_key_t *last = job->keys + job->buckets[2 * b + 1];
+
+        for (const compare_key_t *k = first + 1; k < last; k++) {
+            file_entry_t *file = &fc->files[k->index];
+            for (const compare_key_t *rep = first; rep < k && !file->error; rep++) {
+                file_entry_t *candidate = &fc->files[rep->index];
+                if (candidate->match != rep->index || candidate->error) continue;
+                if (fc->mode == FILE_COMPARE_EXACT && candidate->length == 0) {
+                    file->match = rep->index;
+                    break;
+                }
+                if (same_content(fc, rep->index, k->index)) {
+                    file->match = rep->index;
+                    break;
+                }
+            }
+        }
+    }
+}
+
+static int compare_keys(const void *a, const void *b)
+{
+    const compare_key_t *x = (const compare_key_t *)a, *y = (const compare_key_t *)b;
+
+    if (x->length != y->length) return x->length < y->length ? -1 : 1;
+    if (x->hash != y->hash) return x->hash < y->hash ? -1 : 1;
+    return x->index < y->index ? -1 : x->index > y->index;
+}
+
+/* Sorted keys for `items`, skipping unreadable files; returns how many */
+static size_t collect_keys(const file_compare_t *fc, const uint32_t *items, size_t count,
+                           compare_key_t *keys)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < count; i++) {
+        const file_entry_t *file = &fc->files[items[i]];
+        if (file->error) continue;
+        keys[n].length = file->length;
+        keys[n].hash = file->hash;
+        keys[n].index = items[i];
+        n++;
+    }
+    qsort(keys, n, sizeof(*keys), compare_keys);
+    return n;
+}
+
+/* =============================
+ * Public API
+ * ============================= */
+
+static int assign_groups(file_compare_t *fc)
+{
+    uint32_t *members = (uint32_t *)calloc(fc->num_files ? fc->num_files : 1, sizeof(uint32_t));
+    if (!members) return -1;
+
+    for (size_t i = 0; i < fc->num_files; i++) {
+        if (!fc->files[i].error) members[fc->files[i].match]++;
+    }
+
+    /* A representative is always the lowest index of its set, so it is seen first */
+    size_t grouped = 0;
+    for (size_t i = 0; i < fc->num_files; i++) {
+        file_entry_t *file = &fc->files[i];
+        if (file->error || members[file->match] < 2) continue;
+        if (file->match == i) file->group = (int32_t)fc->num_groups++;
+        else file->group = fc->files[file->match].group;
+        grouped++;
+    }
+
+    fc->group_start = (uint32_t *)calloc(fc->num_groups + 1, sizeof(uint32_t));
+    fc->group_members = (uint32_t *)malloc(sizeof(uint32_t) * (grouped ? grouped : 1));
+    if (!fc->group_start || !fc->group_members) {
+        free(members);
+        return -1;
+    }
+    for (size_t i = 0; i < fc->num_files; i++) {
+        if (fc->files[i].group != FILE_COMPARE_UNIQUE) fc->group_start[fc->files[i].group + 1]++;
+    }
+    for (uint32_t g = 0; g < fc->num_groups; g++) fc->group_start[g + 1] += fc->group_start[g];
+
+    memset(members, 0, sizeof(uint32_t) * fc->num_groups);
+    for (size_t i = 0; i < fc->num_files; i++) {
+        int32_t g = fc->files[i].group;
+        if (g != FILE_COMPARE_UNIQUE) fc->group_members[fc->group_start[g] + members[g]++] = (uint32_t)i;
+    }
+    free(members);
+    return 0;
+}
+
+/* Exact mode: drops unique sizes, hashes the larger same-size sets; returns the candidates */
+static int exact_candidates(file_compare_t *fc, thread_pool_t *pool, uint32_t *all,
+                            compare_key_t *keys, uint32_t *candidates, size_t *num_candidates)
+{
+    compare_job_t job = { fc, all, NULL, NULL };
+    if (run_parallel(pool, &job, stat_work, fc->num_files) != 0) return -1;
+
+    size_t n = collect_keys(fc, all, fc->num_files, keys), to_hash = 0, count = 0;
+    for (size_t s = 0, e; s < n; s = e) {
+        for (e = s + 1; e < n && keys[e].length == keys[s].length; e++) {}
+        if (e - s == 1) {
+            fc->files_skipped++;
+            continue;
+        }
+        for (size_t k = s; k < e; k++) candidates[count++] = keys[k].index;
+        if (e - s >= HASH_MIN_SET && keys[s].length > 0) {
+            for (size_t k = s; k < e; k++) all[to_hash++] = keys[k].index;
+        }
+    }
+
+    job.items = all;
+    if (run_parallel(pool, &job, hash_work, to_hash) != 0) return -1;
+    *num_candidates = count;
+    return 0;
+}
+
+int file_compare_run(file_compare_t *fc, const char *const *paths, size_t count,
+                     file_compare_mode_t mode, thread_pool_t *pool)
+{
+    memset(fc, 0, sizeof(*fc));
+    fc->mode = mode;
+    if (count >= UINT32_MAX) {
+        fprintf(stderr, "file_compare_run: too many files (%zu)\n", count);
+        return -1;
+    }
+
+    size_t slots = count ? count : 1;
+    fc->files = (file_entry_t *)calloc(slots, sizeof(file_entry_t));
+    uint32_t *all = (uint32_t *)malloc(sizeof(uint32_t) * slots);
+    uint32_t *candidates = (uint32_t *)malloc(sizeof(uint32_t) * slots);
+    compare_key_t *keys = (compare_key_t *)malloc(sizeof(compare_key_t) * slots);
+    size_t *buckets = (size_t *)malloc(sizeof(size_t) * slots);
+    int rc = -1;
+
+    if (!fc->files || !all || !candidates || !keys || !buckets) goto done;
+    fc->num_files = count;
+    for (size_t i = 0; i < count; i++) {
+        fc->files[i].path = paths[i];
+        fc->files[i].match = (uint32_t)i;
+        fc->files[i].group = FILE_COMPARE_UNIQUE;
+        all[i] = (uint32_t)i;
+    }
+
+    size_t num_candidates = count;
+    if (mode == FILE_COMPARE_EXACT) {
+        if (exact_candidates(fc, pool, all, keys, candidates, &num_candidates) != 0) goto done;
+    } else {
+        compare_job_t job = { fc, all, NULL, NULL };
+        if (run_parallel(pool, &job, hash_work, count) != 0) goto done;
+        memcpy(candidates, all, sizeof(uint32_t) * count);
+    }
+
+    /* Buckets of two or more equal keys, each verified byte by byte */
+    size_t n = collect_keys(fc, candidates, num_candidates, keys), num_buckets = 0;
+    for (size_t s = 0, e; s < n; s = e) {
+        for (e = s + 1; e < n && keys[e].length == keys[s].length && keys[e].hash == keys[s].hash; e++) {}
+        if (e - s < 2) continue;
+        buckets[2 * num_buckets] = s;
+        buckets[2 * num_buckets + 1] = e;
+        num_buckets++;
+    }
+
+    compare_job_t verify = { fc, NULL, keys, buckets };
+    if (run_parallel(pool, &verify, verify_work, num_buckets) != 0) goto done;
+    rc = assign_groups(fc);
+
+done:
+    if (rc != 0) fprintf(stderr, "file_compare_run: out of memory\n");
+    free(all);
+    free(candidates);
+    free(keys);
+    free(buckets);
+    return rc;
+}
+
+void file_compare_free(file_compare_t *fc)
+{
+    free(fc->files);
+    free(fc->group_start);
+    free(fc->group_members);
+    memset(fc, 0, sizeof(*fc));
+}
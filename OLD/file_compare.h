@@ -0,0 +1,110 @@
+#ifndef FILE_COMPARE_H
+#define FILE_COMPARE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "threadpool.h"
+
+/**
+ * Finds sets of files with identical content (compare_files.py).
+ *
+ * FILE_COMPARE_NORMALIZED compares content the way compare_files.py does:
+ * a leading UTF-8 BOM is ignored and CRLF or a lone CR reads as LF. The
+ * normalised length is only known after reading, so every file is read
+ * once: mapped and hashed as a normalised stream, in parallel on the pool.
+ *
+ * FILE_COMPARE_EXACT compares raw bytes. Files are grouped by size first
+ * and a file whose size no other file has is never opened. Same-size sets
+ * of three or more are hashed in parallel; pairs go straight to the byte
+ * compare, which reads each file once either way.
+ *
+ * In both modes files with equal length and hash are confirmed with a
+ * full compare before they are reported together, so a hash collision
+ * only costs time.
+ */
+
+typedef enum file_compare_mode_t {
+    FILE_COMPARE_NORMALIZED = 0,    /* ignore a BOM, CRLF and CR are LF */
+    FILE_COMPARE_EXACT = 1          /* raw bytes */
+} file_compare_mode_t;
+
+#define FILE_COMPARE_UNIQUE (-1)
+
+typedef struct file_entry_t {
+    const char *path;
+    uint64_t size;                  /* bytes on disk */
+    uint64_t length;                /* compared length: normalised, or the size */
+    uint64_t hash;                  /* of the compared bytes; 0 if never hashed */
+    uint32_t match;                 /* first file with the same content (itself if none) */
+    int32_t group;                  /* index into the groups, or FILE_COMPARE_UNIQUE */
+    int error;                      /* errno if the file could not be read, else 0 */
+} file_entry_t;
+
+typedef struct file_compare_t {
+    file_compare_mode_t mode;
+    file_entry_t *files;            /* in the order the paths were given */
+    size_t num_files;
+
+    /* Files with identical content, in order of their first member */
+    uint32_t num_groups;
+    uint32_t *group_start;          /* num_groups + 1 offsets into group_members */
+    uint32_t *group_members;        /* file indices, each group in input order */
+
+    uint64_t bytes_read;            /* bytes hashed or compared, over all passes */
+    uint64_t files_skipped;         /* never opened: no other file has their size */
+} file_compare_t;
+
+/**
+ * Compare the `count` files in `paths` (which must outlive `fc`), using
+ * `pool` for stat, hash and compare work, or the calling thread if `pool`
+ * is NULL. Unreadable files get `error` set and take no part. Returns 0,
+ * or -1 if memory ran out; free the result with file_compare_free().
+ */
+int file_compare_run(file_compare_t *fc, const char *const *paths, size_t count,
+                     file_compare_mode_t mode, thread_pool_t *pool);
+
+/**
+ * Release everything file_compare_run() allocated.
+ */
+void file_compare_free(file_compare_t *fc);
+
+/* =============================
+ * Content hash
+ * ============================= */
+
+/**
+ * 64-bit streaming hash in the style of XXH3: eight 64-bit lanes take a
+ * 64-byte stripe at a time with one 32x32->64 multiply per lane (two
+ * lanes per SSE2 instruction), scrambled every 1 KB. It uses its own
+ * constants, so values do not match XXH3 and are only meant for grouping
+ * within one run. Updates may be split at any byte boundary.
+ */
+#define FILE_HASH_STRIPE 64
+
+typedef struct file_hash_t {
+    uint64_t acc[8];
+    unsigned char buffer[FILE_HASH_STRIPE];
+    uint32_t buffered;
+    uint32_t stripe;                /* stripes since the last scramble */
+    uint64_t total;
+} file_hash_t;
+
+void file_hash_init(file_hash_t *h);
+void file_hash_update(file_hash_t *h, const void *data, size_t len);
+uint64_t file_hash_final(const file_hash_t *h);
+
+/**
+ * One-shot file_hash_init/update/final.
+ */
+uint64_t file_hash64(const void *data, size_t len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FILE_COMPARE_H
@@ -0,0 +1,84 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "dir_walker.h"
+#include "platform.h"
+#include "threadpool.h"
+
+/**
+ * List the files under a folder changed in the last N minutes:
+ *
+ *   find_main <folder> [minutes] [ctime|mtime] [name_regex|-] [min_size] [max_size] [threads]
+ *
+ * With only the folder this does what find_files.py does: every file
+ * whose ctime is at most 15 minutes old, one path per line. 0 minutes
+ * drops the time filter; name_regex is a POSIX extended pattern for the
+ * base name ("-" for any); max_size 0 means no limit and 0 threads one
+ * per CPU. Counts and the rate go to stderr.
+ */
+
+typedef struct find_output_t {
+    FILE *out;
+} find_output_t;
+
+static int write_paths(void *ctx, const dir_walk_entry_t *entries, size_t count)
+{
+    find_output_t *output = (find_output_t *)ctx;
+
+    for (size_t i = 0; i < count; i++) {
+        fwrite(entries[i].path, 1, entries[i].path_len, output->out);
+        putc_unlocked('\n', output->out);
+    }
+    return ferror(output->out) ? -1 : 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <folder> [minutes] [ctime|mtime] [name_regex|-] [min_size] [max_size] [threads]\n",
+                argv[0]);
+        return 1;
+    }
+
+    dir_walk_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.root = argv[1];
+
+    double minutes = argc > 2 ? atof(argv[2]) : 15.0;
+    if (minutes > 0) {
+        struct timespec now;
+        clock_gettime(CLOCK_REALTIME, &now);
+        int64_t threshold = (int64_t)now.tv_sec * 1000000000LL + now.tv_nsec - (int64_t)(minutes * 60e9);
+        if (argc > 3 && strcmp(argv[3], "mtime") == 0) config.min_mtime_ns = threshold;
+        else config.min_ctime_ns = threshold;
+    }
+    if (argc > 4 && strcmp(argv[4], "-") != 0) config.name_pattern = argv[4];
+    if (argc > 5) config.min_size = strtoull(argv[5], NULL, 0);
+    if (argc > 6) config.max_size = strtoull(argv[6], NULL, 0);
+    int threads = argc > 7 ? atoi(argv[7]) : 0;
+    if (threads <= 0) threads = platform_cpu_count();
+
+    static char buffer[1 << 20];
+    find_output_t output = { stdout };
+    setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+
+    thread_pool_t pool;
+    thread_pool_init(&pool, threads);
+
+    dir_walk_stats_t stats;
+    unsigned long long start = platform_time_ns();
+    int rc = dir_walk_run(&config, &pool, write_paths, &output, &stats);
+    unsigned long long elapsed = platform_time_ns() - start;
+    fflush(stdout);
+    thread_pool_shutdown(&pool);
+    if (rc != 0) return 1;
+
+    fprintf(stderr, "[Main] %llu matches in %llu directories, %llu entries, %llu statx calls, %llu errors "
+            "on %d threads in %.3f ms (%.0f entries/s)\n",
+            (unsigned long long)stats.matches, (unsigned long long)stats.directories,
+            (unsigned long long)stats.entries, (unsigned long long)stats.stat_calls,
+            (unsigned long long)stats.errors, threads, (double)elapsed / 1e6,
+            elapsed ? (double)stats.entries * 1e9 / (double)elapsed : 0.0);
+    return 0;
+}
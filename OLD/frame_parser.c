@@ -0,0 +1,276 @@
+#include "frame_parser.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* =============================
+ * Formats
+ * ============================= */
+
+frame_format_t frame_format_relay(frame_endian_t endian)
+{
+    frame_format_t f;
+    f.endian = endian;
+    f.length_mode = FRAME_LENGTH_HIGH16;
+    f.min_length = 12;          // start marker + length|count + end marker
+    f.max_length = 0xFFFC;      // largest word-aligned 16-bit length
+    f.word_aligned = 1;
+    return f;
+}
+
+frame_format_t frame_format_command(void)
+{
+    frame_format_t f;
+    f.endian = FRAME_ENDIAN_BIG;
+    f.length_mode = FRAME_LENGTH_WORD;
+    f.min_length = 16;          // start + length + index + end
+    f.max_length = 64 * 1024;
+    f.word_aligned = 0;
+    return f;
+}
+
+uint32_t frame_header_size(const frame_format_t *format)
+{
+    return format->length_mode == FRAME_LENGTH_WORD ? 12 : 8;
+}
+
+/* =============================
+ * Byte order helpers
+ * ============================= */
+
+uint32_t frame_load_u32(const frame_format_t *format, const uint8_t *p)
+{
+    if (format->endian == FRAME_ENDIAN_BIG) {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+    return ((uint32_t)p[3] << 24) | ((uint32_t)p[2] << 16) | ((uint32_t)p[1] << 8) | p[0];
+}
+
+void frame_store_u32(const frame_format_t *format, uint8_t *p, uint32_t value)
+{
+    if (format->endian == FRAME_ENDIAN_BIG) {
+        p[0] = (uint8_t)(value >> 24);
+        p[1] = (uint8_t)(value >> 16);
+        p[2] = (uint8_t)(value >> 8);
+        p[3] = (uint8_t)value;
+    } else {
+        p[0] = (uint8_t)value;
+        p[1] = (uint8_t)(value >> 8);
+        p[2] = (uint8_t)(value >> 16);
+        p[3] = (uint8_t)(value >> 24);
+    }
+}
+
+size_t frame_encode(const frame_format_t *format, uint8_t *out, size_t out_size,
+                    uint32_t sequence, const uint8_t *body, uint32_t body_length)
+{
+    uint32_t header = frame_header_size(format);
+    size_t total = (size_t)header + body_length + 4;
+
+    if (total > out_size || total > format->max_length) return 0;
+    if (format->word_aligned && (total % 4) != 0) return 0;
+
+    frame_store_u32(format, out, FRAME_START_MARKER);
+    if (format->length_mode == FRAME_LENGTH_HIGH16) {
+        frame_store_u32(format, out + 4, ((uint32_t)total << 16) | (sequence & 0xFFFF));
+    } else {
+        frame_store_u32(format, out + 4, (uint32_t)total);
+        frame_store_u32(format, out + 8, sequence);
+    }
+    /* Callers that built the body in place pass body == out + header */
+    if (body && body != out + header) {
+        memmove(out + header, body, body_length);
+    }
+    frame_store_u32(format, out + total - 4, FRAME_END_MARKER);
+    return total;
+}
+
+int frame_view_decode(const frame_format_t *format, const uint8_t *data, size_t len,
+                      frame_view_t *out)
+{
+    uint32_t header = frame_header_size(format);
+    if (len < format->min_length || len > format->max_length || len < (size_t)header + 4) return -1;
+    if (frame_load_u32(format, data) != FRAME_START_MARKER) return -1;
+    if (frame_load_u32(format, data + len - 4) != FRAME_END_MARKER) return -1;
+
+    uint32_t word = frame_load_u32(format, data + 4);
+    uint32_t length = (format->length_mode == FRAME_LENGTH_HIGH16) ? (word >> 16) : word;
+    if (length != len) return -1;
+
+    out->data = data;
+    out->length = length;
+    out->sequence = (format->length_mode == FRAME_LENGTH_HIGH16)
+                  ? (word & 0xFFFF)
+                  : frame_load_u32(format, data + 8);
+    out->body = data + header;
+    out->body_length = length - header - 4;
+    return 0;
+}
+
+/* =============================
+ * Parser lifecycle
+ * ============================= */
+
+int frame_parser_init(frame_parser_t *parser, const frame_format_t *format)
+{
+    if (!parser || !format) return -1;
+
+    memset(parser, 0, sizeof(*parser));
+    parser->format = *format;
+    parser->capacity = (size_t)format->max_length * 2;
+    parser->buffer = (uint8_t *)malloc(parser->capacity);
+    if (!parser->buffer) {
+        fprintf(stderr, "frame_parser_init: failed to allocate %zu bytes\n", parser->capacity);
+        return -1;
+    }
+    return 0;
+}
+
+void frame_parser_destroy(frame_parser_t *parser)
+{
+    if (!parser) return;
+    free(parser->buffer);
+    parser->buffer = NULL;
+    parser->capacity = 0;
+    parser->head = parser->tail = 0;
+}
+
+void frame_parser_reset(frame_parser_t *parser)
+{
+    parser->head = parser->tail = 0;
+}
+
+/* =============================
+ * Scanning
+ * ============================= */
+
+/*
+ * Deliver every complete frame in p[0..n). On return *consumed is the
+ * number of leading bytes that were either delivered or discarded; the
+ * rest is the start of a frame that has not fully arrived yet.
+ */
+static size_t scan(frame_parser_t *parser, const uint8_t *p, size_t n,
+                   frame_callback_t callback, void *ctx, size_t *consumed)
+{
+    const frame_format_t *f = &parser->format;
+    const uint8_t first = (f->endian == FRAME_ENDIAN_BIG) ? 0xBA : 0x0D;
+    const size_t header = frame_header_size(f);
+    size_t off = 0;
+    size_t delivered = 0;
+
+    while (n - off >= 8) {
+        if (frame_load_u32(f, p + off) != FRAME_START_MARKER) {
+            /* Resync: jump to the next byte that could begin a start marker */
+            const uint8_t *next = (const uint8_t *)memchr(p + off + 1, first, n - off - 1);
+            size_t skip = next ? (size_t)(next - (p + off)) : n - off;
+            parser->stats.marker_mismatches++;
+            parser->stats.resync_bytes += skip;
+            off += skip;
+            continue;
+        }
+
+        uint32_t word = frame_load_u32(f, p + off + 4);
+        uint32_t length = (f->length_mode == FRAME_LENGTH_HIGH16) ? (word >> 16) : word;
+
+        if (length < f->min_length || length > f->max_length ||
+            (f->word_aligned && (length % 4) != 0)) {
+            /* Not a plausible header, treat the marker as noise */
+            parser->stats.length_mismatches++;
+            parser->stats.resync_bytes++;
+            off++;
+            continue;
+        }
+
+        if (n - off < length) break;
+
+        if (frame_load_u32(f, p + off + length - 4) != FRAME_END_MARKER) {
+            /* Same policy as validate_block(): drop the whole declared frame */
+            parser->stats.invalid_frames++;
+            parser->stats.marker_mismatches++;
+            off += length;
+            continue;
+        }
+
+        frame_view_t view;
+        view.data = p + off;
+        view.length = length;
+        view.sequence = (f->length_mode == FRAME_LENGTH_HIGH16)
+                      ? (word & 0xFFFF)
+                      : frame_load_u32(f, p + off + 8);
+        view.body = p + off + header;
+        view.body_length = length - (uint32_t)header - 4;
+
+        parser->stats.frames++;
+        parser->stats.bytes += length;
+        delivered++;
+        if (callback) callback(ctx, &view);
+
+        off += length;
+    }
+
+    *consumed = off;
+    return delivered;
+}
+
+static void compact(frame_parser_t *parser)
+{
+    if (parser->head == parser->tail) {
+        parser->head = parser->tail = 0;
+    } else if (parser->head > 0) {
+        memmove(parser->buffer, parser->buffer + parser->head, parser->tail - parser->head);
+        parser->tail -= parser->head;
+        parser->head = 0;
+    }
+}
+
+size_t frame_parser_feed(frame_parser_t *parser, const uint8_t *data, size_t len,
+                         frame_callback_t callback, void *ctx)
+{
+    size_t delivered = 0;
+
+    while (len > 0) {
+        if (parser->head == parser->tail) {
+            /* Nothing buffered: parse straight out of the caller's memory */
+            size_t consumed = 0;
+            delivered += scan(parser, data, len, callback, ctx, &consumed);
+            size_t rest = len - consumed;
+            /* scan() leaves at most one partial frame, which always fits */
+            memcpy(parser->buffer, data + consumed, rest);
+            parser->head = 0;
+            parser->tail = rest;
+            return delivered;
+        }
+
+        /* Top up the partial frame, then parse from the buffer */
+        size_t available;
+        uint8_t *dst = frame_parser_write_ptr(parser, &available);
+        size_t take = len < available ? len : available;
+        memcpy(dst, data, take);
+        data += take;
+        len -= take;
+        delivered += frame_parser_commit(parser, take, callback, ctx);
+    }
+    return delivered;
+}
+
+uint8_t *frame_parser_write_ptr(frame_parser_t *parser, size_t *available)
+{
+    compact(parser);
+    *available = parser->capacity - parser->tail;
+    return parser->buffer + parser->tail;
+}
+
+size_t frame_parser_commit(frame_parser_t *parser, size_t len,
+                           frame_callback_t callback, void *ctx)
+{
+    size_t consumed = 0;
+    parser->tail += len;
+    size_t delivered = scan(parser, parser->buffer + parser->head,
+                            parser->tail - parser->head, callback, ctx, &consumed);
+    parser->head += consumed;
+    if (parser->head == parser->tail) {
+        parser->head = parser->tail = 0;
+    }
+    return delivered;
+}
@@ -0,0 +1,172 @@
+#ifndef FRAME_PARSER_H
+#define FRAME_PARSER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Streaming reassembly for the marker-delimited frames used by
+ * threaded_ether_relay.py and command_interface.py:
+ *
+ *   +--------------+-------------+-----------------+--------------+
+ *   | 0xBAADF00D   | length word | body ...        | 0xDEADBEEF   |
+ *   +--------------+-------------+-----------------+--------------+
+ *
+ * The relay packs (length << 16) | count into the length word, the
+ * command protocol uses the whole word as the length and follows it
+ * with a 32-bit message index. Both are described by frame_format_t.
+ */
+
+#define FRAME_START_MARKER 0xBAADF00DU
+#define FRAME_END_MARKER   0xDEADBEEFU
+
+typedef enum frame_endian_t {
+    FRAME_ENDIAN_BIG = 0,
+    FRAME_ENDIAN_LITTLE = 1
+} frame_endian_t;
+
+typedef enum frame_length_mode_t {
+    /** Length in the upper 16 bits, sequence count in the lower 16 (relay). */
+    FRAME_LENGTH_HIGH16 = 0,
+    /** Length is the whole word, sequence is the next word (command/ACK). */
+    FRAME_LENGTH_WORD = 1
+} frame_length_mode_t;
+
+/**
+ * Wire format description.
+ *  - `min_length`/`max_length` bound the declared frame length.
+ *  - `word_aligned` rejects lengths that are not a multiple of 4.
+ */
+typedef struct frame_format_t {
+    frame_endian_t endian;
+    frame_length_mode_t length_mode;
+    uint32_t min_length;
+    uint32_t max_length;
+    int word_aligned;
+} frame_format_t;
+
+/**
+ * Format used by threaded_ether_relay.py (big endian by default).
+ */
+frame_format_t frame_format_relay(frame_endian_t endian);
+
+/**
+ * Format used by command_interface.py (always network byte order).
+ */
+frame_format_t frame_format_command(void);
+
+/**
+ * A complete, validated frame. `data` points into the parser's buffer
+ * and is only valid for the duration of the callback.
+ */
+typedef struct frame_view_t {
+    const uint8_t *data;
+    uint32_t length;
+    uint32_t sequence;
+    const uint8_t *body;
+    uint32_t body_length;
+} frame_view_t;
+
+/**
+ * Called once per complete frame.
+ */
+typedef void (*frame_callback_t)(void *ctx, const frame_view_t *frame);
+
+/**
+ * Counters kept by the parser. Plain integers: a parser is owned by one thread.
+ */
+typedef struct frame_parser_stats_t {
+    uint64_t frames;
+    uint64_t bytes;
+    uint64_t invalid_frames;
+    uint64_t marker_mismatches;
+    uint64_t length_mismatches;
+    uint64_t resync_bytes;
+} frame_parser_stats_t;
+
+/**
+ * Per-stream reassembly state. The buffer holds at most one partial frame
+ * plus whatever arrived after it, so its capacity is 2 * max_length.
+ */
+typedef struct frame_parser_t {
+    frame_format_t format;
+    uint8_t *buffer;
+    size_t capacity;
+    size_t head;
+    size_t tail;
+    frame_parser_stats_t stats;
+} frame_parser_t;
+
+/**
+ * Initialise a parser for `format`. Returns 0 on success, nonzero on failure.
+ */
+int frame_parser_init(frame_parser_t *parser, const frame_format_t *format);
+
+/**
+ * Release the parser's buffer.
+ */
+void frame_parser_destroy(frame_parser_t *parser);
+
+/**
+ * Drop any partial frame, e.g. after a reconnect.
+ */
+void frame_parser_reset(frame_parser_t *parser);
+
+/**
+ * Feed received bytes. Complete frames already present in `data` are
+ * delivered straight from it without copying; only a trailing partial
+ * frame is buffered. Returns the number of frames delivered.
+ */
+size_t frame_parser_feed(frame_parser_t *parser, const uint8_t *data, size_t len,
+                         frame_callback_t callback, void *ctx);
+
+/**
+ * Space for the caller to recv() into directly, avoiding a copy through a
+ * temporary buffer. Follow with frame_parser_commit().
+ */
+uint8_t *frame_parser_write_ptr(frame_parser_t *parser, size_t *available);
+
+/**
+ * Account for `len` bytes written at frame_parser_write_ptr() and deliver
+ * any frames that are now complete. Returns the number of frames delivered.
+ */
+size_t frame_parser_commit(frame_parser_t *parser, size_t len,
+                           frame_callback_t callback, void *ctx);
+
+/**
+ * Read/write a 32-bit word in the format's byte order.
+ */
+uint32_t frame_load_u32(const frame_format_t *format, const uint8_t *p);
+void frame_store_u32(const frame_format_t *format, uint8_t *p, uint32_t value);
+
+/**
+ * Write a complete frame into `out`. The body is copied after the header
+ * unless it was already built in place at out + frame_header_size().
+ * Returns the total frame length, or 0 if it does not fit in `out_size`
+ * or in the format's length field.
+ */
+size_t frame_encode(const frame_format_t *format, uint8_t *out, size_t out_size,
+                    uint32_t sequence, const uint8_t *body, uint32_t body_length);
+
+/**
+ * Validate one complete frame held in memory (e.g. a shared-memory ring
+ * record) and describe it without copying. Returns 0 if `len` bytes are
+ * exactly one valid frame, -1 otherwise.
+ */
+int frame_view_decode(const frame_format_t *format, const uint8_t *data, size_t len,
+                      frame_view_t *out);
+
+/**
+ * Header size (markers and length/sequence words before the body).
+ */
+uint32_t frame_header_size(const frame_format_t *format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // FRAME_PARSER_H
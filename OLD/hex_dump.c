@@ -0,0 +1,194 @@
+#include "hex_dump.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#if defined(__SSSE3__)
+#include <tmmintrin.h>
+#endif
+
+#define HEX_DUMP_MAX_LINE 256
+
+/* =============================
+ * Lookup tables
+ * ============================= */
+
+/* Two digits per byte value, so each byte costs one 2-byte copy */
+static const char g_pairs_upper[513] =
+    "000102030405060708090A0B0C0D0E0F101112131415161718191A1B1C1D1E1F"
+    "202122232425262728292A2B2C2D2E2F303132333435363738393A3B3C3D3E3F"
+    "404142434445464748494A4B4C4D4E4F505152535455565758595A5B5C5D5E5F"
+    "606162636465666768696A6B6C6D6E6F707172737475767778797A7B7C7D7E7F"
+    "808182838485868788898A8B8C8D8E8F909192939495969798999A9B9C9D9E9F"
+    "A0A1A2A3A4A5A6A7A8A9AAABACADAEAFB0B1B2B3B4B5B6B7B8B9BABBBCBDBEBF"
+    "C0C1C2C3C4C5C6C7C8C9CACBCCCDCECFD0D1D2D3D4D5D6D7D8D9DADBDCDDDEDF"
+    "E0E1E2E3E4E5E6E7E8E9EAEBECEDEEEFF0F1F2F3F4F5F6F7F8F9FAFBFCFDFEFF";
+
+static const char g_pairs_lower[513] =
+    "000102030405060708090a0b0c0d0e0f101112131415161718191a1b1c1d1e1f"
+    "202122232425262728292a2b2c2d2e2f303132333435363738393a3b3c3d3e3f"
+    "404142434445464748494a4b4c4d4e4f505152535455565758595a5b5c5d5e5f"
+    "606162636465666768696a6b6c6d6e6f707172737475767778797a7b7c7d7e7f"
+    "808182838485868788898a8b8c8d8e8f909192939495969798999a9b9c9d9e9f"
+    "a0a1a2a3a4a5a6a7a8a9aaabacadaeafb0b1b2b3b4b5b6b7b8b9babbbcbdbebf"
+    "c0c1c2c3c4c5c6c7c8c9cacbcccdcecfd0d1d2d3d4d5d6d7d8d9dadbdcdddedf"
+    "e0e1e2e3e4e5e6e7e8e9eaebecedeeeff0f1f2f3f4f5f6f7f8f9fafbfcfdfeff";
+
+void hex_encode(const uint8_t *data, size_t len, char *out, int uppercase)
+{
+    const char *pairs = uppercase ? g_pairs_upper : g_pairs_lower;
+    size_t i = 0;
+
+#if defined(__SSSE3__)
+    /* Split into nibbles and map both through one PSHUFB table */
+    const __m128i digits = uppercase
+        ? _mm_setr_epi8('0','1','2','3','4','5','6','7','8','9','A','B','C','D','E','F')
+        : _mm_setr_epi8('0','1','2','3','4','5','6','7','8','9','a','b','c','d','e','f');
+    const __m128i low_mask = _mm_set1_epi8(0x0F);
+
+    for (; i + 16 <= len; i += 16) {
+        __m128i v = _mm_loadu_si128((const __m128i *)(data + i));
+        __m128i hi = _mm_and_si128(_mm_srli_epi16(v, 4), low_mask);
+        __m128i lo = _mm_and_si128(v, low_mask);
+        __m128i hi_c = _mm_shuffle_epi8(digits, hi);
+        __m128i lo_c = _mm_shuffle_epi8(digits, lo);
+        _mm_storeu_si128((__m128i *)(out + 2 * i), _mm_unpacklo_epi8(hi_c, lo_c));
+        _mm_storeu_si128((__m128i *)(out + 2 * i + 16), _mm_unpackhi_epi8(hi_c, lo_c));
+    }
+#endif
+
+    for (; i < len; i++) {
+        memcpy(out + 2 * i, pairs + 2 * data[i], 2);
+    }
+}
+
+/* =============================
+ * Layout
+ * ============================= */
+
+void hex_dump_config_default(hex_dump_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->bytes_per_line = 16;
+    config->group_size = 4;
+    config->order = HEX_DUMP_MEMORY;
+    config->uppercase = 1;
+}
+
+static int valid_layout(const hex_dump_config_t *c)
+{
+    if (c->group_size != 1 && c->group_size != 2 && c->group_size != 4 && c->group_size != 8) {
+        return 0;
+    }
+    return c->bytes_per_line > 0 && c->bytes_per_line <= HEX_DUMP_MAX_LINE &&
+           c->bytes_per_line % c->group_size == 0;
+}
+
+static size_t line_length(const hex_dump_config_t *c, size_t prefix_len)
+{
+    size_t groups = (size_t)(c->bytes_per_line / c->group_size);
+    size_t n = prefix_len + 2 + 2 * (size_t)c->bytes_per_line + (groups - 1) + 1;
+
+    if (c->show_offset) n += 16 + 2;
+    if (c->show_ascii) n += 3 + (size_t)c->bytes_per_line + 1;
+    return n;
+}
+
+size_t hex_dump_size(const hex_dump_config_t *config, size_t len)
+{
+    if (!valid_layout(config)) return 0;
+    if (len == 0) return 1;
+
+    const uint64_t bpl = (uint64_t)config->bytes_per_line;
+    uint64_t first = config->stream_offset - config->stream_offset % bpl;
+    uint64_t end = config->stream_offset + len;
+    uint64_t lines = (end - first + bpl - 1) / bpl;
+    size_t prefix_len = config->prefix ? strlen(config->prefix) : 0;
+
+    return (size_t)lines * line_length(config, prefix_len) + 1;
+}
+
+size_t hex_dump_format(const hex_dump_config_t *config, const void *data, size_t len,
+                       char *out, size_t out_size)
+{
+    const uint8_t *bytes = (const uint8_t *)data;
+    size_t need = hex_dump_size(config, len);
+    if (need == 0 || out_size < need) return 0;
+
+    const size_t bpl = (size_t)config->bytes_per_line;
+    const size_t gs = (size_t)config->group_size;
+    const int reverse = config->order == HEX_DUMP_LITTLE_ENDIAN && gs > 1;
+    const size_t prefix_len = config->prefix ? strlen(config->prefix) : 0;
+    const uint64_t start = config->stream_offset;
+    const uint64_t end = start + len;
+    char digits[2 * HEX_DUMP_MAX_LINE];
+    char *p = out;
+
+    for (uint64_t line = start - start % bpl; line < end; line += bpl) {
+        /* Positions of this line that fall inside the data */
+        size_t lo = line < start ? (size_t)(start - line) : 0;
+        size_t hi = line + bpl > end ? (size_t)(end - line) : bpl;
+        const uint8_t *src = bytes + (line + lo - start);
+
+        if (lo > 0) memset(digits, '.', 2 * lo);
+        hex_encode(src, hi - lo, digits + 2 * lo, config->uppercase);
+        if (hi < bpl) memset(digits + 2 * hi, '.', 2 * (bpl - hi));
+
+        if (prefix_len) {
+            memcpy(p, config->prefix, prefix_len);
+            p += prefix_len;
+        }
+        if (config->show_offset) {
+            uint8_t be[8];
+            int width = line >> 32 ? 8 : 4;
+            for (int i = 0; i < width; i++) be[i] = (uint8_t)(line >> (8 * (width - 1 - i)));
+            hex_encode(be, (size_t)width, p, config->uppercase);
+            p += 2 * width;
+            *p++ = ':';
+        }
+        *p++ = ' ';
+        *p++ = ' ';
+
+        for (size_t g = 0; g < bpl; g += gs) {
+            if (g) *p++ = ' ';
+            if (!reverse) {
+                memcpy(p, digits + 2 * g, 2 * gs);
+            } else {
+                /* Most significant byte of a little-endian word is last */
+                for (size_t b = 0; b < gs; b++) memcpy(p + 2 * b, digits + 2 * (g + gs - 1 - b), 2);
+            }
+            p += 2 * gs;
+        }
+
+        if (config->show_ascii) {
+            *p++ = ' ';
+            *p++ = ' ';
+            *p++ = '|';
+            for (size_t i = 0; i < bpl; i++) {
+                uint8_t c = (i >= lo && i < hi) ? src[i - lo] : ' ';
+                *p++ = (c >= 0x20 && c < 0x7F) ? (char)c : '.';
+            }
+            *p++ = '|';
+        }
+        *p++ = '\n';
+    }
+    *p = '\0';
+    return (size_t)(p - out);
+}
+
+int hex_dump_write(const hex_dump_config_t *config, const void *data, size_t len, FILE *out)
+{
+    char stack_buf[4096];
+    size_t need = hex_dump_size(config, len);
+    if (need == 0) return -1;
+
+    char *buf = need <= sizeof(stack_buf) ? stack_buf : (char *)malloc(need);
+    if (!buf) return -1;
+
+    int rc = 0;
+    size_t n = hex_dump_format(config, data, len, buf, need);
+    if (n > 0 && fwrite(buf, 1, n, out) != n) rc = -1;
+
+    if (buf != stack_buf) free(buf);
+    return rc;
+}
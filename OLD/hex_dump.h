@@ -0,0 +1,83 @@
+#ifndef HEX_DUMP_H
+#define HEX_DUMP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Table-driven hex dumps for frame debugging.
+ *
+ * The layout follows print_hex_words() in threaded_ether_relay.py: lines
+ * are aligned to the stream offset, bytes outside the data show as "..",
+ * and bytes are grouped into words. A whole dump is formatted into one
+ * caller buffer and written with a single call instead of one printf per
+ * byte. Full lines are converted 16 bytes at a time with SSSE3 when the
+ * compiler targets it, otherwise through a 256-entry pair table.
+ */
+
+typedef enum hex_dump_order_t {
+    /** Bytes in memory order (what print_hex_words shows). */
+    HEX_DUMP_MEMORY = 0,
+    /** Each group read as a big-endian number. Same as memory order. */
+    HEX_DUMP_BIG_ENDIAN = 1,
+    /** Each group read as a little-endian number, most significant first. */
+    HEX_DUMP_LITTLE_ENDIAN = 2
+} hex_dump_order_t;
+
+/**
+ * Dump layout.
+ *  - `bytes_per_line` multiple of `group_size` (16 by default).
+ *  - `group_size` bytes printed without separator (1, 2, 4 or 8).
+ *  - `stream_offset` of data[0]; lines start on a multiple of bytes_per_line.
+ *  - `prefix` is copied to the start of every line (may be NULL).
+ */
+typedef struct hex_dump_config_t {
+    int bytes_per_line;
+    int group_size;
+    hex_dump_order_t order;
+    int show_offset;
+    int show_ascii;
+    int uppercase;
+    uint64_t stream_offset;
+    const char *prefix;
+} hex_dump_config_t;
+
+/**
+ * Defaults matching print_hex_words(): 16 bytes per line in four 32-bit
+ * words, memory order, upper case, no offset or ASCII columns.
+ */
+void hex_dump_config_default(hex_dump_config_t *config);
+
+/**
+ * Upper bound of the output size for `len` bytes, including the NUL.
+ */
+size_t hex_dump_size(const hex_dump_config_t *config, size_t len);
+
+/**
+ * Format `len` bytes into `out`. Returns the number of characters
+ * written (excluding the NUL), or 0 if `out_size` is below hex_dump_size().
+ */
+size_t hex_dump_format(const hex_dump_config_t *config, const void *data, size_t len,
+                       char *out, size_t out_size);
+
+/**
+ * Format into a temporary buffer and emit it with one fwrite().
+ * Returns 0 on success, nonzero on failure.
+ */
+int hex_dump_write(const hex_dump_config_t *config, const void *data, size_t len, FILE *out);
+
+/**
+ * Plain conversion: 2 * len hex digits, no separators, no NUL.
+ */
+void hex_encode(const uint8_t *data, size_t len, char *out, int uppercase);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // HEX_DUMP_H
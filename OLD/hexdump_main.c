@@ -0,0 +1,70 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "hex_dump.h"
+
+/**
+ * Dump a captured frame or any file the way the relay prints frames:
+ *
+ *   hexdump_main <file|-> [group_bytes] [le|be] [stream_offset]
+ *
+ * With "le" each group is shown as a little-endian number, e.g. to read
+ * frames sent with --endian little. Offsets and ASCII are always shown.
+ */
+
+static unsigned char *read_all(FILE *in, size_t *len)
+{
+    size_t cap = 1 << 16, n = 0;
+    unsigned char *buf = (unsigned char *)malloc(cap);
+
+    while (buf) {
+        size_t got = fread(buf + n, 1, cap - n, in);
+        n += got;
+        if (got == 0) break;
+        if (n == cap) {
+            unsigned char *bigger = (unsigned char *)realloc(buf, cap * 2);
+            if (!bigger) {
+                free(buf);
+                return NULL;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+    }
+    *len = n;
+    return buf;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <file|-> [group_bytes] [le|be] [stream_offset]\n", argv[0]);
+        return 1;
+    }
+
+    FILE *in = strcmp(argv[1], "-") == 0 ? stdin : fopen(argv[1], "rb");
+    if (!in) {
+        fprintf(stderr, "Cannot open %s\n", argv[1]);
+        return 1;
+    }
+    size_t len = 0;
+    unsigned char *data = read_all(in, &len);
+    if (in != stdin) fclose(in);
+    if (!data) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+
+    hex_dump_config_t config;
+    hex_dump_config_default(&config);
+    config.show_offset = 1;
+    config.show_ascii = 1;
+    if (argc > 2) config.group_size = atoi(argv[2]);
+    if (argc > 3 && strcmp(argv[3], "le") == 0) config.order = HEX_DUMP_LITTLE_ENDIAN;
+    if (argc > 4) config.stream_offset = strtoull(argv[4], NULL, 0);
+
+    int rc = hex_dump_write(&config, data, len, stdout);
+    if (rc != 0) fprintf(stderr, "Invalid layout (group must be 1, 2, 4 or 8)\n");
+    free(data);
+    return rc == 0 ? 0 : 1;
+}
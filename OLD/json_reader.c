@@ -0,0 +1,243 @@
+#include "json_reader.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct json_reader_t {
+    const char *p;
+    const char *end;
+    const char *error;
+} json_reader_t;
+
+void json_free(json_node_t *node)
+{
+    while (node) {
+        json_node_t *next = node->next;
+        json_free(node->child);
+        free(node);
+        node = next;
+    }
+}
+
+static void skip_space(json_reader_t *r)
+{
+    while (r->p < r->end && (*r->p == ' ' || *r->p == '\n' || *r->p == '\r' || *r->p == '\t')) {
+        r->p++;
+    }
+}
+
+static int read_string(json_reader_t *r, const char **str, size_t *len)
+{
+    const char *start = ++r->p;
+    while (r->p < r->end && *r->p != '"') {
+        if (*r->p == '\\') r->p++;
+        r->p++;
+    }
+    if (r->p >= r->end) {
+        r->error = "unterminated string";
+        return -1;
+    }
+    *str = start;
+    *len = (size_t)(r->p - start);
+    r->p++;
+    return 0;
+}
+
+static json_node_t *read_value(json_reader_t *r, int depth);
+
+static int read_members(json_reader_t *r, json_node_t *parent, int is_object, int depth)
+{
+    const char close = is_object ? '}' : ']';
+    json_node_t **tail = &parent->child;
+
+    r->p++;
+    skip_space(r);
+    if (r->p < r->end && *r->p == close) {
+        r->p++;
+        return 0;
+    }
+    for (;;) {
+        const char *key = NULL;
+        size_t key_len = 0;
+
+        skip_space(r);
+        if (is_object) {
+            if (r->p >= r->end || *r->p != '"' || read_string(r, &key, &key_len) != 0) {
+                if (!r->error) r->error = "expected member name";
+                return -1;
+            }
+            skip_space(r);
+            if (r->p >= r->end || *r->p != ':') {
+                r->error = "expected ':'";
+                return -1;
+            }
+            r->p++;
+        }
+
+        json_node_t *child = read_value(r, depth + 1);
+        if (!child) return -1;
+        child->key = key;
+        child->key_len = key_len;
+        *tail = child;
+        tail = &child->next;
+
+        skip_space(r);
+        if (r->p < r->end && *r->p == ',') {
+            r->p++;
+            continue;
+        }
+        if (r->p < r->end && *r->p == close) {
+            r->p++;
+            return 0;
+        }
+        r->error = is_object ? "expected ',' or '}'" : "expected ',' or ']'";
+        return -1;
+    }
+}
+
+static json_node_t *read_value(json_reader_t *r, int depth)
+{
+    if (depth > JSON_MAX_DEPTH) {
+        r->error = "nested too deeply";
+        return NULL;
+    }
+    skip_space(r);
+    if (r->p >= r->end) {
+        r->error = "unexpected end of input";
+        return NULL;
+    }
+
+    json_node_t *node = (json_node_t *)calloc(1, sizeof(*node));
+    if (!node) {
+        r->error = "out of memory";
+        return NULL;
+    }
+
+    int rc = 0;
+    char c = *r->p;
+    if (c == '{' || c == '[') {
+        node->type = c == '{' ? JSON_OBJECT : JSON_ARRAY;
+        rc = read_members(r, node, c == '{', depth);
+    } else if (c == '"') {
+        node->type = JSON_STRING;
+        rc = read_string(r, &node->str, &node->str_len);
+    } else if (c == '-' || (c >= '0' && c <= '9')) {
+        char *stop;
+        node->type = JSON_NUMBER;
+        node->number = strtoll(r->p, &stop, 10);
+        /* Fractions and exponents are accepted but truncated */
+        while (stop < r->end && (*stop == '.' || *stop == 'e' || *stop == 'E' || *stop == '+' ||
+                                 *stop == '-' || (*stop >= '0' && *stop <= '9'))) {
+            stop++;
+        }
+        r->p = stop;
+    } else if (r->end - r->p >= 4 && memcmp(r->p, "true", 4) == 0) {
+        node->type = JSON_BOOL;
+        node->number = 1;
+        r->p += 4;
+    } else if (r->end - r->p >= 5 && memcmp(r->p, "false", 5) == 0) {
+        node->type = JSON_BOOL;
+        r->p += 5;
+    } else if (r->end - r->p >= 4 && memcmp(r->p, "null", 4) == 0) {
+        node->type = JSON_NULL;
+        r->p += 4;
+    } else {
+        r->error = "unexpected character";
+        rc = -1;
+    }
+
+    if (rc != 0) {
+        json_free(node);
+        return NULL;
+    }
+    return node;
+}
+
+const json_node_t *json_get(const json_node_t *object, const char *key)
+{
+    size_t len = strlen(key);
+    if (!object || object->type != JSON_OBJECT) return NULL;
+    for (const json_node_t *n = object->child; n; n = n->next) {
+        if (n->key_len == len && memcmp(n->key, key, len) == 0) return n;
+    }
+    return NULL;
+}
+
+int json_get_int(const json_node_t *object, const char *key, long long *value)
+{
+    const json_node_t *n = json_get(object, key);
+    if (!n || n->type != JSON_NUMBER) return -1;
+    *value = n->number;
+    return 0;
+}
+
+int json_string_is(const json_node_t *n, const char *s)
+{
+    return n && n->type == JSON_STRING && n->str_len == strlen(s) && memcmp(n->str, s, n->str_len) == 0;
+}
+
+json_node_t *json_parse(const char *text, size_t len, const char **error, size_t *error_offset)
+{
+    json_reader_t reader = { text, text + len, NULL };
+    json_node_t *root = read_value(&reader, 0);
+
+    if (root) {
+        skip_space(&reader);
+        if (reader.p != reader.end) {
+            reader.error = "trailing characters";
+            json_free(root);
+            root = NULL;
+        }
+    }
+    if (!root) {
+        if (error) *error = reader.error;
+        if (error_offset) *error_offset = (size_t)(reader.p - text);
+    }
+    return root;
+}
+
+static int hex_digit(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+size_t json_string_copy(const char *str, size_t str_len, char *out, size_t out_size)
+{
+    size_t n = 0;
+
+    for (size_t i = 0; i < str_len; i++) {
+        char c = str[i];
+        if (c == '\\' && i + 1 < str_len) {
+            c = str[++i];
+            switch (c) {
+            case 'n': c = '\n'; break;
+            case 't': c = '\t'; break;
+            case 'r': c = '\r'; break;
+            case 'b': c = '\b'; break;
+            case 'f': c = '\f'; break;
+            case 'u': {
+                int v = 0;
+                for (int k = 1; k <= 4; k++) {
+                    int d = i + (size_t)k < str_len ? hex_digit(str[i + (size_t)k]) : -1;
+                    if (d < 0) {
+                        v = -1;
+                        break;
+                    }
+                    v = v * 16 + d;
+                }
+                if (v >= 0) i += 4;
+                c = v > 0 && v < 0x80 ? (char)v : '?';
+                break;
+            }
+            default: break;     /* \" \\ \/ */
+            }
+        }
+        if (out_size > 0 && n < out_size - 1) out[n] = c;
+        n++;
+    }
+    if (out_size > 0) out[n < out_size ? n : out_size - 1] = '\0';
+    return n;
+}
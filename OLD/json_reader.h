@@ -0,0 +1,78 @@
+#ifndef JSON_READER_H
+#define JSON_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+/**
+ * Minimal JSON reader for the files the Python tools export
+ * (StructParser.to_json(), field symbol maps).
+ *
+ * The document is parsed into a tree of nodes whose strings point into
+ * the source text, which must outlive the tree. Strings keep their escapes;
+ * json_string_copy() resolves them. Numbers are read as integers.
+ */
+
+#define JSON_MAX_DEPTH 64
+
+typedef enum json_type_t {
+    JSON_NULL,
+    JSON_BOOL,
+    JSON_NUMBER,
+    JSON_STRING,
+    JSON_ARRAY,
+    JSON_OBJECT
+} json_type_t;
+
+typedef struct json_node_t {
+    json_type_t type;
+    const char *key;                /* member name inside an object */
+    size_t key_len;
+    const char *str;
+    size_t str_len;
+    long long number;               /* numbers and booleans */
+    struct json_node_t *child;      /* first member/element */
+    struct json_node_t *next;       /* next sibling */
+} json_node_t;
+
+/**
+ * Parse `len` bytes of `text`. Returns the root, or NULL with `*error`
+ * and `*error_offset` describing the failure (either may be NULL).
+ */
+json_node_t *json_parse(const char *text, size_t len, const char **error, size_t *error_offset);
+
+/**
+ * Free a tree returned by json_parse().
+ */
+void json_free(json_node_t *node);
+
+/**
+ * Member `key` of an object, or NULL.
+ */
+const json_node_t *json_get(const json_node_t *object, const char *key);
+
+/**
+ * Integer member `key` of an object. Returns 0 if found, -1 otherwise.
+ */
+int json_get_int(const json_node_t *object, const char *key, long long *value);
+
+/**
+ * Nonzero if `node` is the string `s`.
+ */
+int json_string_is(const json_node_t *node, const char *s);
+
+/**
+ * Copy a string (a node's str/str_len or key/key_len) with escapes
+ * resolved and NUL-terminated. \u escapes outside ASCII become '?'.
+ * Returns the unescaped length; the copy is truncated to `out_size` - 1.
+ */
+size_t json_string_copy(const char *str, size_t str_len, char *out, size_t out_size);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // JSON_READER_H
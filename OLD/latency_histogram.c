@@ -0,0 +1,90 @@
+#include "latency_histogram.h"
+
+#include <string.h>
+
+/* =============================
+ * Bucket mapping
+ * ============================= */
+
+static inline int bucket_index(uint64_t v)
+{
+    /* Values below one full sub-bucket row map linearly */
+    if (v < LATENCY_SUB_BUCKETS) return (int)v;
+
+    int msb = 63 - __builtin_clzll(v);
+    int shift = msb - LATENCY_SUB_BITS;
+    int sub = (int)((v >> shift) & (LATENCY_SUB_BUCKETS - 1));
+    return (shift + 1) * LATENCY_SUB_BUCKETS + sub;
+}
+
+static inline uint64_t bucket_upper(int index)
+{
+    if (index < LATENCY_SUB_BUCKETS) return (uint64_t)index;
+
+    int shift = index / LATENCY_SUB_BUCKETS - 1;
+    uint64_t sub = (uint64_t)(index % LATENCY_SUB_BUCKETS) | LATENCY_SUB_BUCKETS;
+    return ((sub + 1) << shift) - 1;
+}
+
+/* =============================
+ * Public API
+ * ============================= */
+
+void latency_histogram_init(latency_histogram_t *h)
+{
+    memset(h, 0, sizeof(*h));
+    h->min = UINT64_MAX;
+}
+
+void latency_histogram_record(latency_histogram_t *h, uint64_t value)
+{
+    h->counts[bucket_index(value)]++;
+    h->total++;
+    h->sum += value;
+    if (value < h->min) h->min = value;
+    if (value > h->max) h->max = value;
+}
+
+void latency_histogram_merge(latency_histogram_t *dst, const latency_histogram_t *src)
+{
+    for (int i = 0; i < LATENCY_BUCKETS; i++) dst->counts[i] += src->counts[i];
+    dst->total += src->total;
+    dst->sum += src->sum;
+    if (src->min < dst->min) dst->min = src->min;
+    if (src->max > dst->max) dst->max = src->max;
+}
+
+uint64_t latency_histogram_percentile(const latency_histogram_t *h, double percentile)
+{
+    if (h->total == 0) return 0;
+
+    uint64_t target = (uint64_t)(percentile / 100.0 * (double)h->total + 0.5);
+    if (target == 0) target = 1;
+
+    uint64_t seen = 0;
+    for (int i = 0; i < LATENCY_BUCKETS; i++) {
+        seen += h->counts[i];
+        if (seen >= target) {
+            uint64_t upper = bucket_upper(i);
+            return upper < h->max ? upper : h->max;
+        }
+    }
+    return h->max;
+}
+
+void latency_histogram_print(const latency_histogram_t *h, FILE *out, const char *label)
+{
+    if (h->total == 0) {
+        fprintf(out, "%s: no samples\n", label);
+        return;
+    }
+    fprintf(out, "%s: n=%llu min=%.1fus mean=%.1fus p50=%.1fus p90=%.1fus p99=%.1fus "
+                 "p99.9=%.1fus max=%.1fus\n",
+            label, (unsigned long long)h->total,
+            h->min / 1e3, (double)h->sum / (double)h->total / 1e3,
+            latency_histogram_percentile(h, 50.0) / 1e3,
+            latency_histogram_percentile(h, 90.0) / 1e3,
+            latency_histogram_percentile(h, 99.0) / 1e3,
+            latency_histogram_percentile(h, 99.9) / 1e3,
+            h->max / 1e3);
+}
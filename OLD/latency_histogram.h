@@ -0,0 +1,62 @@
+#ifndef LATENCY_HISTOGRAM_H
+#define LATENCY_HISTOGRAM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stdint.h>
+#include <stdio.h>
+
+/**
+ * Log-linear latency histogram (HdrHistogram-style, fixed precision).
+ *
+ * Each power of two is split into LATENCY_SUB_BUCKETS linear buckets, so
+ * every recorded value is kept to within ~6% with no allocation and a
+ * recording cost of one count-leading-zeros and an increment. Histograms
+ * are per thread and merged for reporting.
+ */
+
+#define LATENCY_SUB_BITS    4
+#define LATENCY_SUB_BUCKETS (1 << LATENCY_SUB_BITS)
+#define LATENCY_BUCKETS     (64 * LATENCY_SUB_BUCKETS)
+
+typedef struct latency_histogram_t {
+    uint64_t counts[LATENCY_BUCKETS];
+    uint64_t total;
+    uint64_t min;
+    uint64_t max;
+    uint64_t sum;
+} latency_histogram_t;
+
+/**
+ * Reset to empty.
+ */
+void latency_histogram_init(latency_histogram_t *h);
+
+/**
+ * Record one value (nanoseconds, or any unit as long as it is consistent).
+ */
+void latency_histogram_record(latency_histogram_t *h, uint64_t value);
+
+/**
+ * Add every count from `src` into `dst`.
+ */
+void latency_histogram_merge(latency_histogram_t *dst, const latency_histogram_t *src);
+
+/**
+ * Value at or below which `percentile` (0-100) of the samples fall.
+ * Returns the upper edge of the matching bucket, or 0 if empty.
+ */
+uint64_t latency_histogram_percentile(const latency_histogram_t *h, double percentile);
+
+/**
+ * Print min/mean/p50/p90/p99/p99.9/max, scaling nanoseconds to microseconds.
+ */
+void latency_histogram_print(const latency_histogram_t *h, FILE *out, const char *label);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LATENCY_HISTOGRAM_H
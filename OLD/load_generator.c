@@ -0,0 +1,445 @@
+#include "load_generator.h"
+
+#if !defined(__linux__)
+#error "load_generator requires Linux (epoll)"
+#endif
+
+#include <errno.h>
+#include <netdb.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/socket.h>
+
+#include "xoshiro.h"
+
+/* Frames started per connection per pump, so one fast socket cannot starve the rest */
+#define LOADGEN_FRAMES_PER_PUMP 4
+
+/* =============================
+ * Internal types
+ * ============================= */
+
+typedef struct frame_template_t {
+    uint8_t *data;
+    uint32_t length;
+} frame_template_t;
+
+typedef struct loadgen_conn_t {
+    int fd;
+    int connected;
+    int failed;
+    frame_parser_t parser;
+
+    uint8_t *frame;
+    uint32_t frame_len;
+    uint32_t sent;
+    uint32_t chunk_end;
+    int chunks_left;
+
+    int in_flight;
+    uint16_t count;
+    uint64_t next_send_ns;
+} loadgen_conn_t;
+
+typedef struct loadgen_worker_t {
+    const loadgen_config_t *config;
+    const struct sockaddr_storage *addr;
+    socklen_t addr_len;
+    volatile int *stop;
+    volatile int *abort;
+    uint64_t deadline_ns;
+
+    platform_thread_t thread;
+    int epoll_fd;
+    xoshiro_t rng;
+
+    frame_template_t *templates;
+    loadgen_conn_t *conns;
+    int num_conns;
+    uint64_t period_ns;
+
+    /* Published with relaxed atomics for the progress reporter */
+    uint64_t frames_sent;
+    uint64_t bytes_sent;
+    uint64_t frames_received;
+    uint64_t bytes_received;
+    uint64_t send_calls;
+    uint64_t connect_failures;
+    uint64_t invalid_frames;
+
+    latency_histogram_t latency;
+} loadgen_worker_t;
+
+#define PUBLISH_ADD(field, v) __atomic_add_fetch(&(field), (v), __ATOMIC_RELAXED)
+#define PUBLISHED(field)      __atomic_load_n(&(field), __ATOMIC_RELAXED)
+
+/* =============================
+ * Configuration
+ * ============================= */
+
+void loadgen_config_default(loadgen_config_t *config)
+{
+    memset(config, 0, sizeof(*config));
+    config->host = "127.0.0.1";
+    config->port = 4200;
+    config->threads = 2;
+    config->connections = 128;
+    config->duration_s = 10.0;
+    config->rate_per_conn = 0.0;
+    config->window = 8;
+    config->expect_echo = 1;
+    config->max_words = (1500 - 12) / 4;
+    config->min_words = config->max_words / 2;
+    config->max_chunks = 4;
+    config->num_templates = 64;
+    config->endian = FRAME_ENDIAN_BIG;
+    config->seed = 0x5EEDF00DULL;
+}
+
+/* =============================
+ * Templates
+ * ============================= */
+
+static int build_templates(loadgen_worker_t *w)
+{
+    const loadgen_config_t *cfg = w->config;
+    frame_format_t format = frame_format_relay(cfg->endian);
+
+    w->templates = (frame_template_t *)calloc(cfg->num_templates, sizeof(frame_template_t));
+    if (!w->templates) return -1;
+
+    for (int i = 0; i < cfg->num_templates; i++) {
+        /* At least two words so the timestamp fits in the body */
+        uint32_t words = xoshiro_range(&w->rng, cfg->min_words, cfg->max_words);
+        if (words < 2) words = 2;
+        uint32_t length = (words + 3) * 4;
+
+        frame_template_t *t = &w->templates[i];
+        t->data = (uint8_t *)malloc(length);
+        if (!t->data) return -1;
+        t->length = length;
+
+        xoshiro_fill(&w->rng, t->data + 8, words * 4);
+        if (frame_encode(&format, t->data, length, 0, t->data + 8, words * 4) != length) {
+            fprintf(stderr, "loadgen: cannot encode a %u byte template\n", length);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void free_templates(loadgen_worker_t *w)
+{
+    if (!w->templates) return;
+    for (int i = 0; i < w->config->num_templates; i++) free(w->templates[i].data);
+    free(w->templates);
+    w->templates = NULL;
+}
+
+/* =============================
+ * Connections
+ * ============================= */
+
+static int conn_connect(loadgen_worker_t *w, loadgen_conn_t *c)
+{
+    c->fd = socket(w->addr->ss_family, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (c->fd < 0) return -1;
+
+    int one = 1;
+    setsockopt(c->fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+    if (connect(c->fd, (const struct sockaddr *)w->addr, w->addr_len) != 0 && errno != EINPROGRESS) {
+        close(c->fd);
+        c->fd = -1;
+        return -1;
+    }
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = c;
+    return epoll_ctl(w->epoll_fd, EPOLL_CTL_ADD, c->fd, &ev);
+}
+
+static void conn_fail(loadgen_worker_t *w, loadgen_conn_t *c)
+{
+    if (c->failed) return;
+    c->failed = 1;
+    c->connected = 0;
+    PUBLISH_ADD(w->connect_failures, 1);
+}
+
+typedef struct echo_ctx_t {
+    loadgen_worker_t *worker;
+    loadgen_conn_t *conn;
+    uint64_t now;
+} echo_ctx_t;
+
+static void record_echo(void *ctx, const frame_view_t *frame)
+{
+    echo_ctx_t *e = (echo_ctx_t *)ctx;
+    uint64_t sent_ns;
+
+    memcpy(&sent_ns, frame->body, sizeof(sent_ns));
+    if (sent_ns <= e->now) latency_histogram_record(&e->worker->latency, e->now - sent_ns);
+    if (e->conn->in_flight > 0) e->conn->in_flight--;
+    PUBLISH_ADD(e->worker->frames_received, 1);
+}
+
+static void conn_read(loadgen_worker_t *w, loadgen_conn_t *c)
+{
+    echo_ctx_t e = { w, c, 0 };
+
+    for (;;) {
+        size_t available;
+        uint8_t *dst = frame_parser_write_ptr(&c->parser, &available);
+        ssize_t n = recv(c->fd, dst, available, 0);
+        if (n > 0) {
+            e.now = platform_time_ns();
+            PUBLISH_ADD(w->bytes_received, (uint64_t)n);
+            frame_parser_commit(&c->parser, (size_t)n, record_echo, &e);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n == 0 || (errno != EAGAIN && errno != EWOULDBLOCK)) conn_fail(w, c);
+        return;
+    }
+}
+
+/* Stamp the next frame from a random template */
+static void start_frame(loadgen_worker_t *w, loadgen_conn_t *c, uint64_t now)
+{
+    const loadgen_config_t *cfg = w->config;
+    frame_format_t format = frame_format_relay(cfg->endian);
+    const frame_template_t *t =
+        &w->templates[xoshiro_range(&w->rng, 0, (uint32_t)cfg->num_templates - 1)];
+
+    memcpy(c->frame, t->data, t->length);
+    frame_store_u32(&format, c->frame + 4, (t->length << 16) | c->count++);
+    memcpy(c->frame + 8, &now, sizeof(now));
+
+    c->frame_len = t->length;
+    c->sent = 0;
+    c->chunk_end = 0;
+    c->chunks_left = cfg->max_chunks > 1 ? (int)xoshiro_range(&w->rng, 2, (uint32_t)cfg->max_chunks) : 1;
+}
+
+/* Choose where the next send() stops, leaving at least one byte per remaining chunk */
+static void next_boundary(loadgen_worker_t *w, loadgen_conn_t *c)
+{
+    uint32_t remaining = c->frame_len - c->sent;
+    if (c->chunks_left <= 1 || remaining <= (uint32_t)c->chunks_left) {
+        c->chunk_end = c->frame_len;
+    } else {
+        uint32_t max = remaining - (uint32_t)(c->chunks_left - 1);
+        c->chunk_end = c->sent + xoshiro_range(&w->rng, 1, max);
+    }
+    c->chunks_left--;
+}
+
+static void conn_pump(loadgen_worker_t *w, loadgen_conn_t *c, uint64_t now)
+{
+    const loadgen_config_t *cfg = w->config;
+    int started = 0;
+
+    while (c->connected && !c->failed) {
+        if (c->sent == c->frame_len) {
+            if (started == LOADGEN_FRAMES_PER_PUMP) return;
+            if (cfg->expect_echo && c->in_flight >= cfg->window) return;
+            if (w->period_ns) {
+                if (now < c->next_send_ns) return;
+                c->next_send_ns += w->period_ns;
+                /* Do not try to catch up after a long stall */
+                if (c->next_send_ns + 1000000000ULL < now) c->next_send_ns = now + w->period_ns;
+            }
+            start_frame(w, c, now);
+            started++;
+        }
+        if (c->sent == c->chunk_end) next_boundary(w, c);
+
+        ssize_t n = send(c->fd, c->frame + c->sent, c->chunk_end - c->sent, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) conn_fail(w, c);
+            return;  // EPOLLOUT resumes it
+        }
+        PUBLISH_ADD(w->send_calls, 1);
+        PUBLISH_ADD(w->bytes_sent, (uint64_t)n);
+        c->sent += (uint32_t)n;
+        if (c->sent == c->frame_len) {
+            c->in_flight++;
+            PUBLISH_ADD(w->frames_sent, 1);
+        }
+    }
+}
+
+/* =============================
+ * Worker thread
+ * ============================= */
+
+static void *worker_thread(void *arg)
+{
+    loadgen_worker_t *w = (loadgen_worker_t *)arg;
+    const loadgen_config_t *cfg = w->config;
+    frame_format_t format = frame_format_relay(cfg->endian);
+    size_t max_frame = ((size_t)cfg->max_words + 3) * 4;
+    struct epoll_event events[256];
+
+    uint64_t start = platform_time_ns();
+    for (int i = 0; i < w->num_conns; i++) {
+        loadgen_conn_t *c = &w->conns[i];
+        c->fd = -1;
+        c->frame = (uint8_t *)malloc(max_frame);
+        c->next_send_ns = start + (w->period_ns ? xoshiro_next(&w->rng) % w->period_ns : 0);
+        if (!c->frame || frame_parser_init(&c->parser, &format) != 0 || conn_connect(w, c) != 0) {
+            conn_fail(w, c);
+        }
+    }
+
+    while (!*w->stop && !*w->abort) {
+        uint64_t now = platform_time_ns();
+        if (now >= w->deadline_ns) break;
+
+        int n = epoll_wait(w->epoll_fd, events, 256, w->period_ns ? 1 : 10);
+        now = platform_time_ns();
+        for (int i = 0; i < n; i++) {
+            loadgen_conn_t *c = (loadgen_conn_t *)events[i].data.ptr;
+            uint32_t ev = events[i].events;
+
+            if (!c->connected && !c->failed && (ev & (EPOLLOUT | EPOLLERR | EPOLLHUP))) {
+                int err = 0;
+                socklen_t len = sizeof(err);
+                getsockopt(c->fd, SOL_SOCKET, SO_ERROR, &err, &len);
+                if (err != 0) conn_fail(w, c);
+                else c->connected = 1;
+            }
+            if (c->connected && (ev & (EPOLLIN | EPOLLRDHUP))) conn_read(w, c);
+            if (ev & (EPOLLERR | EPOLLHUP)) conn_fail(w, c);
+        }
+
+        for (int i = 0; i < w->num_conns; i++) conn_pump(w, &w->conns[i], now);
+    }
+
+    for (int i = 0; i < w->num_conns; i++) {
+        loadgen_conn_t *c = &w->conns[i];
+        if (c->fd >= 0) close(c->fd);
+        w->invalid_frames += c->parser.stats.invalid_frames;
+        frame_parser_destroy(&c->parser);
+        free(c->frame);
+    }
+    return NULL;
+}
+
+/* =============================
+ * Driver
+ * ============================= */
+
+static void sum_workers(loadgen_worker_t *workers, int count, loadgen_result_t *r)
+{
+    memset(r, 0, sizeof(*r) - sizeof(r->latency));
+    for (int i = 0; i < count; i++) {
+        r->frames_sent += PUBLISHED(workers[i].frames_sent);
+        r->bytes_sent += PUBLISHED(workers[i].bytes_sent);
+        r->frames_received += PUBLISHED(workers[i].frames_received);
+        r->bytes_received += PUBLISHED(workers[i].bytes_received);
+        r->send_calls += PUBLISHED(workers[i].send_calls);
+        r->connect_failures += PUBLISHED(workers[i].connect_failures);
+    }
+}
+
+int loadgen_run(const loadgen_config_t *config, loadgen_result_t *result,
+                volatile int *stop,
+                void (*progress)(const loadgen_result_t *so_far, void *ctx), void *ctx)
+{
+    if (!config || !result || config->threads <= 0 || config->connections <= 0) return -1;
+
+    struct addrinfo hints, *res = NULL;
+    char port[8];
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(port, sizeof(port), "%u", config->port);
+    if (getaddrinfo(config->host, port, &hints, &res) != 0 || !res) {
+        fprintf(stderr, "loadgen: cannot resolve %s\n", config->host);
+        return -1;
+    }
+    struct sockaddr_storage addr;
+    socklen_t addr_len = (socklen_t)res->ai_addrlen;
+    memcpy(&addr, res->ai_addr, res->ai_addrlen);
+    freeaddrinfo(res);
+
+    static volatile int never = 0;
+    volatile int abort_run = 0;
+    if (!stop) stop = &never;
+
+    int nthreads = config->threads;
+    loadgen_worker_t *workers = (loadgen_worker_t *)calloc(nthreads, sizeof(loadgen_worker_t));
+    if (!workers) return -1;
+
+    for (int i = 0; i < nthreads; i++) workers[i].epoll_fd = -1;
+
+    uint64_t start = platform_time_ns();
+    uint64_t deadline = start + (uint64_t)(config->duration_s * 1e9);
+    int rc = 0;
+    int started = 0;
+
+    for (int i = 0; i < nthreads; i++) {
+        loadgen_worker_t *w = &workers[i];
+        w->config = config;
+        w->addr = &addr;
+        w->addr_len = addr_len;
+        w->stop = stop;
+        w->abort = &abort_run;
+        w->deadline_ns = deadline;
+        w->period_ns = config->rate_per_conn > 0 ? (uint64_t)(1e9 / config->rate_per_conn) : 0;
+        xoshiro_seed(&w->rng, config->seed + (uint64_t)i);
+        latency_histogram_init(&w->latency);
+
+        /* Spread the connections as evenly as possible */
+        w->num_conns = config->connections / nthreads + (i < config->connections % nthreads);
+        w->conns = (loadgen_conn_t *)calloc(w->num_conns ? w->num_conns : 1, sizeof(loadgen_conn_t));
+        w->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+        if (!w->conns || w->epoll_fd < 0 || build_templates(w) != 0) {
+            rc = -1;
+            break;
+        }
+        if (platform_thread_create(&w->thread, worker_thread, w) != 0) {
+            fprintf(stderr, "loadgen: error creating worker %d\n", i);
+            rc = -1;
+            break;
+        }
+        started++;
+    }
+
+    /* Report from this thread while the workers run */
+    while (rc == 0 && !*stop && platform_time_ns() < deadline) {
+        platform_sleep_ms(1000);
+        if (progress) {
+            sum_workers(workers, started, result);
+            result->elapsed_s = (platform_time_ns() - start) / 1e9;
+            progress(result, ctx);
+        }
+    }
+    if (rc != 0) abort_run = 1;
+
+    for (int i = 0; i < started; i++) platform_thread_join(workers[i].thread);
+
+    sum_workers(workers, started, result);
+    result->elapsed_s = (platform_time_ns() - start) / 1e9;
+    latency_histogram_init(&result->latency);
+    for (int i = 0; i < nthreads; i++) {
+        loadgen_worker_t *w = &workers[i];
+        if (i < started) {
+            latency_histogram_merge(&result->latency, &w->latency);
+            result->invalid_frames += w->invalid_frames;
+        }
+        free_templates(w);
+        free(w->conns);
+        if (w->epoll_fd >= 0) close(w->epoll_fd);
+    }
+    free(workers);
+    return rc;
+}
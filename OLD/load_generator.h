@@ -0,0 +1,85 @@
+#ifndef LOAD_GENERATOR_H
+#define LOAD_GENERATOR_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+#include "frame_parser.h"
+#include "latency_histogram.h"
+
+/**
+ * Traffic generator for the relay frame protocol (Linux only).
+ *
+ * A few threads each drive many non-blocking connections through their own
+ * epoll set. Frames are stamped from templates built once at start-up
+ * (random length, xoshiro-filled payload); per frame only the count word
+ * and an 8-byte send timestamp at the start of the body are patched. Each
+ * frame is written in several send() calls split at random boundaries,
+ * as create_data_chunks() does, to exercise the receiver's reassembly.
+ *
+ * Echoed frames (e.g. from relay_main) are parsed back and their embedded
+ * timestamp gives the end-to-end latency, recorded per thread.
+ */
+
+typedef struct loadgen_config_t {
+    const char *host;
+    unsigned short port;
+    int threads;
+    int connections;
+    double duration_s;
+
+    /** Frames per second per connection; 0 sends as fast as the window allows. */
+    double rate_per_conn;
+    /** Frames sent but not yet echoed, per connection. */
+    int window;
+    /** Expect echoes; without them the window is not enforced. */
+    int expect_echo;
+
+    /** Payload words per frame, as in create_data_chunks(). */
+    uint32_t min_words;
+    uint32_t max_words;
+    /** Maximum send() calls per frame (1 disables splitting). */
+    int max_chunks;
+
+    int num_templates;
+    frame_endian_t endian;
+    uint64_t seed;
+} loadgen_config_t;
+
+typedef struct loadgen_result_t {
+    uint64_t frames_sent;
+    uint64_t bytes_sent;
+    uint64_t frames_received;
+    uint64_t bytes_received;
+    uint64_t send_calls;
+    uint64_t invalid_frames;
+    uint64_t connect_failures;
+    double elapsed_s;
+    latency_histogram_t latency;
+} loadgen_result_t;
+
+/**
+ * Defaults: 127.0.0.1:4200, 2 threads x 64 connections, 10s, window 8,
+ * 183..367 payload words (MTU-sized, like the Python client), up to 4 chunks.
+ */
+void loadgen_config_default(loadgen_config_t *config);
+
+/**
+ * Run to completion (or until *stop becomes nonzero) and fill `result`.
+ * `progress` is called about once per second from the calling thread with
+ * the totals so far; it may be NULL. Returns 0 on success.
+ */
+int loadgen_run(const loadgen_config_t *config, loadgen_result_t *result,
+                volatile int *stop,
+                void (*progress)(const loadgen_result_t *so_far, void *ctx), void *ctx);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOAD_GENERATOR_H
@@ -0,0 +1,65 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "load_generator.h"
+
+/**
+ * Load tester for relay_main (or anything that echoes relay frames):
+ *
+ *   loadgen_main [host] [port] [connections] [threads] [seconds] [rate_per_conn]
+ *
+ * A rate of 0 runs open loop, limited only by the per-connection window.
+ */
+
+static volatile int g_stop = 0;
+
+void handle_sigint(int sig)
+{
+    (void)sig; // unused
+    g_stop = 1;
+}
+
+static void print_progress(const loadgen_result_t *r, void *ctx)
+{
+    (void)ctx;
+    printf("[Loadgen] %6.1fs sent=%llu recv=%llu (%.0f frames/s, %.1f MB/s) failed=%llu\n",
+           r->elapsed_s, (unsigned long long)r->frames_sent,
+           (unsigned long long)r->frames_received,
+           r->elapsed_s > 0 ? r->frames_sent / r->elapsed_s : 0.0,
+           r->elapsed_s > 0 ? r->bytes_sent / r->elapsed_s / 1e6 : 0.0,
+           (unsigned long long)r->connect_failures);
+}
+
+int main(int argc, char **argv)
+{
+    signal(SIGINT, handle_sigint);
+
+    loadgen_config_t config;
+    loadgen_config_default(&config);
+    if (argc > 1) config.host = argv[1];
+    if (argc > 2) config.port = (unsigned short)atoi(argv[2]);
+    if (argc > 3) config.connections = atoi(argv[3]);
+    if (argc > 4) config.threads = atoi(argv[4]);
+    if (argc > 5) config.duration_s = atof(argv[5]);
+    if (argc > 6) config.rate_per_conn = atof(argv[6]);
+
+    loadgen_result_t result;
+    if (loadgen_run(&config, &result, &g_stop, print_progress, NULL) != 0) {
+        fprintf(stderr, "[Loadgen] Run failed\n");
+        return 1;
+    }
+
+    printf("\n[Loadgen] %d connections, %d threads, %.2fs\n",
+           config.connections, config.threads, result.elapsed_s);
+    printf("  sent:     %llu frames, %.1f MB, %llu send calls (%.2f per frame)\n",
+           (unsigned long long)result.frames_sent, result.bytes_sent / 1e6,
+           (unsigned long long)result.send_calls,
+           result.frames_sent ? (double)result.send_calls / result.frames_sent : 0.0);
+    printf("  received: %llu frames, %.1f MB, %llu invalid\n",
+           (unsigned long long)result.frames_received, result.bytes_received / 1e6,
+           (unsigned long long)result.invalid_frames);
+    printf("  rate:     %.0f frames/s\n", result.frames_sent / result.elapsed_s);
+    latency_histogram_print(&result.latency, stdout, "  latency");
+    return 0;
+}
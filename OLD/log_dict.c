@@ -0,0 +1,524 @@
+#include "log_dict.h"
+
+#include <dirent.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+/* Dictionary file: magic, ID and size (little-endian), then the data */
+#define DICT_MAGIC "LDC1"
+#define DICT_HEADER 12
+
+/* Substring length whose recurrence across samples is scored */
+#define DMER 8
+#define FREQ_BITS 22
+
+/* Bytes taken from each sample and from all of them */
+#define SAMPLE_MAX (1 << 20)
+#define CORPUS_MAX (64 << 20)
+
+#define IO_BUFFER (64 * 1024)
+
+static inline void put_u32(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+    p[2] = (unsigned char)(v >> 16);
+    p[3] = (unsigned char)(v >> 24);
+}
+
+static inline uint32_t get_u32(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8 | (uint32_t)p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+int log_dict_service(const char *path, char *service, size_t cap)
+{
+    const char *base = strrchr(path, '/');
+    base = base ? base + 1 : path;
+    size_t len = strcspn(base, ".");
+    if (len == 0 || len >= cap) return -1;
+    memcpy(service, base, len);
+    service[len] = '\0';
+    return 0;
+}
+
+/* =============================
+ * Training
+ * ============================= */
+
+static inline uint32_t dmer_hash(const unsigned char *p)
+{
+    uint64_t v;
+    memcpy(&v, p, sizeof(v));
+    return (uint32_t)((v * 0x9E3779B97F4A7C15ULL) >> (64 - FREQ_BITS));
+}
+
+/* Concatenates up to SAMPLE_MAX bytes of each sample; `starts` gets count + 1 offsets */
+static unsigned char *load_corpus(const char *const *samples, size_t count, size_t *starts, size_t *len)
+{
+    unsigned char *corpus = (unsigned char *)malloc(CORPUS_MAX);
+    size_t used = 0;
+
+    if (!corpus) return NULL;
+    for (size_t i = 0; i < count; i++) {
+        starts[i] = used;
+        FILE *f = fopen(samples[i], "rb");
+        if (!f) {
+            fprintf(stderr, "log_dict_train: cannot open %s: %s\n", samples[i], strerror(errno));
+            free(corpus);
+            return NULL;
+        }
+        size_t want = CORPUS_MAX - used < SAMPLE_MAX ? CORPUS_MAX - used : SAMPLE_MAX;
+        used += fread(corpus + used, 1, want, f);
+        fclose(f);
+    }
+    starts[count] = used;
+    *len = used;
+    return corpus;
+}
+
+typedef struct dict_pick_t {
+    size_t offset;
+    uint64_t score;
+} dict_pick_t;
+
+static int by_score(const void *a, const void *b)
+{
+    const dict_pick_t *x = (const dict_pick_t *)a, *y = (const dict_pick_t *)b;
+    if (x->score != y->score) return x->score < y->score ? 1 : -1;
+    return x->offset < y->offset ? -1 : x->offset > y->offset;
+}
+
+int log_dict_train(const char *service, const char *const *samples, size_t count, size_t dict_size,
+                   log_dict_t *dict)
+{
+    memset(dict, 0, sizeof(*dict));
+    if (dict_size == 0 || dict_size > LOG_DICT_MAX_SIZE) dict_size = LOG_DICT_MAX_SIZE;
+    if (strlen(service) >= LOG_DICT_SERVICE_MAX) {
+        fprintf(stderr, "log_dict_train: service name %s is too long\n", service);
+        return -1;
+    }
+
+    size_t *starts = (size_t *)malloc((count + 1) * sizeof(size_t));
+    uint32_t *freq = (uint32_t *)calloc((size_t)1 << FREQ_BITS, sizeof(uint32_t));
+    uint32_t *seen = (uint32_t *)calloc((size_t)1 << FREQ_BITS, sizeof(uint32_t));
+    unsigned char *out = (unsigned char *)malloc(dict_size);
+    unsigned char *corpus = NULL;
+    dict_pick_t *picks = NULL;
+    size_t corpus_len = 0;
+    int rc = -1;
+
+    if (!starts || !freq || !seen || !out) goto done;
+    if (!(corpus = load_corpus(samples, count, starts, &corpus_len))) goto done;
+
+    /* How many samples each substring occurs in; one sample alone is no use to the others */
+    for (size_t s = 0; s < count; s++) {
+        for (size_t i = starts[s]; i + DMER <= starts[s + 1]; i++) {
+            uint32_t h = dmer_hash(corpus + i);
+            if (seen[h] != s + 1) {
+                seen[h] = (uint32_t)s + 1;
+                freq[h]++;
+            }
+        }
+    }
+    for (size_t h = 0; h < (size_t)1 << FREQ_BITS; h++) {
+        if (freq[h] < 2) freq[h] = 0;
+    }
+
+    /* The best segment of each epoch, as long as any substring still scores */
+    size_t epochs = dict_size / LOG_DICT_SEGMENT;
+    if (epochs > corpus_len / LOG_DICT_SEGMENT) epochs = corpus_len / LOG_DICT_SEGMENT;
+    const size_t epoch_len = epochs ? corpus_len / epochs : 0;
+    const size_t window = LOG_DICT_SEGMENT - DMER + 1;  /* substrings in a segment */
+    size_t num_picks = 0;
+
+    if (!(picks = (dict_pick_t *)malloc((epochs ? epochs : 1) * sizeof(dict_pick_t)))) goto done;
+    for (size_t e = 0; e < epochs; e++) {
+        const size_t begin = e * epoch_len;
+        const size_t last = begin + epoch_len - LOG_DICT_SEGMENT;  /* last segment start */
+        uint64_t score = 0, best_score;
+        size_t best = begin;
+
+        for (size_t i = begin; i < begin + window; i++) score += freq[dmer_hash(corpus + i)];
+        best_score = score;
+        for (size_t i = begin + 1; i <= last; i++) {
+            score -= freq[dmer_hash(corpus + i - 1)];
+            score += freq[dmer_hash(corpus + i + window - 1)];
+            if (score > best_score) {
+                best_score = score;
+                best = i;
+            }
+        }
+        if (best_score == 0) continue;
+
+        picks[num_picks].offset = best;
+        picks[num_picks].score = best_score;
+        num_picks++;
+        for (size_t i = best; i < best + window; i++) freq[dmer_hash(corpus + i)] = 0;
+    }
+    if (num_picks == 0) {
+        fprintf(stderr, "log_dict_train: the samples have nothing in common\n");
+        goto done;
+    }
+
+    /* Best last: matches into the end of the dictionary are the nearest, so the cheapest to code */
+    qsort(picks, num_picks, sizeof(dict_pick_t), by_score);
+    size_t tail = dict_size;
+    for (size_t i = 0; i < num_picks && tail >= LOG_DICT_SEGMENT; i++) {
+        tail -= LOG_DICT_SEGMENT;
+        memcpy(out + tail, corpus + picks[i].offset, LOG_DICT_SEGMENT);
+    }
+    dict->size = dict_size - tail;
+    memmove(out, out + tail, dict->size);
+    dict->data = out;
+    out = NULL;
+    dict->id = (uint32_t)adler32(adler32(0L, Z_NULL, 0), dict->data, (uInt)dict->size);
+    strcpy(dict->service, service);
+    rc = 0;
+
+done:
+    free(picks);
+    free(corpus);
+    free(out);
+    free(seen);
+    free(freq);
+    free(starts);
+    return rc;
+}
+
+/* =============================
+ * Dictionary files
+ * ============================= */
+
+/* Reads "<service>.<version>.dict"; returns 0 if `name` is one */
+static int parse_dict_name(const char *name, char *service, uint32_t *version)
+{
+    size_t len = strlen(name);
+    if (len < 6 || strcmp(name + len - 5, ".dict") != 0) return -1;
+    if (log_dict_service(name, service, LOG_DICT_SERVICE_MAX) != 0) return -1;
+    const char *p = name + strlen(service) + 1;
+    if (p >= name + len - 5) return -1;
+    uint32_t v = 0;
+    for (; p < name + len - 5; p++) {
+        if (*p < '0' || *p > '9' || v > 100000000) return -1;
+        v = v * 10 + (uint32_t)(*p - '0');
+    }
+    *version = v;
+    return 0;
+}
+
+int log_dict_save(log_dict_t *dict, const char *dir)
+{
+    char service[LOG_DICT_SERVICE_MAX];
+    uint32_t version = 0, newest = 0;
+
+    if (mkdir(dir, 0755) != 0 && errno != EEXIST) {
+        fprintf(stderr, "log_dict_save: cannot create %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    DIR *d = opendir(dir);
+    if (!d) {
+        fprintf(stderr, "log_dict_save: cannot open %s: %s\n", dir, strerror(errno));
+        return -1;
+    }
+    struct dirent *de;
+    while ((de = readdir(d)) != NULL) {
+        if (parse_dict_name(de->d_name, service, &version) == 0 && strcmp(service, dict->service) == 0 &&
+            version > newest) {
+            newest = version;
+        }
+    }
+    closedir(d);
+
+    char path[1024], tmp[1024 + 8];
+    snprintf(path, sizeof(path), "%s/%s.%u.dict", dir, dict->service, newest + 1);
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        fprintf(stderr, "log_dict_save: cannot create %s: %s\n", tmp, strerror(errno));
+        return -1;
+    }
+    unsigned char header[DICT_HEADER];
+    memcpy(header, DICT_MAGIC, 4);
+    put_u32(header + 4, dict->id);
+    put_u32(header + 8, (uint32_t)dict->size);
+    int ok = fwrite(header, 1, DICT_HEADER, f) == DICT_HEADER && fwrite(dict->data, 1, dict->size, f) == dict->size;
+    ok = fclose(f) == 0 && ok;
+    /* Renamed into place so the compressor never loads half a dictionary */
+    if (!ok || rename(tmp, path) != 0) {
+        fprintf(stderr, "log_dict_save: cannot write %s\n", path);
+        remove(tmp);
+        return -1;
+    }
+    dict->version = newest + 1;
+    return 0;
+}
+
+int log_dict_load(log_dict_t *dict, const char *path)
+{
+    const char *base = strrchr(path, '/');
+    unsigned char header[DICT_HEADER];
+
+    memset(dict, 0, sizeof(*dict));
+    if (parse_dict_name(base ? base + 1 : path, dict->service, &dict->version) != 0) {
+        fprintf(stderr, "log_dict_load: %s is not named <service>.<version>.dict\n", path);
+        return -1;
+    }
+    FILE *f = fopen(path, "rb");
+    if (!f) {
+        fprintf(stderr, "log_dict_load: cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    int ok = fread(header, 1, DICT_HEADER, f) == DICT_HEADER && memcmp(header, DICT_MAGIC, 4) == 0;
+    if (ok) {
+        dict->id = get_u32(header + 4);
+        dict->size = get_u32(header + 8);
+        ok = dict->size > 0 && dict->size <= LOG_DICT_MAX_SIZE &&
+             (dict->data = (unsigned char *)malloc(dict->size)) != NULL &&
+             fread(dict->data, 1, dict->size, f) == dict->size &&
+             adler32(adler32(0L, Z_NULL, 0), dict->data, (uInt)dict->size) == dict->id;
+    }
+    fclose(f);
+    if (!ok) {
+        fprintf(stderr, "log_dict_load: %s is damaged\n", path);
+        log_dict_free(dict);
+        return -1;
+    }
+    return 0;
+}
+
+void log_dict_free(log_dict_t *dict)
+{
+    free(dict->data);
+    memset(dict, 0, sizeof(*dict));
+}
+
+/* =============================
+ * Dictionary store
+ * ============================= */
+
+int log_dict_store_load(log_dict_store_t *store, const char *dir)
+{
+    size_t cap = 0;
+    char service[LOG_DICT_SERVICE_MAX];
+    uint32_t version;
+
+    memset(store, 0, sizeof(*store));
+    DIR *d = opendir(dir);
+    if (!d) return errno == ENOENT ? 0 : -1;
+
+    struct dirent *de;
+    int rc = 0;
+    while (rc == 0 && (de = readdir(d)) != NULL) {
+        if (parse_dict_name(de->d_name, service, &version) != 0) continue;
+        if (store->count == cap) {
+            size_t n = cap ? cap * 2 : 8;
+            log_dict_t *grown = (log_dict_t *)realloc(store->dicts, n * sizeof(log_dict_t));
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            store->dicts = grown;
+            cap = n;
+        }
+        char path[1024];
+        snprintf(path, sizeof(path), "%s/%s", dir, de->d_name);
+        if (log_dict_load(&store->dicts[store->count], path) != 0) {
+            rc = -1;
+            break;
+        }
+        store->count++;
+    }
+    closedir(d);
+    if (rc != 0) log_dict_store_free(store);
+    return rc;
+}
+
+void log_dict_store_free(log_dict_store_t *store)
+{
+    for (size_t i = 0; i < store->count; i++) log_dict_free(&store->dicts[i]);
+    free(store->dicts);
+    memset(store, 0, sizeof(*store));
+}
+
+const log_dict_t *log_dict_store_latest(const log_dict_store_t *store, const char *service)
+{
+    const log_dict_t *best = NULL;
+    for (size_t i = 0; i < store->count; i++) {
+        const log_dict_t *dict = &store->dicts[i];
+        if (strcmp(dict->service, service) == 0 && (!best || dict->version > best->version)) best = dict;
+    }
+    return best;
+}
+
+const log_dict_t *log_dict_store_find(const log_dict_store_t *store, uint32_t id)
+{
+    for (size_t i = 0; i < store->count; i++) {
+        if (store->dicts[i].id == id) return &store->dicts[i];
+    }
+    return NULL;
+}
+
+/* =============================
+ * Compression
+ * ============================= */
+
+int log_dict_compress_file(const log_dict_t *dict, const char *in_path, const char *out_path, int level)
+{
+    FILE *in = fopen(in_path, "rb");
+    if (!in) {
+        fprintf(stderr, "log_dict_compress_file: cannot open %s: %s\n", in_path, strerror(errno));
+        return -1;
+    }
+    FILE *out = fopen(out_path, "wb");
+    if (!out) {
+        fprintf(stderr, "log_dict_compress_file: cannot create %s: %s\n", out_path, strerror(errno));
+        fclose(in);
+        return -1;
+    }
+
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    unsigned char *inbuf = (unsigned char *)malloc(IO_BUFFER);
+    unsigned char *outbuf = (unsigned char *)malloc(IO_BUFFER);
+    int rc = -1;
+    if (!inbuf || !outbuf || deflateInit(&zs, level) != Z_OK) goto done;
+    if (deflateSetDictionary(&zs, dict->data, (uInt)dict->size) != Z_OK) goto deflated;
+
+    int flush;
+    do {
+        zs.avail_in = (uInt)fread(inbuf, 1, IO_BUFFER, in);
+        zs.next_in = inbuf;
+        if (ferror(in)) goto deflated;
+        flush = feof(in) ? Z_FINISH : Z_NO_FLUSH;
+        do {
+            zs.next_out = outbuf;
+            zs.avail_out = IO_BUFFER;
+            deflate(&zs, flush);
+            size_t n = IO_BUFFER - zs.avail_out;
+            if (fwrite(outbuf, 1, n, out) != n) goto deflated;
+        } while (zs.avail_out == 0);
+    } while (flush != Z_FINISH);
+    rc = 0;
+
+deflated:
+    deflateEnd(&zs);
+done:
+    free(outbuf);
+    free(inbuf);
+    fclose(in);
+    if (fclose(out) != 0) rc = -1;
+    if (rc != 0) fprintf(stderr, "log_dict_compress_file: cannot write %s\n", out_path);
+    return rc;
+}
+
+/* =============================
+ * Reading
+ * ============================= */
+
+struct log_dict_reader_t {
+    const log_dict_store_t *store;
+    FILE *in;
+    z_stream zs;
+    unsigned char *inbuf;
+    int status;                     /* 0 reading, 1 at the end, -1 failed */
+    char path[1024];
+};
+
+log_dict_reader_t *log_dict_reader_open(const log_dict_store_t *store, const char *path)
+{
+    log_dict_reader_t *reader = (log_dict_reader_t *)calloc(1, sizeof(log_dict_reader_t));
+    if (!reader) return NULL;
+    reader->store = store;
+    snprintf(reader->path, sizeof(reader->path), "%s", path);
+    reader->inbuf = (unsigned char *)malloc(IO_BUFFER);
+    reader->in = fopen(path, "rb");
+    if (!reader->in) fprintf(stderr, "log_dict_reader_open: cannot open %s: %s\n", path, strerror(errno));
+    if (!reader->inbuf || !reader->in || inflateInit(&reader->zs) != Z_OK) {
+        if (reader->in) fclose(reader->in);
+        free(reader->inbuf);
+        free(reader);
+        return NULL;
+    }
+    return reader;
+}
+
+int log_dict_read(log_dict_reader_t *reader, void *buf, unsigned int len)
+{
+    z_stream *zs = &reader->zs;
+
+    if (reader->status != 0) return reader->status < 0 ? -1 : 0;
+    zs->next_out = (unsigned char *)buf;
+    zs->avail_out = len;
+    while (zs->avail_out > 0) {
+        if (zs->avail_in == 0) {
+            zs->avail_in = (uInt)fread(reader->inbuf, 1, IO_BUFFER, reader->in);
+            zs->next_in = reader->inbuf;
+            if (zs->avail_in == 0) {
+                fprintf(stderr, "log_dict_read: %s is truncated\n", reader->path);
+                reader->status = -1;
+                break;
+            }
+        }
+        int status = inflate(zs, Z_NO_FLUSH);
+        if (status == Z_NEED_DICT) {
+            /* After the header zs->adler holds the dictionary ID */
+            const log_dict_t *dict = log_dict_store_find(reader->store, (uint32_t)zs->adler);
+            if (!dict) {
+                fprintf(stderr, "log_dict_read: no dictionary %08x for %s\n", (unsigned int)zs->adler,
+                        reader->path);
+                reader->status = -1;
+                break;
+            }
+            status = inflateSetDictionary(zs, dict->data, (uInt)dict->size);
+        }
+        if (status == Z_STREAM_END) {
+            reader->status = 1;
+            break;
+        }
+        if (status != Z_OK && status != Z_BUF_ERROR) {
+            fprintf(stderr, "log_dict_read: %s is corrupt\n", reader->path);
+            reader->status = -1;
+            break;
+        }
+    }
+
+    /* Whatever came out before an error is still handed over */
+    unsigned int got = len - zs->avail_out;
+    return got > 0 || reader->status >= 0 ? (int)got : -1;
+}
+
+void log_dict_reader_close(log_dict_reader_t *reader)
+{
+    if (!reader) return;
+    inflateEnd(&reader->zs);
+    fclose(reader->in);
+    free(reader->inbuf);
+    free(reader);
+}
+
+int log_dict_decompress_file(const log_dict_store_t *store, const char *in_path, const char *out_path)
+{
+    log_dict_reader_t *reader = log_dict_reader_open(store, in_path);
+    if (!reader) return -1;
+    FILE *out = fopen(out_path, "wb");
+    if (!out) {
+        fprintf(stderr, "log_dict_decompress_file: cannot create %s: %s\n", out_path, strerror(errno));
+        log_dict_reader_close(reader);
+        return -1;
+    }
+
+    unsigned char *outbuf = (unsigned char *)malloc(IO_BUFFER);
+    int rc = outbuf ? 0 : -1, got;
+    while (rc == 0 && (got = log_dict_read(reader, outbuf, IO_BUFFER)) != 0) {
+        if (got < 0 || fwrite(outbuf, 1, (size_t)got, out) != (size_t)got) rc = -1;
+    }
+    free(outbuf);
+    log_dict_reader_close(reader);
+    if (fclose(out) != 0) rc = -1;
+    return rc;
+}
@@ -0,0 +1,148 @@
+#ifndef LOG_DICT_H
+#define LOG_DICT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Trained preset dictionaries for small log segments.
+ *
+ * A segment of a few KB gives deflate too little history to find its
+ * repeats: every timestamp prefix, logger name and message template is
+ * new to it. A dictionary built from earlier segments of the same
+ * service supplies that history up front.
+ *
+ * Dictionaries are trained per service (the log name before its first
+ * '.', "client" for client.2024.05.01_00.00.00.log) and stored as
+ * `<dir>/<service>.<version>.dict`; training again adds the next version
+ * and keeps the old ones, so every segment stays readable. A segment is
+ * compressed to `<segment>.zd`, a zlib stream (RFC 1950) with a preset
+ * dictionary: its header carries the dictionary ID (the Adler-32 of the
+ * dictionary), which picks the dictionary again when it is inflated.
+ *
+ * Training follows the COVER method: the samples are split into epochs,
+ * and from each the LOG_DICT_SEGMENT-byte stretch whose 8-byte substrings
+ * occur in the most samples is taken, after which those substrings no
+ * longer score. The highest-scoring segments go at the end of the
+ * dictionary, where matches against them are cheapest to encode.
+ */
+
+#define LOG_DICT_MAX_SIZE (32 * 1024)         /* deflate's window */
+#define LOG_DICT_SEGMENT 128
+#define LOG_DICT_SMALL_SEGMENT (512 * 1024)   /* larger segments compress well without one */
+#define LOG_DICT_EXT ".zd"
+#define LOG_DICT_SERVICE_MAX 64
+#define LOG_DICT_DIR "log_dicts"              /* where the logger keeps them, relative to its working directory */
+
+typedef struct log_dict_t {
+    char service[LOG_DICT_SERVICE_MAX];
+    uint32_t version;
+    uint32_t id;                    /* Adler-32 of the data, as in the zlib header */
+    unsigned char *data;
+    size_t size;
+} log_dict_t;
+
+/**
+ * Service name of the log at `path`: its base name up to the first '.'.
+ * Returns 0, or -1 if it does not fit in LOG_DICT_SERVICE_MAX.
+ */
+int log_dict_service(const char *path, char *service, size_t cap);
+
+/**
+ * Train a dictionary of at most `dict_size` bytes (0: LOG_DICT_MAX_SIZE)
+ * for `service` from the sample files. The version is left 0 until it
+ * is saved. Returns 0, or -1 if the samples cannot be read or hold
+ * nothing that recurs.
+ */
+int log_dict_train(const char *service, const char *const *samples, size_t count, size_t dict_size,
+                   log_dict_t *dict);
+
+/**
+ * Store `dict` in `dir` as the next version of its service, setting
+ * `dict->version`. Returns 0 on success.
+ */
+int log_dict_save(log_dict_t *dict, const char *dir);
+
+int log_dict_load(log_dict_t *dict, const char *path);
+
+void log_dict_free(log_dict_t *dict);
+
+/* =============================
+ * Dictionary store
+ * ============================= */
+
+typedef struct log_dict_store_t {
+    log_dict_t *dicts;
+    size_t count;
+} log_dict_store_t;
+
+/**
+ * Load every dictionary in `dir`. A missing directory gives an empty
+ * store. Returns 0, or -1 if a dictionary file is damaged or memory ran
+ * out.
+ */
+int log_dict_store_load(log_dict_store_t *store, const char *dir);
+
+void log_dict_store_free(log_dict_store_t *store);
+
+/**
+ * Newest version for `service`, or NULL.
+ */
+const log_dict_t *log_dict_store_latest(const log_dict_store_t *store, const char *service);
+
+/**
+ * Dictionary with the given ID, or NULL.
+ */
+const log_dict_t *log_dict_store_find(const log_dict_store_t *store, uint32_t id);
+
+/* =============================
+ * Compression
+ * ============================= */
+
+/**
+ * Compress `in_path` into `out_path` with `dict` at zlib `level`.
+ * Returns 0 if the whole file was written.
+ */
+int log_dict_compress_file(const log_dict_t *dict, const char *in_path, const char *out_path, int level);
+
+/**
+ * Inflate `in_path` into `out_path`, taking the dictionary named in its
+ * header from `store`. Returns 0 on success.
+ */
+int log_dict_decompress_file(const log_dict_store_t *store, const char *in_path, const char *out_path);
+
+/* =============================
+ * Reading
+ * ============================= */
+
+/**
+ * A `.zd` segment inflated as a stream, for readers that want its lines
+ * rather than a copy on disk. The dictionary named in the header is
+ * taken from `store`, which must outlive the reader.
+ */
+typedef struct log_dict_reader_t log_dict_reader_t;
+
+/**
+ * Returns NULL if the file cannot be opened or memory ran out.
+ */
+log_dict_reader_t *log_dict_reader_open(const log_dict_store_t *store, const char *path);
+
+/**
+ * Up to `len` bytes of the inflated segment, as gzread() does. Returns
+ * the number read, 0 at the end, or -1 once the segment turns out to be
+ * truncated or corrupt or its dictionary is not in the store; bytes
+ * inflated before that are returned first.
+ */
+int log_dict_read(log_dict_reader_t *reader, void *buf, unsigned int len);
+
+void log_dict_reader_close(log_dict_reader_t *reader);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_DICT_H
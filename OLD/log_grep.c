@@ -0,0 +1,586 @@
+#define _GNU_SOURCE  // memrchr
+#include "log_grep.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+
+#include "log_dict.h"
+#include "log_reader.h"
+#include "platform.h"
+#include "seekable_log.h"
+
+/* Inflated per gzread() when streaming an ordinary .gz */
+#define GZ_READ LOG_CHUNK
+
+#define GZ_BUFFER (256 * 1024)
+
+/* =============================
+ * Scanning
+ * ============================= */
+
+const char *log_grep_find(const char *hay, size_t hay_len, const char *needle, size_t needle_len)
+{
+    if (needle_len == 0) return hay;
+    if (hay_len < needle_len) return NULL;
+    if (needle_len == 1) return (const char *)memchr(hay, needle[0], hay_len);
+
+    const size_t last = needle_len - 1;
+    const size_t stop = hay_len - last;  /* candidate starts are [0, stop) */
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    /*
+     * A candidate needs the first byte at i and the last at i + last; both
+     * are tested for sixteen starts at once and only survivors are compared.
+     */
+    const __m128i first_byte = _mm_set1_epi8(needle[0]);
+    const __m128i last_byte = _mm_set1_epi8(needle[last]);
+    for (; i + 16 <= stop; i += 16) {
+        __m128i head = _mm_loadu_si128((const __m128i *)(hay + i));
+        __m128i tail = _mm_loadu_si128((const __m128i *)(hay + i + last));
+        unsigned int mask = (unsigned int)_mm_movemask_epi8(
+            _mm_and_si128(_mm_cmpeq_epi8(head, first_byte), _mm_cmpeq_epi8(tail, last_byte)));
+        while (mask) {
+            size_t k = i + (size_t)__builtin_ctz(mask);
+            if (memcmp(hay + k + 1, needle + 1, last - 1) == 0) return hay + k;
+            mask &= mask - 1;
+        }
+    }
+#endif
+    while (i < stop) {
+        const char *p = (const char *)memchr(hay + i, needle[0], stop - i);
+        if (!p) return NULL;
+        if (memcmp(p + 1, needle + 1, last) == 0) return p;
+        i = (size_t)(p - hay) + 1;
+    }
+    return NULL;
+}
+
+static uint64_t count_newlines(const char *p, size_t n)
+{
+    uint64_t count = 0;
+    size_t i = 0;
+
+#if defined(__SSE2__)
+    /* Byte counters are summed every 255 blocks, before they can wrap */
+    const __m128i nl = _mm_set1_epi8('\n');
+    const __m128i zero = _mm_setzero_si128();
+    while (i + 16 <= n) {
+        size_t blocks = (n - i) / 16;
+        if (blocks > 255) blocks = 255;
+        __m128i acc = zero;
+        for (size_t b = 0; b < blocks; b++, i += 16) {
+            acc = _mm_sub_epi8(acc, _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(p + i)), nl));
+        }
+        __m128i sums = _mm_sad_epu8(acc, zero);
+        count += (uint64_t)_mm_cvtsi128_si32(sums) + (uint64_t)_mm_extract_epi16(sums, 4);
+    }
+#endif
+    for (; i < n; i++) count += p[i] == '\n';
+    return count;
+}
+
+/*
+ * Record times within one buffer. A line without a timestamp belongs to
+ * the record above it, so finding a line's time means walking back to the
+ * nearest stamped line; the last answer is remembered so that walks
+ * never cross the same lines twice.
+ */
+typedef struct record_clock_t {
+    const char *floor;              /* nothing before this is looked at */
+    int64_t lead_ts;                /* time of lines above the first stamp after `floor` */
+    const char *known;              /* a line start whose time is `known_ts`, or NULL */
+    int64_t known_ts;
+} record_clock_t;
+
+static int64_t record_time(record_clock_t *clock, const char *line, const char *line_end)
+{
+    const char *p = line, *p_end = line_end;
+    int64_t ts;
+
+    for (;;) {
+        if (clock->known && p <= clock->known) {
+            ts = clock->known_ts;
+            break;
+        }
+        if (log_parse_timestamp(p, (size_t)(p_end - p), &ts)) break;
+        if (p <= clock->floor) {
+            ts = clock->lead_ts;
+            break;
+        }
+        p_end = p - 1;
+        const char *nl = (const char *)memrchr(clock->floor, '\n', (size_t)(p_end - clock->floor));
+        p = nl ? nl + 1 : clock->floor;
+    }
+    clock->known = line;
+    clock->known_ts = ts;
+    return ts;
+}
+
+typedef struct grep_match_t {
+    uint64_t line;                  /* newlines before it in the unit */
+    size_t offset;                  /* of its text in the unit's arena */
+    size_t len;
+} grep_match_t;
+
+struct grep_run_t;
+
+typedef struct grep_unit_t {
+    struct grep_run_t *run;
+    uint32_t source;
+    uint32_t frame;                 /* seekable logs */
+    size_t begin;                   /* plain files: [begin, end) of the mapping */
+    size_t end;
+
+    uint64_t lines;                 /* newlines in the unit */
+    uint64_t bytes;
+    grep_match_t *matches;
+    size_t num_matches;
+    size_t matches_cap;
+    char *text;
+    size_t text_len;
+    size_t text_cap;
+    int error;
+    int done;
+} grep_unit_t;
+
+enum { SOURCE_PLAIN, SOURCE_SEEKABLE, SOURCE_GZIP, SOURCE_DICT };
+
+typedef struct grep_source_t {
+    const char *path;
+    int kind;
+    const char *map;                /* plain files */
+    size_t map_size;
+    seekable_log_t log;
+    int numbered;                   /* every line is scanned, so line numbers are known */
+} grep_source_t;
+
+typedef struct grep_run_t {
+    const log_grep_config_t *config;
+    int windowed;
+    grep_source_t *sources;
+    thread_pool_t *pool;
+    log_dict_store_t dicts;         /* for .zd sources */
+    platform_mutex_t lock;
+    platform_cond_t finished;
+} grep_run_t;
+
+static int add_match(grep_unit_t *unit, uint64_t line, const char *text, size_t len)
+{
+    if (unit->num_matches == unit->matches_cap) {
+        size_t cap = unit->matches_cap ? unit->matches_cap * 2 : 16;
+        grep_match_t *matches = (grep_match_t *)realloc(unit->matches, cap * sizeof(grep_match_t));
+        if (!matches) return -1;
+        unit->matches = matches;
+        unit->matches_cap = cap;
+    }
+    if (unit->text_len + len > unit->text_cap) {
+        size_t cap = unit->text_cap ? unit->text_cap * 2 : 4096;
+        while (cap < unit->text_len + len) cap *= 2;
+        char *text_buf = (char *)realloc(unit->text, cap);
+        if (!text_buf) return -1;
+        unit->text = text_buf;
+        unit->text_cap = cap;
+    }
+    memcpy(unit->text + unit->text_len, text, len);
+    unit->matches[unit->num_matches].line = line;
+    unit->matches[unit->num_matches].offset = unit->text_len;
+    unit->matches[unit->num_matches].len = len;
+    unit->num_matches++;
+    unit->text_len += len;
+    return 0;
+}
+
+/* Finds the matching lines of data[0, len), which starts at a line start. Returns -1 if memory ran out. */
+static int scan_lines(grep_unit_t *unit, const char *data, size_t len, record_clock_t *clock)
+{
+    const grep_run_t *run = unit->run;
+    const log_grep_config_t *config = run->config;
+    const char *p = data, *end = data + len;
+    const char *counted = data;     /* newlines before here are in unit->lines */
+
+    while (p < end) {
+        const char *hit = log_grep_find(p, (size_t)(end - p), config->pattern, config->pattern_len);
+        if (!hit) break;
+        const char *nl = (const char *)memrchr(p, '\n', (size_t)(hit - p));
+        const char *line = nl ? nl + 1 : p;
+        const char *eol = (const char *)memchr(hit, '\n', (size_t)(end - hit));
+        if (!eol) eol = end;
+
+        unit->lines += count_newlines(counted, (size_t)(line - counted));
+        counted = line;
+        int keep = 1;
+        if (run->windowed) {
+            int64_t ts = record_time(clock, line, eol);
+            keep = ts >= config->from_us && ts <= config->to_us;
+        }
+        if (keep && add_match(unit, unit->lines, line, (size_t)(eol - line)) != 0) return -1;
+        p = eol + 1;
+    }
+    unit->lines += count_newlines(counted, (size_t)(end - counted));
+    unit->bytes += len;
+    return 0;
+}
+
+/*
+ * Inflates an ordinary .gz, or a .zd with its dictionary, piece by piece,
+ * scanning the whole lines of each
+ */
+static int scan_stream(grep_unit_t *unit, const grep_source_t *source)
+{
+    const char *path = source->path;
+    gzFile gz = NULL;
+    log_dict_reader_t *zd = NULL;
+
+    if (source->kind == SOURCE_DICT) {
+        zd = log_dict_reader_open(&unit->run->dicts, path);
+        if (!zd) return -1;
+    } else {
+        gz = gzopen(path, "rb");
+        if (!gz) {
+            fprintf(stderr, "log_grep: cannot open %s\n", path);
+            return -1;
+        }
+        gzbuffer(gz, GZ_BUFFER);
+    }
+
+    record_clock_t clock = { NULL, INT64_MIN, NULL, 0 };
+    size_t cap = GZ_READ * 2, have = 0;
+    char *buffer = (char *)malloc(cap);
+    int rc = buffer ? 0 : -1;
+
+    while (rc == 0) {
+        if (cap - have < GZ_READ) {
+            char *grown = (char *)realloc(buffer, cap * 2);
+            if (!grown) {
+                rc = -1;
+                break;
+            }
+            buffer = grown;
+            cap *= 2;
+        }
+        int got = gz ? gzread(gz, buffer + have, GZ_READ) : log_dict_read(zd, buffer + have, GZ_READ);
+        if (got < 0) {
+            /* log_dict_read() has said why */
+            if (gz) fprintf(stderr, "log_grep: %s is corrupt\n", path);
+            rc = -1;
+            break;
+        }
+        if (got == 0) {
+            int err = Z_OK;
+            if (gz) gzerror(gz, &err);
+            if (err == Z_BUF_ERROR) {
+                fprintf(stderr, "log_grep: %s is truncated\n", path);
+                rc = -1;
+            }
+            clock.floor = buffer;
+            clock.known = NULL;
+            if (have > 0 && scan_lines(unit, buffer, have, &clock) != 0) rc = -1;
+            break;
+        }
+        have += (size_t)got;
+        const char *last_nl = (const char *)memrchr(buffer, '\n', have);
+        if (!last_nl) continue;
+
+        /* The partial line at the end waits for the next piece */
+        const size_t whole = (size_t)(last_nl - buffer) + 1;
+        clock.floor = buffer;
+        clock.known = NULL;
+        if (scan_lines(unit, buffer, whole, &clock) != 0) {
+            rc = -1;
+            break;
+        }
+        if (unit->run->windowed) {
+            const char *nl = (const char *)memrchr(buffer, '\n', whole - 1);
+            clock.lead_ts = record_time(&clock, nl ? nl + 1 : buffer, last_nl);
+        }
+        memmove(buffer, buffer + whole, have - whole);
+        have -= whole;
+    }
+    free(buffer);
+    if (gz) gzclose(gz);
+    log_dict_reader_close(zd);
+    return rc;
+}
+
+static void scan_unit(grep_unit_t *unit)
+{
+    const grep_source_t *source = &unit->run->sources[unit->source];
+
+    switch (source->kind) {
+    case SOURCE_PLAIN: {
+        /* Record times may be looked up before the chunk, in the same mapping */
+        record_clock_t clock = { source->map, INT64_MIN, NULL, 0 };
+        unit->error = scan_lines(unit, source->map + unit->begin, unit->end - unit->begin, &clock) != 0;
+        break;
+    }
+    case SOURCE_SEEKABLE: {
+        const seekable_log_frame_t *frame = &source->log.frames[unit->frame];
+        char *data = (char *)malloc(frame->size ? frame->size : 1);
+        if (!data || seekable_log_read_frame(&source->log, unit->frame, data) != 0) {
+            fprintf(stderr, "log_grep: frame %u of %s is corrupt\n", unit->frame, source->path);
+            unit->error = 1;
+        } else {
+            record_clock_t clock = { data, frame->lead_ts_us, NULL, 0 };
+            unit->error = scan_lines(unit, data, frame->size, &clock) != 0;
+        }
+        free(data);
+        break;
+    }
+    default:
+        unit->error = scan_stream(unit, source) != 0;
+        break;
+    }
+}
+
+static void grep_task(void *arg)
+{
+    grep_unit_t *unit = (grep_unit_t *)arg;
+    grep_run_t *run = unit->run;
+
+    scan_unit(unit);
+
+    platform_mutex_lock(&run->lock);
+    unit->done = 1;
+    platform_cond_broadcast(&run->finished);
+    platform_mutex_unlock(&run->lock);
+}
+
+/* =============================
+ * Sources
+ * ============================= */
+
+static int ends_with(const char *s, const char *suffix)
+{
+    size_t n = strlen(s), m = strlen(suffix);
+    return n >= m && memcmp(s + n - m, suffix, m) == 0;
+}
+
+static int open_source(grep_source_t *source, const char *path)
+{
+    memset(source, 0, sizeof(*source));
+    source->path = path;
+    source->numbered = 1;
+
+    if (ends_with(path, ".gz")) {
+        int rc = seekable_log_open(&source->log, path);
+        if (rc < 0) return -1;
+        source->kind = rc == 0 ? SOURCE_SEEKABLE : SOURCE_GZIP;
+        return 0;
+    }
+    if (ends_with(path, LOG_DICT_EXT)) {
+        /* Small segments without a time index, streamed as one unit */
+        source->kind = SOURCE_DICT;
+        return 0;
+    }
+
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "log_grep: cannot open %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    source->kind = SOURCE_PLAIN;
+    if (st.st_size > 0) {
+        void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+        if (map == MAP_FAILED) {
+            fprintf(stderr, "log_grep: mmap of %s failed: %s\n", path, strerror(errno));
+            close(fd);
+            return -1;
+        }
+        madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+        source->map = (const char *)map;
+        source->map_size = (size_t)st.st_size;
+    }
+    close(fd);
+    return 0;
+}
+
+static void close_source(grep_source_t *source)
+{
+    if (source->kind == SOURCE_PLAIN && source->map) munmap((void *)source->map, source->map_size);
+    if (source->kind == SOURCE_SEEKABLE) seekable_log_close(&source->log);
+}
+
+static grep_unit_t *push_unit(grep_unit_t **units, size_t *count, size_t *cap, uint32_t source)
+{
+    if (*count == *cap) {
+        size_t n = *cap ? *cap * 2 : 64;
+        grep_unit_t *grown = (grep_unit_t *)realloc(*units, n * sizeof(grep_unit_t));
+        if (!grown) return NULL;
+        *units = grown;
+        *cap = n;
+    }
+    grep_unit_t *unit = &(*units)[(*count)++];
+    memset(unit, 0, sizeof(*unit));
+    unit->source = source;
+    return unit;
+}
+
+/* Cuts the sources into units; frames outside the window are left out */
+static int plan_units(grep_run_t *run, uint32_t num_sources, grep_unit_t **units, size_t *count,
+                      log_grep_stats_t *stats)
+{
+    size_t cap = 0;
+
+    for (uint32_t s = 0; s < num_sources; s++) {
+        grep_source_t *source = &run->sources[s];
+        grep_unit_t *unit;
+
+        if (source->kind == SOURCE_PLAIN) {
+            size_t begin = 0;
+            while (begin < source->map_size) {
+                size_t end = begin + LOG_GREP_CHUNK;
+                if (end >= source->map_size) {
+                    end = source->map_size;
+                } else {
+                    const char *nl = (const char *)memchr(source->map + end, '\n', source->map_size - end);
+                    end = nl ? (size_t)(nl - source->map) + 1 : source->map_size;
+                }
+                if (!(unit = push_unit(units, count, &cap, s))) return -1;
+                unit->begin = begin;
+                unit->end = end;
+                begin = end;
+            }
+        } else if (source->kind == SOURCE_SEEKABLE) {
+            for (uint32_t i = 0; i < source->log.num_frames; i++) {
+                const seekable_log_frame_t *frame = &source->log.frames[i];
+                if (frame->max_ts_us < run->config->from_us || frame->min_ts_us > run->config->to_us) {
+                    source->numbered = 0;
+                    stats->frames_skipped++;
+                    continue;
+                }
+                if (!(unit = push_unit(units, count, &cap, s))) return -1;
+                unit->frame = i;
+            }
+        } else {
+            if (!push_unit(units, count, &cap, s)) return -1;
+        }
+    }
+    return 0;
+}
+
+/* =============================
+ * Search
+ * ============================= */
+
+int log_grep_run(const char *const *paths, size_t count, const log_grep_config_t *config, thread_pool_t *pool,
+                 log_grep_sink_t sink, void *ctx, log_grep_stats_t *stats)
+{
+    log_grep_stats_t local;
+    grep_run_t run;
+    grep_unit_t *units = NULL;
+    size_t num_units = 0;
+    uint32_t num_sources = 0;
+    int rc = 0;
+
+    memset(&local, 0, sizeof(local));
+    if (memchr(config->pattern, '\n', config->pattern_len)) {
+        fprintf(stderr, "log_grep_run: the pattern spans lines\n");
+        return -1;
+    }
+    memset(&run, 0, sizeof(run));
+    run.config = config;
+    run.windowed = config->from_us != INT64_MIN || config->to_us != INT64_MAX;
+    run.pool = pool && pool->num_threads > 0 ? pool : NULL;
+    run.sources = (grep_source_t *)calloc(count ? count : 1, sizeof(grep_source_t));
+    if (!run.sources) return -1;
+
+    for (size_t i = 0; i < count; i++) {
+        if (!ends_with(paths[i], LOG_DICT_EXT)) continue;
+        /* Without them the .zd sources fail on their own; the rest is still searched */
+        if (log_dict_store_load(&run.dicts, LOG_DICT_DIR) != 0) {
+            fprintf(stderr, "log_grep_run: cannot load dictionaries from %s\n", LOG_DICT_DIR);
+        }
+        break;
+    }
+    for (size_t i = 0; i < count; i++) {
+        if (open_source(&run.sources[num_sources], paths[i]) != 0) {
+            local.errors++;
+            rc = -1;
+            continue;
+        }
+        num_sources++;
+    }
+    local.files = num_sources;
+    if (plan_units(&run, num_sources, &units, &num_units, &local) != 0) {
+        fprintf(stderr, "log_grep_run: out of memory\n");
+        rc = -1;
+        num_units = 0;
+    }
+    for (size_t i = 0; i < num_units; i++) units[i].run = &run;
+
+    /*
+     * Units run up to `window` ahead of the one being emitted; its matches
+     * are passed on as soon as it is done, so output starts at once and
+     * memory stays bounded however many units there are.
+     */
+    const size_t window = run.pool ? (size_t)run.pool->num_threads * LOG_GREP_UNITS_PER_THREAD : 1;
+    size_t next_submit = 0, next_emit = 0;
+    uint64_t line_base = 0;
+    int stopped = 0;
+
+    if (run.pool) {
+        platform_mutex_init(&run.lock);
+        platform_cond_init(&run.finished);
+    }
+
+    while (next_emit < next_submit || (!stopped && next_emit < num_units)) {
+        while (!stopped && next_submit < num_units && next_submit - next_emit < window) {
+            if (run.pool && thread_pool_add_task(run.pool, grep_task, &units[next_submit]) != 0) {
+                grep_task(&units[next_submit]);
+            }
+            next_submit++;
+        }
+
+        grep_unit_t *unit = &units[next_emit];
+        if (run.pool) {
+            platform_mutex_lock(&run.lock);
+            while (!unit->done) platform_cond_wait(&run.finished, &run.lock);
+            platform_mutex_unlock(&run.lock);
+        } else {
+            scan_unit(unit);
+        }
+
+        const grep_source_t *source = &run.sources[unit->source];
+        if (next_emit == 0 || units[next_emit - 1].source != unit->source) line_base = 0;
+        if (unit->error) {
+            local.errors++;
+            rc = -1;
+        }
+        local.units++;
+        local.bytes_scanned += unit->bytes;
+        for (size_t m = 0; m < unit->num_matches && !stopped; m++) {
+            const grep_match_t *match = &unit->matches[m];
+            uint64_t line_no = source->numbered ? line_base + match->line + 1 : 0;
+            local.matches++;
+            stopped = sink(ctx, source->path, line_no, unit->text + match->offset, match->len) != 0;
+        }
+        line_base += unit->lines;
+        free(unit->matches);
+        free(unit->text);
+        next_emit++;
+    }
+
+    if (run.pool) {
+        platform_cond_destroy(&run.finished);
+        platform_mutex_destroy(&run.lock);
+    }
+    for (uint32_t s = 0; s < num_sources; s++) close_source(&run.sources[s]);
+    log_dict_store_free(&run.dicts);
+    free(run.sources);
+    free(units);
+    if (stats) *stats = local;
+    return rc;
+}
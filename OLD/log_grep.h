@@ -0,0 +1,80 @@
+#ifndef LOG_GREP_H
+#define LOG_GREP_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "threadpool.h"
+
+/**
+ * Parallel fixed-string search over plain, gzip, seekable and dictionary
+ * (.zd, log_dict.h) logs: the native replacement for running zgrep over
+ * each segment in turn.
+ *
+ * Every input is cut into independent units of work: a plain file into
+ * LOG_GREP_CHUNK pieces of its mapping, a seekable log (seekable_log.h)
+ * into its frames, and an ordinary .gz or a .zd, which can only be
+ * inflated from the start, into one unit. A .zd takes its dictionary from
+ * LOG_DICT_DIR; it has no time index, but is small enough that reading it
+ * whole costs little. Units are inflated and scanned on the pool,
+ * up to LOG_GREP_UNITS_PER_THREAD per thread ahead of the output, and
+ * their matches are handed to the sink strictly in input order.
+ *
+ * With a time window, frames of a seekable log whose index range misses
+ * it are never read, and a matching line is reported only if the record
+ * it belongs to (see log_parse_timestamp()) is stamped inside it.
+ *
+ * The scan looks for the first and last byte of the pattern sixteen
+ * positions at a time and compares the rest only where both agree, so
+ * it runs at close to memory speed unless those two bytes are common.
+ */
+
+#define LOG_GREP_CHUNK (4 << 20)
+#define LOG_GREP_UNITS_PER_THREAD 4
+
+typedef struct log_grep_config_t {
+    const char *pattern;
+    size_t pattern_len;
+    int64_t from_us;                /* INT64_MIN: no lower bound */
+    int64_t to_us;                  /* INT64_MAX: no upper bound */
+} log_grep_config_t;
+
+/**
+ * Receives one matching line (without its newline). `line_no` counts from
+ * 1 within the file, or is 0 when frames before the line were skipped and
+ * it is unknown. A nonzero return stops the search.
+ */
+typedef int (*log_grep_sink_t)(void *ctx, const char *path, uint64_t line_no, const char *line, size_t len);
+
+typedef struct log_grep_stats_t {
+    uint32_t files;
+    uint32_t units;                 /* chunks, frames and streams scanned */
+    uint32_t frames_skipped;        /* by the time index */
+    uint64_t bytes_scanned;         /* uncompressed */
+    uint64_t matches;
+    uint32_t errors;                /* files or frames that could not be read */
+} log_grep_stats_t;
+
+/**
+ * Search `paths` for `config->pattern`, using `pool` (or only the calling
+ * thread when it is NULL). Unreadable files are reported and skipped.
+ * Returns 0, or -1 if anything could not be read or memory ran out.
+ * `stats` may be NULL.
+ */
+int log_grep_run(const char *const *paths, size_t count, const log_grep_config_t *config, thread_pool_t *pool,
+                 log_grep_sink_t sink, void *ctx, log_grep_stats_t *stats);
+
+/**
+ * First occurrence of `needle` in `hay`, or NULL.
+ */
+const char *log_grep_find(const char *hay, size_t hay_len, const char *needle, size_t needle_len);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_GREP_H
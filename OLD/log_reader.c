@@ -0,0 +1,730 @@
+#define _GNU_SOURCE  // memrchr
+#include "log_reader.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "log_dict.h"
+
+/* Bytes of each segment read up front to find its first timestamp */
+#define PROBE_BYTES (64 * 1024)
+
+#define GZ_BUFFER (256 * 1024)
+
+#define STAMP_LEN 19
+
+/* =============================
+ * Timestamps
+ * ============================= */
+
+/* Days since 1970-01-01 of a proleptic Gregorian date */
+static int64_t days_from_civil(int64_t y, unsigned int m, unsigned int d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned int yoe = (unsigned int)(y - era * 400);
+    const unsigned int doy = (153 * (m + (m > 2 ? -3 : 9)) + 2) / 5 + d - 1;
+    const unsigned int doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + (int64_t)doe - 719468;
+}
+
+static inline int digits(const char *p, int n, unsigned int *value)
+{
+    unsigned int v = 0;
+    for (int i = 0; i < n; i++) {
+        if (p[i] < '0' || p[i] > '9') return 0;
+        v = v * 10 + (unsigned int)(p[i] - '0');
+    }
+    *value = v;
+    return 1;
+}
+
+int log_parse_timestamp(const char *text, size_t len, int64_t *timestamp_us)
+{
+    const char *p = text, *end = text + len;
+    unsigned int year, month, day, hour, minute, second, fraction = 0;
+
+    if (p < end && *p == '[') p++;
+    if (end - p < STAMP_LEN) return 0;
+    if (!strchr("-./", p[4]) || p[7] != p[4] || !strchr(" T_", p[10]) ||
+        !strchr(":.", p[13]) || p[16] != p[13] || !p[4] || !p[10] || !p[13]) {
+        return 0;
+    }
+    if (!digits(p, 4, &year) || !digits(p + 5, 2, &month) || !digits(p + 8, 2, &day) ||
+        !digits(p + 11, 2, &hour) || !digits(p + 14, 2, &minute) || !digits(p + 17, 2, &second)) {
+        return 0;
+    }
+    if (month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60) return 0;
+
+    p += STAMP_LEN;
+    if (p + 1 < end && (*p == '.' || *p == ',') && p[1] >= '0' && p[1] <= '9') {
+        unsigned int scale = 100000;
+        for (p++; p < end && *p >= '0' && *p <= '9'; p++, scale /= 10) {
+            fraction += (unsigned int)(*p - '0') * scale;
+        }
+    }
+
+    int64_t seconds = days_from_civil(year, month, day) * 86400 + hour * 3600 + minute * 60 + second;
+    *timestamp_us = seconds * 1000000 + fraction;
+    return 1;
+}
+
+/* =============================
+ * Rotation set discovery
+ * ============================= */
+
+/* "dddd.dd.dd_dd.dd.dd" */
+static int is_stamp(const char *p)
+{
+    static const char shape[] = "dddd.dd.dd_dd.dd.dd";
+    for (int i = 0; i < STAMP_LEN; i++) {
+        if (shape[i] == 'd' ? (p[i] < '0' || p[i] > '9') : p[i] != shape[i]) return 0;
+    }
+    return 1;
+}
+
+/* Checks `name` against stem.STAMP.ext[.gz|.zd] */
+static int match_rotated(const char *name, const char *stem, size_t stem_len, const char *ext,
+                         size_t ext_len, log_segment_t *segment)
+{
+    size_t len = strlen(name);
+
+    if (len < stem_len + 1 + STAMP_LEN + ext_len) return 0;
+    if (memcmp(name, stem, stem_len) != 0 || name[stem_len] != '.' || !is_stamp(name + stem_len + 1)) return 0;
+
+    const char *rest = name + stem_len + 1 + STAMP_LEN;
+    if (memcmp(rest, ext, ext_len) != 0) return 0;
+    rest += ext_len;
+    if (strcmp(rest, ".gz") == 0) segment->compressed = LOG_SEGMENT_GZIP;
+    else if (strcmp(rest, LOG_DICT_EXT) == 0) segment->compressed = LOG_SEGMENT_DICT;
+    else if (*rest) return 0;
+
+    memcpy(segment->stamp, name + stem_len + 1, STAMP_LEN);
+    segment->stamp[STAMP_LEN] = '\0';
+    return 1;
+}
+
+static int add_segment(log_set_t *set, size_t *cap, const char *prefix, const char *name,
+                       const log_segment_t *match)
+{
+    if (set->count == *cap) {
+        size_t grown = *cap ? *cap * 2 : 16;
+        log_segment_t *bigger = (log_segment_t *)realloc(set->segments, grown * sizeof(log_segment_t));
+        if (!bigger) return -1;
+        set->segments = bigger;
+        *cap = grown;
+    }
+    log_segment_t *segment = &set->segments[set->count];
+    if ((size_t)snprintf(segment->path, sizeof(segment->path), "%s%s", prefix, name) >= sizeof(segment->path)) {
+        return 0;
+    }
+    memcpy(segment->stamp, match->stamp, sizeof(segment->stamp));
+    segment->compressed = match->compressed;
+    set->count++;
+    return 0;
+}
+
+static int newest_first(const void *a, const void *b)
+{
+    const log_segment_t *x = *(const log_segment_t *const *)a, *y = *(const log_segment_t *const *)b;
+    const char *sx = x->stamp[0] ? x->stamp : "9999.99.99_99.99.99";
+    const char *sy = y->stamp[0] ? y->stamp : "9999.99.99_99.99.99";
+    int c = strcmp(sy, sx);
+    /* Stable, as Python's sort is: discovery order for equal stamps */
+    return c ? c : (x < y ? -1 : x > y);
+}
+
+int log_set_discover(log_set_t *set, const char *input_file)
+{
+    while (input_file[0] == '.' && input_file[1] == '/') input_file += 2;
+    const char *slash = strrchr(input_file, '/');
+    const char *base = slash ? slash + 1 : input_file;
+    char prefixes[2][LOG_PATH_MAX];
+    int num_dirs = 0;
+    size_t cap = 0;
+
+    memset(set, 0, sizeof(*set));
+
+    /* Same split as os.path.splitext: a leading dot is not an extension */
+    const char *dot = strrchr(base, '.');
+    const char *first = base;
+    while (*first == '.') first++;
+    if (!dot || dot < first) dot = base + strlen(base);
+    const size_t stem_len = (size_t)(dot - base);
+
+    if (slash) {
+        snprintf(prefixes[num_dirs++], LOG_PATH_MAX, "%.*s/", (int)(slash == input_file ? 0 : slash - input_file),
+                 input_file);
+    } else {
+        prefixes[num_dirs++][0] = '\0';
+        snprintf(prefixes[num_dirs++], LOG_PATH_MAX, "logs/");
+    }
+
+    for (int i = 0; i < num_dirs; i++) {
+        DIR *dir = opendir(prefixes[i][0] ? prefixes[i] : ".");
+        struct dirent *entry;
+        if (!dir) continue;
+        while ((entry = readdir(dir)) != NULL) {
+            log_segment_t match;
+            memset(&match, 0, sizeof(match));
+            if (strcmp(entry->d_name, base) != 0 &&
+                !match_rotated(entry->d_name, base, stem_len, dot, strlen(dot), &match)) {
+                continue;
+            }
+            if (add_segment(set, &cap, prefixes[i], entry->d_name, &match) != 0) {
+                closedir(dir);
+                log_set_free(set);
+                return -1;
+            }
+        }
+        closedir(dir);
+    }
+
+    /* A .gz or .zd still being written next to its source: read the source */
+    size_t kept = 0;
+    for (size_t i = 0; i < set->count; i++) {
+        const log_segment_t *segment = &set->segments[i];
+        int shadowed = 0;
+        for (size_t j = 0; j < set->count && segment->compressed && !shadowed; j++) {
+            const log_segment_t *other = &set->segments[j];
+            size_t len = strlen(other->path);
+            shadowed = !other->compressed && strncmp(segment->path, other->path, len) == 0 &&
+                       (strcmp(segment->path + len, ".gz") == 0 || strcmp(segment->path + len, LOG_DICT_EXT) == 0);
+        }
+        if (!shadowed) set->segments[kept++] = *segment;
+    }
+    set->count = kept;
+
+    if (set->count > 1) {
+        const log_segment_t **sorted = (const log_segment_t **)malloc(set->count * sizeof(*sorted));
+        log_segment_t *ordered = (log_segment_t *)malloc(set->count * sizeof(*ordered));
+        if (!sorted || !ordered) {
+            free(sorted);
+            free(ordered);
+            log_set_free(set);
+            return -1;
+        }
+        for (size_t i = 0; i < set->count; i++) sorted[i] = &set->segments[i];
+        qsort(sorted, set->count, sizeof(*sorted), newest_first);
+        for (size_t i = 0; i < set->count; i++) ordered[i] = *sorted[i];
+        free(sorted);
+        free(set->segments);
+        set->segments = ordered;
+    }
+    return 0;
+}
+
+int log_set_live_name(const char *path, char *out, size_t out_size)
+{
+    const char *slash = strrchr(path, '/');
+    const char *base = slash ? slash + 1 : path;
+    size_t len = strlen(path);
+
+    /* The stamp sits between the stem and the extension, as match_rotated() expects */
+    for (const char *p = base; *p; p++) {
+        if (*p != '.' || p == base || strlen(p + 1) < STAMP_LEN || !is_stamp(p + 1)) continue;
+        const char *rest = p + 1 + STAMP_LEN;
+        if (*rest != '.' && *rest != '\0') continue;
+        if (len - (STAMP_LEN + 1) >= out_size) return -1;
+        memcpy(out, path, (size_t)(p - path));
+        memcpy(out + (p - path), rest, strlen(rest) + 1);
+        return 1;
+    }
+    if (len >= out_size) return -1;
+    memcpy(out, path, len + 1);
+    return 0;
+}
+
+void log_set_free(log_set_t *set)
+{
+    free(set->segments);
+    set->segments = NULL;
+    set->count = 0;
+}
+
+/* =============================
+ * Segment sources
+ * ============================= */
+
+enum { CHUNK_EMPTY = 0, CHUNK_FILLING, CHUNK_READY };
+
+typedef struct log_chunk_t {
+    char *data;
+    size_t cap;
+    size_t len;
+    int state;
+    int last;                       /* the segment ends with this chunk */
+    int error;
+} log_chunk_t;
+
+typedef struct log_source_t {
+    log_reader_t *reader;
+    const log_segment_t *segment;
+    uint32_t index;                 /* in the set */
+    uint32_t rank;                  /* in merge order; breaks timestamp ties */
+    int64_t first_ts;
+    int prepared;
+    int finished;
+    int failed;
+
+    /* Plain segments: the whole file mapped */
+    const char *map;
+    size_t map_size;
+
+    /* Compressed segments: two chunks, one consumed while the other fills */
+    gzFile gz;
+    log_dict_reader_t *zd;
+    log_chunk_t chunks[2];
+    int current;                    /* chunk being consumed, -1 before the first */
+    int expect;                     /* chunk to consume next */
+    int filling;                    /* chunk a fill task owns, -1 if none */
+    int at_last_chunk;
+    char *carry;                    /* partial line left at the end of a chunk */
+    size_t carry_len;
+    size_t carry_cap;
+    platform_mutex_t lock;
+    platform_cond_t ready;
+
+    /* Cursor and the line at the head of this segment */
+    const char *pos;
+    const char *end;
+    const char *line;
+    size_t line_len;
+    int64_t ts;
+    int has_ts;
+} log_source_t;
+
+struct log_reader_t {
+    const log_set_t *set;
+    thread_pool_t *pool;
+    log_source_t *sources;
+    size_t count;
+
+    log_source_t **order;           /* by first timestamp */
+    size_t next_activate;
+    log_source_t **heap;
+    size_t heap_size;
+    log_source_t *pending;          /* returned last; advanced on the next call */
+    log_dict_store_t dicts;         /* for .zd segments */
+
+    platform_mutex_t lock;          /* probes outstanding */
+    platform_cond_t idle;
+    size_t outstanding;
+};
+
+/* gzread() or log_dict_read(), whichever the segment needs; -1 once it fails */
+static int source_read(log_source_t *src, char *buffer, unsigned int len)
+{
+    if (src->zd) return log_dict_read(src->zd, buffer, len);
+
+    int got = gzread(src->gz, buffer, len);
+    if (got == 0) {
+        /* Z_BUF_ERROR here is a truncated member */
+        int error;
+        gzerror(src->gz, &error);
+        if (error != Z_OK) return -1;
+    }
+    return got;
+}
+
+static int fill_chunk(log_source_t *src, log_chunk_t *chunk)
+{
+    size_t need = src->carry_len + LOG_CHUNK;
+
+    if (chunk->cap < need) {
+        char *grown = (char *)realloc(chunk->data, need);
+        if (!grown) return -1;
+        chunk->data = grown;
+        chunk->cap = need;
+    }
+    if (src->carry_len) memcpy(chunk->data, src->carry, src->carry_len);
+    chunk->len = src->carry_len;
+    src->carry_len = 0;
+
+    for (;;) {
+        if (chunk->len == chunk->cap) {
+            /* One line longer than the chunk: grow until it ends */
+            char *grown = (char *)realloc(chunk->data, chunk->cap * 2);
+            if (!grown) return -1;
+            chunk->data = grown;
+            chunk->cap *= 2;
+        }
+        size_t room = chunk->cap - chunk->len;
+        int got = source_read(src, chunk->data + chunk->len, room > (1U << 30) ? 1U << 30 : (unsigned int)room);
+        /* A failure keeps what came out before it */
+        if (got < 0) return -1;
+        if (got == 0) {
+            chunk->last = 1;
+            return 0;
+        }
+        chunk->len += (size_t)got;
+        if (chunk->len < chunk->cap) continue;
+
+        const char *nl = (const char *)memrchr(chunk->data, '\n', chunk->len);
+        if (!nl) continue;
+        size_t tail = chunk->len - (size_t)(nl + 1 - chunk->data);
+        if (src->carry_cap < tail) {
+            char *grown = (char *)realloc(src->carry, tail);
+            if (!grown) return -1;
+            src->carry = grown;
+            src->carry_cap = tail;
+        }
+        memcpy(src->carry, nl + 1, tail);
+        src->carry_len = tail;
+        chunk->len -= tail;
+        return 0;
+    }
+}
+
+static void fill_task(void *arg)
+{
+    log_source_t *src = (log_source_t *)arg;
+    log_chunk_t *chunk = &src->chunks[src->filling];
+
+    chunk->last = 0;
+    chunk->error = fill_chunk(src, chunk) != 0;
+    if (chunk->error) chunk->last = 1;
+
+    platform_mutex_lock(&src->lock);
+    chunk->state = CHUNK_READY;
+    src->filling = -1;
+    platform_cond_broadcast(&src->ready);
+    platform_mutex_unlock(&src->lock);
+}
+
+static void start_fill(log_source_t *src, int index)
+{
+    platform_mutex_lock(&src->lock);
+    src->chunks[index].state = CHUNK_FILLING;
+    src->filling = index;
+    platform_mutex_unlock(&src->lock);
+
+    if (!src->reader->pool || thread_pool_add_task(src->reader->pool, fill_task, src) != 0) fill_task(src);
+}
+
+/* Opens the segment and starts inflating its first chunk; idempotent */
+static void source_prepare(log_source_t *src)
+{
+    if (src->prepared) return;
+    src->prepared = 1;
+    src->ts = src->first_ts;
+
+    if (!src->segment->compressed) {
+        struct stat st;
+        int fd = open(src->segment->path, O_RDONLY | O_CLOEXEC);
+        if (fd < 0 || fstat(fd, &st) != 0) {
+            if (fd >= 0) close(fd);
+            src->failed = 1;
+            return;
+        }
+        if (st.st_size > 0) {
+            void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (map == MAP_FAILED) {
+                close(fd);
+                src->failed = 1;
+                return;
+            }
+            /* Advice values are not flags: one call each */
+            madvise(map, (size_t)st.st_size, MADV_SEQUENTIAL);
+            madvise(map, (size_t)st.st_size, MADV_WILLNEED);
+            src->map = (const char *)map;
+            src->map_size = (size_t)st.st_size;
+        }
+        close(fd);
+        src->pos = src->map;
+        src->end = src->map + src->map_size;
+        src->at_last_chunk = 1;
+        return;
+    }
+
+    if (src->segment->compressed == LOG_SEGMENT_DICT) {
+        src->zd = log_dict_reader_open(&src->reader->dicts, src->segment->path);
+        if (!src->zd) {
+            src->failed = 1;
+            return;
+        }
+    } else {
+        src->gz = gzopen(src->segment->path, "rb");
+        if (!src->gz) {
+            src->failed = 1;
+            return;
+        }
+        gzbuffer(src->gz, GZ_BUFFER);
+    }
+    src->current = -1;
+    src->expect = 0;
+    start_fill(src, 0);
+}
+
+/* Moves to the next inflated chunk, waiting for it; starts the one after */
+static void source_next_chunk(log_source_t *src)
+{
+    platform_mutex_lock(&src->lock);
+    if (src->current >= 0) src->chunks[src->current].state = CHUNK_EMPTY;
+    while (src->chunks[src->expect].state != CHUNK_READY) platform_cond_wait(&src->ready, &src->lock);
+    platform_mutex_unlock(&src->lock);
+
+    log_chunk_t *chunk = &src->chunks[src->expect];
+    src->current = src->expect;
+    src->expect ^= 1;
+    src->pos = chunk->data;
+    src->end = chunk->data + chunk->len;
+    if (chunk->error) src->failed = 1;
+    if (chunk->last) src->at_last_chunk = 1;
+    else start_fill(src, src->expect);
+}
+
+/* Loads the next line of `src` into its head. Returns 1, or 0 at its end */
+static int source_advance(log_source_t *src)
+{
+    while (src->pos >= src->end) {
+        if (src->failed || src->at_last_chunk) return 0;
+        source_next_chunk(src);
+    }
+
+    const char *nl = (const char *)memchr(src->pos, '\n', (size_t)(src->end - src->pos));
+    src->line = src->pos;
+    src->line_len = nl ? (size_t)(nl - src->pos) : (size_t)(src->end - src->pos);
+    src->pos = nl ? nl + 1 : src->end;
+
+    int64_t ts;
+    src->has_ts = log_parse_timestamp(src->line, src->line_len, &ts);
+    if (src->has_ts) src->ts = ts;
+    return 1;
+}
+
+static void source_release(log_source_t *src)
+{
+    if (src->gz || src->zd) {
+        platform_mutex_lock(&src->lock);
+        while (src->filling >= 0) platform_cond_wait(&src->ready, &src->lock);
+        platform_mutex_unlock(&src->lock);
+        if (src->gz) gzclose(src->gz);
+        log_dict_reader_close(src->zd);
+        src->gz = NULL;
+        src->zd = NULL;
+    }
+    for (int i = 0; i < 2; i++) {
+        free(src->chunks[i].data);
+        src->chunks[i].data = NULL;
+    }
+    free(src->carry);
+    src->carry = NULL;
+    if (src->map) munmap((void *)src->map, src->map_size);
+    src->map = NULL;
+    src->finished = 1;
+}
+
+/* =============================
+ * First timestamps
+ * ============================= */
+
+static void probe_task(void *arg)
+{
+    log_source_t *src = (log_source_t *)arg;
+    log_reader_t *reader = src->reader;
+    char *buffer = (char *)malloc(PROBE_BYTES);
+    const int dict = src->segment->compressed == LOG_SEGMENT_DICT;
+    /* gzread passes plain files through, so one path serves both of those */
+    gzFile in = buffer && !dict ? gzopen(src->segment->path, "rb") : NULL;
+    log_dict_reader_t *zd = buffer && dict ? log_dict_reader_open(&reader->dicts, src->segment->path) : NULL;
+
+    src->first_ts = INT64_MIN;
+    if (in || zd) {
+        int got = in ? gzread(in, buffer, PROBE_BYTES) : log_dict_read(zd, buffer, PROBE_BYTES);
+        const char *p = buffer, *end = buffer + (got > 0 ? got : 0);
+        while (p < end) {
+            const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+            size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+            if (log_parse_timestamp(p, len, &src->first_ts)) break;
+            p += len + 1;
+        }
+        if (in) gzclose(in);
+        log_dict_reader_close(zd);
+    }
+    free(buffer);
+
+    platform_mutex_lock(&reader->lock);
+    if (--reader->outstanding == 0) platform_cond_broadcast(&reader->idle);
+    platform_mutex_unlock(&reader->lock);
+}
+
+static int by_first_timestamp(const void *a, const void *b)
+{
+    const log_source_t *x = *(log_source_t *const *)a, *y = *(log_source_t *const *)b;
+    if (x->first_ts != y->first_ts) return x->first_ts < y->first_ts ? -1 : 1;
+    /* The set is newest first: older names go first */
+    return x->index > y->index ? -1 : x->index < y->index;
+}
+
+/* =============================
+ * Merge
+ * ============================= */
+
+static inline int heap_less(const log_source_t *a, const log_source_t *b)
+{
+    return a->ts < b->ts || (a->ts == b->ts && a->rank < b->rank);
+}
+
+static void heap_push(log_reader_t *reader, log_source_t *src)
+{
+    size_t i = reader->heap_size++;
+    while (i > 0) {
+        size_t parent = (i - 1) / 2;
+        if (!heap_less(src, reader->heap[parent])) break;
+        reader->heap[i] = reader->heap[parent];
+        i = parent;
+    }
+    reader->heap[i] = src;
+}
+
+static log_source_t *heap_pop(log_reader_t *reader)
+{
+    log_source_t *top = reader->heap[0];
+    log_source_t *last = reader->heap[--reader->heap_size];
+    size_t i = 0, n = reader->heap_size;
+
+    for (;;) {
+        size_t child = 2 * i + 1;
+        if (child >= n) break;
+        if (child + 1 < n && heap_less(reader->heap[child + 1], reader->heap[child])) child++;
+        if (!heap_less(reader->heap[child], last)) break;
+        reader->heap[i] = reader->heap[child];
+        i = child;
+    }
+    if (n) reader->heap[i] = last;
+    return top;
+}
+
+log_reader_t *log_reader_open(const log_set_t *set, thread_pool_t *pool)
+{
+    if (!set || set->count == 0) return NULL;
+
+    log_reader_t *reader = (log_reader_t *)calloc(1, sizeof(log_reader_t));
+    if (!reader) return NULL;
+    reader->set = set;
+    reader->pool = pool && pool->num_threads > 0 ? pool : NULL;
+    reader->count = set->count;
+    reader->sources = (log_source_t *)calloc(set->count, sizeof(log_source_t));
+    reader->order = (log_source_t **)malloc(set->count * sizeof(log_source_t *));
+    reader->heap = (log_source_t **)malloc(set->count * sizeof(log_source_t *));
+    if (!reader->sources || !reader->order || !reader->heap) {
+        free(reader->sources);
+        free(reader->order);
+        free(reader->heap);
+        free(reader);
+        return NULL;
+    }
+    for (size_t i = 0; i < set->count; i++) {
+        if (set->segments[i].compressed != LOG_SEGMENT_DICT) continue;
+        /* Without them the .zd segments fail on their own; the rest still reads */
+        if (log_dict_store_load(&reader->dicts, LOG_DICT_DIR) != 0) {
+            fprintf(stderr, "log_reader_open: cannot load dictionaries from %s\n", LOG_DICT_DIR);
+        }
+        break;
+    }
+    platform_mutex_init(&reader->lock);
+    platform_cond_init(&reader->idle);
+
+    reader->outstanding = set->count;
+    for (size_t i = 0; i < set->count; i++) {
+        log_source_t *src = &reader->sources[i];
+        src->reader = reader;
+        src->segment = &set->segments[i];
+        src->index = (uint32_t)i;
+        src->filling = -1;
+        platform_mutex_init(&src->lock);
+        platform_cond_init(&src->ready);
+        reader->order[i] = src;
+        if (!reader->pool || thread_pool_add_task(reader->pool, probe_task, src) != 0) probe_task(src);
+    }
+    platform_mutex_lock(&reader->lock);
+    while (reader->outstanding > 0) platform_cond_wait(&reader->idle, &reader->lock);
+    platform_mutex_unlock(&reader->lock);
+
+    qsort(reader->order, set->count, sizeof(log_source_t *), by_first_timestamp);
+    for (size_t i = 0; i < set->count; i++) reader->order[i]->rank = (uint32_t)i;
+    return reader;
+}
+
+/* Brings in segments that start no later than the head of the merge */
+static int activate(log_reader_t *reader)
+{
+    int failed = 0;
+
+    while (reader->next_activate < reader->count) {
+        log_source_t *src = reader->order[reader->next_activate];
+        if (reader->heap_size > 0 && src->first_ts > reader->heap[0]->ts) break;
+        reader->next_activate++;
+
+        for (size_t k = reader->next_activate; k < reader->count && k < reader->next_activate + LOG_PREFETCH; k++) {
+            source_prepare(reader->order[k]);
+        }
+        source_prepare(src);
+        if (source_advance(src)) {
+            heap_push(reader, src);
+        } else {
+            failed |= src->failed;
+            source_release(src);
+        }
+    }
+    return failed;
+}
+
+int log_reader_next(log_reader_t *reader, log_line_t *line)
+{
+    log_source_t *src = reader->pending;
+    int failed = 0;
+
+    reader->pending = NULL;
+    if (src) {
+        if (!source_advance(src)) {
+            failed = src->failed;
+            source_release(src);
+        } else if (!src->has_ts) {
+            /* A continuation stays with the record it belongs to */
+            reader->pending = src;
+        } else {
+            heap_push(reader, src);
+        }
+    }
+    if (!reader->pending) {
+        failed |= activate(reader);
+        if (failed) return -1;
+        if (reader->heap_size == 0) return 0;
+        reader->pending = heap_pop(reader);
+    }
+
+    src = reader->pending;
+    line->text = src->line;
+    line->len = src->line_len;
+    line->timestamp_us = src->ts;
+    line->has_timestamp = src->has_ts;
+    line->segment = src->index;
+    return 1;
+}
+
+void log_reader_close(log_reader_t *reader)
+{
+    if (!reader) return;
+    for (size_t i = 0; i < reader->count; i++) {
+        log_source_t *src = &reader->sources[i];
+        if (!src->finished) source_release(src);
+        platform_cond_destroy(&src->ready);
+        platform_mutex_destroy(&src->lock);
+    }
+    platform_cond_destroy(&reader->idle);
+    platform_mutex_destroy(&reader->lock);
+    log_dict_store_free(&reader->dicts);
+    free(reader->sources);
+    free(reader->order);
+    free(reader->heap);
+    free(reader);
+}
@@ -0,0 +1,129 @@
+#ifndef LOG_READER_H
+#define LOG_READER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "threadpool.h"
+
+/* =============================
+ * Rotation set discovery
+ * ============================= */
+
+#define LOG_PATH_MAX 1024
+
+/**
+ * One file of a rotation set: the live `client.log` or a rotated
+ * `client.YYYY.MM.DD_hh.mm.ss.log`, possibly compressed by
+ * log_compression_thread() to `.log.gz`, or to `.log.zd` with a trained
+ * dictionary (log_dict.h).
+ */
+enum { LOG_SEGMENT_PLAIN = 0, LOG_SEGMENT_GZIP, LOG_SEGMENT_DICT };
+
+typedef struct log_segment_t {
+    char path[LOG_PATH_MAX];
+    char stamp[20];                 /* "YYYY.MM.DD_hh.mm.ss", "" for the live file */
+    int compressed;                 /* LOG_SEGMENT_*; nonzero for either compressed form */
+} log_segment_t;
+
+typedef struct log_set_t {
+    log_segment_t *segments;        /* newest first, the live file before all others */
+    size_t count;
+} log_set_t;
+
+/**
+ * Find the rotation set of `input_file` the way logs.py's
+ * find_matching_logs() does: in the file's own directory, or in "." and
+ * "logs" when it has none. Rotated segments may also be `.gz` or `.zd`;
+ * when a compressed form exists next to the plain file (compression still
+ * running) the plain file is used.
+ * Returns 0, or -1 if memory ran out.
+ */
+int log_set_discover(log_set_t *set, const char *input_file);
+
+void log_set_free(log_set_t *set);
+
+/**
+ * The live file a rotated segment belongs to: `path` with the
+ * `.YYYY.MM.DD_hh.mm.ss` stamp taken out of its base name, so
+ * `logs/client.2024.05.01_00.00.00.log` gives `logs/client.log`.
+ * Discovering from a rotated name would match only that one file.
+ * Returns 1 if a stamp was removed, 0 if `path` has none (it is copied
+ * as is), or -1 if `out_size` is too small.
+ */
+int log_set_live_name(const char *path, char *out, size_t out_size);
+
+/* =============================
+ * Merged reader
+ * ============================= */
+
+/**
+ * Reads a rotation set as one stream of lines in time order.
+ *
+ * A line's time is the timestamp it starts with ("YYYY-MM-DD hh:mm:ss"
+ * with '-', '.' or '/' in the date, ' ', 'T' or '_' before the time,
+ * optional fraction and optional leading '['). A line without one belongs
+ * to the record above it and is never separated from it; lines before a
+ * segment's first timestamp take that timestamp.
+ *
+ * Plain segments are mapped. Compressed ones are inflated in LOG_CHUNK
+ * pieces on the pool, one chunk ahead of the reader, and the next
+ * LOG_PREFETCH segments to be merged are opened and their first chunk
+ * inflated before the reader reaches them. `.zd` segments take their
+ * dictionaries from LOG_DICT_DIR, loaded once when the reader opens.
+ *
+ * Segments are merged with a heap keyed on their next line, so segments
+ * whose time ranges overlap interleave correctly. Each segment's first
+ * timestamp is probed up front, in parallel, and a segment only joins
+ * the merge once the stream reaches that time. A normal rotation set,
+ * where ranges do not overlap, therefore has one or two segments open at
+ * a time. Ties go to the segment that started earlier.
+ */
+
+#define LOG_CHUNK (1 << 20)
+#define LOG_PREFETCH 2
+
+typedef struct log_line_t {
+    const char *text;               /* valid until the next log_reader_next() */
+    size_t len;                     /* without the newline */
+    int64_t timestamp_us;           /* microseconds since the epoch, zone as written */
+    int has_timestamp;              /* 0: a continuation line, timestamp inherited */
+    uint32_t segment;               /* index into the set */
+} log_line_t;
+
+typedef struct log_reader_t log_reader_t;
+
+/**
+ * Open every segment of `set` (which must outlive the reader) for
+ * merged reading; decompression runs on `pool`, or inline if it is NULL.
+ * Returns NULL if nothing could be opened or memory ran out.
+ */
+log_reader_t *log_reader_open(const log_set_t *set, thread_pool_t *pool);
+
+/**
+ * Next line of the merged stream. Returns 1 with `line` filled, 0 at the
+ * end, -1 if a segment failed to read (the stream continues without it
+ * on the next call).
+ */
+int log_reader_next(log_reader_t *reader, log_line_t *line);
+
+/**
+ * Wait for outstanding decompression and free the reader.
+ */
+void log_reader_close(log_reader_t *reader);
+
+/**
+ * Timestamp at the start of `text`, in microseconds. Returns 1 if there
+ * is one.
+ */
+int log_parse_timestamp(const char *text, size_t len, int64_t *timestamp_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // LOG_READER_H
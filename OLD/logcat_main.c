@@ -0,0 +1,76 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_reader.h"
+#include "platform.h"
+#include "threadpool.h"
+
+/**
+ * Read a rotated log set as one stream:
+ *
+ *   logcat_main <client.log> [list|cat] [threads]
+ *
+ * "list" prints the rotation set newest first, as logs.py does. "cat"
+ * (the default) writes every line of every segment, plain or .gz, in
+ * timestamp order, with the line and byte counts on stderr. 0 threads
+ * means one per CPU.
+ */
+
+int main(int argc, char **argv)
+{
+    if (argc < 2) {
+        fprintf(stderr, "usage: %s <client.log> [list|cat] [threads]\n", argv[0]);
+        return 1;
+    }
+
+    log_set_t set;
+    if (log_set_discover(&set, argv[1]) != 0) {
+        fprintf(stderr, "Out of memory\n");
+        return 1;
+    }
+    if (argc > 2 && strcmp(argv[2], "list") == 0) {
+        for (size_t i = 0; i < set.count; i++) printf("%s\n", set.segments[i].path);
+        log_set_free(&set);
+        return 0;
+    }
+    if (set.count == 0) {
+        fprintf(stderr, "No logs matching %s\n", argv[1]);
+        log_set_free(&set);
+        return 1;
+    }
+
+    int threads = argc > 3 ? atoi(argv[3]) : 0;
+    if (threads <= 0) threads = platform_cpu_count();
+    thread_pool_t pool;
+    thread_pool_init(&pool, threads);
+
+    static char buffer[1 << 20];
+    setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+
+    unsigned long long start = platform_time_ns(), lines = 0, bytes = 0, errors = 0;
+    log_reader_t *reader = log_reader_open(&set, &pool);
+    int rc = reader ? 0 : 1;
+    log_line_t line;
+    int got;
+
+    while (reader && (got = log_reader_next(reader, &line)) != 0) {
+        if (got < 0) {
+            errors++;
+            continue;
+        }
+        fwrite(line.text, 1, line.len, stdout);
+        putc_unlocked('\n', stdout);
+        lines++;
+        bytes += line.len + 1;
+    }
+    fflush(stdout);
+    unsigned long long elapsed = platform_time_ns() - start;
+
+    log_reader_close(reader);
+    thread_pool_shutdown(&pool);
+    fprintf(stderr, "[Main] %zu segments, %llu lines, %llu bytes in %.3f ms (%.1f MB/s)%s\n",
+            set.count, lines, bytes, (double)elapsed / 1e6, elapsed ? (double)bytes * 1e3 / (double)elapsed : 0.0,
+            errors ? ", some segments failed to read" : "");
+    log_set_free(&set);
+    return rc;
+}
@@ -0,0 +1,160 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "log_dict.h"
+#include "platform.h"
+
+/**
+ * Per-service compression dictionaries for small log segments:
+ *
+ *   logdict_main train <dir> <service> <sample>...
+ *   logdict_main compress <dir> <log> [level]
+ *   logdict_main decompress <dir> <log.zd> <out>
+ *   logdict_main bench <dir> <log>...
+ *
+ * "train" stores the next dictionary version for the service in <dir>.
+ * "compress" writes <log>.zd with the newest dictionary for the log's
+ * service. "bench" compresses each log (use ones left out of training)
+ * as gzip and with the dictionary, in memory, and prints sizes and times.
+ */
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    if (!f) return NULL;
+    fseek(f, 0, SEEK_END);
+    long size = ftell(f);
+    fseek(f, 0, SEEK_SET);
+    char *data = (char *)malloc(size > 0 ? (size_t)size : 1);
+    *len = data && size > 0 ? fread(data, 1, (size_t)size, f) : 0;
+    fclose(f);
+    return data;
+}
+
+/* Compressed size of `data` as gzip, or with `dict` as zlib when it is set */
+static size_t deflated_size(const char *data, size_t len, const log_dict_t *dict, unsigned char *out, size_t cap)
+{
+    z_stream zs;
+    memset(&zs, 0, sizeof(zs));
+    if (deflateInit2(&zs, Z_DEFAULT_COMPRESSION, Z_DEFLATED, dict ? 15 : 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        return 0;
+    }
+    if (dict) deflateSetDictionary(&zs, dict->data, (uInt)dict->size);
+    zs.next_in = (Bytef *)data;
+    zs.avail_in = (uInt)len;
+    zs.next_out = out;
+    zs.avail_out = (uInt)cap;
+    deflate(&zs, Z_FINISH);
+    size_t size = zs.total_out;
+    deflateEnd(&zs);
+    return size;
+}
+
+static int run_bench(const log_dict_store_t *store, char **paths, int count)
+{
+    uint64_t total = 0, gz_total = 0, dict_total = 0;
+    unsigned long long gz_ns = 0, dict_ns = 0;
+
+    for (int i = 0; i < count; i++) {
+        char service[LOG_DICT_SERVICE_MAX];
+        const log_dict_t *dict = log_dict_service(paths[i], service, sizeof(service)) == 0
+                                     ? log_dict_store_latest(store, service) : NULL;
+        if (!dict) {
+            fprintf(stderr, "No dictionary for %s\n", paths[i]);
+            continue;
+        }
+        size_t len = 0;
+        char *data = read_file(paths[i], &len);
+        size_t cap = compressBound((uLong)len) + 64;
+        unsigned char *out = (unsigned char *)malloc(cap);
+        if (!data || !out) {
+            fprintf(stderr, "Cannot read %s\n", paths[i]);
+            free(data);
+            free(out);
+            continue;
+        }
+
+        unsigned long long start = platform_time_ns();
+        size_t gz = deflated_size(data, len, NULL, out, cap);
+        unsigned long long mid = platform_time_ns();
+        size_t zd = deflated_size(data, len, dict, out, cap);
+        unsigned long long end = platform_time_ns();
+
+        printf("%-40s %9zu  gzip %8zu (%5.2fx)  dict v%u %8zu (%5.2fx)\n", paths[i], len, gz,
+               gz ? (double)len / (double)gz : 0.0, dict->version, zd, zd ? (double)len / (double)zd : 0.0);
+        total += len;
+        gz_total += gz;
+        dict_total += zd;
+        gz_ns += mid - start;
+        dict_ns += end - mid;
+        free(out);
+        free(data);
+    }
+    if (gz_total && dict_total) {
+        printf("[Main] %llu bytes: gzip %.2fx in %.3f ms, dictionary %.2fx in %.3f ms\n", (unsigned long long)total,
+               (double)total / (double)gz_total, (double)gz_ns / 1e6, (double)total / (double)dict_total,
+               (double)dict_ns / 1e6);
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 4) {
+        fprintf(stderr, "usage: %s train <dir> <service> <sample>...\n", argv[0]);
+        fprintf(stderr, "       %s compress <dir> <log> [level]\n", argv[0]);
+        fprintf(stderr, "       %s decompress <dir> <log.zd> <out>\n", argv[0]);
+        fprintf(stderr, "       %s bench <dir> <log>...\n", argv[0]);
+        return 1;
+    }
+    const char *dir = argv[2];
+
+    if (strcmp(argv[1], "train") == 0) {
+        if (argc < 5) {
+            fprintf(stderr, "train needs <service> and samples\n");
+            return 1;
+        }
+        log_dict_t dict;
+        unsigned long long start = platform_time_ns();
+        if (log_dict_train(argv[3], (const char *const *)(argv + 4), (size_t)(argc - 4), 0, &dict) != 0) return 1;
+        unsigned long long elapsed = platform_time_ns() - start;
+        int rc = log_dict_save(&dict, dir) == 0 ? 0 : 1;
+        if (rc == 0) {
+            printf("[Main] %s.%u.dict: %zu bytes, id %08x, from %d samples in %.3f ms\n", dict.service,
+                   dict.version, dict.size, dict.id, argc - 4, (double)elapsed / 1e6);
+        }
+        log_dict_free(&dict);
+        return rc;
+    }
+
+    log_dict_store_t store;
+    if (log_dict_store_load(&store, dir) != 0) {
+        fprintf(stderr, "Cannot load dictionaries from %s\n", dir);
+        return 1;
+    }
+
+    int rc = 0;
+    if (strcmp(argv[1], "compress") == 0) {
+        char service[LOG_DICT_SERVICE_MAX], out_path[1024];
+        const log_dict_t *dict = log_dict_service(argv[3], service, sizeof(service)) == 0
+                                     ? log_dict_store_latest(&store, service) : NULL;
+        if (!dict) {
+            fprintf(stderr, "No dictionary for %s in %s\n", argv[3], dir);
+            rc = 1;
+        } else {
+            snprintf(out_path, sizeof(out_path), "%s%s", argv[3], LOG_DICT_EXT);
+            int level = argc > 4 ? atoi(argv[4]) : Z_DEFAULT_COMPRESSION;
+            rc = log_dict_compress_file(dict, argv[3], out_path, level) == 0 ? 0 : 1;
+        }
+    } else if (strcmp(argv[1], "decompress") == 0 && argc >= 5) {
+        rc = log_dict_decompress_file(&store, argv[3], argv[4]) == 0 ? 0 : 1;
+    } else if (strcmp(argv[1], "bench") == 0) {
+        rc = run_bench(&store, argv + 3, argc - 3);
+    } else {
+        fprintf(stderr, "Unknown command %s\n", argv[1]);
+        rc = 1;
+    }
+    log_dict_store_free(&store);
+    return rc;
+}
@@ -0,0 +1,81 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "log_grep.h"
+#include "log_reader.h"
+#include "platform.h"
+#include "threadpool.h"
+
+/**
+ * Search plain, .gz and seekable .gz logs for a fixed string:
+ *
+ *   loggrep_main <pattern> <from> <to> <file>...
+ *
+ * Prints "file:line:text" for each matching line, files in the order
+ * given, like zgrep -Hn run over them one after another. <from> and <to>
+ * (e.g. "2024-05-01 10:00:00", "-" for an open end) keep only records
+ * stamped within the window; seekable logs then skip frames outside it
+ * and their lines print as "file:text", as their numbers are unknown.
+ */
+
+static int print_match(void *ctx, const char *path, uint64_t line_no, const char *line, size_t len)
+{
+    (void)ctx;
+    if (line_no) {
+        printf("%s:%llu:", path, (unsigned long long)line_no);
+    } else {
+        printf("%s:", path);
+    }
+    fwrite(line, 1, len, stdout);
+    putc_unlocked('\n', stdout);
+    return 0;
+}
+
+static int parse_bound(const char *arg, int64_t open_value, int64_t *value)
+{
+    if (strcmp(arg, "-") == 0) {
+        *value = open_value;
+        return 0;
+    }
+    if (!log_parse_timestamp(arg, strlen(arg), value)) {
+        fprintf(stderr, "Cannot read a time from '%s'\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 5) {
+        fprintf(stderr, "usage: %s <pattern> <from|-> <to|-> <file>...\n", argv[0]);
+        return 2;
+    }
+
+    log_grep_config_t config;
+    memset(&config, 0, sizeof(config));
+    config.pattern = argv[1];
+    config.pattern_len = strlen(argv[1]);
+    if (parse_bound(argv[2], INT64_MIN, &config.from_us) != 0 || parse_bound(argv[3], INT64_MAX, &config.to_us) != 0) {
+        return 2;
+    }
+
+    thread_pool_t pool;
+    thread_pool_init(&pool, platform_cpu_count());
+
+    static char buffer[1 << 20];
+    setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+    log_grep_stats_t stats;
+    unsigned long long start = platform_time_ns();
+    int rc = log_grep_run((const char *const *)(argv + 4), (size_t)(argc - 4), &config, &pool, print_match, NULL,
+                          &stats);
+    fflush(stdout);
+    unsigned long long elapsed = platform_time_ns() - start;
+    thread_pool_shutdown(&pool);
+
+    fprintf(stderr, "[Main] %llu matches in %u files, %u units (%u frames skipped), %llu bytes in %.3f ms\n",
+            (unsigned long long)stats.matches, stats.files, stats.units, stats.frames_skipped,
+            (unsigned long long)stats.bytes_scanned, (double)elapsed / 1e6);
+    /* grep's exit status: 0 matched, 1 nothing found, 2 trouble */
+    if (rc != 0) return 2;
+    return stats.matches ? 0 : 1;
+}
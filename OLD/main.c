@@ -1,13 +1,35 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <signal.h>
+#include "command_server.h"
+#include "config.h"
 #include "threadpool.h"
 
+/**
+ * Thread pool demo with a reloadable config:
+ *
+ *   main [config.json]       (default threadpool.json)
+ *
+ * A command server (command_interface.py's protocol) listens on the
+ * configured command_port, with max_frame_length as its frame limit, and
+ * prints commands from the pool at log level info and up.
+ *
+ * Send SIGHUP to reload the file; see config.h for its members. The
+ * pool size, port and frame limit are read once at start, everything
+ * else takes effect on the next task or command.
+ */
+
+#define DEFAULT_CONFIG "threadpool.json"
+
 /**
  * We use a global volatile sig_atomic_t so that the
  * signal handler can safely set a shutdown flag.
  */
 static volatile sig_atomic_t g_keepRunning = 1;
+static volatile sig_atomic_t g_reload = 0;
+
+/* Read by tasks on every run, reloaded by the main thread */
+static config_store_t g_config;
 
 /**
  * Simple signal handler for Ctrl + C (SIGINT).
@@ -20,34 +42,131 @@ void handle_sigint(int sig)
     g_keepRunning = 0;
 }
 
+/**
+ * SIGHUP asks for a reload; the main loop does it, since parsing is not
+ * safe in a signal handler.
+ */
+void handle_sighup(int sig)
+{
+    (void)sig; // unused
+    g_reload = 1;
+}
+
 /**
  * Example task function that just prints its ID, "works" for a bit,
- * and then finishes.
+ * and then finishes. Pool workers are inside an epoch critical region
+ * for the whole task, so the config snapshot needs no locking.
  */
 static void example_task(void *arg)
 {
     int taskId = *(int *)arg;
     free(arg); // free the allocated memory for the ID
 
-    printf("[Task] Executing taskId = %d\n", taskId);
+    const config_t *config = config_current(&g_config);
+    if (config->log_level >= CONFIG_LOG_INFO) printf("[Task] Executing taskId = %d\n", taskId);
 
     // Simulate some work (300ms)
     platform_sleep_ms(300);
 
-    printf("[Task] Finished taskId = %d\n", taskId);
+    if (config->log_level >= CONFIG_LOG_DEBUG) {
+        printf("[Task] Finished taskId = %d (config version %llu)\n", taskId, (unsigned long long)config->version);
+    } else if (config->log_level >= CONFIG_LOG_INFO) {
+        printf("[Task] Finished taskId = %d\n", taskId);
+    }
+}
+
+/* Pool task, so inside a critical region: the snapshot needs no locking */
+static void print_command(void *ctx, uint32_t index, const char *message, size_t len)
+{
+    (void)ctx;
+    (void)len;
+    if (config_current(&g_config)->log_level >= CONFIG_LOG_INFO) {
+        printf("[Command] Received (index %u): %s\n", index, message);
+    }
+}
+
+/* Reload on the main thread, outside any critical region */
+static void reload_config(thread_pool_t *pool, const command_server_t *server, ebr_thread_t *self)
+{
+    if (config_store_reload(&g_config, self) != 0) {
+        fprintf(stderr, "[Main] Reload failed, keeping the current config.\n");
+        return;
+    }
+    ebr_enter(self);
+    const config_t *config = config_current(&g_config);
+    config_print(config, "[Main] Reloaded:");
+    if (config->pool_threads != pool->num_threads) {
+        printf("[Main] pool_threads takes effect on restart (running %d).\n", pool->num_threads);
+    }
+    if (config->command_port != server->config.port ||
+        config->max_frame_length != server->config.max_frame_length) {
+        printf("[Main] The protocol settings take effect on restart (port %u, max_frame_length %u).\n",
+               server->config.port, server->config.max_frame_length);
+    }
+    ebr_exit(self);
 }
 
-int main(void)
+int main(int argc, char **argv)
 {
+    const char *config_path = argc > 1 ? argv[1] : DEFAULT_CONFIG;
+
     signal(SIGINT, handle_sigint);
+#ifdef SIGHUP
+    signal(SIGHUP, handle_sighup);
+#endif
+
+    // 1. Load the config, falling back to the defaults
+    config_t *initial = config_load(config_path);
+    if (!initial) {
+        initial = (config_t *)malloc(sizeof(config_t));
+        if (!initial) return 1;
+        config_defaults(initial);
+        printf("[Main] Using the default config.\n");
+    }
+    config_print(initial, "[Main] Config:");
 
-    // 1. Initialise a thread pool with N worker threads
+    // 2. Initialise a thread pool with the configured number of worker threads
     thread_pool_t pool;
-    thread_pool_init(&pool, 4);
+    thread_pool_init(&pool, initial->pool_threads);
+    if (!pool.threads) {
+        config_free(initial);
+        return 1;
+    }
 
-    // 2. Main loop: keep adding tasks until user presses Ctrl + C
+    // Old snapshots are reclaimed through the pool's epoch domain
+    config_store_init(&g_config, config_path, initial, &pool.reclaim);
+    ebr_thread_t *self = ebr_register(&pool.reclaim);
+    if (!self) {
+        thread_pool_shutdown(&pool);
+        config_store_destroy(&g_config);
+        return 1;
+    }
+
+    // 3. Serve commands with the configured protocol settings
+    command_server_config_t command_config = { 0 };
+    command_config.port = (unsigned short)initial->command_port;
+    command_config.max_frame_length = initial->max_frame_length;
+    command_config.num_loops = 1;
+    command_config.pool = &pool;
+    command_config.handler = print_command;
+    command_server_t server;
+    if (command_server_start(&server, &command_config) != 0) {
+        fprintf(stderr, "[Main] Cannot listen for commands on port %u.\n", command_config.port);
+        ebr_unregister(self);
+        thread_pool_shutdown(&pool);
+        config_store_destroy(&g_config);
+        return 1;
+    }
+    printf("[Main] Listening for commands on port %u.\n", command_config.port);
+
+    // 4. Main loop: keep adding tasks until user presses Ctrl + C
     int counter = 0;
     while (g_keepRunning) {
+        if (g_reload) {
+            g_reload = 0;
+            reload_config(&pool, &server, self);
+        }
+
         // allocate memory for the task ID
         int *taskId = (int *)malloc(sizeof(int));
         if (!taskId) {
@@ -57,16 +176,27 @@ int main(void)
         *taskId = counter++;
 
         // Add the task to the thread pool
-        thread_pool_add_task(&pool, example_task, taskId);
-
-        printf("[Main] Enqueued task %d. Press Ctrl + C to stop.\n", *taskId);
+        if (thread_pool_add_task(&pool, example_task, taskId) != 0) {
+            fprintf(stderr, "[Main] Task %d not queued.\n", counter - 1);
+            free(taskId);
+        } else {
+            ebr_enter(self);
+            if (config_current(&g_config)->log_level >= CONFIG_LOG_INFO) {
+                printf("[Main] Enqueued task %d. Press Ctrl + C to stop.\n", counter - 1);
+            }
+            ebr_exit(self);
+        }
 
         // Sleep half a second between tasks
         platform_sleep_ms(500);
     }
 
-    // 3. Gracefully shut down the thread pool
+    // 5. Stop the commands before the pool they run on, then shut the pool down,
+    // which frees the retired snapshots
+    command_server_stop(&server);
+    ebr_unregister(self);
     thread_pool_shutdown(&pool);
+    config_store_destroy(&g_config);
 
     printf("[Main] All threads shut down, exiting.\n");
     return 0;
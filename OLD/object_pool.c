@@ -0,0 +1,306 @@
+#include "object_pool.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#if defined(_WIN32) || defined(_WIN64)
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+
+#include "platform.h"
+
+/* Spins before a waiter yields, in case the holder was preempted */
+#define SPIN_LIMIT 64
+
+static inline void spin_lock(unsigned char *lock)
+{
+    int spins = 0;
+    while (__atomic_test_and_set(lock, __ATOMIC_ACQUIRE)) {
+        while (__atomic_load_n(lock, __ATOMIC_RELAXED)) {
+            if (++spins == SPIN_LIMIT) {
+                platform_thread_yield();
+                spins = 0;
+            }
+        }
+    }
+}
+
+static inline void spin_unlock(unsigned char *lock)
+{
+    __atomic_clear(lock, __ATOMIC_RELEASE);
+}
+
+/* =============================
+ * Regions
+ * ============================= */
+
+static void *map_region(int flags, int *huge)
+{
+    *huge = 0;
+#if defined(_WIN32) || defined(_WIN64)
+    (void)flags;
+    return VirtualAlloc(NULL, OBJECT_POOL_REGION, MEM_RESERVE | MEM_COMMIT, PAGE_READWRITE);
+#else
+    void *p;
+#if defined(MAP_HUGETLB)
+    if (flags & OBJECT_POOL_HUGEPAGES) {
+        /* Reserved huge pages first; most systems have none configured */
+        p = mmap(NULL, OBJECT_POOL_REGION, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (p != MAP_FAILED) {
+            *huge = 1;
+            return p;
+        }
+    }
+#endif
+    p = mmap(NULL, OBJECT_POOL_REGION, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (p == MAP_FAILED) return NULL;
+#if defined(MADV_HUGEPAGE)
+    /* Otherwise ask for transparent huge pages */
+    if (flags & OBJECT_POOL_HUGEPAGES) madvise(p, OBJECT_POOL_REGION, MADV_HUGEPAGE);
+#endif
+    return p;
+#endif
+}
+
+static void unmap_region(void *region)
+{
+#if defined(_WIN32) || defined(_WIN64)
+    VirtualFree(region, 0, MEM_RELEASE);
+#else
+    munmap(region, OBJECT_POOL_REGION);
+#endif
+}
+
+/* Carves up to OBJECT_POOL_MAGAZINE new objects into `mag`; caller holds no lock but its CPU's */
+static void refill(object_pool_t *pool, object_magazine_t *mag)
+{
+    spin_lock(&pool->grow_lock);
+    while (mag->rounds < OBJECT_POOL_MAGAZINE) {
+        if ((size_t)(pool->carve_end - pool->carve) < pool->object_size) {
+            if (pool->num_regions == pool->regions_cap) {
+                uint32_t cap = pool->regions_cap ? pool->regions_cap * 2 : 16;
+                void **grown = (void **)realloc(pool->regions, cap * sizeof(void *));
+                if (!grown) break;
+                pool->regions = grown;
+                pool->regions_cap = cap;
+            }
+            int huge;
+            void *region = map_region(pool->flags, &huge);
+            if (!region) break;
+            pool->regions[pool->num_regions++] = region;
+            pool->hugepage_regions += (uint64_t)huge;
+            pool->carve = (char *)region;
+            pool->carve_end = (char *)region + OBJECT_POOL_REGION;
+        }
+        mag->objects[mag->rounds++] = pool->carve;
+        pool->carve += pool->object_size;
+        pool->objects_carved++;
+    }
+    spin_unlock(&pool->grow_lock);
+}
+
+/* =============================
+ * Magazines and the depot
+ * ============================= */
+
+static inline object_magazine_t *magazine_at(object_pool_t *pool, uint32_t index)
+{
+    object_magazine_t *chunk = __atomic_load_n(&pool->mag_chunks[index / OBJECT_POOL_MAG_CHUNK], __ATOMIC_ACQUIRE);
+    return &chunk[index % OBJECT_POOL_MAG_CHUNK];
+}
+
+static object_magazine_t *new_magazine(object_pool_t *pool)
+{
+    object_magazine_t *mag = NULL;
+
+    spin_lock(&pool->grow_lock);
+    const uint32_t index = pool->num_magazines;
+    const uint32_t c = index / OBJECT_POOL_MAG_CHUNK;
+    if (c < OBJECT_POOL_MAG_CHUNKS) {
+        if (!pool->mag_chunks[c]) {
+            object_magazine_t *chunk =
+                (object_magazine_t *)calloc(OBJECT_POOL_MAG_CHUNK, sizeof(object_magazine_t));
+            /* Published before any index in it can reach the depot */
+            if (chunk) __atomic_store_n(&pool->mag_chunks[c], chunk, __ATOMIC_RELEASE);
+        }
+        if (pool->mag_chunks[c]) {
+            mag = &pool->mag_chunks[c][index % OBJECT_POOL_MAG_CHUNK];
+            mag->index = index;
+            pool->num_magazines++;
+        }
+    }
+    spin_unlock(&pool->grow_lock);
+    return mag;
+}
+
+/*
+ * Treiber stacks of magazine indices. The head carries a tag that every
+ * push and pop increments, so a head that was popped and pushed back in
+ * between (ABA) fails the compare-and-swap.
+ */
+static void depot_push(uint64_t *stack, object_magazine_t *mag)
+{
+    uint64_t head = __atomic_load_n(stack, __ATOMIC_RELAXED);
+    uint64_t next;
+    do {
+        __atomic_store_n(&mag->next, (uint32_t)head, __ATOMIC_RELAXED);
+        next = ((head >> 32) + 1) << 32 | (uint64_t)(mag->index + 1);
+    } while (!__atomic_compare_exchange_n(stack, &head, next, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static object_magazine_t *depot_pop(object_pool_t *pool, uint64_t *stack)
+{
+    uint64_t head = __atomic_load_n(stack, __ATOMIC_ACQUIRE);
+    while ((uint32_t)head != 0) {
+        object_magazine_t *mag = magazine_at(pool, (uint32_t)head - 1);
+        /* May be stale if another thread pops first; the tag makes the swap fail then */
+        uint32_t link = __atomic_load_n(&mag->next, __ATOMIC_RELAXED);
+        uint64_t next = ((head >> 32) + 1) << 32 | link;
+        if (__atomic_compare_exchange_n(stack, &head, next, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) return mag;
+    }
+    return NULL;
+}
+
+/* =============================
+ * Pool
+ * ============================= */
+
+int object_pool_init(object_pool_t *pool, size_t object_size, int flags)
+{
+    memset(pool, 0, sizeof(*pool));
+    pool->object_size = (object_size + OBJECT_POOL_ALIGN - 1) & ~(size_t)(OBJECT_POOL_ALIGN - 1);
+    if (pool->object_size == 0) pool->object_size = OBJECT_POOL_ALIGN;
+    if (pool->object_size > OBJECT_POOL_REGION) {
+        fprintf(stderr, "object_pool_init: objects of %zu bytes do not fit a region\n", object_size);
+        return -1;
+    }
+    pool->flags = flags;
+    pool->num_cpus = platform_cpu_count();
+    if (pool->num_cpus > OBJECT_POOL_MAX_CPUS) pool->num_cpus = OBJECT_POOL_MAX_CPUS;
+
+    /* One cache line per CPU, so neighbouring caches never share a line */
+    pool->cpus = (object_cpu_cache_t *)aligned_alloc(64, sizeof(object_cpu_cache_t) * (size_t)pool->num_cpus);
+    if (!pool->cpus) return -1;
+    memset(pool->cpus, 0, sizeof(object_cpu_cache_t) * (size_t)pool->num_cpus);
+    for (int i = 0; i < pool->num_cpus; i++) {
+        pool->cpus[i].loaded = new_magazine(pool);
+        pool->cpus[i].previous = new_magazine(pool);
+        if (!pool->cpus[i].loaded || !pool->cpus[i].previous) {
+            object_pool_destroy(pool);
+            return -1;
+        }
+    }
+    return 0;
+}
+
+void object_pool_destroy(object_pool_t *pool)
+{
+    for (uint32_t i = 0; i < pool->num_regions; i++) unmap_region(pool->regions[i]);
+    for (uint32_t c = 0; c < OBJECT_POOL_MAG_CHUNKS; c++) free(pool->mag_chunks[c]);
+    free(pool->regions);
+    free(pool->cpus);
+    memset(pool, 0, sizeof(*pool));
+}
+
+static inline object_cpu_cache_t *cpu_cache(object_pool_t *pool)
+{
+    return &pool->cpus[(unsigned int)platform_current_cpu() % (unsigned int)pool->num_cpus];
+}
+
+void *object_pool_alloc(object_pool_t *pool)
+{
+    object_cpu_cache_t *cpu = cpu_cache(pool);
+    void *object = NULL;
+
+    spin_lock(&cpu->lock);
+    object_magazine_t *mag = cpu->loaded;
+    int hit = 1;
+    if (mag->rounds == 0) {
+        if (cpu->previous->rounds > 0) {
+            cpu->loaded = cpu->previous;
+            cpu->previous = mag;
+        } else {
+            /* Both empty: trade the previous one for a full one, or carve new objects */
+            object_magazine_t *full = depot_pop(pool, &pool->full);
+            hit = 0;
+            if (full) {
+                depot_push(&pool->empty, cpu->previous);
+                cpu->previous = mag;
+                cpu->loaded = full;
+                __atomic_fetch_add(&pool->depot_hits, 1, __ATOMIC_RELAXED);
+            } else {
+                refill(pool, mag);
+            }
+        }
+        mag = cpu->loaded;
+    }
+    if (mag->rounds > 0) {
+        object = mag->objects[--mag->rounds];
+        cpu->allocs++;
+        cpu->cache_hits += (uint64_t)hit;
+    }
+    spin_unlock(&cpu->lock);
+    return object;
+}
+
+void object_pool_free(object_pool_t *pool, void *object)
+{
+    object_cpu_cache_t *cpu = cpu_cache(pool);
+
+    spin_lock(&cpu->lock);
+    object_magazine_t *mag = cpu->loaded;
+    int hit = 1;
+    if (mag->rounds == OBJECT_POOL_MAGAZINE) {
+        if (cpu->previous->rounds == 0) {
+            cpu->loaded = cpu->previous;
+            cpu->previous = mag;
+        } else {
+            /* Both full: hand the previous one to the depot for an empty one */
+            object_magazine_t *empty = depot_pop(pool, &pool->empty);
+            if (!empty) empty = new_magazine(pool);
+            if (!empty) {
+                spin_unlock(&cpu->lock);
+                fprintf(stderr, "object_pool_free: out of memory, object leaked\n");
+                return;
+            }
+            hit = 0;
+            depot_push(&pool->full, cpu->previous);
+            cpu->previous = mag;
+            cpu->loaded = empty;
+        }
+        mag = cpu->loaded;
+    }
+    mag->objects[mag->rounds++] = object;
+    cpu->frees++;
+    cpu->cache_hits += (uint64_t)hit;
+    spin_unlock(&cpu->lock);
+}
+
+void object_pool_stats(object_pool_t *pool, object_pool_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < pool->num_cpus; i++) {
+        object_cpu_cache_t *cpu = &pool->cpus[i];
+        spin_lock(&cpu->lock);
+        stats->allocs += cpu->allocs;
+        stats->frees += cpu->frees;
+        stats->cache_hits += cpu->cache_hits;
+        spin_unlock(&cpu->lock);
+    }
+    const uint64_t ops = stats->allocs + stats->frees;
+    stats->hit_rate = ops ? (double)stats->cache_hits / (double)ops : 0.0;
+    stats->depot_hits = __atomic_load_n(&pool->depot_hits, __ATOMIC_RELAXED);
+    stats->in_use = stats->allocs >= stats->frees ? stats->allocs - stats->frees : 0;
+
+    spin_lock(&pool->grow_lock);
+    stats->objects_carved = pool->objects_carved;
+    stats->regions = pool->num_regions;
+    stats->magazines = pool->num_magazines;
+    stats->hugepage_regions = pool->hugepage_regions;
+    uint64_t chunks = (pool->num_magazines + OBJECT_POOL_MAG_CHUNK - 1) / OBJECT_POOL_MAG_CHUNK;
+    spin_unlock(&pool->grow_lock);
+    stats->footprint = (uint64_t)stats->regions * OBJECT_POOL_REGION +
+                       chunks * OBJECT_POOL_MAG_CHUNK * sizeof(object_magazine_t);
+}
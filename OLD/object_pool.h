@@ -0,0 +1,124 @@
+#ifndef OBJECT_POOL_H
+#define OBJECT_POOL_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Fixed-size object pool with per-CPU magazines (Bonwick and Adams'
+ * magazine layer).
+ *
+ * Each CPU has a cache of two magazines, small stacks of free objects,
+ * guarded by a lock that only threads running on that CPU take, so it
+ * is almost never contended. Allocation pops from the loaded magazine,
+ * and free pushes onto it. When the loaded magazine runs out (or fills
+ * up), it is swapped with the previous one, and only when both are
+ * exhausted does the CPU exchange a whole magazine with the depot, a
+ * lock-free stack of full and one of empty magazines. Alternating
+ * allocations and frees therefore never leave the CPU, and a run of
+ * either costs one depot operation per OBJECT_POOL_MAGAZINE objects.
+ *
+ * Objects come from regions of OBJECT_POOL_REGION bytes that are mapped
+ * as needed and only unmapped by object_pool_destroy(); with
+ * OBJECT_POOL_HUGEPAGES the regions are backed by huge pages when the
+ * system has them. An object may be freed on any thread.
+ */
+
+#define OBJECT_POOL_MAGAZINE 32
+#define OBJECT_POOL_REGION (2u << 20)
+#define OBJECT_POOL_MAX_CPUS 256
+#define OBJECT_POOL_ALIGN 16
+
+/* Flags for object_pool_init() */
+#define OBJECT_POOL_HUGEPAGES 1
+
+typedef struct object_magazine_t {
+    uint32_t rounds;                /* objects held */
+    uint32_t index;                 /* in the pool's magazine table */
+    uint32_t next;                  /* depot link: index + 1, 0 ends the stack */
+    void *objects[OBJECT_POOL_MAGAZINE];
+} object_magazine_t;
+
+typedef struct object_cpu_cache_t {
+    unsigned char lock;
+    object_magazine_t *loaded;
+    object_magazine_t *previous;
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t cache_hits;            /* served without touching the depot */
+} __attribute__((aligned(64))) object_cpu_cache_t;
+
+/* Magazines are addressed by index so the depot can tag its stack heads */
+#define OBJECT_POOL_MAG_CHUNK 1024
+#define OBJECT_POOL_MAG_CHUNKS 1024
+
+typedef struct object_pool_t {
+    size_t object_size;
+    int flags;
+    int num_cpus;
+    object_cpu_cache_t *cpus;
+
+    uint64_t full;                  /* depot stacks: tag << 32 | (index + 1) */
+    uint64_t empty;
+
+    unsigned char grow_lock;        /* regions and new magazines */
+    object_magazine_t *mag_chunks[OBJECT_POOL_MAG_CHUNKS];
+    uint32_t num_magazines;
+    void **regions;
+    uint32_t num_regions;
+    uint32_t regions_cap;
+    char *carve;                    /* next unused object in the newest region */
+    char *carve_end;
+    uint64_t objects_carved;
+    uint64_t depot_hits;            /* full magazines handed out by the depot */
+    uint64_t hugepage_regions;
+} object_pool_t;
+
+/**
+ * Prepare a pool of `object_size` objects. Returns 0, or -1 if memory ran
+ * out.
+ */
+int object_pool_init(object_pool_t *pool, size_t object_size, int flags);
+
+/**
+ * Unmap every region. Objects still in use become invalid.
+ */
+void object_pool_destroy(object_pool_t *pool);
+
+/**
+ * One object, aligned to OBJECT_POOL_ALIGN and not zeroed, or NULL if
+ * memory ran out.
+ */
+void *object_pool_alloc(object_pool_t *pool);
+
+void object_pool_free(object_pool_t *pool, void *object);
+
+typedef struct object_pool_stats_t {
+    uint64_t allocs;
+    uint64_t frees;
+    uint64_t cache_hits;            /* operations served by the CPU's own magazines */
+    double hit_rate;                /* cache_hits / (allocs + frees) */
+    uint64_t depot_hits;
+    uint64_t in_use;
+    uint64_t objects_carved;        /* objects ever taken from the regions */
+    uint64_t footprint;             /* bytes of regions and magazines */
+    uint64_t hugepage_regions;
+    uint32_t regions;
+    uint32_t magazines;
+} object_pool_stats_t;
+
+/**
+ * Sum the per-CPU counters. Taken while the pool is busy the figures may
+ * be slightly inconsistent with each other.
+ */
+void object_pool_stats(object_pool_t *pool, object_pool_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // OBJECT_POOL_H
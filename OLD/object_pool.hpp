@@ -0,0 +1,76 @@
+#ifndef OBJECT_POOL_HPP
+#define OBJECT_POOL_HPP
+
+/**
+ * Typed object_pool_t (C++17):
+ *
+ *   mem::object_pool<connection_t> connections;
+ *   connection_t *c = connections.create(fd, peer);
+ *   ...
+ *   connections.destroy(c);
+ *
+ * create() constructs in place and destroy() runs the destructor before
+ * the memory goes back to the pool. An object may be destroyed on any
+ * thread. The pool must outlive every object taken from it.
+ */
+
+#include <cstddef>
+#include <new>
+#include <utility>
+
+#include "object_pool.h"
+
+namespace mem {
+
+template <typename T>
+class object_pool {
+public:
+    static_assert(alignof(T) <= OBJECT_POOL_ALIGN, "object_pool cannot align T");
+
+    explicit object_pool(int flags = 0)
+    {
+        if (object_pool_init(&pool_, sizeof(T), flags) != 0) throw std::bad_alloc();
+    }
+
+    ~object_pool() { object_pool_destroy(&pool_); }
+
+    object_pool(const object_pool &) = delete;
+    object_pool &operator=(const object_pool &) = delete;
+
+    /** A new T, or throws std::bad_alloc if memory ran out */
+    template <typename... Args>
+    T *create(Args &&...args)
+    {
+        void *p = object_pool_alloc(&pool_);
+        if (!p) throw std::bad_alloc();
+        try {
+            return new (p) T(std::forward<Args>(args)...);
+        } catch (...) {
+            object_pool_free(&pool_, p);
+            throw;
+        }
+    }
+
+    void destroy(T *object)
+    {
+        if (!object) return;
+        object->~T();
+        object_pool_free(&pool_, object);
+    }
+
+    object_pool_stats_t stats()
+    {
+        object_pool_stats_t s;
+        object_pool_stats(&pool_, &s);
+        return s;
+    }
+
+    object_pool_t *get() { return &pool_; }
+
+private:
+    object_pool_t pool_;
+};
+
+} // namespace mem
+
+#endif // OBJECT_POOL_HPP
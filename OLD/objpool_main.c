@@ -0,0 +1,155 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "object_pool.h"
+#include "platform.h"
+#include "xoshiro.h"
+
+/**
+ * Object pool benchmark:
+ *
+ *   objpool_main [threads] [operations_per_thread] [object_size] [hugepages]
+ *
+ * Each thread keeps up to LIVE_MAX objects alive, allocating or freeing
+ * one at random per operation, and hands every eighth object to its
+ * neighbour to free so objects also cross threads. The same run is made
+ * with malloc and with an object_pool_t; the pool's statistics follow.
+ */
+
+#define LIVE_MAX 512
+#define HANDOFF 64
+
+typedef struct bench_thread_t {
+    object_pool_t *pool;            /* NULL for malloc */
+    size_t object_size;
+    int operations;
+    uint64_t seed;
+
+    /* Objects passed in by the previous thread, freed by this one */
+    platform_mutex_t lock;
+    void *handoff[HANDOFF];
+    int handoff_count;
+    struct bench_thread_t *next;
+} bench_thread_t;
+
+static void *obj_alloc(bench_thread_t *t)
+{
+    return t->pool ? object_pool_alloc(t->pool) : malloc(t->object_size);
+}
+
+static void obj_free(bench_thread_t *t, void *p)
+{
+    if (t->pool) {
+        object_pool_free(t->pool, p);
+    } else {
+        free(p);
+    }
+}
+
+static void drain_handoff(bench_thread_t *t)
+{
+    platform_mutex_lock(&t->lock);
+    for (int i = 0; i < t->handoff_count; i++) obj_free(t, t->handoff[i]);
+    t->handoff_count = 0;
+    platform_mutex_unlock(&t->lock);
+}
+
+static void *bench_thread(void *arg)
+{
+    bench_thread_t *t = (bench_thread_t *)arg;
+    void *live[LIVE_MAX];
+    int count = 0;
+    xoshiro_t rng;
+
+    xoshiro_seed(&rng, t->seed);
+    for (int op = 0; op < t->operations; op++) {
+        uint64_t r = xoshiro_next(&rng);
+        if (count < LIVE_MAX && (count == 0 || (r & 1))) {
+            void *p = obj_alloc(t);
+            if (!p) break;
+            memset(p, (int)(op & 0xFF), 16);
+            live[count++] = p;
+        } else {
+            void *p = live[--count];
+            if ((r & 14) == 0) {
+                /* Cross-thread free; falls back to a local one when the neighbour is behind */
+                bench_thread_t *n = t->next;
+                platform_mutex_lock(&n->lock);
+                if (n->handoff_count < HANDOFF) {
+                    n->handoff[n->handoff_count++] = p;
+                    p = NULL;
+                }
+                platform_mutex_unlock(&n->lock);
+            }
+            if (p) obj_free(t, p);
+        }
+        if ((op & 255) == 0) drain_handoff(t);
+    }
+    while (count > 0) obj_free(t, live[--count]);
+    return NULL;
+}
+
+static double run(object_pool_t *pool, int threads, int operations, size_t object_size)
+{
+    bench_thread_t *state = (bench_thread_t *)calloc((size_t)threads, sizeof(bench_thread_t));
+    platform_thread_t *handles = (platform_thread_t *)malloc(sizeof(platform_thread_t) * (size_t)threads);
+    if (!state || !handles) {
+        free(state);
+        free(handles);
+        return 0.0;
+    }
+
+    for (int i = 0; i < threads; i++) {
+        state[i].pool = pool;
+        state[i].object_size = object_size;
+        state[i].operations = operations;
+        state[i].seed = 42 + (uint64_t)i;
+        state[i].next = &state[(i + 1) % threads];
+        platform_mutex_init(&state[i].lock);
+    }
+
+    unsigned long long start = platform_time_ns();
+    for (int i = 0; i < threads; i++) platform_thread_create(&handles[i], bench_thread, &state[i]);
+    for (int i = 0; i < threads; i++) platform_thread_join(handles[i]);
+    unsigned long long elapsed = platform_time_ns() - start;
+
+    /* Whatever was handed off after its owner finished */
+    for (int i = 0; i < threads; i++) {
+        drain_handoff(&state[i]);
+        platform_mutex_destroy(&state[i].lock);
+    }
+    free(state);
+    free(handles);
+    return (double)elapsed / ((double)threads * (double)operations);
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    int operations = argc > 2 ? atoi(argv[2]) : 2000000;
+    int object_size = argc > 3 ? atoi(argv[3]) : 64;
+    int flags = argc > 4 && atoi(argv[4]) ? OBJECT_POOL_HUGEPAGES : 0;
+    if (threads <= 0) threads = platform_cpu_count();
+    if (operations <= 0 || object_size < 16) {
+        fprintf(stderr, "usage: %s [threads] [operations_per_thread] [object_size >= 16] [hugepages]\n", argv[0]);
+        return 1;
+    }
+
+    object_pool_t pool;
+    if (object_pool_init(&pool, (size_t)object_size, flags) != 0) return 1;
+    printf("[Main] %d threads, %d operations each, %d-byte objects\n", threads, operations, object_size);
+
+    printf("[Main] malloc %6.1f ns/op\n", run(NULL, threads, operations, (size_t)object_size));
+    printf("[Main] pool   %6.1f ns/op\n", run(&pool, threads, operations, (size_t)object_size));
+
+    object_pool_stats_t s;
+    object_pool_stats(&pool, &s);
+    printf("[Main] pool: %llu allocs, %llu frees, %.2f%% served per CPU, %llu depot hits, %llu in use\n",
+           (unsigned long long)s.allocs, (unsigned long long)s.frees, s.hit_rate * 100.0,
+           (unsigned long long)s.depot_hits, (unsigned long long)s.in_use);
+    printf("[Main] pool: %llu objects carved, %u regions (%llu huge), %u magazines, %.1f KB footprint\n",
+           (unsigned long long)s.objects_carved, s.regions, (unsigned long long)s.hugepage_regions, s.magazines,
+           (double)s.footprint / 1024.0);
+    object_pool_destroy(&pool);
+    return s.in_use == 0 ? 0 : 1;
+}
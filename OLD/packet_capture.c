@@ -0,0 +1,398 @@
+#define _GNU_SOURCE  // CPU_SET, pthread_setaffinity_np
+
+#include "packet_capture.h"
+
+#if !defined(__linux__)
+#error "packet_capture requires Linux (AF_PACKET TPACKET_V3)"
+#endif
+
+#include <errno.h>
+#include <poll.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <arpa/inet.h>
+#include <net/if.h>
+#include <linux/if_ether.h>
+#include <linux/if_packet.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+
+/* =============================
+ * Internal types
+ * ============================= */
+
+/* Preallocated task argument, one per ring block */
+typedef struct capture_slot_t {
+    capture_block_t block;
+    capture_ring_t *ring;
+    struct tpacket_block_desc *desc;
+    volatile int in_flight;
+} capture_slot_t;
+
+struct capture_ring_t {
+    capture_t *cap;
+    int index;
+    int fd;
+    uint8_t *map;
+    size_t map_len;
+    uint32_t block_count;
+    uint32_t block_size;
+    capture_slot_t *slots;
+    uint32_t current;
+    uint64_t next_sequence;
+
+    platform_thread_t thread;
+    int thread_started;
+
+    platform_mutex_t lock;
+    platform_cond_t idle;
+    int outstanding;
+
+    capture_stats_t stats;
+};
+
+static void *poll_thread(void *arg);
+
+/* =============================
+ * Ethernet / VLAN decoding
+ * ============================= */
+
+static inline uint16_t load_be16(const uint8_t *p)
+{
+    return (uint16_t)((p[0] << 8) | p[1]);
+}
+
+static inline int is_vlan_tpid(uint16_t type)
+{
+    return type == ETH_TPID_8021Q || type == ETH_TPID_8021AD || type == ETH_TPID_QINQ;
+}
+
+int eth_decode(const uint8_t *frame, uint32_t cap_len, int has_offloaded_tag,
+               uint16_t offloaded_tpid, uint16_t offloaded_tci, eth_frame_view_t *out)
+{
+    /* Destination MAC + source MAC + EtherType/TPID */
+    if (cap_len < 14) return -1;
+
+    out->dst = frame;
+    out->src = frame + ETH_ADDR_LEN;
+    out->vlan_count = 0;
+    out->vlan_offloaded = 0;
+
+    if (has_offloaded_tag) {
+        out->vlan_tpid[0] = offloaded_tpid ? offloaded_tpid : ETH_TPID_8021Q;
+        out->vlan_tci[0] = offloaded_tci;
+        out->vlan_count = 1;
+        out->vlan_offloaded = 1;
+    }
+
+    uint32_t off = 12;
+    uint16_t type = load_be16(frame + off);
+    while (is_vlan_tpid(type)) {
+        /* TPID(2) + TCI(2) + next EtherType(2) */
+        if (cap_len < off + 6) return -1;
+        if (out->vlan_count < ETH_MAX_VLAN_TAGS) {
+            out->vlan_tpid[out->vlan_count] = type;
+            out->vlan_tci[out->vlan_count] = load_be16(frame + off + 2);
+            out->vlan_count++;
+        }
+        off += 4;
+        type = load_be16(frame + off);
+    }
+
+    out->ethertype = type;
+    out->payload = frame + off + 2;
+    out->payload_len = cap_len - (off + 2);
+    return 0;
+}
+
+void capture_block_foreach(const capture_block_t *block, capture_frame_func_t func, void *ctx)
+{
+    const struct tpacket_block_desc *desc = (const struct tpacket_block_desc *)block->desc;
+    const uint8_t *base = (const uint8_t *)desc;
+    const struct tpacket3_hdr *hdr =
+        (const struct tpacket3_hdr *)(base + desc->hdr.bh1.offset_to_first_pkt);
+
+    for (uint32_t i = 0; i < desc->hdr.bh1.num_pkts; i++) {
+        int tagged = (hdr->tp_status & TP_STATUS_VLAN_VALID) != 0;
+        uint16_t tpid = (hdr->tp_status & TP_STATUS_VLAN_TPID_VALID) ? hdr->hv1.tp_vlan_tpid : 0;
+
+        eth_frame_view_t view;
+        if (eth_decode((const uint8_t *)hdr + hdr->tp_mac, hdr->tp_snaplen, tagged,
+                       tpid, hdr->hv1.tp_vlan_tci, &view) == 0) {
+            view.wire_len = hdr->tp_len;
+            view.timestamp_ns = (uint64_t)hdr->tp_sec * 1000000000ULL + hdr->tp_nsec;
+            func(ctx, &view);
+        }
+        hdr = (const struct tpacket3_hdr *)((const uint8_t *)hdr + hdr->tp_next_offset);
+    }
+}
+
+/* =============================
+ * Configuration
+ * ============================= */
+
+void capture_config_default(capture_config_t *config, const char *ifname)
+{
+    memset(config, 0, sizeof(*config));
+    config->ifname = ifname;
+    config->num_sockets = 4;
+    config->fanout_mode = PACKET_FANOUT_HASH;
+    config->block_size = 1 << 20;
+    config->block_count = 64;
+    config->frame_size = 2048;
+    config->retire_ms = 60;
+    config->pin_threads = 1;
+}
+
+/* =============================
+ * Ring setup
+ * ============================= */
+
+static int ring_open(capture_t *cap, capture_ring_t *ring, int index, int fanout_id)
+{
+    const capture_config_t *cfg = &cap->config;
+
+    memset(ring, 0, sizeof(*ring));
+    ring->cap = cap;
+    ring->index = index;
+    ring->fd = -1;
+    ring->block_count = cfg->block_count;
+    ring->block_size = cfg->block_size;
+    platform_mutex_init(&ring->lock);
+    platform_cond_init(&ring->idle);
+
+    ring->fd = socket(AF_PACKET, SOCK_RAW | SOCK_CLOEXEC, htons(ETH_P_ALL));
+    if (ring->fd < 0) {
+        perror("capture: socket(AF_PACKET)");
+        return -1;
+    }
+
+    int version = TPACKET_V3;
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_VERSION, &version, sizeof(version)) != 0) {
+        perror("capture: PACKET_VERSION");
+        return -1;
+    }
+
+    struct tpacket_req3 req;
+    memset(&req, 0, sizeof(req));
+    req.tp_block_size = cfg->block_size;
+    req.tp_block_nr = cfg->block_count;
+    req.tp_frame_size = cfg->frame_size;
+    req.tp_frame_nr = (cfg->block_size / cfg->frame_size) * cfg->block_count;
+    req.tp_retire_blk_tov = cfg->retire_ms;
+    req.tp_feature_req_word = TP_FT_REQ_FILL_RXHASH;
+    if (setsockopt(ring->fd, SOL_PACKET, PACKET_RX_RING, &req, sizeof(req)) != 0) {
+        perror("capture: PACKET_RX_RING");
+        return -1;
+    }
+
+    ring->map_len = (size_t)cfg->block_size * cfg->block_count;
+    ring->map = (uint8_t *)mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE,
+                                MAP_SHARED | MAP_LOCKED | MAP_POPULATE, ring->fd, 0);
+    if (ring->map == MAP_FAILED) {
+        /* MAP_LOCKED needs RLIMIT_MEMLOCK headroom; retry without it */
+        ring->map = (uint8_t *)mmap(NULL, ring->map_len, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED | MAP_POPULATE, ring->fd, 0);
+    }
+    if (ring->map == MAP_FAILED) {
+        ring->map = NULL;
+        perror("capture: mmap");
+        return -1;
+    }
+
+    ring->slots = (capture_slot_t *)calloc(cfg->block_count, sizeof(capture_slot_t));
+    if (!ring->slots) return -1;
+    for (uint32_t i = 0; i < cfg->block_count; i++) {
+        ring->slots[i].ring = ring;
+        ring->slots[i].desc = (struct tpacket_block_desc *)(ring->map + (size_t)i * cfg->block_size);
+        ring->slots[i].block.desc = ring->slots[i].desc;
+        ring->slots[i].block.socket_index = (uint32_t)index;
+    }
+
+    struct sockaddr_ll addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sll_family = AF_PACKET;
+    addr.sll_protocol = htons(ETH_P_ALL);
+    addr.sll_ifindex = (int)if_nametoindex(cfg->ifname);
+    if (addr.sll_ifindex == 0) {
+        fprintf(stderr, "capture: unknown interface %s\n", cfg->ifname);
+        return -1;
+    }
+    if (bind(ring->fd, (struct sockaddr *)&addr, sizeof(addr)) != 0) {
+        perror("capture: bind");
+        return -1;
+    }
+
+    if (cfg->num_sockets > 1) {
+        int fanout = (fanout_id & 0xFFFF) | (cfg->fanout_mode << 16);
+        if (setsockopt(ring->fd, SOL_PACKET, PACKET_FANOUT, &fanout, sizeof(fanout)) != 0) {
+            perror("capture: PACKET_FANOUT");
+            return -1;
+        }
+    }
+    return 0;
+}
+
+static void ring_close(capture_ring_t *ring)
+{
+    if (ring->map) munmap(ring->map, ring->map_len);
+    if (ring->fd >= 0) close(ring->fd);
+    free(ring->slots);
+    platform_mutex_destroy(&ring->lock);
+    platform_cond_destroy(&ring->idle);
+    ring->map = NULL;
+    ring->fd = -1;
+    ring->slots = NULL;
+}
+
+/* =============================
+ * Block processing
+ * ============================= */
+
+static void block_task(void *arg)
+{
+    capture_slot_t *slot = (capture_slot_t *)arg;
+    capture_ring_t *ring = slot->ring;
+    capture_t *cap = ring->cap;
+
+    cap->handler(cap->handler_ctx, &slot->block);
+
+    /* Hand the block back to the kernel only after the handler is done with it */
+    __atomic_store_n(&slot->desc->hdr.bh1.block_status, TP_STATUS_KERNEL, __ATOMIC_RELEASE);
+    slot->in_flight = 0;
+
+    platform_mutex_lock(&ring->lock);
+    if (--ring->outstanding == 0) platform_cond_broadcast(&ring->idle);
+    platform_mutex_unlock(&ring->lock);
+}
+
+static void *poll_thread(void *arg)
+{
+    capture_ring_t *ring = (capture_ring_t *)arg;
+    capture_t *cap = ring->cap;
+
+    if (cap->config.pin_threads) {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(ring->index % platform_cpu_count(), &set);
+        pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+    }
+
+    struct pollfd pfd;
+    pfd.fd = ring->fd;
+    pfd.events = POLLIN | POLLERR;
+
+    while (cap->keep_running) {
+        capture_slot_t *slot = &ring->slots[ring->current];
+        uint32_t status = __atomic_load_n(&slot->desc->hdr.bh1.block_status, __ATOMIC_ACQUIRE);
+
+        /* Either the kernel still owns the block, or the pool still has it */
+        if (!(status & TP_STATUS_USER) || slot->in_flight) {
+            pfd.revents = 0;
+            poll(&pfd, 1, 100);
+            continue;
+        }
+
+        slot->in_flight = 1;
+        slot->block.num_packets = slot->desc->hdr.bh1.num_pkts;
+        slot->block.sequence = ring->next_sequence++;
+        ring->stats.blocks++;
+        ring->stats.packets += slot->block.num_packets;
+
+        platform_mutex_lock(&ring->lock);
+        ring->outstanding++;
+        platform_mutex_unlock(&ring->lock);
+
+        if (thread_pool_add_task(cap->pool, block_task, slot) != 0) block_task(slot);
+        ring->current = (ring->current + 1) % ring->block_count;
+    }
+
+    /* Blocks still on the pool reference the ring; wait before it is unmapped */
+    platform_mutex_lock(&ring->lock);
+    while (ring->outstanding > 0) platform_cond_wait(&ring->idle, &ring->lock);
+    platform_mutex_unlock(&ring->lock);
+    return NULL;
+}
+
+/* =============================
+ * Public API
+ * ============================= */
+
+int capture_start(capture_t *cap, const capture_config_t *config, thread_pool_t *pool,
+                  capture_block_handler_t handler, void *ctx)
+{
+    if (!cap || !config || !config->ifname || !pool || !handler) return -1;
+
+    memset(cap, 0, sizeof(*cap));
+    cap->config = *config;
+    if (cap->config.num_sockets <= 0) cap->config.num_sockets = 1;
+    cap->pool = pool;
+    cap->handler = handler;
+    cap->handler_ctx = ctx;
+
+    cap->rings = (capture_ring_t *)calloc(cap->config.num_sockets, sizeof(capture_ring_t));
+    if (!cap->rings) return -1;
+
+    int fanout_id = (int)(getpid() & 0xFFFF);
+    for (int i = 0; i < cap->config.num_sockets; i++) {
+        if (ring_open(cap, &cap->rings[i], i, fanout_id) != 0) {
+            ring_close(&cap->rings[i]);
+            for (int j = 0; j < i; j++) ring_close(&cap->rings[j]);
+            free(cap->rings);
+            cap->rings = NULL;
+            return -1;
+        }
+        cap->num_rings++;
+    }
+
+    cap->keep_running = 1;
+    for (int i = 0; i < cap->num_rings; i++) {
+        capture_ring_t *ring = &cap->rings[i];
+        if (platform_thread_create(&ring->thread, poll_thread, ring) != 0) {
+            fprintf(stderr, "capture_start: error creating poll thread %d\n", i);
+            capture_stop(cap);
+            return -1;
+        }
+        ring->thread_started = 1;
+    }
+    return 0;
+}
+
+void capture_stop(capture_t *cap)
+{
+    if (!cap || !cap->rings) return;
+
+    cap->keep_running = 0;
+    for (int i = 0; i < cap->num_rings; i++) {
+        capture_ring_t *ring = &cap->rings[i];
+        if (ring->thread_started) platform_thread_join(ring->thread);
+        ring_close(ring);
+    }
+    free(cap->rings);
+    cap->rings = NULL;
+    cap->num_rings = 0;
+}
+
+void capture_get_stats(capture_t *cap, capture_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < cap->num_rings; i++) {
+        capture_ring_t *ring = &cap->rings[i];
+
+        /* PACKET_STATISTICS resets on read, so accumulate into the ring */
+        struct tpacket_stats_v3 st;
+        socklen_t len = sizeof(st);
+        if (getsockopt(ring->fd, SOL_PACKET, PACKET_STATISTICS, &st, &len) == 0) {
+            ring->stats.kernel_drops += st.tp_drops;
+            ring->stats.freeze_count += st.tp_freeze_q_cnt;
+        }
+
+        stats->blocks += ring->stats.blocks;
+        stats->packets += ring->stats.packets;
+        stats->kernel_drops += ring->stats.kernel_drops;
+        stats->freeze_count += ring->stats.freeze_count;
+    }
+}
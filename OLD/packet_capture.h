@@ -0,0 +1,158 @@
+#ifndef PACKET_CAPTURE_H
+#define PACKET_CAPTURE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+#include "threadpool.h"
+
+/**
+ * Raw L2 capture through a memory-mapped AF_PACKET TPACKET_V3 block ring
+ * (Linux only, needs CAP_NET_RAW).
+ *
+ * The kernel writes frames straight into the mapped ring, one block of many
+ * frames at a time, so there is no per-packet system call or copy. Several
+ * sockets join one PACKET_FANOUT group to spread flows across cores; each
+ * has a poll thread that submits every retired block to the thread pool
+ * as one task and hands the block back to the kernel when the task ends.
+ *
+ * Frames are decoded in place into eth_frame_view_t following the layouts
+ * in ethernet.md: destination/source MAC, optional 802.1Q/802.1ad tags
+ * (TPID + TCI) and the EtherType.
+ */
+
+#define ETH_ADDR_LEN       6
+#define ETH_MAX_VLAN_TAGS  2
+
+#define ETH_TPID_8021Q     0x8100
+#define ETH_TPID_8021AD    0x88A8
+#define ETH_TPID_QINQ      0x9100
+
+/** Priority Code Point, Drop Eligible Indicator and VLAN ID from a TCI. */
+#define ETH_TCI_PCP(tci)   (((tci) >> 13) & 0x7)
+#define ETH_TCI_DEI(tci)   (((tci) >> 12) & 0x1)
+#define ETH_TCI_VID(tci)   ((tci) & 0x0FFF)
+
+/**
+ * A decoded frame. All pointers refer to the ring; nothing is copied.
+ * Tags are listed outermost first. `vlan_offloaded` is set when the NIC
+ * stripped the outer tag and the kernel reported it out of band.
+ */
+typedef struct eth_frame_view_t {
+    const uint8_t *dst;
+    const uint8_t *src;
+    int vlan_count;
+    int vlan_offloaded;
+    uint16_t vlan_tpid[ETH_MAX_VLAN_TAGS];
+    uint16_t vlan_tci[ETH_MAX_VLAN_TAGS];
+    uint16_t ethertype;
+    const uint8_t *payload;
+    uint32_t payload_len;
+    uint32_t wire_len;
+    uint64_t timestamp_ns;
+} eth_frame_view_t;
+
+/**
+ * Decode `cap_len` bytes of an Ethernet frame. `offloaded_tci`/`tpid` are
+ * used when `has_offloaded_tag` is nonzero. Returns 0 on success, -1 if
+ * the frame is too short for its headers.
+ */
+int eth_decode(const uint8_t *frame, uint32_t cap_len, int has_offloaded_tag,
+               uint16_t offloaded_tpid, uint16_t offloaded_tci, eth_frame_view_t *out);
+
+/**
+ * One retired ring block, valid until the pool task that received it returns.
+ */
+typedef struct capture_block_t {
+    const void *desc;
+    uint32_t num_packets;
+    uint32_t socket_index;
+    uint64_t sequence;
+} capture_block_t;
+
+/**
+ * Called once per frame by capture_block_foreach().
+ */
+typedef void (*capture_frame_func_t)(void *ctx, const eth_frame_view_t *frame);
+
+/**
+ * Called on a pool thread once per block.
+ */
+typedef void (*capture_block_handler_t)(void *ctx, const capture_block_t *block);
+
+/**
+ * Capture configuration.
+ *  - `num_sockets` ring sockets joined in one fanout group.
+ *  - `fanout_mode` is a PACKET_FANOUT_* value (default hash by flow).
+ *  - ring geometry: `block_size` (power of two pages) x `block_count`.
+ *  - `retire_ms` bounds how long a partly filled block is held back.
+ */
+typedef struct capture_config_t {
+    const char *ifname;
+    int num_sockets;
+    int fanout_mode;
+    uint32_t block_size;
+    uint32_t block_count;
+    uint32_t frame_size;
+    uint32_t retire_ms;
+    int pin_threads;
+} capture_config_t;
+
+typedef struct capture_stats_t {
+    uint64_t blocks;
+    uint64_t packets;
+    uint64_t kernel_drops;
+    uint64_t freeze_count;
+} capture_stats_t;
+
+typedef struct capture_ring_t capture_ring_t;
+
+typedef struct capture_t {
+    capture_config_t config;
+    capture_ring_t *rings;
+    int num_rings;
+    volatile int keep_running;
+
+    thread_pool_t *pool;
+    capture_block_handler_t handler;
+    void *handler_ctx;
+} capture_t;
+
+/**
+ * Defaults: 4 sockets, hash fanout, 64 x 1MB blocks per ring, 60ms retire.
+ */
+void capture_config_default(capture_config_t *config, const char *ifname);
+
+/**
+ * Create the rings, join the fanout group and start the poll threads.
+ * Returns 0 on success, nonzero on failure (nothing is left running).
+ */
+int capture_start(capture_t *cap, const capture_config_t *config, thread_pool_t *pool,
+                  capture_block_handler_t handler, void *ctx);
+
+/**
+ * Stop the poll threads, wait for outstanding blocks and unmap the rings.
+ * Call this before shutting the pool down.
+ */
+void capture_stop(capture_t *cap);
+
+/**
+ * Decode and visit every frame in a block.
+ */
+void capture_block_foreach(const capture_block_t *block, capture_frame_func_t func, void *ctx);
+
+/**
+ * Sum of per-ring counters, including PACKET_STATISTICS drops.
+ */
+void capture_get_stats(capture_t *cap, capture_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PACKET_CAPTURE_H
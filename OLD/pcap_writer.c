@@ -0,0 +1,414 @@
+#include "pcap_writer.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+/* =============================
+ * pcapng blocks
+ * ============================= */
+
+#define PCAPNG_SHB_TYPE     0x0A0D0D0AU
+#define PCAPNG_IDB_TYPE     0x00000001U
+#define PCAPNG_EPB_TYPE     0x00000006U
+#define PCAPNG_BYTE_ORDER   0x1A2B3C4DU
+
+#define PCAPNG_OPT_END      0
+#define PCAPNG_IF_TSRESOL   9
+
+#define EPB_OVERHEAD        32      /* block header, fields and trailing length */
+#define PAGE_ALIGN          4096
+
+static inline uint32_t pad4(uint32_t n)
+{
+    return (n + 3) & ~3U;
+}
+
+static inline uint8_t *put_u16(uint8_t *p, uint16_t v)
+{
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+static inline uint8_t *put_u32(uint8_t *p, uint32_t v)
+{
+    memcpy(p, &v, sizeof(v));
+    return p + sizeof(v);
+}
+
+/*
+ * Section Header Block followed by one Interface Description Block with
+ * nanosecond timestamps. Written in host byte order, which the byte-order
+ * magic tells readers. Returns the number of bytes written to `out`.
+ */
+static size_t build_file_header(uint8_t *out, uint32_t link_type, uint32_t snaplen)
+{
+    uint8_t *p = out;
+
+    p = put_u32(p, PCAPNG_SHB_TYPE);
+    p = put_u32(p, 28);
+    p = put_u32(p, PCAPNG_BYTE_ORDER);
+    p = put_u16(p, 1);                      /* major version */
+    p = put_u16(p, 0);                      /* minor version */
+    p = put_u32(p, 0xFFFFFFFFU);            /* section length unknown */
+    p = put_u32(p, 0xFFFFFFFFU);
+    p = put_u32(p, 28);
+
+    p = put_u32(p, PCAPNG_IDB_TYPE);
+    p = put_u32(p, 32);
+    p = put_u16(p, (uint16_t)link_type);
+    p = put_u16(p, 0);
+    p = put_u32(p, snaplen);
+    p = put_u16(p, PCAPNG_IF_TSRESOL);
+    p = put_u16(p, 1);
+    *p++ = 9;                               /* 10^-9: nanoseconds */
+    *p++ = 0; *p++ = 0; *p++ = 0;
+    p = put_u16(p, PCAPNG_OPT_END);
+    p = put_u16(p, 0);
+    p = put_u32(p, 32);
+
+    return (size_t)(p - out);
+}
+
+static uint64_t wall_clock_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/* =============================
+ * Segments (writer thread only)
+ * ============================= */
+
+static int write_all(int fd, const uint8_t *data, size_t len)
+{
+    while (len > 0) {
+        ssize_t n = write(fd, data, len);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        data += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int open_segment(pcap_writer_t *w)
+{
+    uint8_t header[64];
+
+    snprintf(w->segment_path, sizeof(w->segment_path), "%s_%05u.pcapng",
+             w->prefix, w->segment_index);
+    w->fd = open(w->segment_path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (w->fd < 0) {
+        fprintf(stderr, "pcap_writer: cannot create %s: %s\n", w->segment_path, strerror(errno));
+        return -1;
+    }
+
+    size_t len = build_file_header(header, w->config.link_type, w->config.snaplen);
+    if (write_all(w->fd, header, len) != 0) {
+        fprintf(stderr, "pcap_writer: write to %s failed: %s\n", w->segment_path, strerror(errno));
+        close(w->fd);
+        w->fd = -1;
+        return -1;
+    }
+    w->segment_bytes = len;
+    w->segment_start_ns = platform_time_ns();
+    return 0;
+}
+
+static void close_segment(pcap_writer_t *w)
+{
+    if (w->fd < 0) return;
+    close(w->fd);
+    w->fd = -1;
+    w->segment_index++;
+
+    platform_mutex_lock(&w->lock);
+    w->stats.segments++;
+    platform_mutex_unlock(&w->lock);
+
+    if (w->config.on_segment) w->config.on_segment(w->config.segment_ctx, w->segment_path);
+}
+
+static int segment_has_packets(const pcap_writer_t *w)
+{
+    /* Anything past the SHB and IDB */
+    return w->fd >= 0 && w->segment_bytes > 60;
+}
+
+/* Returns -1 if the next segment could not be opened */
+static int maybe_rotate(pcap_writer_t *w)
+{
+    const pcap_writer_config_t *c = &w->config;
+    int rotate = 0;
+
+    if (!segment_has_packets(w)) return 0;
+    if (c->rotate_bytes && w->segment_bytes >= c->rotate_bytes) rotate = 1;
+    if (c->rotate_seconds &&
+        platform_time_ns() - w->segment_start_ns >= (unsigned long long)c->rotate_seconds * 1000000000ULL) {
+        rotate = 1;
+    }
+    if (!rotate) return 0;
+    close_segment(w);
+    return open_segment(w);
+}
+
+/* Capture stops for good: later writes are dropped and report failure */
+static void set_failed(pcap_writer_t *w)
+{
+    platform_mutex_lock(&w->lock);
+    if (!w->failed) {
+        fprintf(stderr, "pcap_writer: capture to %s stopped\n", w->prefix);
+        w->failed = 1;
+    }
+    platform_mutex_unlock(&w->lock);
+}
+
+/* =============================
+ * Buffer hand-off
+ * ============================= */
+
+/* Called with the lock held */
+static void queue_active(pcap_writer_t *w)
+{
+    if (w->active < 0) return;
+    if (w->buffers[w->active].used == 0) return;
+
+    int tail = (w->full_head + w->full_count) % w->config.num_buffers;
+    w->full_queue[tail] = w->active;
+    w->full_count++;
+    w->active = -1;
+    platform_cond_signal(&w->cond);
+}
+
+static void *writer_thread(void *arg)
+{
+    pcap_writer_t *w = (pcap_writer_t *)arg;
+
+    platform_mutex_lock(&w->lock);
+    for (;;) {
+        if (w->full_count == 0 && w->running) {
+            /* Time out to push out partial buffers and rotate by age */
+            if (platform_cond_timedwait(&w->cond, &w->lock, w->config.flush_ms) != 0) {
+                queue_active(w);
+            }
+        }
+        if (w->full_count == 0) {
+            if (!w->running) break;
+            platform_mutex_unlock(&w->lock);
+            if (maybe_rotate(w) != 0) set_failed(w);
+            platform_mutex_lock(&w->lock);
+            continue;
+        }
+
+        int idx = w->full_queue[w->full_head];
+        w->full_head = (w->full_head + 1) % w->config.num_buffers;
+        w->full_count--;
+        platform_mutex_unlock(&w->lock);
+
+        pcap_buffer_t *b = &w->buffers[idx];
+        int ok = 1;
+        if (w->fd >= 0) {
+            if (write_all(w->fd, b->data, b->used) != 0) {
+                fprintf(stderr, "pcap_writer: write to %s failed: %s\n",
+                        w->segment_path, strerror(errno));
+                ok = 0;
+                /* The segment may end in half a block: leave it, unreported */
+                close(w->fd);
+                w->fd = -1;
+                set_failed(w);
+            } else {
+                w->segment_bytes += b->used;
+            }
+        }
+        if (maybe_rotate(w) != 0) set_failed(w);
+
+        platform_mutex_lock(&w->lock);
+        if (ok && w->fd >= 0) w->stats.writes++;
+        b->used = 0;
+        w->free_list[w->free_count++] = idx;
+    }
+    platform_mutex_unlock(&w->lock);
+    return NULL;
+}
+
+/* =============================
+ * Public API
+ * ============================= */
+
+void pcap_writer_config_default(pcap_writer_config_t *config, const char *prefix)
+{
+    memset(config, 0, sizeof(*config));
+    config->prefix = prefix;
+    config->link_type = PCAP_LINKTYPE_ETHERNET;
+    config->snaplen = 65535;
+    config->buffer_size = 4 * 1024 * 1024;
+    config->num_buffers = 8;
+    config->rotate_bytes = 256ULL * 1024 * 1024;
+    config->rotate_seconds = 0;
+    config->flush_ms = 500;
+}
+
+int pcap_writer_open(pcap_writer_t *writer, const pcap_writer_config_t *config)
+{
+    if (!writer || !config || !config->prefix) return -1;
+
+    memset(writer, 0, sizeof(*writer));
+    writer->config = *config;
+    writer->fd = -1;
+    writer->active = -1;
+    snprintf(writer->prefix, sizeof(writer->prefix), "%s", config->prefix);
+
+    pcap_writer_config_t *c = &writer->config;
+    if (c->num_buffers < 2) c->num_buffers = 2;
+    if (c->flush_ms == 0) c->flush_ms = 500;
+    c->buffer_size = (c->buffer_size + PAGE_ALIGN - 1) & ~(size_t)(PAGE_ALIGN - 1);
+    if (c->snaplen == 0 || c->snaplen + EPB_OVERHEAD + 4 > c->buffer_size) {
+        fprintf(stderr, "pcap_writer_open: snaplen %u does not fit a %zu byte buffer\n",
+                c->snaplen, c->buffer_size);
+        return -1;
+    }
+
+    writer->buffers = (pcap_buffer_t *)calloc((size_t)c->num_buffers, sizeof(pcap_buffer_t));
+    writer->free_list = (int *)calloc((size_t)c->num_buffers, sizeof(int));
+    writer->full_queue = (int *)calloc((size_t)c->num_buffers, sizeof(int));
+    if (!writer->buffers || !writer->free_list || !writer->full_queue) goto fail;
+
+    for (int i = 0; i < c->num_buffers; i++) {
+        void *mem = NULL;
+        /* Page-aligned so each write() hands the kernel whole pages */
+        if (posix_memalign(&mem, PAGE_ALIGN, c->buffer_size) != 0) goto fail;
+        writer->buffers[i].data = (uint8_t *)mem;
+        writer->free_list[writer->free_count++] = i;
+    }
+
+    if (open_segment(writer) != 0) goto fail;
+
+    platform_mutex_init(&writer->lock);
+    platform_cond_init(&writer->cond);
+    writer->running = 1;
+    if (platform_thread_create(&writer->thread, writer_thread, writer) != 0) {
+        fprintf(stderr, "pcap_writer_open: failed to start writer thread\n");
+        platform_cond_destroy(&writer->cond);
+        platform_mutex_destroy(&writer->lock);
+        close(writer->fd);
+        goto fail;
+    }
+    return 0;
+
+fail:
+    if (writer->buffers) {
+        for (int i = 0; i < c->num_buffers; i++) free(writer->buffers[i].data);
+    }
+    free(writer->buffers);
+    free(writer->free_list);
+    free(writer->full_queue);
+    writer->buffers = NULL;
+    return -1;
+}
+
+int pcap_writer_write(pcap_writer_t *writer, uint64_t timestamp_ns,
+                      const void *data, uint32_t cap_len, uint32_t orig_len)
+{
+    int truncated = 0;
+
+    if (cap_len > writer->config.snaplen) {
+        cap_len = writer->config.snaplen;
+        truncated = 1;
+    }
+    if (orig_len < cap_len) orig_len = cap_len;
+    if (timestamp_ns == 0) timestamp_ns = wall_clock_ns();
+
+    const uint32_t block_len = EPB_OVERHEAD + pad4(cap_len);
+
+    platform_mutex_lock(&writer->lock);
+    if (writer->failed) {
+        writer->stats.dropped++;
+        platform_mutex_unlock(&writer->lock);
+        return -1;
+    }
+    if (writer->active >= 0 &&
+        writer->buffers[writer->active].used + block_len > writer->config.buffer_size) {
+        queue_active(writer);
+    }
+    if (writer->active < 0) {
+        if (writer->free_count == 0) {
+            /* Disk is behind: drop rather than stall the caller */
+            writer->stats.dropped++;
+            platform_mutex_unlock(&writer->lock);
+            return -1;
+        }
+        writer->active = writer->free_list[--writer->free_count];
+    }
+
+    pcap_buffer_t *b = &writer->buffers[writer->active];
+    uint8_t *p = b->data + b->used;
+    p = put_u32(p, PCAPNG_EPB_TYPE);
+    p = put_u32(p, block_len);
+    p = put_u32(p, 0);                                  /* interface id */
+    p = put_u32(p, (uint32_t)(timestamp_ns >> 32));
+    p = put_u32(p, (uint32_t)timestamp_ns);
+    p = put_u32(p, cap_len);
+    p = put_u32(p, orig_len);
+    memcpy(p, data, cap_len);
+    memset(p + cap_len, 0, pad4(cap_len) - cap_len);
+    put_u32(p + pad4(cap_len), block_len);
+    b->used += block_len;
+
+    writer->stats.packets++;
+    writer->stats.bytes += cap_len;
+    if (truncated) writer->stats.truncated++;
+    platform_mutex_unlock(&writer->lock);
+    return 0;
+}
+
+void pcap_writer_flush(pcap_writer_t *writer)
+{
+    platform_mutex_lock(&writer->lock);
+    queue_active(writer);
+    platform_mutex_unlock(&writer->lock);
+}
+
+void pcap_writer_close(pcap_writer_t *writer)
+{
+    if (!writer || !writer->buffers) return;
+
+    platform_mutex_lock(&writer->lock);
+    queue_active(writer);
+    writer->running = 0;
+    platform_cond_broadcast(&writer->cond);
+    platform_mutex_unlock(&writer->lock);
+    platform_thread_join(writer->thread);
+
+    close_segment(writer);
+
+    for (int i = 0; i < writer->config.num_buffers; i++) free(writer->buffers[i].data);
+    free(writer->buffers);
+    free(writer->free_list);
+    free(writer->full_queue);
+    writer->buffers = NULL;
+    platform_cond_destroy(&writer->cond);
+    platform_mutex_destroy(&writer->lock);
+}
+
+void pcap_writer_get_stats(pcap_writer_t *writer, pcap_writer_stats_t *stats)
+{
+    platform_mutex_lock(&writer->lock);
+    *stats = writer->stats;
+    platform_mutex_unlock(&writer->lock);
+}
+
+int pcap_writer_failed(pcap_writer_t *writer)
+{
+    platform_mutex_lock(&writer->lock);
+    int failed = writer->failed;
+    platform_mutex_unlock(&writer->lock);
+    return failed;
+}
@@ -0,0 +1,153 @@
+#ifndef PCAP_WRITER_H
+#define PCAP_WRITER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+
+/**
+ * pcapng capture writer for the relay and packet_capture.
+ *
+ * Callers append Enhanced Packet Blocks to an in-memory buffer under a
+ * short lock and never touch the disk: full buffers are handed to a
+ * writer thread that issues one large write() per page-aligned buffer.
+ * When every buffer is queued the packet is dropped and counted instead
+ * of stalling the caller, so capture cannot add latency to the relay.
+ *
+ * Output is split into segments `<prefix>_00000.pcapng`, `_00001`, ...
+ * rotated by size and/or age. Each closed segment is passed to
+ * `on_segment`. A program that runs zip_logs.c's log_compression_thread
+ * passes log_compression_enqueue() there, which queues the path on
+ * log_compression_queue, so finished segments are compressed and removed
+ * off the capture path.
+ */
+
+/** Link types from the tcpdump.org LINKTYPE registry. */
+#define PCAP_LINKTYPE_ETHERNET  1
+/** Private use; relay frames have no L2 header. */
+#define PCAP_LINKTYPE_USER0     147
+
+/**
+ * Called on the writer thread after a segment has been closed.
+ */
+typedef void (*pcap_segment_func_t)(void *ctx, const char *path);
+
+/**
+ * Writer configuration.
+ *  - `prefix` of the segment file names.
+ *  - `link_type` and `snaplen` go into the Interface Description Block.
+ *  - `buffer_size` x `num_buffers` is the memory between callers and disk.
+ *  - `rotate_bytes` / `rotate_seconds` (0 disables either limit).
+ *  - `flush_ms` bounds how long a partly filled buffer is held back.
+ */
+typedef struct pcap_writer_config_t {
+    const char *prefix;
+    uint32_t link_type;
+    uint32_t snaplen;
+    size_t buffer_size;
+    int num_buffers;
+    uint64_t rotate_bytes;
+    uint32_t rotate_seconds;
+    uint32_t flush_ms;
+    pcap_segment_func_t on_segment;
+    void *segment_ctx;
+} pcap_writer_config_t;
+
+typedef struct pcap_writer_stats_t {
+    uint64_t packets;
+    uint64_t bytes;
+    uint64_t dropped;
+    uint64_t truncated;
+    uint64_t writes;
+    uint64_t segments;
+} pcap_writer_stats_t;
+
+typedef struct pcap_buffer_t {
+    uint8_t *data;
+    size_t used;
+} pcap_buffer_t;
+
+typedef struct pcap_writer_t {
+    pcap_writer_config_t config;
+    char prefix[200];
+
+    pcap_buffer_t *buffers;
+    int *free_list;             /* stack of idle buffer indices */
+    int free_count;
+    int *full_queue;            /* ring of indices waiting for the writer */
+    int full_head;
+    int full_count;
+    int active;                 /* buffer being filled, or -1 */
+
+    platform_mutex_t lock;
+    platform_cond_t cond;
+    platform_thread_t thread;
+    int running;
+    int failed;                 /* a segment could not be opened or written */
+
+    /* Owned by the writer thread */
+    int fd;
+    uint32_t segment_index;
+    uint64_t segment_bytes;
+    unsigned long long segment_start_ns;
+    char segment_path[256];
+
+    pcap_writer_stats_t stats;
+} pcap_writer_t;
+
+/**
+ * Defaults: Ethernet, 64KB snaplen, 8 x 4MB buffers, 256MB segments,
+ * no age limit, 500ms flush.
+ */
+void pcap_writer_config_default(pcap_writer_config_t *config, const char *prefix);
+
+/**
+ * Allocate the buffers, open the first segment and start the writer
+ * thread. Returns 0 on success, nonzero on failure.
+ */
+int pcap_writer_open(pcap_writer_t *writer, const pcap_writer_config_t *config);
+
+/**
+ * Append one packet captured at `timestamp_ns` (any epoch; wall clock
+ * if the file is to be read by Wireshark). At most `snaplen` bytes of
+ * `data` are kept, `orig_len` is the length on the wire. Never blocks on
+ * I/O. Returns 0 if the packet was queued, nonzero if it was dropped:
+ * no buffer was free, or the writer has failed (see pcap_writer_failed()).
+ */
+int pcap_writer_write(pcap_writer_t *writer, uint64_t timestamp_ns,
+                      const void *data, uint32_t cap_len, uint32_t orig_len);
+
+/**
+ * Hand the partly filled buffer to the writer thread now.
+ */
+void pcap_writer_flush(pcap_writer_t *writer);
+
+/**
+ * Write out everything queued, close the last segment (reporting it to
+ * `on_segment`) and free the writer.
+ */
+void pcap_writer_close(pcap_writer_t *writer);
+
+/**
+ * Snapshot of the counters.
+ */
+void pcap_writer_get_stats(pcap_writer_t *writer, pcap_writer_stats_t *stats);
+
+/**
+ * Nonzero once a write to the current segment failed, or a rotation
+ * could not open the next one. Capture has stopped then; every later
+ * pcap_writer_write() drops its packet. After pcap_writer_close() read
+ * `failed` directly.
+ */
+int pcap_writer_failed(pcap_writer_t *writer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // PCAP_WRITER_H
@@ -1,3 +1,4 @@
+#define _GNU_SOURCE  // sched_getcpu
 #include "platform.h"
 
 #include <stdio.h>    // For fprintf, etc.
@@ -46,6 +47,10 @@ void platform_sleep_ms(unsigned int ms) {
     Sleep(ms);
 }
 
+void platform_thread_yield(void) {
+    SwitchToThread();
+}
+
 /* ----- Condition Variables (Windows Vista / Server 2008+) ----- */
 
 void platform_cond_init(platform_cond_t *cond) {
@@ -63,6 +68,10 @@ void platform_cond_wait(platform_cond_t *cond, platform_mutex_t *mutex) {
     SleepConditionVariableCS(cond, mutex, INFINITE);
 }
 
+int platform_cond_timedwait(platform_cond_t *cond, platform_mutex_t *mutex, unsigned int ms) {
+    return SleepConditionVariableCS(cond, mutex, ms) ? 0 : 1;
+}
+
 void platform_cond_signal(platform_cond_t *cond) {
     WakeConditionVariable(cond);
 }
@@ -71,6 +80,32 @@ void platform_cond_broadcast(platform_cond_t *cond) {
     WakeAllConditionVariable(cond);
 }
 
+/* ----- System information ----- */
+
+int platform_cpu_count(void) {
+    SYSTEM_INFO info;
+    GetSystemInfo(&info);
+    return info.dwNumberOfProcessors > 0 ? (int)info.dwNumberOfProcessors : 1;
+}
+
+double platform_cpu_load(void) {
+    // Windows keeps no load average
+    return -1.0;
+}
+
+int platform_current_cpu(void) {
+    return (int)GetCurrentProcessorNumber();
+}
+
+unsigned long long platform_time_ns(void) {
+    LARGE_INTEGER freq, now;
+    QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&now);
+    // Split the multiply so the counter does not overflow 64 bits
+    return (unsigned long long)(now.QuadPart / freq.QuadPart) * 1000000000ULL
+         + (unsigned long long)(now.QuadPart % freq.QuadPart) * 1000000000ULL / freq.QuadPart;
+}
+
 #else
 
 /* =========================
@@ -78,7 +113,9 @@ void platform_cond_broadcast(platform_cond_t *cond) {
  * ========================= */
 
 #include <pthread.h>
-#include <unistd.h>   // For usleep
+#include <sched.h>    // For sched_yield, sched_getcpu
+#include <unistd.h>   // For usleep, sysconf
+#include <time.h>     // For clock_gettime
 
 void platform_mutex_init(platform_mutex_t *mutex) {
     pthread_mutex_init(mutex, NULL);
@@ -109,6 +146,10 @@ void platform_sleep_ms(unsigned int ms) {
     usleep(ms * 1000);
 }
 
+void platform_thread_yield(void) {
+    sched_yield();
+}
+
 /* ----- Condition Variables (POSIX) ----- */
 
 void platform_cond_init(platform_cond_t *cond) {
@@ -123,6 +164,19 @@ void platform_cond_wait(platform_cond_t *cond, platform_mutex_t *mutex) {
     pthread_cond_wait(cond, mutex);
 }
 
+int platform_cond_timedwait(platform_cond_t *cond, platform_mutex_t *mutex, unsigned int ms) {
+    // pthread_cond_timedwait takes an absolute CLOCK_REALTIME deadline
+    struct timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    ts.tv_sec += ms / 1000;
+    ts.tv_nsec += (long)(ms % 1000) * 1000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return pthread_cond_timedwait(cond, mutex, &ts) == 0 ? 0 : 1;
+}
+
 void platform_cond_signal(platform_cond_t *cond) {
     pthread_cond_signal(cond);
 }
@@ -131,4 +185,36 @@ void platform_cond_broadcast(platform_cond_t *cond) {
     pthread_cond_broadcast(cond);
 }
 
+/* ----- System information ----- */
+
+int platform_cpu_count(void) {
+    long n = sysconf(_SC_NPROCESSORS_ONLN);
+    return n > 0 ? (int)n : 1;
+}
+
+double platform_cpu_load(void) {
+    // Linux; elsewhere the file is missing and the load is unknown
+    FILE *f = fopen("/proc/loadavg", "r");
+    double load;
+    if (!f) return -1.0;
+    int ok = fscanf(f, "%lf", &load) == 1;
+    fclose(f);
+    return ok ? load / platform_cpu_count() : -1.0;
+}
+
+int platform_current_cpu(void) {
+#if defined(__linux__)
+    int cpu = sched_getcpu();
+    return cpu >= 0 ? cpu : 0;
+#else
+    return 0;
+#endif
+}
+
+unsigned long long platform_time_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (unsigned long long)ts.tv_sec * 1000000000ULL + (unsigned long long)ts.tv_nsec;
+}
+
 #endif
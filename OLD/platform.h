@@ -70,6 +70,11 @@ int platform_thread_join(platform_thread_t thread);
  */
 void platform_sleep_ms(unsigned int ms);
 
+/**
+ * Give up the rest of the time slice to another ready thread.
+ */
+void platform_thread_yield(void);
+
 /**
  * Initialise a platform condition variable.
  */
@@ -86,6 +91,12 @@ void platform_cond_destroy(platform_cond_t *cond);
  */
 void platform_cond_wait(platform_cond_t *cond, platform_mutex_t *mutex);
 
+/**
+ * Like platform_cond_wait() but gives up after `ms` milliseconds.
+ * Returns 0 if woken, nonzero on timeout. Spurious wakeups are possible.
+ */
+int platform_cond_timedwait(platform_cond_t *cond, platform_mutex_t *mutex, unsigned int ms);
+
 /**
  * Signal one thread waiting on the condition variable.
  */
@@ -96,6 +107,28 @@ void platform_cond_signal(platform_cond_t *cond);
  */
 void platform_cond_broadcast(platform_cond_t *cond);
 
+/**
+ * Number of online CPUs, or 1 if it cannot be determined.
+ */
+int platform_cpu_count(void);
+
+/**
+ * Runnable threads per CPU averaged over the last minute (1.0: every CPU
+ * busy), or -1.0 if the system does not say.
+ */
+double platform_cpu_load(void);
+
+/**
+ * CPU the calling thread is running on, or 0 if unknown. The thread may
+ * have moved by the time the caller looks at the answer.
+ */
+int platform_current_cpu(void);
+
+/**
+ * Monotonic clock in nanoseconds. Only differences are meaningful.
+ */
+unsigned long long platform_time_ns(void);
+
 #ifdef __cplusplus
 }
 #endif
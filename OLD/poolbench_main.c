@@ -0,0 +1,191 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "arena.h"
+#include "platform.h"
+#include "threadpool.h"
+#include "xoshiro.h"
+
+/**
+ * Thread pool allocation benchmark:
+ *
+ *   poolbench_main [threads] [batches] [tasks_per_batch]
+ *
+ * Runs the same batches twice. Each task gets an argument and an input
+ * buffer from the submitter and allocates a few temporaries of its own.
+ * The "malloc" run takes all of them from malloc and frees each one.
+ * The "arena" run takes the arguments from a batch arena that the
+ * submitter resets once the batch is done, and the temporaries from the
+ * worker's scratch arena, which the pool resets after each task. Both
+ * runs print wall time and the time spent allocating and freeing, per
+ * task.
+ */
+
+#define TEMPS_PER_TASK 4
+
+typedef struct bench_batch_t {
+    platform_mutex_t lock;
+    platform_cond_t idle;
+    size_t outstanding;
+    int use_arena;
+} bench_batch_t;
+
+typedef struct bench_job_t {
+    bench_batch_t *batch;
+    unsigned char *input;
+    size_t input_len;
+    size_t temp_len[TEMPS_PER_TASK];
+    unsigned long long alloc_ns;    /* set by the task */
+    uint64_t checksum;
+} bench_job_t;
+
+static void bench_task(void *arg)
+{
+    bench_job_t *job = (bench_job_t *)arg;
+    bench_batch_t *batch = job->batch;
+    arena_t *scratch = batch->use_arena ? thread_pool_scratch() : NULL;
+    unsigned char *temps[TEMPS_PER_TASK];
+    uint64_t sum = 0;
+
+    unsigned long long start = platform_time_ns();
+    for (int i = 0; i < TEMPS_PER_TASK; i++) {
+        temps[i] = (unsigned char *)(scratch ? arena_alloc(scratch, job->temp_len[i]) : malloc(job->temp_len[i]));
+    }
+    unsigned long long alloc_ns = platform_time_ns() - start;
+
+    /* A little work on the input so the temporaries are really used */
+    for (int i = 0; i < TEMPS_PER_TASK; i++) {
+        size_t n = job->temp_len[i] < job->input_len ? job->temp_len[i] : job->input_len;
+        memcpy(temps[i], job->input, n);
+        for (size_t k = 0; k < n; k++) sum += temps[i][k];
+    }
+
+    if (!scratch) {
+        start = platform_time_ns();
+        for (int i = 0; i < TEMPS_PER_TASK; i++) free(temps[i]);
+        alloc_ns += platform_time_ns() - start;
+    }
+    job->alloc_ns = alloc_ns;
+    job->checksum = sum;
+
+    platform_mutex_lock(&batch->lock);
+    if (--batch->outstanding == 0) platform_cond_broadcast(&batch->idle);
+    platform_mutex_unlock(&batch->lock);
+}
+
+/* One run over every batch; returns the checksum so both runs can be compared */
+static uint64_t run(thread_pool_t *pool, int use_arena, int batches, int tasks, uint64_t seed, int report)
+{
+    bench_batch_t batch;
+    arena_t args;
+    xoshiro_t rng;
+    bench_job_t **jobs = (bench_job_t **)malloc(sizeof(bench_job_t *) * (size_t)tasks);
+    unsigned long long submit_alloc_ns = 0, task_alloc_ns = 0;
+    uint64_t checksum = 0;
+
+    if (!jobs) return 0;
+    memset(&batch, 0, sizeof(batch));
+    batch.use_arena = use_arena;
+    platform_mutex_init(&batch.lock);
+    platform_cond_init(&batch.idle);
+    arena_init(&args);
+    xoshiro_seed(&rng, seed);
+
+    unsigned long long start = platform_time_ns();
+    for (int b = 0; b < batches; b++) {
+        batch.outstanding = (size_t)tasks;
+
+        unsigned long long t0 = platform_time_ns();
+        for (int t = 0; t < tasks; t++) {
+            uint64_t r = xoshiro_next(&rng);
+            size_t input_len = 64 + (size_t)(r & 447);
+            bench_job_t *job;
+            if (use_arena) {
+                job = (bench_job_t *)arena_alloc(&args, sizeof(bench_job_t));
+                job->input = (unsigned char *)arena_alloc(&args, input_len);
+            } else {
+                job = (bench_job_t *)malloc(sizeof(bench_job_t));
+                job->input = (unsigned char *)malloc(input_len);
+            }
+            job->batch = &batch;
+            job->input_len = input_len;
+            for (int i = 0; i < TEMPS_PER_TASK; i++) job->temp_len[i] = 32 + (size_t)((r >> (9 + 10 * i)) & 1023);
+            jobs[t] = job;
+        }
+        submit_alloc_ns += platform_time_ns() - t0;
+
+        for (int t = 0; t < tasks; t++) {
+            memset(jobs[t]->input, (int)(t & 0xFF), jobs[t]->input_len);
+            if (thread_pool_add_task(pool, bench_task, jobs[t]) != 0) bench_task(jobs[t]);
+        }
+
+        platform_mutex_lock(&batch.lock);
+        while (batch.outstanding > 0) platform_cond_wait(&batch.idle, &batch.lock);
+        platform_mutex_unlock(&batch.lock);
+
+        for (int t = 0; t < tasks; t++) {
+            task_alloc_ns += jobs[t]->alloc_ns;
+            checksum += jobs[t]->checksum;
+        }
+
+        /* The whole batch's arguments go at once */
+        t0 = platform_time_ns();
+        if (use_arena) {
+            arena_reset(&args);
+        } else {
+            for (int t = 0; t < tasks; t++) {
+                free(jobs[t]->input);
+                free(jobs[t]);
+            }
+        }
+        submit_alloc_ns += platform_time_ns() - t0;
+    }
+    unsigned long long elapsed = platform_time_ns() - start;
+
+    const double n = (double)batches * (double)tasks;
+    if (report) {
+        printf("[Main] %-6s %8.1f ns/task wall, %6.1f ns/task allocating (%5.1f submitter, %5.1f in task)\n",
+               use_arena ? "arena" : "malloc", (double)elapsed / n, (double)(submit_alloc_ns + task_alloc_ns) / n,
+               (double)submit_alloc_ns / n, (double)task_alloc_ns / n);
+    }
+
+    arena_destroy(&args);
+    platform_cond_destroy(&batch.idle);
+    platform_mutex_destroy(&batch.lock);
+    free(jobs);
+    return checksum;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    int batches = argc > 2 ? atoi(argv[2]) : 200;
+    int tasks = argc > 3 ? atoi(argv[3]) : 5000;
+    if (threads <= 0) threads = platform_cpu_count();
+    if (batches <= 0 || tasks <= 0) {
+        fprintf(stderr, "usage: %s [threads] [batches] [tasks_per_batch]\n", argv[0]);
+        return 1;
+    }
+
+    thread_pool_t pool;
+    thread_pool_init(&pool, threads);
+    printf("[Main] %d threads, %d batches of %d tasks\n", threads, batches, tasks);
+
+    /* Warm both allocators before measuring */
+    run(&pool, 0, 1, tasks, 1, 0);
+    run(&pool, 1, 1, tasks, 1, 0);
+    uint64_t a = run(&pool, 0, batches, tasks, 42, 1);
+    uint64_t b = run(&pool, 1, batches, tasks, 42, 1);
+
+    thread_pool_shutdown(&pool);
+    arena_cache_stats_t cache;
+    arena_cache_stats(&cache);
+    printf("[Main] arena chunk cache: %llu hits, %llu misses, %llu cached\n", (unsigned long long)cache.hits,
+           (unsigned long long)cache.misses, (unsigned long long)cache.cached);
+    arena_cache_trim();
+    if (a != b) {
+        fprintf(stderr, "Checksums differ: %llu vs %llu\n", (unsigned long long)a, (unsigned long long)b);
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,360 @@
+#include "reclaim.h"
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* Frees a list of retired nodes, returning how many there were */
+static uint64_t free_list(object_pool_t *nodes, reclaim_node_t *node)
+{
+    uint64_t count = 0;
+    while (node) {
+        reclaim_node_t *next = node->next;
+        node->free_fn(node->ptr, node->ctx);
+        object_pool_free(nodes, node);
+        node = next;
+        count++;
+    }
+    return count;
+}
+
+/* =============================
+ * Epoch-based reclamation
+ * ============================= */
+
+/*
+ * A node retired in epoch e may still be read by threads that entered in
+ * e (or e - 1, if they read the epoch just before it moved). The epoch
+ * only moves from g to g + 1 once every thread inside a region has
+ * announced g, so by the time it reaches e + 2 all of those have left,
+ * and the node is unreachable to everyone else.
+ */
+
+int ebr_init(ebr_t *ebr)
+{
+    memset(ebr, 0, sizeof(*ebr));
+    if (object_pool_init(&ebr->nodes, sizeof(reclaim_node_t), 0) != 0) return -1;
+    platform_mutex_init(&ebr->orphan_lock);
+    return 0;
+}
+
+void ebr_destroy(ebr_t *ebr)
+{
+    uint64_t freed = 0;
+    ebr_thread_t *thread = ebr->threads;
+    while (thread) {
+        ebr_thread_t *next = thread->next;
+        for (int b = 0; b < 3; b++) freed += free_list(&ebr->nodes, thread->limbo[b]);
+        free(thread);
+        thread = next;
+    }
+    freed += free_list(&ebr->nodes, ebr->orphans);
+    ebr->reclaimed += freed;
+
+    platform_mutex_destroy(&ebr->orphan_lock);
+    object_pool_destroy(&ebr->nodes);
+    memset(ebr, 0, sizeof(*ebr));
+}
+
+ebr_thread_t *ebr_register(ebr_t *ebr)
+{
+    /* Reuse a record given back earlier */
+    for (ebr_thread_t *t = __atomic_load_n(&ebr->threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+        int expected = 0;
+        if (__atomic_load_n(&t->in_use, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&t->in_use, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return t;
+        }
+    }
+
+    ebr_thread_t *thread = (ebr_thread_t *)aligned_alloc(64, sizeof(ebr_thread_t));
+    if (!thread) {
+        fprintf(stderr, "ebr_register: failed to allocate a thread record\n");
+        return NULL;
+    }
+    memset(thread, 0, sizeof(*thread));
+    thread->in_use = 1;
+    thread->ebr = ebr;
+
+    /* Records are never unlinked, so a plain push is safe against concurrent walkers */
+    ebr_thread_t *head = __atomic_load_n(&ebr->threads, __ATOMIC_RELAXED);
+    do {
+        thread->next = head;
+    } while (!__atomic_compare_exchange_n(&ebr->threads, &head, thread, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    return thread;
+}
+
+static void reclaim_orphans(ebr_t *ebr, uint64_t epoch)
+{
+    if (!__atomic_load_n(&ebr->orphans, __ATOMIC_ACQUIRE)) return;
+
+    /* Unlink what is old enough under the lock, free it outside */
+    reclaim_node_t *ready = NULL;
+    platform_mutex_lock(&ebr->orphan_lock);
+    reclaim_node_t **link = &ebr->orphans;
+    while (*link) {
+        reclaim_node_t *node = *link;
+        if (node->epoch + 2 <= epoch) {
+            /* `link` may be the head, which is read without the lock above */
+            __atomic_store_n(link, node->next, __ATOMIC_RELAXED);
+            node->next = ready;
+            ready = node;
+        } else {
+            link = &node->next;
+        }
+    }
+    platform_mutex_unlock(&ebr->orphan_lock);
+
+    uint64_t freed = free_list(&ebr->nodes, ready);
+    if (freed) __atomic_fetch_add(&ebr->reclaimed, freed, __ATOMIC_RELAXED);
+}
+
+/* Moves the epoch on if every thread inside a region has seen it; returns the epoch */
+static uint64_t try_advance(ebr_t *ebr)
+{
+    uint64_t epoch = __atomic_load_n(&ebr->epoch, __ATOMIC_SEQ_CST);
+    for (ebr_thread_t *t = __atomic_load_n(&ebr->threads, __ATOMIC_ACQUIRE); t; t = t->next) {
+        uint64_t local = __atomic_load_n(&t->local, __ATOMIC_SEQ_CST);
+        if ((local & 1) && (local >> 1) != epoch) return epoch;
+    }
+    if (__atomic_compare_exchange_n(&ebr->epoch, &epoch, epoch + 1, 0, __ATOMIC_ACQ_REL, __ATOMIC_ACQUIRE)) {
+        __atomic_fetch_add(&ebr->advances, 1, __ATOMIC_RELAXED);
+        epoch++;
+        reclaim_orphans(ebr, epoch);
+    }
+    return epoch;
+}
+
+static void reclaim_limbo(ebr_thread_t *thread, uint64_t epoch)
+{
+    uint64_t freed = 0;
+    for (int b = 0; b < 3; b++) {
+        if (thread->limbo[b] && thread->limbo_epoch[b] + 2 <= epoch) {
+            freed += free_list(&thread->ebr->nodes, thread->limbo[b]);
+            thread->limbo[b] = NULL;
+        }
+    }
+    if (freed) {
+        thread->pending -= freed;
+        __atomic_fetch_add(&thread->ebr->reclaimed, freed, __ATOMIC_RELAXED);
+    }
+}
+
+void ebr_reclaim(ebr_thread_t *thread)
+{
+    ebr_t *ebr = thread->ebr;
+    uint64_t epoch = thread->pending >= EBR_RECLAIM_BATCH ? try_advance(ebr)
+                                                          : __atomic_load_n(&ebr->epoch, __ATOMIC_ACQUIRE);
+    reclaim_limbo(thread, epoch);
+}
+
+void ebr_unregister(ebr_thread_t *thread)
+{
+    ebr_t *ebr = thread->ebr;
+
+    __atomic_store_n(&thread->local, 0, __ATOMIC_RELEASE);
+    reclaim_limbo(thread, try_advance(ebr));
+
+    if (thread->pending) {
+        platform_mutex_lock(&ebr->orphan_lock);
+        for (int b = 0; b < 3; b++) {
+            reclaim_node_t *node = thread->limbo[b];
+            while (node) {
+                reclaim_node_t *next = node->next;
+                node->next = ebr->orphans;
+                __atomic_store_n(&ebr->orphans, node, __ATOMIC_RELEASE);
+                node = next;
+            }
+            thread->limbo[b] = NULL;
+        }
+        platform_mutex_unlock(&ebr->orphan_lock);
+        thread->pending = 0;
+    }
+    __atomic_store_n(&thread->in_use, 0, __ATOMIC_RELEASE);
+}
+
+void ebr_retire(ebr_thread_t *thread, void *ptr, reclaim_free_t free_fn, void *ctx)
+{
+    ebr_t *ebr = thread->ebr;
+    reclaim_node_t *node = (reclaim_node_t *)object_pool_alloc(&ebr->nodes);
+    if (!node) {
+        fprintf(stderr, "ebr_retire: out of memory, node leaked\n");
+        return;
+    }
+
+    const uint64_t epoch = __atomic_load_n(&ebr->epoch, __ATOMIC_ACQUIRE);
+    const int b = (int)(epoch % 3);
+    if (thread->limbo[b] && thread->limbo_epoch[b] != epoch) {
+        /* The bucket holds epoch - 3 or older: free it before reusing it */
+        uint64_t freed = free_list(&ebr->nodes, thread->limbo[b]);
+        thread->pending -= freed;
+        __atomic_fetch_add(&ebr->reclaimed, freed, __ATOMIC_RELAXED);
+    }
+
+    node->ptr = ptr;
+    node->free_fn = free_fn;
+    node->ctx = ctx;
+    node->epoch = epoch;
+    node->next = thread->limbo_epoch[b] == epoch ? thread->limbo[b] : NULL;
+    thread->limbo[b] = node;
+    thread->limbo_epoch[b] = epoch;
+    thread->pending++;
+    __atomic_fetch_add(&ebr->retired, 1, __ATOMIC_RELAXED);
+}
+
+void ebr_flush(ebr_thread_t *thread)
+{
+    /* A node needs two advances; a thread left in the old epoch stops the second */
+    try_advance(thread->ebr);
+    reclaim_limbo(thread, try_advance(thread->ebr));
+}
+
+void ebr_stats(ebr_t *ebr, ebr_stats_t *stats)
+{
+    stats->epoch = __atomic_load_n(&ebr->epoch, __ATOMIC_RELAXED);
+    stats->advances = __atomic_load_n(&ebr->advances, __ATOMIC_RELAXED);
+    stats->retired = __atomic_load_n(&ebr->retired, __ATOMIC_RELAXED);
+    stats->reclaimed = __atomic_load_n(&ebr->reclaimed, __ATOMIC_RELAXED);
+}
+
+/* =============================
+ * Hazard pointers
+ * ============================= */
+
+int hazard_init(hazard_domain_t *domain)
+{
+    memset(domain, 0, sizeof(*domain));
+    return object_pool_init(&domain->nodes, sizeof(reclaim_node_t), 0);
+}
+
+void hazard_destroy(hazard_domain_t *domain)
+{
+    uint64_t freed = 0;
+    hazard_record_t *record = domain->records;
+    while (record) {
+        hazard_record_t *next = record->next;
+        freed += free_list(&domain->nodes, record->retired);
+        free(record->scan);
+        free(record);
+        record = next;
+    }
+    domain->reclaimed += freed;
+    object_pool_destroy(&domain->nodes);
+    memset(domain, 0, sizeof(*domain));
+}
+
+hazard_record_t *hazard_acquire(hazard_domain_t *domain)
+{
+    for (hazard_record_t *r = __atomic_load_n(&domain->records, __ATOMIC_ACQUIRE); r; r = r->next) {
+        int expected = 0;
+        if (__atomic_load_n(&r->in_use, __ATOMIC_RELAXED) == 0 &&
+            __atomic_compare_exchange_n(&r->in_use, &expected, 1, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            return r;
+        }
+    }
+
+    hazard_record_t *record = (hazard_record_t *)aligned_alloc(64, sizeof(hazard_record_t));
+    if (!record) {
+        fprintf(stderr, "hazard_acquire: failed to allocate a hazard record\n");
+        return NULL;
+    }
+    memset(record, 0, sizeof(*record));
+    record->in_use = 1;
+    record->domain = domain;
+
+    hazard_record_t *head = __atomic_load_n(&domain->records, __ATOMIC_RELAXED);
+    do {
+        record->next = head;
+    } while (!__atomic_compare_exchange_n(&domain->records, &head, record, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+    __atomic_fetch_add(&domain->num_records, 1, __ATOMIC_RELAXED);
+    return record;
+}
+
+void hazard_release(hazard_record_t *record)
+{
+    for (int i = 0; i < HAZARD_SLOTS; i++) hazard_clear(record, i);
+    /* What is still protected stays with the record for its next owner */
+    if (record->pending) hazard_scan(record);
+    __atomic_store_n(&record->in_use, 0, __ATOMIC_RELEASE);
+}
+
+void hazard_retire(hazard_record_t *record, void *ptr, reclaim_free_t free_fn, void *ctx)
+{
+    hazard_domain_t *domain = record->domain;
+    reclaim_node_t *node = (reclaim_node_t *)object_pool_alloc(&domain->nodes);
+    if (!node) {
+        fprintf(stderr, "hazard_retire: out of memory, node leaked\n");
+        return;
+    }
+    node->ptr = ptr;
+    node->free_fn = free_fn;
+    node->ctx = ctx;
+    node->epoch = 0;
+    node->next = record->retired;
+    record->retired = node;
+    record->pending++;
+    __atomic_fetch_add(&domain->retired, 1, __ATOMIC_RELAXED);
+
+    /* Scanning once per 2 * slots-in-use retirements keeps the cost per node constant */
+    uint64_t threshold = 2 * (uint64_t)HAZARD_SLOTS * __atomic_load_n(&domain->num_records, __ATOMIC_RELAXED);
+    if (threshold < HAZARD_SCAN_BATCH) threshold = HAZARD_SCAN_BATCH;
+    if (record->pending >= threshold) hazard_scan(record);
+}
+
+static int compare_pointers(const void *a, const void *b)
+{
+    uintptr_t x = (uintptr_t)*(void *const *)a;
+    uintptr_t y = (uintptr_t)*(void *const *)b;
+    return (x > y) - (x < y);
+}
+
+void hazard_scan(hazard_record_t *record)
+{
+    hazard_domain_t *domain = record->domain;
+    size_t count = 0;
+
+    /* Every slot that holds a pointer now, sorted for lookup */
+    for (hazard_record_t *r = __atomic_load_n(&domain->records, __ATOMIC_ACQUIRE); r; r = r->next) {
+        for (int i = 0; i < HAZARD_SLOTS; i++) {
+            void *p = __atomic_load_n(&r->slots[i], __ATOMIC_SEQ_CST);
+            if (!p) continue;
+            if (count == record->scan_cap) {
+                size_t cap = record->scan_cap ? record->scan_cap * 2 : 64;
+                void **grown = (void **)realloc(record->scan, cap * sizeof(void *));
+                if (!grown) return;         /* try again on the next retirement */
+                record->scan = grown;
+                record->scan_cap = cap;
+            }
+            record->scan[count++] = p;
+        }
+    }
+    if (count > 1) qsort(record->scan, count, sizeof(void *), compare_pointers);
+
+    reclaim_node_t *keep = NULL, *ready = NULL;
+    reclaim_node_t *node = record->retired;
+    while (node) {
+        reclaim_node_t *next = node->next;
+        if (count && bsearch(&node->ptr, record->scan, count, sizeof(void *), compare_pointers)) {
+            node->next = keep;
+            keep = node;
+        } else {
+            node->next = ready;
+            ready = node;
+        }
+        node = next;
+    }
+    record->retired = keep;
+
+    uint64_t freed = free_list(&domain->nodes, ready);
+    record->pending -= freed;
+    __atomic_fetch_add(&domain->scans, 1, __ATOMIC_RELAXED);
+    if (freed) __atomic_fetch_add(&domain->reclaimed, freed, __ATOMIC_RELAXED);
+}
+
+void hazard_stats(hazard_domain_t *domain, hazard_stats_t *stats)
+{
+    stats->scans = __atomic_load_n(&domain->scans, __ATOMIC_RELAXED);
+    stats->retired = __atomic_load_n(&domain->retired, __ATOMIC_RELAXED);
+    stats->reclaimed = __atomic_load_n(&domain->reclaimed, __ATOMIC_RELAXED);
+    stats->records = __atomic_load_n(&domain->num_records, __ATOMIC_RELAXED);
+}
@@ -0,0 +1,268 @@
+#ifndef RECLAIM_H
+#define RECLAIM_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "object_pool.h"
+#include "platform.h"
+
+/**
+ * Safe memory reclamation for lock-free structures.
+ *
+ * A node unlinked from a lock-free structure may still be read by threads
+ * that loaded a pointer to it before the unlink, so it cannot be freed at
+ * once. It is retired instead, with the function that frees it, and freed
+ * once no thread can hold such a pointer. Two schemes are offered:
+ *
+ *  - Epoch-based reclamation (ebr_t). Readers bracket their accesses with
+ *    ebr_enter() and ebr_exit(), which cost a store each; a retired node
+ *    is freed two epochs later, once every thread inside a critical
+ *    region has been seen in the current epoch. Cheap for readers, but
+ *    one thread stalled inside a region holds back every free.
+ *
+ *  - Hazard pointers (hazard_domain_t). A reader publishes each pointer
+ *    it is about to follow in one of HAZARD_SLOTS slots, and a node is
+ *    freed once no slot holds it. Each protected load costs a fence, but
+ *    the memory waiting to be freed stays bounded whatever the readers do.
+ *
+ * Pool workers are registered with their pool's ebr_t and leave their
+ * critical region between tasks, so tasks need no ebr_enter()/ebr_exit()
+ * of their own: see thread_pool_reclaimer().
+ *
+ * Retirement records come from an object_pool_t, so retiring takes no
+ * malloc.
+ */
+
+#define EBR_RECLAIM_BATCH 64
+#define HAZARD_SLOTS 4
+#define HAZARD_SCAN_BATCH 64
+
+/** Frees a retired node; `ctx` is what was passed to the retire call. */
+typedef void (*reclaim_free_t)(void *ptr, void *ctx);
+
+typedef struct reclaim_node_t {
+    void *ptr;
+    reclaim_free_t free_fn;
+    void *ctx;
+    uint64_t epoch;                 /* global epoch when retired (EBR only) */
+    struct reclaim_node_t *next;
+} reclaim_node_t;
+
+/* =============================
+ * Epoch-based reclamation
+ * ============================= */
+
+struct ebr_t;
+
+/**
+ * A thread's registration. Owned by the domain and reused after
+ * ebr_unregister().
+ */
+typedef struct ebr_thread_t {
+    uint64_t local;                 /* epoch << 1 | 1 inside a region, 0 outside */
+    int in_use;
+    struct ebr_thread_t *next;      /* every record of the domain */
+    struct ebr_t *ebr;
+
+    /* Nodes retired in the last three epochs, by epoch % 3 */
+    reclaim_node_t *limbo[3];
+    uint64_t limbo_epoch[3];
+    uint64_t pending;
+} __attribute__((aligned(64))) ebr_thread_t;
+
+typedef struct ebr_t {
+    uint64_t epoch;
+    ebr_thread_t *threads;
+    object_pool_t nodes;
+
+    /* Left behind by threads that unregistered */
+    platform_mutex_t orphan_lock;
+    reclaim_node_t *orphans;
+
+    uint64_t advances;
+    uint64_t retired;
+    uint64_t reclaimed;
+} ebr_t;
+
+/**
+ * Returns 0, or -1 if memory ran out.
+ */
+int ebr_init(ebr_t *ebr);
+
+/**
+ * Free every node still waiting, then the domain. No thread may be inside
+ * a critical region.
+ */
+void ebr_destroy(ebr_t *ebr);
+
+/**
+ * Registration for the calling thread, or NULL if memory ran out. A
+ * registration is used by one thread at a time.
+ */
+ebr_thread_t *ebr_register(ebr_t *ebr);
+
+/**
+ * Give the registration back. Nodes it retired that cannot be freed yet
+ * are handed to the domain.
+ */
+void ebr_unregister(ebr_thread_t *thread);
+
+/**
+ * Start reading shared nodes. Pointers loaded after this stay valid until
+ * ebr_exit().
+ */
+static inline void ebr_enter(ebr_thread_t *thread)
+{
+    uint64_t epoch = __atomic_load_n(&thread->ebr->epoch, __ATOMIC_ACQUIRE);
+    /* A full barrier: the announcement must be visible before any read of the structure */
+    __atomic_store_n(&thread->local, epoch << 1 | 1, __ATOMIC_SEQ_CST);
+}
+
+void ebr_reclaim(ebr_thread_t *thread);
+
+/**
+ * Stop reading shared nodes, and free what this thread retired if the
+ * epoch allows it.
+ */
+static inline void ebr_exit(ebr_thread_t *thread)
+{
+    __atomic_store_n(&thread->local, 0, __ATOMIC_RELEASE);
+    if (thread->pending) ebr_reclaim(thread);
+}
+
+/**
+ * ebr_exit() followed by ebr_enter(), for a thread that stays inside a
+ * region for long: pointers loaded before the call become invalid.
+ */
+static inline void ebr_quiescent(ebr_thread_t *thread)
+{
+    ebr_exit(thread);
+    ebr_enter(thread);
+}
+
+/**
+ * Free `ptr` with `free_fn(ptr, ctx)` once no thread can still be reading
+ * it. The caller must already have unlinked it.
+ */
+void ebr_retire(ebr_thread_t *thread, void *ptr, reclaim_free_t free_fn, void *ctx);
+
+/**
+ * Try to move the epoch on and free whatever that allows, without
+ * waiting for the batch to fill. Call outside a critical region.
+ */
+void ebr_flush(ebr_thread_t *thread);
+
+typedef struct ebr_stats_t {
+    uint64_t epoch;
+    uint64_t advances;
+    uint64_t retired;
+    uint64_t reclaimed;
+} ebr_stats_t;
+
+void ebr_stats(ebr_t *ebr, ebr_stats_t *stats);
+
+/* =============================
+ * Hazard pointers
+ * ============================= */
+
+struct hazard_domain_t;
+
+/**
+ * A thread's slots. Owned by the domain and reused after
+ * hazard_release(), together with any nodes it could not free yet.
+ */
+typedef struct hazard_record_t {
+    void *slots[HAZARD_SLOTS];
+    int in_use;
+    struct hazard_record_t *next;
+    struct hazard_domain_t *domain;
+
+    reclaim_node_t *retired;
+    uint64_t pending;
+    void **scan;                    /* scratch for hazard_scan() */
+    size_t scan_cap;
+} __attribute__((aligned(64))) hazard_record_t;
+
+typedef struct hazard_domain_t {
+    hazard_record_t *records;
+    uint32_t num_records;
+    object_pool_t nodes;
+
+    uint64_t scans;
+    uint64_t retired;
+    uint64_t reclaimed;
+} hazard_domain_t;
+
+/**
+ * Returns 0, or -1 if memory ran out.
+ */
+int hazard_init(hazard_domain_t *domain);
+
+/**
+ * Free every node still waiting, then the domain. No slot may be in use.
+ */
+void hazard_destroy(hazard_domain_t *domain);
+
+/**
+ * Slots for the calling thread, or NULL if memory ran out.
+ */
+hazard_record_t *hazard_acquire(hazard_domain_t *domain);
+
+/**
+ * Clear the slots and give them back.
+ */
+void hazard_release(hazard_record_t *record);
+
+/**
+ * Load `*src` and protect it in `slot`: the node it points to will not
+ * be freed until the slot is cleared or reused. Returns the pointer,
+ * which may be NULL.
+ */
+static inline void *hazard_protect(hazard_record_t *record, int slot, void *const *src)
+{
+    void *p = __atomic_load_n(src, __ATOMIC_ACQUIRE);
+    for (;;) {
+        __atomic_store_n(&record->slots[slot], p, __ATOMIC_SEQ_CST);
+        /* Still linked after the slot became visible, so no scan can have missed it */
+        void *again = __atomic_load_n(src, __ATOMIC_SEQ_CST);
+        if (again == p) return p;
+        p = again;
+    }
+}
+
+static inline void hazard_clear(hazard_record_t *record, int slot)
+{
+    __atomic_store_n(&record->slots[slot], NULL, __ATOMIC_RELEASE);
+}
+
+/**
+ * Free `ptr` with `free_fn(ptr, ctx)` once no slot protects it. The
+ * caller must already have unlinked it.
+ */
+void hazard_retire(hazard_record_t *record, void *ptr, reclaim_free_t free_fn, void *ctx);
+
+/**
+ * Free every retired node no slot protects. Runs on its own from
+ * hazard_retire() once enough nodes are waiting.
+ */
+void hazard_scan(hazard_record_t *record);
+
+typedef struct hazard_stats_t {
+    uint64_t scans;
+    uint64_t retired;
+    uint64_t reclaimed;
+    uint32_t records;
+} hazard_stats_t;
+
+void hazard_stats(hazard_domain_t *domain, hazard_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECLAIM_H
@@ -0,0 +1,372 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+#include "reclaim.h"
+#include "threadpool.h"
+#include "xoshiro.h"
+
+/**
+ * Reclamation stress test:
+ *
+ *   reclaim_main [threads] [operations_per_thread] [ebr|hazard|pool|all]
+ *
+ * Threads push and pop at random on one lock-free (Treiber) stack of
+ * malloc'd nodes, retiring every node they pop. "ebr" runs plain threads
+ * that bracket each operation with ebr_enter()/ebr_exit(); "hazard"
+ * protects the top node with a hazard pointer; "pool" runs the
+ * operations as thread pool tasks, which rely on the workers' quiescent
+ * states alone. Freed nodes are poisoned, and a pop that reads a poisoned
+ * or freed node is an error, so build it with -fsanitize=address (reads
+ * of freed nodes) and with -fsanitize=thread (frees racing with reads) as
+ * well as plainly. Exits 1 if any check fails: values pushed must equal
+ * values popped plus those left, and every popped node must be freed
+ * exactly once by the end.
+ */
+
+#define NODE_LIVE 0x4c495645u
+#define NODE_DEAD 0xdeadbeefu
+#define POOL_TASKS_PER_THREAD 16
+
+typedef struct stress_node_t {
+    uint64_t value;
+    uint32_t magic;
+    struct stress_node_t *next;
+} stress_node_t;
+
+typedef struct stress_t {
+    stress_node_t *head;
+    uint64_t freed;
+    uint64_t errors;
+} stress_t;
+
+typedef struct stress_job_t {
+    stress_t *stack;
+    ebr_t *ebr;
+    hazard_domain_t *hazard;
+    int operations;
+    uint64_t seed;
+    uint64_t pushed_sum;
+    uint64_t popped_sum;
+    uint64_t pops;
+
+    /* Pool mode: completion of every task */
+    platform_mutex_t *lock;
+    platform_cond_t *idle;
+    int *outstanding;
+} stress_job_t;
+
+static void free_node(void *ptr, void *ctx)
+{
+    stress_t *stack = (stress_t *)ctx;
+    stress_node_t *node = (stress_node_t *)ptr;
+    node->magic = NODE_DEAD;
+    free(node);
+    __atomic_fetch_add(&stack->freed, 1, __ATOMIC_RELAXED);
+}
+
+static void push(stress_t *stack, stress_node_t *node)
+{
+    stress_node_t *head = __atomic_load_n(&stack->head, __ATOMIC_RELAXED);
+    do {
+        __atomic_store_n(&node->next, head, __ATOMIC_RELAXED);
+    } while (!__atomic_compare_exchange_n(&stack->head, &head, node, 1, __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+static int check(stress_t *stack, stress_node_t *node)
+{
+    if (node->magic == NODE_LIVE) return 1;
+    __atomic_fetch_add(&stack->errors, 1, __ATOMIC_RELAXED);
+    return 0;
+}
+
+/* Caller is inside an epoch critical region */
+static stress_node_t *pop_ebr(stress_t *stack)
+{
+    stress_node_t *node = __atomic_load_n(&stack->head, __ATOMIC_ACQUIRE);
+    while (node) {
+        if (!check(stack, node)) return NULL;
+        stress_node_t *next = __atomic_load_n(&node->next, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&stack->head, &node, next, 1, __ATOMIC_ACQUIRE, __ATOMIC_ACQUIRE)) break;
+    }
+    return node;
+}
+
+static stress_node_t *pop_hazard(stress_t *stack, hazard_record_t *record)
+{
+    for (;;) {
+        stress_node_t *node = (stress_node_t *)hazard_protect(record, 0, (void *const *)&stack->head);
+        if (!node || !check(stack, node)) break;
+        stress_node_t *next = __atomic_load_n(&node->next, __ATOMIC_RELAXED);
+        if (__atomic_compare_exchange_n(&stack->head, &node, next, 0, __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            hazard_clear(record, 0);
+            return node;
+        }
+    }
+    hazard_clear(record, 0);
+    return NULL;
+}
+
+static stress_node_t *new_node(stress_job_t *job, xoshiro_t *rng)
+{
+    stress_node_t *node = (stress_node_t *)malloc(sizeof(stress_node_t));
+    if (!node) return NULL;
+    node->value = xoshiro_next(rng);
+    node->magic = NODE_LIVE;
+    job->pushed_sum += node->value;
+    return node;
+}
+
+static void popped(stress_job_t *job, stress_node_t *node)
+{
+    job->popped_sum += node->value;
+    job->pops++;
+}
+
+static void *ebr_worker(void *arg)
+{
+    stress_job_t *job = (stress_job_t *)arg;
+    ebr_thread_t *self = ebr_register(job->ebr);
+    xoshiro_t rng;
+
+    if (!self) return NULL;
+    xoshiro_seed(&rng, job->seed);
+    for (int op = 0; op < job->operations; op++) {
+        ebr_enter(self);
+        if (xoshiro_next(&rng) & 1) {
+            stress_node_t *node = new_node(job, &rng);
+            if (node) push(job->stack, node);
+        } else {
+            stress_node_t *node = pop_ebr(job->stack);
+            if (node) {
+                popped(job, node);
+                ebr_retire(self, node, free_node, job->stack);
+            }
+        }
+        ebr_exit(self);
+    }
+    ebr_unregister(self);
+    return NULL;
+}
+
+static void *hazard_worker(void *arg)
+{
+    stress_job_t *job = (stress_job_t *)arg;
+    hazard_record_t *record = hazard_acquire(job->hazard);
+    xoshiro_t rng;
+
+    if (!record) return NULL;
+    xoshiro_seed(&rng, job->seed);
+    for (int op = 0; op < job->operations; op++) {
+        if (xoshiro_next(&rng) & 1) {
+            stress_node_t *node = new_node(job, &rng);
+            if (node) push(job->stack, node);
+        } else {
+            stress_node_t *node = pop_hazard(job->stack, record);
+            if (node) {
+                popped(job, node);
+                hazard_retire(record, node, free_node, job->stack);
+            }
+        }
+    }
+    hazard_release(record);
+    return NULL;
+}
+
+/*
+ * Runs as a pool task: the worker is already inside a critical region.
+ * One the pool could not queue runs on the submitter, registered for it.
+ */
+static void pool_task(void *arg)
+{
+    stress_job_t *job = (stress_job_t *)arg;
+    ebr_thread_t *self = thread_pool_reclaimer(), *own = NULL;
+    xoshiro_t rng;
+
+    if (!self && (self = own = ebr_register(job->ebr)) != NULL) ebr_enter(own);
+    xoshiro_seed(&rng, job->seed);
+    for (int op = 0; self && op < job->operations; op++) {
+        if (xoshiro_next(&rng) & 1) {
+            stress_node_t *node = new_node(job, &rng);
+            if (node) push(job->stack, node);
+        } else {
+            stress_node_t *node = pop_ebr(job->stack);
+            if (node) {
+                popped(job, node);
+                ebr_retire(self, node, free_node, job->stack);
+            }
+        }
+    }
+    if (own) {
+        ebr_exit(own);
+        ebr_unregister(own);
+    }
+
+    platform_mutex_lock(job->lock);
+    if (--*job->outstanding == 0) platform_cond_broadcast(job->idle);
+    platform_mutex_unlock(job->lock);
+}
+
+/* Pops what is left and checks the totals; returns the number of failed checks */
+static int finish(const char *name, stress_t *stack, stress_job_t *jobs, int count, unsigned long long elapsed)
+{
+    uint64_t pushed = 0, popped_sum = 0, pops = 0, left = 0, left_sum = 0;
+    int failures = 0;
+
+    for (int i = 0; i < count; i++) {
+        pushed += jobs[i].pushed_sum;
+        popped_sum += jobs[i].popped_sum;
+        pops += jobs[i].pops;
+    }
+    stress_node_t *node = stack->head;
+    while (node) {
+        stress_node_t *next = node->next;
+        left_sum += node->value;
+        left++;
+        free(node);
+        node = next;
+    }
+    stack->head = NULL;
+
+    printf("[Main] %-6s %8.1f ns/op, %llu popped and retired, %llu freed, %llu left on the stack\n", name,
+           (double)elapsed / (double)(pops ? pops : 1) / 2.0, (unsigned long long)pops,
+           (unsigned long long)stack->freed, (unsigned long long)left);
+    if (stack->errors) {
+        fprintf(stderr, "%s: %llu pops read a freed node\n", name, (unsigned long long)stack->errors);
+        failures++;
+    }
+    if (pushed != popped_sum + left_sum) {
+        fprintf(stderr, "%s: values pushed do not match values popped and left\n", name);
+        failures++;
+    }
+    if (stack->freed != pops) {
+        fprintf(stderr, "%s: %llu nodes popped but %llu freed\n", name, (unsigned long long)pops,
+                (unsigned long long)stack->freed);
+        failures++;
+    }
+    return failures;
+}
+
+static int run_threads(const char *name, int threads, int operations, int use_hazard)
+{
+    stress_t stack;
+    ebr_t ebr;
+    hazard_domain_t hazard;
+    stress_job_t *jobs = (stress_job_t *)calloc((size_t)threads, sizeof(stress_job_t));
+    platform_thread_t *handles = (platform_thread_t *)malloc(sizeof(platform_thread_t) * (size_t)threads);
+
+    memset(&stack, 0, sizeof(stack));
+    if (!jobs || !handles || (use_hazard ? hazard_init(&hazard) : ebr_init(&ebr)) != 0) {
+        free(jobs);
+        free(handles);
+        return 1;
+    }
+
+    unsigned long long start = platform_time_ns();
+    for (int i = 0; i < threads; i++) {
+        jobs[i].stack = &stack;
+        jobs[i].ebr = &ebr;
+        jobs[i].hazard = &hazard;
+        jobs[i].operations = operations;
+        jobs[i].seed = 1 + (uint64_t)i;
+        platform_thread_create(&handles[i], use_hazard ? hazard_worker : ebr_worker, &jobs[i]);
+    }
+    for (int i = 0; i < threads; i++) platform_thread_join(handles[i]);
+    unsigned long long elapsed = platform_time_ns() - start;
+
+    /* Frees whatever the domain still holds */
+    if (use_hazard) {
+        hazard_stats_t s;
+        hazard_stats(&hazard, &s);
+        printf("[Main] hazard: %llu scans, %llu of %llu freed before shutdown, %u records\n",
+               (unsigned long long)s.scans, (unsigned long long)s.reclaimed, (unsigned long long)s.retired,
+               s.records);
+        hazard_destroy(&hazard);
+    } else {
+        ebr_stats_t s;
+        ebr_stats(&ebr, &s);
+        printf("[Main] ebr: epoch %llu, %llu of %llu freed before shutdown\n", (unsigned long long)s.epoch,
+               (unsigned long long)s.reclaimed, (unsigned long long)s.retired);
+        ebr_destroy(&ebr);
+    }
+
+    int failures = finish(name, &stack, jobs, threads, elapsed);
+    free(jobs);
+    free(handles);
+    return failures;
+}
+
+static int run_pool(int threads, int operations)
+{
+    stress_t stack;
+    thread_pool_t pool;
+    platform_mutex_t lock;
+    platform_cond_t idle;
+    const int tasks = threads * POOL_TASKS_PER_THREAD;
+    int outstanding = tasks;
+    stress_job_t *jobs = (stress_job_t *)calloc((size_t)tasks, sizeof(stress_job_t));
+
+    if (!jobs) return 1;
+    memset(&stack, 0, sizeof(stack));
+    platform_mutex_init(&lock);
+    platform_cond_init(&idle);
+    thread_pool_init(&pool, threads);
+
+    unsigned long long start = platform_time_ns();
+    for (int i = 0; i < tasks; i++) {
+        jobs[i].stack = &stack;
+        jobs[i].ebr = &pool.reclaim;
+        jobs[i].operations = operations / POOL_TASKS_PER_THREAD;
+        jobs[i].seed = 1000 + (uint64_t)i;
+        jobs[i].lock = &lock;
+        jobs[i].idle = &idle;
+        jobs[i].outstanding = &outstanding;
+        if (thread_pool_add_task(&pool, pool_task, &jobs[i]) != 0) pool_task(&jobs[i]);
+    }
+    platform_mutex_lock(&lock);
+    while (outstanding > 0) platform_cond_wait(&idle, &lock);
+    platform_mutex_unlock(&lock);
+    unsigned long long elapsed = platform_time_ns() - start;
+
+    ebr_stats_t s;
+    ebr_stats(&pool.reclaim, &s);
+    printf("[Main] pool: epoch %llu, %llu of %llu freed before shutdown\n", (unsigned long long)s.epoch,
+           (unsigned long long)s.reclaimed, (unsigned long long)s.retired);
+    thread_pool_shutdown(&pool);
+
+    int failures = finish("pool", &stack, jobs, tasks, elapsed);
+    platform_cond_destroy(&idle);
+    platform_mutex_destroy(&lock);
+    free(jobs);
+    return failures;
+}
+
+int main(int argc, char **argv)
+{
+    int threads = argc > 1 ? atoi(argv[1]) : 0;
+    int operations = argc > 2 ? atoi(argv[2]) : 200000;
+    const char *mode = argc > 3 ? argv[3] : "all";
+    if (threads <= 0) threads = platform_cpu_count() < 4 ? 4 : platform_cpu_count();
+    if (operations <= 0) {
+        fprintf(stderr, "usage: %s [threads] [operations_per_thread] [ebr|hazard|pool|all]\n", argv[0]);
+        return 1;
+    }
+    int all = strcmp(mode, "all") == 0;
+    if (!all && strcmp(mode, "ebr") != 0 && strcmp(mode, "hazard") != 0 && strcmp(mode, "pool") != 0) {
+        fprintf(stderr, "Unknown mode: %s\n", mode);
+        return 1;
+    }
+
+    printf("[Main] %d threads, %d operations each\n", threads, operations);
+    int failures = 0;
+    if (all || strcmp(mode, "ebr") == 0) failures += run_threads("ebr", threads, operations, 0);
+    if (all || strcmp(mode, "hazard") == 0) failures += run_threads("hazard", threads, operations, 1);
+    if (all || strcmp(mode, "pool") == 0) failures += run_pool(threads, operations);
+
+    if (failures) {
+        fprintf(stderr, "%d checks failed\n", failures);
+        return 1;
+    }
+    printf("[Main] all checks passed\n");
+    return 0;
+}
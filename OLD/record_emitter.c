@@ -0,0 +1,327 @@
+#include "record_emitter.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+/* Fragments up to this long are copied with one fixed-size move */
+#define FRAGMENT_COPY 32
+
+/* =============================
+ * Integer formatting
+ * ============================= */
+
+static const char g_digit_pairs[201] =
+    "00010203040506070809101112131415161718192021222324252627282930313233343536373839"
+    "40414243444546474849505152535455565758596061626364656667686970717273747576777879"
+    "8081828384858687888990919293949596979899";
+
+static const uint64_t g_pow10[20] = {
+    1ULL, 10ULL, 100ULL, 1000ULL, 10000ULL, 100000ULL, 1000000ULL, 10000000ULL,
+    100000000ULL, 1000000000ULL, 10000000000ULL, 100000000000ULL, 1000000000000ULL,
+    10000000000000ULL, 100000000000000ULL, 1000000000000000ULL, 10000000000000000ULL,
+    100000000000000000ULL, 1000000000000000000ULL, 10000000000000000000ULL
+};
+
+/* log10 from the bit length (1233/4096 ~ log10(2)), corrected by one compare */
+static inline unsigned int digit_count(uint64_t v)
+{
+    v |= 1;
+    unsigned int t = ((unsigned int)(64 - __builtin_clzll(v)) * 1233) >> 12;
+    return t + 1 - (v < g_pow10[t]);
+}
+
+/* Exactly 8 digits; the four pairs are independent 32-bit divisions */
+static inline void put_8_digits(char *p, uint32_t v)
+{
+    const uint32_t hi = v / 10000, lo = v % 10000;
+    memcpy(p, g_digit_pairs + 2 * (hi / 100), 2);
+    memcpy(p + 2, g_digit_pairs + 2 * (hi % 100), 2);
+    memcpy(p + 4, g_digit_pairs + 2 * (lo / 100), 2);
+    memcpy(p + 6, g_digit_pairs + 2 * (lo % 100), 2);
+}
+
+char *record_format_u64(char *out, uint64_t value)
+{
+    const unsigned int n = digit_count(value);
+    char *p = out + n;
+
+    /* 64-bit divisions only for the (rare) digits above the first eight */
+    while (value >= 100000000) {
+        p -= 8;
+        put_8_digits(p, (uint32_t)(value % 100000000));
+        value /= 100000000;
+    }
+
+    uint32_t v = (uint32_t)value;
+    while (v >= 100) {
+        p -= 2;
+        memcpy(p, g_digit_pairs + 2 * (v % 100), 2);
+        v /= 100;
+    }
+    if (v >= 10) memcpy(p - 2, g_digit_pairs + 2 * v, 2);
+    else p[-1] = (char)('0' + v);
+    return out + n;
+}
+
+char *record_format_i64(char *out, int64_t value)
+{
+    uint64_t magnitude = (uint64_t)value;
+    if (value < 0) {
+        *out++ = '-';
+        magnitude = 0 - magnitude;
+    }
+    return record_format_u64(out, magnitude);
+}
+
+/* =============================
+ * Strings
+ * ============================= */
+
+static size_t json_escape(char *out, const char *s)
+{
+    static const char hex[] = "0123456789abcdef";
+    char *p = out;
+
+    *p++ = '"';
+    for (; *s; s++) {
+        unsigned char c = (unsigned char)*s;
+        if (c == '"' || c == '\\') {
+            *p++ = '\\';
+            *p++ = (char)c;
+        } else if (c < 0x20) {
+            memcpy(p, "\\u00", 4);
+            p[4] = hex[c >> 4];
+            p[5] = hex[c & 15];
+            p += 6;
+        } else {
+            *p++ = (char)c;
+        }
+    }
+    *p++ = '"';
+    return (size_t)(p - out);
+}
+
+static size_t csv_field(char *out, const char *s)
+{
+    char *p = out;
+
+    if (!strpbrk(s, ",\"\r\n")) {
+        size_t len = strlen(s);
+        memcpy(out, s, len);
+        return len;
+    }
+    *p++ = '"';
+    for (; *s; s++) {
+        if (*s == '"') *p++ = '"';
+        *p++ = *s;
+    }
+    *p++ = '"';
+    return (size_t)(p - out);
+}
+
+/* Worst-case encoded size of a string of `len` bytes */
+static size_t escaped_bound(record_format_t format, size_t len)
+{
+    return format == RECORD_JSON ? 6 * len + 2 : 2 * len + 2;
+}
+
+/* =============================
+ * Setup
+ * ============================= */
+
+static size_t column_bound(const record_emitter_t *em, uint32_t column)
+{
+    size_t bound = 21;
+    const symbol_table_t *table = em->symbols[column];
+
+    if (table) {
+        /* Longest name in the table, found once */
+        size_t longest = 0;
+        uint32_t entries = table->kind == SYMBOL_DENSE ? table->size + 1 : table->size;
+        for (uint32_t i = 0; i < entries; i++) {
+            size_t len = strlen(table->strings + table->names[i]);
+            if (len > longest) longest = len;
+        }
+        if (escaped_bound(em->format, longest) > bound) bound = escaped_bound(em->format, longest);
+    }
+    return bound;
+}
+
+static int update_bound(record_emitter_t *em)
+{
+    const uint32_t columns = em->layout->num_ops;
+    size_t bound = FRAGMENT_COPY + em->fragment_offset[columns + 1];
+
+    for (uint32_t c = 0; c < columns; c++) bound += column_bound(em, c);
+    em->max_record = bound;
+
+    if (em->capacity < 2 * bound) {
+        char *grown = (char *)realloc(em->buffer, 2 * bound);
+        if (!grown) return -1;
+        em->buffer = grown;
+        em->capacity = 2 * bound;
+    }
+    return 0;
+}
+
+int record_emitter_init(record_emitter_t *emitter, const bitfield_layout_t *layout,
+                        record_format_t format, FILE *out, size_t buffer_size)
+{
+    const uint32_t columns = layout->num_ops;
+    size_t size = FRAGMENT_COPY;
+
+    memset(emitter, 0, sizeof(*emitter));
+    emitter->layout = layout;
+    emitter->format = format;
+    emitter->out = out;
+
+    for (uint32_t c = 0; c < columns; c++) size += escaped_bound(format, strlen(layout->names[c])) + 2;
+    size += 2;
+
+    emitter->fragments = (char *)calloc(1, size);
+    emitter->fragment_offset = (uint32_t *)malloc(sizeof(uint32_t) * (columns + 2));
+    emitter->symbols = (const symbol_table_t **)calloc(columns ? columns : 1, sizeof(*emitter->symbols));
+    emitter->capacity = buffer_size ? buffer_size : RECORD_EMITTER_DEFAULT_BUFFER;
+    emitter->buffer = (char *)malloc(emitter->capacity);
+    if (!emitter->fragments || !emitter->fragment_offset || !emitter->symbols || !emitter->buffer) {
+        fprintf(stderr, "record_emitter_init: out of memory\n");
+        record_emitter_destroy(emitter);
+        return -1;
+    }
+
+    /* JSON: {"a":  ,"b":  ...  }\n     CSV: (none)  ,  ...  \n */
+    char *p = emitter->fragments;
+    for (uint32_t c = 0; c < columns; c++) {
+        emitter->fragment_offset[c] = (uint32_t)(p - emitter->fragments);
+        if (format == RECORD_JSON) {
+            *p++ = c == 0 ? '{' : ',';
+            p += json_escape(p, layout->names[c]);
+            *p++ = ':';
+        } else if (c > 0) {
+            *p++ = ',';
+        }
+    }
+    emitter->fragment_offset[columns] = (uint32_t)(p - emitter->fragments);
+    if (format == RECORD_JSON) *p++ = columns ? '}' : '{';
+    if (format == RECORD_JSON && columns == 0) *p++ = '}';
+    *p++ = '\n';
+    emitter->fragment_offset[columns + 1] = (uint32_t)(p - emitter->fragments);
+
+    if (update_bound(emitter) != 0) {
+        fprintf(stderr, "record_emitter_init: out of memory\n");
+        record_emitter_destroy(emitter);
+        return -1;
+    }
+    return 0;
+}
+
+void record_emitter_destroy(record_emitter_t *emitter)
+{
+    if (emitter->buffer && emitter->used) record_emitter_flush(emitter);
+    free(emitter->fragments);
+    free(emitter->fragment_offset);
+    free(emitter->symbols);
+    free(emitter->buffer);
+    emitter->fragments = NULL;
+    emitter->fragment_offset = NULL;
+    emitter->symbols = NULL;
+    emitter->buffer = NULL;
+}
+
+void record_emitter_set_symbols(record_emitter_t *emitter, uint32_t column,
+                                const symbol_table_t *table)
+{
+    if (column >= emitter->layout->num_ops) return;
+    emitter->symbols[column] = table;
+    if (update_bound(emitter) != 0) {
+        emitter->symbols[column] = NULL;
+        update_bound(emitter);
+    }
+}
+
+/* =============================
+ * Output
+ * ============================= */
+
+int record_emitter_flush(record_emitter_t *emitter)
+{
+    if (emitter->used == 0 || emitter->error) return emitter->error ? -1 : 0;
+    if (fwrite(emitter->buffer, 1, emitter->used, emitter->out) != emitter->used) {
+        fprintf(stderr, "record_emitter_flush: write failed\n");
+        emitter->error = 1;
+        return -1;
+    }
+    emitter->bytes_written += emitter->used;
+    emitter->used = 0;
+    return 0;
+}
+
+int record_emitter_header(record_emitter_t *emitter)
+{
+    const bitfield_layout_t *layout = emitter->layout;
+
+    if (emitter->format != RECORD_CSV) return 0;
+    for (uint32_t c = 0; c < layout->num_ops; c++) {
+        if (emitter->capacity - emitter->used < escaped_bound(RECORD_CSV, BITFIELD_MAX_NAME) + 2 &&
+            record_emitter_flush(emitter) != 0) {
+            return -1;
+        }
+        if (c) emitter->buffer[emitter->used++] = ',';
+        emitter->used += csv_field(emitter->buffer + emitter->used, layout->names[c]);
+    }
+    emitter->buffer[emitter->used++] = '\n';
+    return 0;
+}
+
+static inline char *put_fragment(char *p, const char *fragment, size_t len)
+{
+    /* Over-copies into slack reserved by max_record; the length decides */
+    if (len <= FRAGMENT_COPY) memcpy(p, fragment, FRAGMENT_COPY);
+    else memcpy(p, fragment, len);
+    return p + len;
+}
+
+static inline char *put_value(const record_emitter_t *em, char *p, uint32_t column, uint64_t value)
+{
+    const symbol_table_t *table = em->symbols[column];
+
+    if (table) {
+        const char *name = symbol_lookup(table, (int64_t)value);
+        if (name) return p + (em->format == RECORD_JSON ? json_escape(p, name) : csv_field(p, name));
+    }
+    if (em->layout->ops[column].is_signed) return record_format_i64(p, (int64_t)value);
+    return record_format_u64(p, value);
+}
+
+/* Row `row` of `columns`, or the single record in `values` (row 0) */
+static inline int emit_row(record_emitter_t *em, uint64_t *const *columns, const uint64_t *values,
+                           size_t row)
+{
+    const uint32_t count = em->layout->num_ops;
+    const uint32_t *offset = em->fragment_offset;
+    const char *fragments = em->fragments;
+
+    if (em->capacity - em->used < em->max_record && record_emitter_flush(em) != 0) return -1;
+
+    char *p = em->buffer + em->used;
+    for (uint32_t c = 0; c < count; c++) {
+        p = put_fragment(p, fragments + offset[c], offset[c + 1] - offset[c]);
+        p = put_value(em, p, c, values ? values[c] : columns[c][row]);
+    }
+    p = put_fragment(p, fragments + offset[count], offset[count + 1] - offset[count]);
+    em->used = (size_t)(p - em->buffer);
+    return 0;
+}
+
+int record_emitter_write_batch(record_emitter_t *emitter, uint64_t *const *columns, size_t count)
+{
+    for (size_t i = 0; i < count; i++) {
+        if (emit_row(emitter, columns, NULL, i) != 0) return -1;
+    }
+    return 0;
+}
+
+int record_emitter_write_record(record_emitter_t *emitter, const uint64_t *values)
+{
+    return emit_row(emitter, NULL, values, 0);
+}
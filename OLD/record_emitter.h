@@ -0,0 +1,106 @@
+#ifndef RECORD_EMITTER_H
+#define RECORD_EMITTER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "bitfield_decoder.h"
+#include "symbol_table.h"
+
+/**
+ * Serialises decoded records (bitfield_decode_batch() columns) as JSON
+ * lines or CSV.
+ *
+ * Everything that does not depend on the values is prepared once per
+ * layout: each column's key fragment (`{"name":` / `,"name":` for JSON,
+ * the separator for CSV) is stored in a single string and copied with one
+ * memcpy. Integers go through a two-digits-at-a-time table with a
+ * branchless digit count. Output accumulates in one large buffer that is
+ * reused and written with a single fwrite() when full, so the stream
+ * layer never copies.
+ *
+ * Columns with a symbol table are written as the symbol name (a JSON
+ * string, or a CSV field), falling back to the number for values without
+ * one.
+ */
+
+typedef enum record_format_t {
+    RECORD_JSON = 0,                /* one object per line */
+    RECORD_CSV = 1
+} record_format_t;
+
+#define RECORD_EMITTER_DEFAULT_BUFFER (1 << 20)
+
+typedef struct record_emitter_t {
+    const bitfield_layout_t *layout;
+    record_format_t format;
+    FILE *out;
+
+    char *fragments;                /* all key fragments back to back */
+    uint32_t *fragment_offset;      /* num_ops + 2: fragment c, then the record trailer */
+    const symbol_table_t **symbols; /* per column, NULL for numbers */
+    size_t max_record;              /* bound for a record without symbol names */
+
+    char *buffer;
+    size_t capacity;
+    size_t used;
+    uint64_t bytes_written;
+    int error;
+} record_emitter_t;
+
+/**
+ * Prepare an emitter for `layout`, writing to `out`. `buffer_size` 0
+ * selects RECORD_EMITTER_DEFAULT_BUFFER. Returns 0 on success.
+ */
+int record_emitter_init(record_emitter_t *emitter, const bitfield_layout_t *layout,
+                        record_format_t format, FILE *out, size_t buffer_size);
+
+/**
+ * Flush and free the emitter's buffers.
+ */
+void record_emitter_destroy(record_emitter_t *emitter);
+
+/**
+ * Write column `column` as names from `table` (NULL: numbers again).
+ */
+void record_emitter_set_symbols(record_emitter_t *emitter, uint32_t column,
+                                const symbol_table_t *table);
+
+/**
+ * CSV header line with the column names (nothing for JSON).
+ */
+int record_emitter_header(record_emitter_t *emitter);
+
+/**
+ * Emit records [0, count) of columns as returned by bitfield_decode_batch().
+ * Returns 0, or -1 once a write has failed.
+ */
+int record_emitter_write_batch(record_emitter_t *emitter, uint64_t *const *columns, size_t count);
+
+/**
+ * Emit one record from bitfield_decode_record() values.
+ */
+int record_emitter_write_record(record_emitter_t *emitter, const uint64_t *values);
+
+/**
+ * Write out everything buffered. Returns 0 on success.
+ */
+int record_emitter_flush(record_emitter_t *emitter);
+
+/**
+ * Decimal text of `value` at `out` (no terminator). Returns the end.
+ * `out` needs 20 bytes (21 for the signed form).
+ */
+char *record_format_u64(char *out, uint64_t value);
+char *record_format_i64(char *out, int64_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RECORD_EMITTER_H
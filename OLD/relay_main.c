@@ -0,0 +1,171 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "pcap_writer.h"
+#include "relay_server.h"
+#include "stats_counters.h"
+
+/**
+ * Server-mode counterpart of threaded_ether_relay.py:
+ *
+ *   relay_main [port] [loops] [pool_threads] [pcap_prefix]
+ *
+ * Every valid frame is echoed back to its sender. With pool_threads > 0
+ * each frame is copied and checksummed on the pool first, standing in for
+ * work too heavy for the loop thread, and the echo is posted back.
+ *
+ * With a pcap_prefix every received frame is also recorded to rotating
+ * pcapng segments (link type USER0) instead of print_hex_words output.
+ */
+
+static volatile sig_atomic_t g_keepRunning = 1;
+
+static relay_server_t g_server;
+
+static pcap_writer_t g_pcap;
+static int g_pcap_enabled = 0;
+
+static stats_registry_t g_stats;
+
+void handle_sigint(int sig)
+{
+    (void)sig; // unused
+    g_keepRunning = 0;
+}
+
+typedef struct echo_job_t {
+    relay_conn_ref_t ref;
+    size_t len;
+    unsigned char data[];
+} echo_job_t;
+
+/**
+ * Pool task: "process" the frame, then hand the reply back to its loop.
+ */
+static void echo_task(void *arg)
+{
+    echo_job_t *job = (echo_job_t *)arg;
+
+    unsigned int checksum = 0;
+    for (size_t i = 0; i < job->len; i++) {
+        checksum = (checksum << 1 | checksum >> 31) ^ job->data[i];
+    }
+    (void)checksum;
+
+    relay_server_post(&g_server, job->ref, job->data, job->len, 1);
+    free(job);
+}
+
+static void on_frame(relay_conn_t *conn, const frame_view_t *frame, void *user)
+{
+    (void)user;
+    thread_pool_t *pool = relay_server_pool(conn);
+
+    if (g_pcap_enabled) {
+        pcap_writer_write(&g_pcap, 0, frame->data, frame->length, frame->length);
+    }
+
+    if (!pool) {
+        if (relay_conn_send(conn, frame->data, frame->length) == 0) relay_conn_note_frames(conn, 1);
+        return;
+    }
+
+    echo_job_t *job = (echo_job_t *)malloc(sizeof(*job) + frame->length);
+    if (!job) return;
+    job->ref = relay_conn_get_ref(conn);
+    job->len = frame->length;
+    memcpy(job->data, frame->data, frame->length);
+    if (thread_pool_add_task(pool, echo_task, job) != 0) echo_task(job);
+}
+
+/*
+ * This driver has no log_compression_thread, so segments stay as written;
+ * a program that runs one passes log_compression_enqueue instead.
+ */
+static void on_segment(void *ctx, const char *path)
+{
+    (void)ctx;
+    printf("[Main] Capture segment closed: %s\n", path);
+}
+
+static void export_stats(void *ctx, const stats_snapshot_t *current,
+                         const stats_snapshot_t *previous)
+{
+    (void)ctx;
+    stats_snapshot_print(current, previous, stdout);
+}
+
+int main(int argc, char **argv)
+{
+    unsigned short port = argc > 1 ? (unsigned short)atoi(argv[1]) : 4200;
+    int loops = argc > 2 ? atoi(argv[2]) : 0;
+    int pool_threads = argc > 3 ? atoi(argv[3]) : 0;
+    const char *pcap_prefix = argc > 4 ? argv[4] : NULL;
+
+    signal(SIGINT, handle_sigint);
+    signal(SIGTERM, handle_sigint);
+
+    thread_pool_t pool;
+    relay_server_config_t config;
+    relay_server_config_default(&config, port);
+    config.num_loops = loops;
+    config.on_frame = on_frame;
+    if (stats_registry_init(&g_stats) == 0) config.stats = &g_stats;
+    if (pool_threads > 0) {
+        thread_pool_init(&pool, pool_threads);
+        config.pool = &pool;
+    }
+
+    if (pcap_prefix) {
+        pcap_writer_config_t pcap_config;
+        pcap_writer_config_default(&pcap_config, pcap_prefix);
+        pcap_config.link_type = PCAP_LINKTYPE_USER0;
+        pcap_config.on_segment = on_segment;
+        if (pcap_writer_open(&g_pcap, &pcap_config) != 0) {
+            if (pool_threads > 0) thread_pool_shutdown(&pool);
+            return 1;
+        }
+        g_pcap_enabled = 1;
+    }
+
+    if (relay_server_start(&g_server, &config) != 0) {
+        fprintf(stderr, "[Main] Failed to start relay server on port %u\n", port);
+        if (pool_threads > 0) thread_pool_shutdown(&pool);
+        if (g_pcap_enabled) pcap_writer_close(&g_pcap);
+        return 1;
+    }
+    printf("[Main] Relay listening on port %u with %d loops. Press Ctrl + C to stop.\n",
+           port, g_server.num_loops);
+    if (config.stats) stats_exporter_start(&g_stats, 1000, export_stats, NULL);
+
+    while (g_keepRunning) {
+        platform_sleep_ms(200);
+    }
+
+    /* Stop the pool first so no task posts to a stopped server */
+    if (pool_threads > 0) thread_pool_shutdown(&pool);
+    relay_server_stop(&g_server);
+    /* After the stop, so the loops have joined and the totals are final */
+    relay_server_stats_t s;
+    relay_server_get_stats(&g_server, &s);
+
+    printf("[Main] accepted=%llu idle_closed=%llu frames=%llu in=%llu out=%llu invalid=%llu\n",
+           (unsigned long long)s.accepted, (unsigned long long)s.idle_closed,
+           (unsigned long long)s.frames, (unsigned long long)s.bytes_in,
+           (unsigned long long)s.bytes_out, (unsigned long long)s.invalid_frames);
+    if (config.stats) stats_registry_destroy(&g_stats);
+
+    if (g_pcap_enabled) {
+        pcap_writer_close(&g_pcap);
+        /* The writer thread is gone, the counters are final */
+        pcap_writer_stats_t ps = g_pcap.stats;
+        printf("[Main] Captured %llu frames (%llu dropped) in %llu segments\n",
+               (unsigned long long)ps.packets, (unsigned long long)ps.dropped,
+               (unsigned long long)ps.segments);
+        if (g_pcap.failed) printf("[Main] Capture stopped early: a segment could not be opened or written\n");
+    }
+
+    printf("[Main] Relay shut down, exiting.\n");
+    return 0;
+}
@@ -0,0 +1,756 @@
+#define _GNU_SOURCE  // accept4, CPU_SET, pthread_setaffinity_np
+
+#include "relay_server.h"
+
+#if !defined(__linux__)
+#error "relay_server requires Linux (epoll, eventfd, SO_REUSEPORT)"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+
+/* =============================
+ * Internal types
+ * ============================= */
+
+struct relay_conn_t {
+    int fd;
+    uint32_t generation;
+    relay_loop_t *loop;
+    conn_entry_t *entry;
+    void *user;
+
+    frame_parser_t parser;
+
+    uint8_t *out;
+    size_t out_len;
+    size_t out_cap;
+
+    int closing;
+    int on_flush_list;
+    relay_conn_t *flush_next;
+
+    /* All connections of a loop, for shutdown */
+    relay_conn_t *prev;
+    relay_conn_t *next;
+};
+
+/* A block of bytes handed to a loop by relay_server_post() */
+typedef struct relay_post_t {
+    relay_conn_ref_t ref;
+    size_t len;
+    uint32_t frames;
+    struct relay_post_t *next;
+    uint8_t data[];
+} relay_post_t;
+
+struct relay_loop_t {
+    relay_server_t *server;
+    int index;
+    platform_thread_t thread;
+    int thread_started;
+
+    int epoll_fd;
+    int listen_fd;
+    int wake_fd;
+    int spare_fd;                   /* closed to accept and drop when out of fds */
+
+    /* Connections keyed by fd and generation, in LRU order for idle eviction */
+    conn_table_t table;
+    uint32_t next_generation;
+    unsigned long long now_ns;
+
+    relay_conn_t *all;
+    relay_conn_t *flush_list;
+
+    platform_mutex_t post_lock;
+    relay_post_t *post_head;
+    relay_post_t *post_tail;
+
+    /* Written by the loop thread only */
+    relay_server_stats_t stats;
+    stats_shard_t *shard;           /* in config.stats, NULL if not configured */
+};
+
+static inline void loop_count(relay_loop_t *loop, stat_id_t id, uint64_t n)
+{
+    if (loop->shard) stats_add(loop->shard, id, n);
+}
+
+/* epoll user data for the two non-connection descriptors */
+static char g_listen_tag;
+static char g_wake_tag;
+
+static void *loop_thread(void *arg);
+
+/* =============================
+ * Configuration
+ * ============================= */
+
+void relay_server_config_default(relay_server_config_t *config, unsigned short port)
+{
+    memset(config, 0, sizeof(*config));
+    config->port = port;
+    config->backlog = 1024;
+    config->num_loops = 0;
+    config->pin_loops = 1;
+    config->max_events = 256;
+    config->max_out_bytes = 4 * 1024 * 1024;
+    config->format = frame_format_relay(FRAME_ENDIAN_BIG);
+}
+
+/* =============================
+ * Socket helpers
+ * ============================= */
+
+static int open_listener(unsigned short port, int backlog)
+{
+    int fd = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int family = AF_INET6;
+    if (fd < 0) {
+        fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        family = AF_INET;
+    }
+    if (fd < 0) {
+        perror("relay_server: socket");
+        return -1;
+    }
+
+    int one = 1;
+    int zero = 0;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (setsockopt(fd, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) != 0) {
+        perror("relay_server: SO_REUSEPORT");
+        close(fd);
+        return -1;
+    }
+
+    int rc;
+    if (family == AF_INET6) {
+        /* Dual-stack, so IPv4 clients like the Python relay still connect */
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &zero, sizeof(zero));
+        struct sockaddr_in6 addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(port);
+        rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    } else {
+        struct sockaddr_in addr;
+        memset(&addr, 0, sizeof(addr));
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        addr.sin_port = htons(port);
+        rc = bind(fd, (struct sockaddr *)&addr, sizeof(addr));
+    }
+    if (rc != 0 || listen(fd, backlog) != 0) {
+        perror("relay_server: bind/listen");
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+/* =============================
+ * Connection management
+ * ============================= */
+
+static relay_conn_t *conn_lookup(relay_loop_t *loop, int fd, uint32_t generation)
+{
+    conn_entry_t *entry = conn_table_find(&loop->table, conn_key_fd(fd, generation));
+    if (!entry) return NULL;
+    relay_conn_t *conn = (relay_conn_t *)entry->user;
+    return conn->closing ? NULL : conn;
+}
+
+/* A closing connection is already on the list, or being destroyed by it */
+static void schedule_flush(relay_conn_t *conn)
+{
+    if (conn->on_flush_list || conn->closing) return;
+    conn->on_flush_list = 1;
+    conn->flush_next = conn->loop->flush_list;
+    conn->loop->flush_list = conn;
+}
+
+static relay_conn_t *conn_open(relay_loop_t *loop, int fd)
+{
+    relay_conn_t *conn = (relay_conn_t *)calloc(1, sizeof(*conn));
+    if (!conn) return NULL;
+
+    if (frame_parser_init(&conn->parser, &loop->server->config.format) != 0) {
+        free(conn);
+        return NULL;
+    }
+    conn->fd = fd;
+    conn->loop = loop;
+    conn->generation = ++loop->next_generation;
+    conn->entry = conn_table_insert(&loop->table, conn_key_fd(fd, conn->generation), loop->now_ns);
+    if (!conn->entry) {
+        frame_parser_destroy(&conn->parser);
+        free(conn);
+        return NULL;
+    }
+    conn->entry->user = conn;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+    ev.data.ptr = conn;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        conn_table_remove(&loop->table, conn->entry);
+        frame_parser_destroy(&conn->parser);
+        free(conn);
+        return NULL;
+    }
+
+    conn->next = loop->all;
+    if (loop->all) loop->all->prev = conn;
+    loop->all = conn;
+
+    loop->stats.accepted++;
+    loop->stats.active++;
+    loop_count(loop, STAT_CONNECTIONS_OPENED, 1);
+    return conn;
+}
+
+static void conn_destroy(relay_conn_t *conn)
+{
+    relay_loop_t *loop = conn->loop;
+    relay_server_config_t *cfg = &loop->server->config;
+
+    if (cfg->on_close) cfg->on_close(conn, cfg->user);
+
+    /* Closed from its own on_flush, it may be queued for the next pass */
+    if (conn->on_flush_list) {
+        relay_conn_t **link = &loop->flush_list;
+        while (*link && *link != conn) link = &(*link)->flush_next;
+        if (*link) *link = conn->flush_next;
+    }
+
+    /* Fold the parser's counters into the loop before they disappear */
+    loop->stats.invalid_frames += conn->parser.stats.invalid_frames;
+    loop->stats.resync_bytes += conn->parser.stats.resync_bytes;
+
+    epoll_ctl(loop->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+    close(conn->fd);
+    conn_table_remove(&loop->table, conn->entry);
+
+    if (conn->prev) conn->prev->next = conn->next;
+    else loop->all = conn->next;
+    if (conn->next) conn->next->prev = conn->prev;
+
+    frame_parser_destroy(&conn->parser);
+    free(conn->out);
+    free(conn);
+
+    loop->stats.closed++;
+    loop->stats.active--;
+    loop_count(loop, STAT_CONNECTIONS_CLOSED, 1);
+}
+
+/* =============================
+ * Public connection API
+ * ============================= */
+
+int relay_conn_send(relay_conn_t *conn, const void *data, size_t len)
+{
+    if (!conn || conn->closing) return -1;
+
+    size_t need = conn->out_len + len;
+    if (need > conn->loop->server->config.max_out_bytes) {
+        /* Slow reader: drop it rather than buffer without bound */
+        relay_conn_close(conn);
+        return -1;
+    }
+    if (need > conn->out_cap) {
+        size_t cap = conn->out_cap ? conn->out_cap : 4096;
+        while (cap < need) cap *= 2;
+        uint8_t *grown = (uint8_t *)realloc(conn->out, cap);
+        if (!grown) return -1;
+        conn->out = grown;
+        conn->out_cap = cap;
+    }
+    memcpy(conn->out + conn->out_len, data, len);
+    conn->out_len += len;
+    schedule_flush(conn);
+    return 0;
+}
+
+void relay_conn_close(relay_conn_t *conn)
+{
+    if (!conn || conn->closing) return;
+    schedule_flush(conn);
+    conn->closing = 1;
+}
+
+int relay_conn_fd(const relay_conn_t *conn)
+{
+    return conn->fd;
+}
+
+size_t relay_conn_pending_output(const relay_conn_t *conn)
+{
+    return conn->out_len;
+}
+
+void relay_conn_note_output(relay_conn_t *conn, size_t bytes)
+{
+    conn->loop->stats.bytes_out += bytes;
+    loop_count(conn->loop, STAT_BYTES_OUT, bytes);
+}
+
+void relay_conn_note_frames(relay_conn_t *conn, uint32_t frames)
+{
+    loop_count(conn->loop, STAT_FRAMES_OUT, frames);
+    conn_table_stats(&conn->loop->table, conn->entry)->frames_out += frames;
+}
+
+relay_conn_ref_t relay_conn_get_ref(const relay_conn_t *conn)
+{
+    relay_conn_ref_t ref;
+    ref.loop = conn->loop->index;
+    ref.fd = conn->fd;
+    ref.generation = conn->generation;
+    return ref;
+}
+
+void relay_conn_get_stats(const relay_conn_t *conn, conn_stats_t *stats)
+{
+    *stats = *conn_table_stats(&conn->loop->table, conn->entry);
+    stats->invalid_frames = conn->parser.stats.invalid_frames;
+}
+
+void *relay_conn_get_user(const relay_conn_t *conn)
+{
+    return conn->user;
+}
+
+void relay_conn_set_user(relay_conn_t *conn, void *user)
+{
+    conn->user = user;
+}
+
+thread_pool_t *relay_server_pool(relay_conn_t *conn)
+{
+    return conn->loop->server->config.pool;
+}
+
+int relay_server_post(relay_server_t *server, relay_conn_ref_t ref, const void *data, size_t len,
+                      uint32_t frames)
+{
+    if (!server || ref.loop < 0 || ref.loop >= server->num_loops) return -1;
+
+    relay_loop_t *loop = &server->loops[ref.loop];
+    relay_post_t *post = (relay_post_t *)malloc(sizeof(*post) + len);
+    if (!post) return -1;
+    post->ref = ref;
+    post->len = len;
+    post->frames = frames;
+    post->next = NULL;
+    memcpy(post->data, data, len);
+
+    platform_mutex_lock(&loop->post_lock);
+    int was_empty = (loop->post_head == NULL);
+    if (loop->post_tail) loop->post_tail->next = post;
+    else loop->post_head = post;
+    loop->post_tail = post;
+    platform_mutex_unlock(&loop->post_lock);
+
+    /* Only the first post of a batch needs to wake the loop */
+    if (was_empty) {
+        uint64_t one = 1;
+        ssize_t rc = write(loop->wake_fd, &one, sizeof(one));
+        (void)rc;
+    }
+    return 0;
+}
+
+/* =============================
+ * Loop internals
+ * ============================= */
+
+static void on_parsed_frame(void *ctx, const frame_view_t *frame)
+{
+    relay_conn_t *conn = (relay_conn_t *)ctx;
+    relay_server_config_t *cfg = &conn->loop->server->config;
+
+    conn->loop->stats.frames++;
+    loop_count(conn->loop, STAT_FRAMES_IN, 1);
+    conn_table_stats(&conn->loop->table, conn->entry)->frames_in++;
+    if (cfg->on_frame && !conn->closing) cfg->on_frame(conn, frame, cfg->user);
+    if (cfg->on_flush) schedule_flush(conn);
+}
+
+static void handle_accept(relay_loop_t *loop)
+{
+    relay_server_config_t *cfg = &loop->server->config;
+
+    for (;;) {
+        int fd = accept4(loop->listen_fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR || errno == ECONNABORTED) continue;
+            if ((errno == EMFILE || errno == ENFILE) && loop->spare_fd >= 0) {
+                /*
+                 * Out of descriptors. Under EPOLLET the listener would not
+                 * report the pending connections again, so free the spare,
+                 * take one off the queue and close it, and go on draining.
+                 */
+                close(loop->spare_fd);
+                fd = accept4(loop->listen_fd, NULL, NULL, SOCK_CLOEXEC);
+                int err = errno;
+                if (fd >= 0) close(fd);
+                loop->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+                if (fd >= 0) {
+                    loop_count(loop, STAT_ERRORS, 1);
+                    fprintf(stderr, "relay_server: dropping connection, out of file descriptors\n");
+                    continue;
+                }
+                errno = err;
+            }
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("relay_server: accept4");
+            return;
+        }
+
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+        relay_conn_t *conn = conn_open(loop, fd);
+        if (!conn) {
+            fprintf(stderr, "relay_server: dropping connection, out of memory\n");
+            close(fd);
+            continue;
+        }
+        if (cfg->on_open) cfg->on_open(conn, cfg->user);
+    }
+}
+
+/* Move what the parser counted during one commit into the loop's shard */
+static void count_parser_errors(relay_loop_t *loop, const frame_parser_stats_t *before,
+                                const frame_parser_stats_t *after)
+{
+    if (after->resync_bytes == before->resync_bytes &&
+        after->invalid_frames == before->invalid_frames) {
+        return;
+    }
+    loop_count(loop, STAT_INVALID_FRAMES, after->invalid_frames - before->invalid_frames);
+    loop_count(loop, STAT_MARKER_MISMATCHES, after->marker_mismatches - before->marker_mismatches);
+    loop_count(loop, STAT_LENGTH_MISMATCHES, after->length_mismatches - before->length_mismatches);
+    loop_count(loop, STAT_RESYNC_BYTES, after->resync_bytes - before->resync_bytes);
+}
+
+static void handle_readable(relay_conn_t *conn)
+{
+    /* Edge-triggered: keep reading until the socket reports EAGAIN */
+    while (!conn->closing) {
+        size_t available;
+        uint8_t *dst = frame_parser_write_ptr(&conn->parser, &available);
+        ssize_t n = recv(conn->fd, dst, available, 0);
+        if (n > 0) {
+            conn->loop->stats.bytes_in += (uint64_t)n;
+            conn_table_stats(&conn->loop->table, conn->entry)->bytes_in += (uint64_t)n;
+            conn_table_touch(&conn->loop->table, conn->entry, conn->loop->now_ns);
+            loop_count(conn->loop, STAT_BYTES_IN, (uint64_t)n);
+
+            frame_parser_stats_t before = conn->parser.stats;
+            frame_parser_commit(&conn->parser, (size_t)n, on_parsed_frame, conn);
+            count_parser_errors(conn->loop, &before, &conn->parser.stats);
+            continue;
+        }
+        if (n == 0) {
+            relay_conn_close(conn);
+            return;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) {
+            loop_count(conn->loop, STAT_ERRORS, 1);
+            relay_conn_close(conn);
+        }
+        return;
+    }
+}
+
+/* Returns nonzero if unsent data remains (waiting for EPOLLOUT) */
+static int flush_conn(relay_conn_t *conn)
+{
+    size_t off = 0;
+    while (off < conn->out_len) {
+        ssize_t n = send(conn->fd, conn->out + off, conn->out_len - off, MSG_NOSIGNAL);
+        if (n > 0) {
+            off += (size_t)n;
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        loop_count(conn->loop, STAT_ERRORS, 1);
+        conn->closing = 1;
+        break;
+    }
+    conn->loop->stats.bytes_out += off;
+    loop_count(conn->loop, STAT_BYTES_OUT, off);
+    conn_table_stats(&conn->loop->table, conn->entry)->bytes_out += off;
+    if (off > 0) {
+        memmove(conn->out, conn->out + off, conn->out_len - off);
+        conn->out_len -= off;
+    }
+    return conn->out_len > 0;
+}
+
+static void drain_posts(relay_loop_t *loop)
+{
+    uint64_t counter;
+    ssize_t rc = read(loop->wake_fd, &counter, sizeof(counter));
+    (void)rc;
+
+    platform_mutex_lock(&loop->post_lock);
+    relay_post_t *post = loop->post_head;
+    loop->post_head = loop->post_tail = NULL;
+    platform_mutex_unlock(&loop->post_lock);
+
+    while (post) {
+        relay_post_t *next = post->next;
+        relay_conn_t *conn = conn_lookup(loop, post->ref.fd, post->ref.generation);
+        if (conn && relay_conn_send(conn, post->data, post->len) == 0) {
+            relay_conn_note_frames(conn, post->frames);
+            loop->stats.posted++;
+        }
+        free(post);
+        post = next;
+    }
+}
+
+static void run_flush_list(relay_loop_t *loop)
+{
+    relay_conn_t *conn = loop->flush_list;
+    loop->flush_list = NULL;
+
+    while (conn) {
+        relay_conn_t *next = conn->flush_next;
+        conn->on_flush_list = 0;
+        conn->flush_next = NULL;
+
+        if (conn->loop->server->config.on_flush && !conn->closing) {
+            conn->loop->server->config.on_flush(conn, conn->loop->server->config.user);
+        }
+
+        /* Unsent data stays buffered; EPOLLOUT puts it back on the list */
+        if (conn->out_len > 0) flush_conn(conn);
+        if (conn->closing) conn_destroy(conn);
+        conn = next;
+    }
+}
+
+static void on_idle(void *ctx, conn_entry_t *entry)
+{
+    relay_loop_t *loop = (relay_loop_t *)ctx;
+    loop->stats.idle_closed++;
+    relay_conn_close((relay_conn_t *)entry->user);
+}
+
+static void pin_to_cpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % platform_cpu_count(), &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+static void *loop_thread(void *arg)
+{
+    relay_loop_t *loop = (relay_loop_t *)arg;
+    relay_server_t *server = loop->server;
+    int max_events = server->config.max_events > 0 ? server->config.max_events : 256;
+
+    struct epoll_event *events = (struct epoll_event *)malloc(sizeof(*events) * max_events);
+    if (!events) {
+        fprintf(stderr, "relay_server: loop %d failed to allocate events\n", loop->index);
+        return NULL;
+    }
+    if (server->config.pin_loops) pin_to_cpu(loop->index);
+    if (server->config.stats) loop->shard = stats_register_shard(server->config.stats);
+    unsigned long long idle_ns = (unsigned long long)server->config.idle_timeout_ms * 1000000ULL;
+
+    while (server->keep_running) {
+        /* Timeout only bounds how long a stop request can go unnoticed */
+        int n = epoll_wait(loop->epoll_fd, events, max_events, 100);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            perror("relay_server: epoll_wait");
+            break;
+        }
+        loop->now_ns = platform_time_ns();
+
+        for (int i = 0; i < n; i++) {
+            void *tag = events[i].data.ptr;
+            if (tag == &g_listen_tag) {
+                handle_accept(loop);
+                continue;
+            }
+            if (tag == &g_wake_tag) {
+                drain_posts(loop);
+                continue;
+            }
+
+            relay_conn_t *conn = (relay_conn_t *)tag;
+            uint32_t ev = events[i].events;
+            if (ev & (EPOLLIN | EPOLLRDHUP | EPOLLHUP | EPOLLERR)) handle_readable(conn);
+            if (ev & (EPOLLHUP | EPOLLERR)) relay_conn_close(conn);
+            if ((ev & EPOLLOUT) && conn->out_len > 0) schedule_flush(conn);
+        }
+
+        /* Only connections past the timeout are visited */
+        conn_table_expire(&loop->table, loop->now_ns, idle_ns, on_idle, loop, 0);
+
+        /* One flush per connection per iteration coalesces pipelined replies */
+        run_flush_list(loop);
+    }
+
+    while (loop->all) conn_destroy(loop->all);
+    free(events);
+    return NULL;
+}
+
+/* =============================
+ * Server lifecycle
+ * ============================= */
+
+static void loop_close(relay_loop_t *loop)
+{
+    if (loop->epoll_fd >= 0) close(loop->epoll_fd);
+    if (loop->listen_fd >= 0) close(loop->listen_fd);
+    if (loop->wake_fd >= 0) close(loop->wake_fd);
+    if (loop->spare_fd >= 0) close(loop->spare_fd);
+
+    relay_post_t *post = loop->post_head;
+    while (post) {
+        relay_post_t *next = post->next;
+        free(post);
+        post = next;
+    }
+    platform_mutex_destroy(&loop->post_lock);
+    conn_table_destroy(&loop->table);
+}
+
+static int loop_open(relay_server_t *server, relay_loop_t *loop, int index)
+{
+    memset(loop, 0, sizeof(*loop));
+    loop->server = server;
+    loop->index = index;
+    loop->epoll_fd = loop->listen_fd = loop->wake_fd = loop->spare_fd = -1;
+    platform_mutex_init(&loop->post_lock);
+    loop->now_ns = platform_time_ns();
+    if (conn_table_init(&loop->table, 1024) != 0) return -1;
+
+    loop->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    loop->listen_fd = open_listener(server->config.port, server->config.backlog);
+    loop->wake_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    loop->spare_fd = open("/dev/null", O_RDONLY | O_CLOEXEC);
+    if (loop->epoll_fd < 0 || loop->listen_fd < 0 || loop->wake_fd < 0 || loop->spare_fd < 0) return -1;
+
+    struct epoll_event ev;
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &g_listen_tag;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->listen_fd, &ev) != 0) return -1;
+
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.ptr = &g_wake_tag;
+    if (epoll_ctl(loop->epoll_fd, EPOLL_CTL_ADD, loop->wake_fd, &ev) != 0) return -1;
+    return 0;
+}
+
+int relay_server_start(relay_server_t *server, const relay_server_config_t *config)
+{
+    if (!server || !config) return -1;
+
+    memset(server, 0, sizeof(*server));
+    server->config = *config;
+    server->num_loops = config->num_loops > 0 ? config->num_loops : platform_cpu_count();
+    server->loops = (relay_loop_t *)calloc(server->num_loops, sizeof(relay_loop_t));
+    if (!server->loops) {
+        fprintf(stderr, "relay_server_start: failed to allocate loops\n");
+        return -1;
+    }
+
+    int opened = 0;
+    for (; opened < server->num_loops; opened++) {
+        if (loop_open(server, &server->loops[opened], opened) != 0) {
+            loop_close(&server->loops[opened]);
+            break;
+        }
+    }
+    if (opened < server->num_loops) {
+        for (int i = 0; i < opened; i++) loop_close(&server->loops[i]);
+        free(server->loops);
+        server->loops = NULL;
+        return -1;
+    }
+
+    server->keep_running = 1;
+    for (int i = 0; i < server->num_loops; i++) {
+        relay_loop_t *loop = &server->loops[i];
+        if (platform_thread_create(&loop->thread, loop_thread, loop) != 0) {
+            fprintf(stderr, "relay_server_start: error creating loop thread %d\n", i);
+            relay_server_stop(server);
+            return -1;
+        }
+        loop->thread_started = 1;
+    }
+    return 0;
+}
+
+static void sum_loop_stats(const relay_server_t *server, relay_server_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    for (int i = 0; i < server->num_loops; i++) {
+        const relay_server_stats_t *s = &server->loops[i].stats;
+        stats->accepted += s->accepted;
+        stats->closed += s->closed;
+        stats->active += s->active;
+        stats->frames += s->frames;
+        stats->bytes_in += s->bytes_in;
+        stats->bytes_out += s->bytes_out;
+        stats->invalid_frames += s->invalid_frames;
+        stats->resync_bytes += s->resync_bytes;
+        stats->posted += s->posted;
+        stats->idle_closed += s->idle_closed;
+    }
+}
+
+void relay_server_stop(relay_server_t *server)
+{
+    if (!server || !server->loops) return;
+
+    server->keep_running = 0;
+    for (int i = 0; i < server->num_loops; i++) {
+        relay_loop_t *loop = &server->loops[i];
+        if (loop->thread_started) {
+            uint64_t one = 1;
+            ssize_t rc = write(loop->wake_fd, &one, sizeof(one));
+            (void)rc;
+            platform_thread_join(loop->thread);
+        }
+        loop_close(loop);
+    }
+    /* Kept for relay_server_get_stats() once the loops are gone */
+    sum_loop_stats(server, &server->final_stats);
+    free(server->loops);
+    server->loops = NULL;
+    server->num_loops = 0;
+}
+
+void relay_server_get_stats(relay_server_t *server, relay_server_stats_t *stats)
+{
+    if (!server->loops) {
+        *stats = server->final_stats;
+        return;
+    }
+    sum_loop_stats(server, stats);
+}
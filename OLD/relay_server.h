@@ -0,0 +1,206 @@
+#ifndef RELAY_SERVER_H
+#define RELAY_SERVER_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "platform.h"
+#include "threadpool.h"
+#include "frame_parser.h"
+#include "conn_table.h"
+#include "stats_counters.h"
+
+/**
+ * Native replacement for the server side of threaded_ether_relay.py (Linux only).
+ *
+ * Instead of a sender and receiver thread per client, the server runs one
+ * edge-triggered epoll loop per core. Each loop owns its own SO_REUSEPORT
+ * listening socket, so the kernel spreads new connections across loops and
+ * a connection never migrates. Sockets are non-blocking, frames are parsed
+ * on the loop thread, and only work the frame handler explicitly hands to
+ * the thread pool leaves it.
+ */
+
+typedef struct relay_conn_t relay_conn_t;
+typedef struct relay_loop_t relay_loop_t;
+typedef struct relay_server_t relay_server_t;
+
+/**
+ * Handle for referring to a connection from another thread. The generation
+ * makes a stale reference to a recycled file descriptor harmless.
+ */
+typedef struct relay_conn_ref_t {
+    int loop;
+    int fd;
+    uint32_t generation;
+} relay_conn_ref_t;
+
+/**
+ * Called on the loop thread for every complete frame. Must not block.
+ */
+typedef void (*relay_frame_handler_t)(relay_conn_t *conn, const frame_view_t *frame, void *user);
+
+/**
+ * Called on the loop thread when a connection opens or closes.
+ */
+typedef void (*relay_conn_handler_t)(relay_conn_t *conn, void *user);
+
+/**
+ * Server configuration.
+ *  - `on_flush` runs once per iteration for every connection that received
+ *    frames or queued output, just before its output is written. Handlers
+ *    that batch replies to pipelined frames emit them here.
+ *  - `num_loops` of 0 means one loop per online CPU.
+ *  - `pin_loops` pins loop i to CPU i.
+ *  - `max_out_bytes` bounds each connection's unsent data; a peer that
+ *    stops reading is disconnected rather than buffered without limit.
+ *  - `idle_timeout_ms` closes connections that have received nothing for
+ *    that long (0 disables it).
+ *  - `pool` is optional and only used by handlers via relay_server_pool().
+ *  - `stats` is optional; each loop then counts into its own shard of it.
+ */
+typedef struct relay_server_config_t {
+    unsigned short port;
+    int backlog;
+    int num_loops;
+    int pin_loops;
+    int max_events;
+    size_t max_out_bytes;
+    unsigned int idle_timeout_ms;
+    frame_format_t format;
+
+    relay_frame_handler_t on_frame;
+    relay_conn_handler_t on_open;
+    relay_conn_handler_t on_close;
+    relay_conn_handler_t on_flush;
+    void *user;
+
+    thread_pool_t *pool;
+    stats_registry_t *stats;
+} relay_server_config_t;
+
+/**
+ * Aggregate counters, summed across loops by relay_server_get_stats().
+ */
+typedef struct relay_server_stats_t {
+    uint64_t accepted;
+    uint64_t closed;
+    uint64_t active;
+    uint64_t frames;
+    uint64_t bytes_in;
+    uint64_t bytes_out;
+    uint64_t invalid_frames;
+    uint64_t resync_bytes;
+    uint64_t posted;
+    uint64_t idle_closed;
+} relay_server_stats_t;
+
+struct relay_server_t {
+    relay_server_config_t config;
+    relay_loop_t *loops;
+    int num_loops;
+    volatile int keep_running;
+    relay_server_stats_t final_stats;   /* totals as of relay_server_stop() */
+};
+
+/**
+ * Fill `config` with defaults for the relay frame format on `port`.
+ */
+void relay_server_config_default(relay_server_config_t *config, unsigned short port);
+
+/**
+ * Bind the listening sockets and start the loop threads.
+ * Returns 0 on success, nonzero on failure (nothing is left running).
+ */
+int relay_server_start(relay_server_t *server, const relay_server_config_t *config);
+
+/**
+ * Stop all loops, close every connection and join the loop threads.
+ */
+void relay_server_stop(relay_server_t *server);
+
+/**
+ * Snapshot of the counters. Values are read without locking and may be
+ * momentarily inconsistent with each other. After relay_server_stop()
+ * this returns the final totals.
+ */
+void relay_server_get_stats(relay_server_t *server, relay_server_stats_t *stats);
+
+/**
+ * Queue bytes on a connection. Loop thread only (i.e. from a handler).
+ * Data is flushed once per loop iteration, so several small replies to
+ * pipelined frames leave in one system call. Returns 0 on success, nonzero
+ * if the connection is closing or over its output limit.
+ */
+int relay_conn_send(relay_conn_t *conn, const void *data, size_t len);
+
+/**
+ * Close a connection after the current iteration. Loop thread only.
+ */
+void relay_conn_close(relay_conn_t *conn);
+
+/**
+ * The connection's socket, for handlers that write directly (e.g. writev
+ * from on_flush). Only write when relay_conn_pending_output() is 0, and
+ * queue any unsent remainder with relay_conn_send() to keep ordering.
+ */
+int relay_conn_fd(const relay_conn_t *conn);
+
+/**
+ * Bytes queued by relay_conn_send() that are not yet written.
+ */
+size_t relay_conn_pending_output(const relay_conn_t *conn);
+
+/**
+ * Count bytes a handler wrote directly to relay_conn_fd() in the stats.
+ */
+void relay_conn_note_output(relay_conn_t *conn, size_t bytes);
+
+/**
+ * Count `frames` frames a handler sent to this connection, by any route
+ * (relay_conn_send() or writes to relay_conn_fd()), as frames out.
+ * relay_conn_send() deals in bytes and counts none itself. Loop thread
+ * only.
+ */
+void relay_conn_note_frames(relay_conn_t *conn, uint32_t frames);
+
+/**
+ * Reference for use from other threads (e.g. pool tasks).
+ */
+relay_conn_ref_t relay_conn_get_ref(const relay_conn_t *conn);
+
+/**
+ * Counters of one connection. Loop thread only.
+ */
+void relay_conn_get_stats(const relay_conn_t *conn, conn_stats_t *stats);
+
+/**
+ * Per-connection user pointer, initially NULL.
+ */
+void *relay_conn_get_user(const relay_conn_t *conn);
+void relay_conn_set_user(relay_conn_t *conn, void *user);
+
+/**
+ * The pool from the configuration, for handing heavy work off the loop.
+ */
+thread_pool_t *relay_server_pool(relay_conn_t *conn);
+
+/**
+ * Send bytes to a connection from any thread. The data is copied and
+ * handed to the owning loop, which writes it on its next iteration; it is
+ * dropped silently if the connection has gone. `frames` is how many
+ * frames the data holds, counted as frames out once it is queued on the
+ * connection. Returns 0 if queued.
+ */
+int relay_server_post(relay_server_t *server, relay_conn_ref_t ref, const void *data, size_t len,
+                      uint32_t frames);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // RELAY_SERVER_H
@@ -0,0 +1,577 @@
+#include "seekable_log.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <zlib.h>
+
+#include "log_reader.h"
+
+/* Index entry on disk: offset, compressed size, size, min, max, lead */
+#define ENTRY_SIZE 40
+
+/* gzip header with FEXTRA: magic, CM, FLG, MTIME, XFL, OS, then XLEN */
+#define GZIP_HEADER 12
+/* A deflate stream with nothing in it, then CRC32 and ISIZE of nothing */
+#define EMPTY_BODY 10
+
+#define LOCATOR_MAGIC 0x31584C53U   /* "SLX1" */
+
+/* Frames are limited by the 32-bit sizes in the index */
+#define MAX_FRAME_BYTES (1U << 30)
+
+/* =============================
+ * Little-endian fields
+ * ============================= */
+
+static inline void put_u16(unsigned char *p, uint32_t v)
+{
+    p[0] = (unsigned char)v;
+    p[1] = (unsigned char)(v >> 8);
+}
+
+static inline void put_u32(unsigned char *p, uint32_t v)
+{
+    put_u16(p, v & 0xFFFF);
+    put_u16(p + 2, v >> 16);
+}
+
+static inline void put_u64(unsigned char *p, uint64_t v)
+{
+    put_u32(p, (uint32_t)v);
+    put_u32(p + 4, (uint32_t)(v >> 32));
+}
+
+static inline uint32_t get_u16(const unsigned char *p)
+{
+    return (uint32_t)p[0] | (uint32_t)p[1] << 8;
+}
+
+static inline uint32_t get_u32(const unsigned char *p)
+{
+    return get_u16(p) | get_u16(p + 2) << 16;
+}
+
+static inline uint64_t get_u64(const unsigned char *p)
+{
+    return (uint64_t)get_u32(p) | (uint64_t)get_u32(p + 4) << 32;
+}
+
+/* Header of an empty member whose FEXTRA holds one subfield of `len` bytes */
+static void put_empty_header(unsigned char *p, char si1, char si2, uint32_t len)
+{
+    static const unsigned char fixed[10] = { 0x1f, 0x8b, 8, 4, 0, 0, 0, 0, 0, 255 };
+    memcpy(p, fixed, sizeof(fixed));
+    put_u16(p + 10, len + 4);
+    p[12] = (unsigned char)si1;
+    p[13] = (unsigned char)si2;
+    put_u16(p + 14, len);
+}
+
+static void put_empty_body(unsigned char *p)
+{
+    memset(p, 0, EMPTY_BODY);
+    p[0] = 0x03;
+}
+
+/* Checks an empty member at p (`avail` bytes) carrying subfield si1 si2; returns its data length */
+static int check_empty_member(const unsigned char *p, size_t avail, char si1, char si2, uint32_t *len)
+{
+    static const unsigned char fixed[4] = { 0x1f, 0x8b, 8, 4 };
+    static const unsigned char body[EMPTY_BODY] = { 0x03 };
+
+    if (avail < GZIP_HEADER + 4 + EMPTY_BODY || memcmp(p, fixed, sizeof(fixed)) != 0) return -1;
+    uint32_t xlen = get_u16(p + 10);
+    if (xlen < 4 || p[12] != (unsigned char)si1 || p[13] != (unsigned char)si2) return -1;
+    *len = get_u16(p + 14);
+    if (*len + 4 != xlen || avail < GZIP_HEADER + xlen + EMPTY_BODY) return -1;
+    if (memcmp(p + GZIP_HEADER + xlen, body, EMPTY_BODY) != 0) return -1;
+    return 0;
+}
+
+/* =============================
+ * Writing
+ * ============================= */
+
+static int write_all(seekable_log_writer_t *writer, const void *data, size_t len)
+{
+    const char *p = (const char *)data;
+
+    while (len > 0 && !writer->error) {
+        ssize_t n = write(writer->fd, p, len);
+        if (n < 0 && errno == EINTR) continue;
+        if (n <= 0) {
+            fprintf(stderr, "seekable_log: write failed: %s\n", strerror(errno));
+            writer->error = 1;
+            break;
+        }
+        p += n;
+        len -= (size_t)n;
+        writer->offset += (uint64_t)n;
+    }
+    return writer->error ? -1 : 0;
+}
+
+static void reset_frame_times(seekable_log_writer_t *writer)
+{
+    writer->min_ts = INT64_MAX;
+    writer->max_ts = INT64_MIN;
+}
+
+/* Compresses pending[frame_start, end) as one member and indexes it */
+static int emit_frame(seekable_log_writer_t *writer, size_t end)
+{
+    z_stream *zs = (z_stream *)writer->stream;
+    size_t len = end - writer->frame_start;
+
+    if (len == 0 || writer->error) return writer->error ? -1 : 0;
+
+    size_t bound = deflateBound(zs, (uLong)len);
+    if (writer->out_cap < bound) {
+        unsigned char *grown = (unsigned char *)realloc(writer->out, bound);
+        if (!grown) {
+            writer->error = 1;
+            return -1;
+        }
+        writer->out = grown;
+        writer->out_cap = bound;
+    }
+    if (writer->num_frames == writer->frames_cap) {
+        uint32_t cap = writer->frames_cap ? writer->frames_cap * 2 : 64;
+        seekable_log_frame_t *grown = (seekable_log_frame_t *)realloc(writer->frames, cap * sizeof(*grown));
+        if (!grown) {
+            writer->error = 1;
+            return -1;
+        }
+        writer->frames = grown;
+        writer->frames_cap = cap;
+    }
+
+    deflateReset(zs);
+    zs->next_in = (Bytef *)(writer->pending + writer->frame_start);
+    zs->avail_in = (uInt)len;
+    zs->next_out = writer->out;
+    zs->avail_out = (uInt)writer->out_cap;
+    if (deflate(zs, Z_FINISH) != Z_STREAM_END) {
+        fprintf(stderr, "seekable_log: deflate failed\n");
+        writer->error = 1;
+        return -1;
+    }
+
+    seekable_log_frame_t *frame = &writer->frames[writer->num_frames++];
+    frame->offset = writer->offset;
+    frame->compressed_size = (uint32_t)zs->total_out;
+    frame->size = (uint32_t)len;
+    frame->min_ts_us = writer->min_ts;
+    frame->max_ts_us = writer->max_ts;
+    frame->lead_ts_us = writer->lead_ts;
+    writer->frame_start = end;
+    writer->lead_ts = writer->last_ts;
+    reset_frame_times(writer);
+    return write_all(writer, writer->out, zs->total_out);
+}
+
+/*
+ * Looks at each complete line from `scanned` on and cuts a frame in
+ * front of it when it is due: at frame_bytes in front of a timestamped
+ * line, at twice that in front of any line.
+ */
+static int scan_lines(seekable_log_writer_t *writer, int final)
+{
+    while (writer->scanned < writer->pending_len) {
+        const char *line = writer->pending + writer->scanned;
+        size_t avail = writer->pending_len - writer->scanned;
+        const char *nl = (const char *)memchr(line, '\n', avail);
+        if (!nl && !final) break;
+
+        size_t len = nl ? (size_t)(nl - line) : avail;
+        size_t in_frame = writer->scanned - writer->frame_start;
+        int64_t ts;
+        int has_ts = log_parse_timestamp(line, len, &ts);
+
+        if (in_frame >= writer->frame_bytes && (has_ts || in_frame >= 2 * writer->frame_bytes)) {
+            if (emit_frame(writer, writer->scanned) != 0) return -1;
+        }
+        if (!has_ts && writer->scanned == writer->frame_start) ts = writer->last_ts;
+        if (has_ts || writer->scanned == writer->frame_start) {
+            if (ts != INT64_MIN) {
+                if (ts < writer->min_ts) writer->min_ts = ts;
+                if (ts > writer->max_ts) writer->max_ts = ts;
+            }
+        }
+        if (has_ts) writer->last_ts = ts;
+        writer->scanned += nl ? len + 1 : len;
+    }
+    return 0;
+}
+
+int seekable_log_writer_open(seekable_log_writer_t *writer, const char *path, size_t frame_bytes, int level)
+{
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = -1;
+    writer->level = level;
+    writer->frame_bytes = frame_bytes ? frame_bytes : SEEKABLE_LOG_DEFAULT_FRAME;
+    if (writer->frame_bytes > MAX_FRAME_BYTES / 2) writer->frame_bytes = MAX_FRAME_BYTES / 2;
+    writer->last_ts = INT64_MIN;
+    writer->lead_ts = INT64_MIN;
+    reset_frame_times(writer);
+
+    z_stream *zs = (z_stream *)calloc(1, sizeof(z_stream));
+    if (!zs || deflateInit2(zs, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) != Z_OK) {
+        fprintf(stderr, "seekable_log_writer_open: cannot set up deflate\n");
+        free(zs);
+        return -1;
+    }
+    writer->stream = zs;
+
+    writer->fd = open(path, O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    if (writer->fd < 0) {
+        fprintf(stderr, "seekable_log_writer_open: cannot create %s: %s\n", path, strerror(errno));
+        deflateEnd(zs);
+        free(zs);
+        writer->stream = NULL;
+        return -1;
+    }
+    return 0;
+}
+
+int seekable_log_write(seekable_log_writer_t *writer, const void *data, size_t len)
+{
+    if (writer->error) return -1;
+
+    if (writer->pending_cap - writer->pending_len < len) {
+        /* Drop the frames already written before growing */
+        size_t keep = writer->pending_len - writer->frame_start;
+        memmove(writer->pending, writer->pending + writer->frame_start, keep);
+        writer->scanned -= writer->frame_start;
+        writer->pending_len = keep;
+        writer->frame_start = 0;
+    }
+    if (writer->pending_cap - writer->pending_len < len) {
+        size_t cap = writer->pending_cap ? writer->pending_cap : 2 * writer->frame_bytes + 4096;
+        while (cap - writer->pending_len < len) cap *= 2;
+        char *grown = (char *)realloc(writer->pending, cap);
+        if (!grown) {
+            writer->error = 1;
+            return -1;
+        }
+        writer->pending = grown;
+        writer->pending_cap = cap;
+    }
+    memcpy(writer->pending + writer->pending_len, data, len);
+    writer->pending_len += len;
+    return scan_lines(writer, 0);
+}
+
+static int write_index(seekable_log_writer_t *writer)
+{
+    const uint64_t index_offset = writer->offset;
+    unsigned char *member = (unsigned char *)malloc(GZIP_HEADER + 4 + ENTRY_SIZE * SEEKABLE_LOG_ENTRIES_PER_MEMBER +
+                                                    EMPTY_BODY);
+    if (!member) return -1;
+
+    uint32_t i = 0;
+    do {
+        uint32_t n = writer->num_frames - i;
+        if (n > SEEKABLE_LOG_ENTRIES_PER_MEMBER) n = SEEKABLE_LOG_ENTRIES_PER_MEMBER;
+        unsigned char *p = member + GZIP_HEADER + 4;
+
+        put_empty_header(member, 'L', 'I', n * ENTRY_SIZE);
+        for (uint32_t k = 0; k < n; k++, p += ENTRY_SIZE) {
+            const seekable_log_frame_t *frame = &writer->frames[i + k];
+            put_u64(p, frame->offset);
+            put_u32(p + 8, frame->compressed_size);
+            put_u32(p + 12, frame->size);
+            put_u64(p + 16, (uint64_t)frame->min_ts_us);
+            put_u64(p + 24, (uint64_t)frame->max_ts_us);
+            put_u64(p + 32, (uint64_t)frame->lead_ts_us);
+        }
+        put_empty_body(p);
+        write_all(writer, member, (size_t)(p + EMPTY_BODY - member));
+        i += n;
+    } while (i < writer->num_frames);
+    free(member);
+
+    unsigned char locator[SEEKABLE_LOG_LOCATOR_SIZE];
+    put_empty_header(locator, 'L', 'L', 16);
+    put_u64(locator + 16, index_offset);
+    put_u32(locator + 24, writer->num_frames);
+    put_u32(locator + 28, LOCATOR_MAGIC);
+    put_empty_body(locator + 32);
+    return write_all(writer, locator, sizeof(locator));
+}
+
+int seekable_log_writer_close(seekable_log_writer_t *writer)
+{
+    int rc = -1;
+
+    if (writer->fd >= 0 && !writer->error && scan_lines(writer, 1) == 0 &&
+        emit_frame(writer, writer->pending_len) == 0 && write_index(writer) == 0) {
+        rc = 0;
+    }
+    if (writer->fd >= 0 && close(writer->fd) != 0) rc = -1;
+    if (writer->stream) deflateEnd((z_stream *)writer->stream);
+    free(writer->stream);
+    free(writer->pending);
+    free(writer->out);
+    free(writer->frames);
+    memset(writer, 0, sizeof(*writer));
+    writer->fd = -1;
+    return rc;
+}
+
+int seekable_log_compress_file(const char *in_path, const char *out_path, size_t frame_bytes, int level)
+{
+    /* gzread() passes plain files through, so a .gz can be recompressed too */
+    gzFile in = gzopen(in_path, "rb");
+    if (!in) {
+        fprintf(stderr, "seekable_log_compress_file: cannot open %s\n", in_path);
+        return -1;
+    }
+    gzbuffer(in, 64 * 1024);
+
+    seekable_log_writer_t writer;
+    if (seekable_log_writer_open(&writer, out_path, frame_bytes, level) != 0) {
+        gzclose(in);
+        return -1;
+    }
+
+    char buffer[64 * 1024];
+    int got, err = Z_OK;
+    int rc = 0;
+    while (rc == 0 && (got = gzread(in, buffer, sizeof(buffer))) > 0) {
+        rc = seekable_log_write(&writer, buffer, (size_t)got);
+    }
+    gzerror(in, &err);
+    if (err != Z_OK) {
+        fprintf(stderr, "seekable_log_compress_file: cannot read %s\n", in_path);
+        rc = -1;
+    }
+    gzclose(in);
+    if (seekable_log_writer_close(&writer) != 0) rc = -1;
+    return rc;
+}
+
+/* =============================
+ * Reading
+ * ============================= */
+
+int seekable_log_open(seekable_log_t *log, const char *path)
+{
+    struct stat st;
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+
+    memset(log, 0, sizeof(*log));
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        fprintf(stderr, "seekable_log_open: cannot open %s: %s\n", path, strerror(errno));
+        if (fd >= 0) close(fd);
+        return -1;
+    }
+    if ((size_t)st.st_size < SEEKABLE_LOG_LOCATOR_SIZE) {
+        close(fd);
+        return 1;
+    }
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "seekable_log_open: mmap of %s failed: %s\n", path, strerror(errno));
+        return -1;
+    }
+    log->map = (const unsigned char *)map;
+    log->map_size = (size_t)st.st_size;
+
+    const unsigned char *locator = log->map + log->map_size - SEEKABLE_LOG_LOCATOR_SIZE;
+    uint32_t len;
+    if (check_empty_member(locator, SEEKABLE_LOG_LOCATOR_SIZE, 'L', 'L', &len) != 0 || len != 16 ||
+        get_u32(locator + 28) != LOCATOR_MAGIC) {
+        seekable_log_close(log);
+        return 1;
+    }
+    const uint64_t index_offset = get_u64(locator + 16);
+    const uint32_t count = get_u32(locator + 24);
+    const size_t index_end = log->map_size - SEEKABLE_LOG_LOCATOR_SIZE;
+
+    log->frames = (seekable_log_frame_t *)malloc(sizeof(seekable_log_frame_t) * (count ? count : 1));
+    if (!log->frames || index_offset > index_end) {
+        fprintf(stderr, "seekable_log_open: bad index in %s\n", path);
+        seekable_log_close(log);
+        return -1;
+    }
+
+    size_t pos = (size_t)index_offset;
+    while (log->num_frames < count) {
+        if (check_empty_member(log->map + pos, index_end - pos, 'L', 'I', &len) != 0 || len % ENTRY_SIZE != 0 ||
+            len == 0 || log->num_frames + len / ENTRY_SIZE > count) {
+            fprintf(stderr, "seekable_log_open: bad index in %s\n", path);
+            seekable_log_close(log);
+            return -1;
+        }
+        const unsigned char *p = log->map + pos + GZIP_HEADER + 4;
+        for (uint32_t k = 0; k < len / ENTRY_SIZE; k++, p += ENTRY_SIZE) {
+            seekable_log_frame_t *frame = &log->frames[log->num_frames++];
+            frame->offset = get_u64(p);
+            frame->compressed_size = get_u32(p + 8);
+            frame->size = get_u32(p + 12);
+            frame->min_ts_us = (int64_t)get_u64(p + 16);
+            frame->max_ts_us = (int64_t)get_u64(p + 24);
+            frame->lead_ts_us = (int64_t)get_u64(p + 32);
+            if (frame->offset > index_offset || frame->compressed_size > index_offset - frame->offset) {
+                fprintf(stderr, "seekable_log_open: bad index in %s\n", path);
+                seekable_log_close(log);
+                return -1;
+            }
+        }
+        pos += GZIP_HEADER + 4 + len + EMPTY_BODY;
+    }
+    return 0;
+}
+
+void seekable_log_close(seekable_log_t *log)
+{
+    if (log->map) munmap((void *)log->map, log->map_size);
+    free(log->frames);
+    memset(log, 0, sizeof(*log));
+}
+
+int seekable_log_read_frame(const seekable_log_t *log, uint32_t index, char *out)
+{
+    const seekable_log_frame_t *frame = &log->frames[index];
+    z_stream zs;
+
+    memset(&zs, 0, sizeof(zs));
+    if (inflateInit2(&zs, 15 + 16) != Z_OK) return -1;
+    zs.next_in = (Bytef *)(log->map + frame->offset);
+    zs.avail_in = frame->compressed_size;
+    zs.next_out = (Bytef *)out;
+    zs.avail_out = frame->size;
+    int rc = inflate(&zs, Z_FINISH);
+    int ok = rc == Z_STREAM_END && zs.total_out == frame->size;
+    inflateEnd(&zs);
+    return ok ? 0 : -1;
+}
+
+/* =============================
+ * Queries
+ * ============================= */
+
+typedef struct query_frame_t {
+    const seekable_log_t *log;
+    uint32_t index;
+    char *data;
+    int error;
+    platform_mutex_t *lock;
+    platform_cond_t *idle;
+    size_t *outstanding;
+} query_frame_t;
+
+static void inflate_task(void *arg)
+{
+    query_frame_t *qf = (query_frame_t *)arg;
+
+    qf->data = (char *)malloc(qf->log->frames[qf->index].size + 1);
+    qf->error = !qf->data || seekable_log_read_frame(qf->log, qf->index, qf->data) != 0;
+
+    if (qf->lock) {
+        platform_mutex_lock(qf->lock);
+        if (--*qf->outstanding == 0) platform_cond_broadcast(qf->idle);
+        platform_mutex_unlock(qf->lock);
+    }
+}
+
+/* Passes the records of one inflated frame that fall in the window; nonzero stops */
+static int filter_frame(const seekable_log_frame_t *frame, const char *data, int64_t from_us, int64_t to_us,
+                        seekable_log_line_t sink, void *ctx, uint64_t *lines)
+{
+    const char *p = data, *end = data + frame->size;
+    int64_t ts = frame->lead_ts_us;
+
+    while (p < end) {
+        const char *nl = (const char *)memchr(p, '\n', (size_t)(end - p));
+        size_t len = nl ? (size_t)(nl - p) : (size_t)(end - p);
+        int64_t line_ts;
+        if (log_parse_timestamp(p, len, &line_ts)) ts = line_ts;
+        if (ts >= from_us && ts <= to_us) {
+            (*lines)++;
+            if (sink(ctx, p, len, ts) != 0) return 1;
+        }
+        p += len + 1;
+    }
+    return 0;
+}
+
+int seekable_log_query(const seekable_log_t *log, int64_t from_us, int64_t to_us, thread_pool_t *pool,
+                       seekable_log_line_t sink, void *ctx, seekable_log_query_stats_t *stats)
+{
+    const size_t batch = pool && pool->num_threads > 0 ? (size_t)pool->num_threads * 2 : 1;
+    query_frame_t *frames = (query_frame_t *)calloc(batch, sizeof(query_frame_t));
+    seekable_log_query_stats_t local;
+    platform_mutex_t lock;
+    platform_cond_t idle;
+    size_t outstanding = 0;
+    uint32_t next = 0;
+    int rc = 0, stopped = 0;
+
+    memset(&local, 0, sizeof(local));
+    if (!frames) return -1;
+    if (batch > 1) {
+        platform_mutex_init(&lock);
+        platform_cond_init(&idle);
+    }
+
+    while (next < log->num_frames && !stopped) {
+        /* The next `batch` frames that overlap the window, inflated together */
+        size_t n = 0;
+        for (; next < log->num_frames && n < batch; next++) {
+            const seekable_log_frame_t *frame = &log->frames[next];
+            if (frame->max_ts_us < from_us || frame->min_ts_us > to_us) continue;
+            memset(&frames[n], 0, sizeof(frames[n]));
+            frames[n].log = log;
+            frames[n].index = next;
+            if (batch > 1) {
+                frames[n].lock = &lock;
+                frames[n].idle = &idle;
+                frames[n].outstanding = &outstanding;
+            }
+            n++;
+        }
+        if (n == 0) break;
+
+        if (batch > 1) {
+            outstanding = n;
+            for (size_t i = 0; i < n; i++) {
+                if (thread_pool_add_task(pool, inflate_task, &frames[i]) != 0) inflate_task(&frames[i]);
+            }
+            platform_mutex_lock(&lock);
+            while (outstanding > 0) platform_cond_wait(&idle, &lock);
+            platform_mutex_unlock(&lock);
+        } else {
+            inflate_task(&frames[0]);
+        }
+
+        for (size_t i = 0; i < n; i++) {
+            const seekable_log_frame_t *frame = &log->frames[frames[i].index];
+            if (frames[i].error) {
+                fprintf(stderr, "seekable_log_query: frame %u is corrupt\n", frames[i].index);
+                rc = -1;
+            } else if (!stopped) {
+                local.frames_read++;
+                local.bytes_inflated += frame->size;
+                stopped = filter_frame(frame, frames[i].data, from_us, to_us, sink, ctx, &local.lines);
+            }
+            free(frames[i].data);
+        }
+    }
+
+    if (batch > 1) {
+        platform_cond_destroy(&idle);
+        platform_mutex_destroy(&lock);
+    }
+    free(frames);
+    if (stats) *stats = local;
+    return rc;
+}
@@ -0,0 +1,155 @@
+#ifndef SEEKABLE_LOG_H
+#define SEEKABLE_LOG_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "threadpool.h"
+
+/**
+ * Seekable compressed logs with a time index.
+ *
+ * The file is a sequence of independent gzip members ("frames"), each
+ * holding about `frame_bytes` of whole log records, followed by the
+ * index, so it is still an ordinary .gz: gunzip, zcat and gzread() see
+ * the complete log. The index is carried in the FEXTRA field of trailing
+ * members that decompress to nothing:
+ *
+ *   frame member ... | index member ... | locator member (42 bytes)
+ *
+ * Each index member holds up to SEEKABLE_LOG_ENTRIES_PER_MEMBER entries:
+ * offset, sizes, the earliest and latest timestamp in the frame and the
+ * time of the record that any leading continuation lines belong to. The
+ * fixed-size locator at the very end points at the first index member, so
+ * opening the file reads the last 42 bytes and the index and nothing else.
+ *
+ * A frame is cut only in front of a line that starts with a timestamp
+ * (see log_parse_timestamp()), so a record with continuation lines never
+ * spans two frames. Frames may grow to twice `frame_bytes` while waiting
+ * for such a line, after which they are cut at the next line end.
+ */
+
+#define SEEKABLE_LOG_DEFAULT_FRAME (1 << 20)
+#define SEEKABLE_LOG_ENTRIES_PER_MEMBER 1600
+#define SEEKABLE_LOG_LOCATOR_SIZE 42
+
+typedef struct seekable_log_frame_t {
+    uint64_t offset;                /* of the gzip member in the file */
+    uint32_t compressed_size;
+    uint32_t size;                  /* uncompressed */
+    int64_t min_ts_us;              /* INT64_MIN/MAX if the frame has no timestamp */
+    int64_t max_ts_us;
+    int64_t lead_ts_us;             /* record time of continuation lines the frame opens with */
+} seekable_log_frame_t;
+
+/* =============================
+ * Writing
+ * ============================= */
+
+typedef struct seekable_log_writer_t {
+    int fd;
+    int level;
+    size_t frame_bytes;
+    uint64_t offset;                /* bytes written so far */
+
+    char *pending;                  /* uncompressed bytes of the open frame */
+    size_t pending_len;
+    size_t pending_cap;
+    size_t frame_start;             /* the open frame is pending[frame_start, pending_len) */
+    size_t scanned;                 /* next line start in `pending` not yet looked at */
+    int64_t min_ts;
+    int64_t max_ts;
+    int64_t last_ts;                /* of the last timestamped line */
+    int64_t lead_ts;                /* last_ts when the open frame started */
+
+    void *stream;                   /* z_stream, reset per frame */
+    unsigned char *out;
+    size_t out_cap;
+
+    seekable_log_frame_t *frames;
+    uint32_t num_frames;
+    uint32_t frames_cap;
+    int error;
+} seekable_log_writer_t;
+
+/**
+ * Create `path` for writing. `frame_bytes` 0 selects
+ * SEEKABLE_LOG_DEFAULT_FRAME; `level` is a zlib level. Returns 0 on success.
+ */
+int seekable_log_writer_open(seekable_log_writer_t *writer, const char *path, size_t frame_bytes, int level);
+
+/**
+ * Append log text; it may be split anywhere. Returns 0, or -1 once a
+ * write has failed.
+ */
+int seekable_log_write(seekable_log_writer_t *writer, const void *data, size_t len);
+
+/**
+ * Compress the last frame, append the index and close. Returns 0 if
+ * the whole file was written.
+ */
+int seekable_log_writer_close(seekable_log_writer_t *writer);
+
+/**
+ * Compress the file at `in_path` into `out_path`. The input may itself be
+ * gzip-compressed, seekable or not, which recompresses it at `level`.
+ */
+int seekable_log_compress_file(const char *in_path, const char *out_path, size_t frame_bytes, int level);
+
+/* =============================
+ * Reading
+ * ============================= */
+
+typedef struct seekable_log_t {
+    const unsigned char *map;
+    size_t map_size;
+    seekable_log_frame_t *frames;
+    uint32_t num_frames;
+} seekable_log_t;
+
+/**
+ * Map `path` and load its index. Returns 0, -1 if it cannot be read or
+ * the index is damaged, or 1 without a message if the file has no index
+ * (a plain .gz), so callers can fall back to reading it as a stream.
+ */
+int seekable_log_open(seekable_log_t *log, const char *path);
+
+void seekable_log_close(seekable_log_t *log);
+
+/**
+ * Inflate frame `index` into `out` (frames[index].size bytes). Returns 0
+ * on success.
+ */
+int seekable_log_read_frame(const seekable_log_t *log, uint32_t index, char *out);
+
+/**
+ * Receives one line (without its newline) and its record's timestamp.
+ * A nonzero return stops the query.
+ */
+typedef int (*seekable_log_line_t)(void *ctx, const char *line, size_t len, int64_t timestamp_us);
+
+typedef struct seekable_log_query_stats_t {
+    uint32_t frames_read;
+    uint64_t bytes_inflated;
+    uint64_t lines;
+} seekable_log_query_stats_t;
+
+/**
+ * Pass every record whose timestamp is in [from_us, to_us] to `sink`, in
+ * file order, continuation lines with their record. Only frames whose
+ * range overlaps the window are inflated, several at a time on `pool`
+ * (or inline if it is NULL). Returns 0, or -1 if a frame is corrupt.
+ * `stats` may be NULL.
+ */
+int seekable_log_query(const seekable_log_t *log, int64_t from_us, int64_t to_us, thread_pool_t *pool,
+                       seekable_log_line_t sink, void *ctx, seekable_log_query_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SEEKABLE_LOG_H
@@ -0,0 +1,124 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <zlib.h>
+#include "log_reader.h"
+#include "platform.h"
+#include "seekable_log.h"
+#include "threadpool.h"
+
+/**
+ * Seekable compressed logs:
+ *
+ *   seeklog_main pack <log> <log.gz> [frame_kb] [level]
+ *   seeklog_main index <log.gz>
+ *   seeklog_main query <log.gz> <from> <to> [threads]
+ *
+ * The packed file is an ordinary .gz that also carries a time index.
+ * "query" prints the records stamped within [from, to] (e.g. "2024-05-01
+ * 10:00:00"), reading only the frames that overlap; "-" leaves that end
+ * of the window open.
+ */
+
+static int print_line(void *ctx, const char *line, size_t len, int64_t timestamp_us)
+{
+    (void)ctx;
+    (void)timestamp_us;
+    fwrite(line, 1, len, stdout);
+    putc_unlocked('\n', stdout);
+    return 0;
+}
+
+static int parse_bound(const char *arg, int64_t open_value, int64_t *value)
+{
+    if (strcmp(arg, "-") == 0) {
+        *value = open_value;
+        return 0;
+    }
+    if (!log_parse_timestamp(arg, strlen(arg), value)) {
+        fprintf(stderr, "Cannot read a time from '%s'\n", arg);
+        return -1;
+    }
+    return 0;
+}
+
+static int run_pack(const char *in_path, const char *out_path, size_t frame_bytes, int level)
+{
+    unsigned long long start = platform_time_ns();
+    if (seekable_log_compress_file(in_path, out_path, frame_bytes, level) != 0) return 1;
+    unsigned long long elapsed = platform_time_ns() - start;
+
+    seekable_log_t log;
+    if (seekable_log_open(&log, out_path) != 0) return 1;
+    uint64_t size = 0;
+    for (uint32_t i = 0; i < log.num_frames; i++) size += log.frames[i].size;
+    printf("[Main] %llu bytes in %u frames -> %zu bytes (%.1f%%) in %.3f ms\n", (unsigned long long)size,
+           log.num_frames, log.map_size, size ? 100.0 * (double)log.map_size / (double)size : 0.0,
+           (double)elapsed / 1e6);
+    seekable_log_close(&log);
+    return 0;
+}
+
+static void run_index(const seekable_log_t *log)
+{
+    for (uint32_t i = 0; i < log->num_frames; i++) {
+        const seekable_log_frame_t *frame = &log->frames[i];
+        printf("%6u  offset %-12llu %10u -> %-10u  %lld .. %lld\n", i, (unsigned long long)frame->offset,
+               frame->size, frame->compressed_size, (long long)frame->min_ts_us, (long long)frame->max_ts_us);
+    }
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s pack <log> <log.gz> [frame_kb] [level]\n", argv[0]);
+        fprintf(stderr, "       %s index <log.gz>\n", argv[0]);
+        fprintf(stderr, "       %s query <log.gz> <from> <to> [threads]\n", argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "pack") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "pack needs <log> <log.gz>\n");
+            return 1;
+        }
+        size_t frame_bytes = argc > 4 ? (size_t)strtoull(argv[4], NULL, 0) * 1024 : 0;
+        int level = argc > 5 ? atoi(argv[5]) : Z_DEFAULT_COMPRESSION;
+        return run_pack(argv[2], argv[3], frame_bytes, level);
+    }
+
+    seekable_log_t log;
+    int rc = seekable_log_open(&log, argv[2]);
+    if (rc == 1) fprintf(stderr, "%s has no index\n", argv[2]);
+    if (rc != 0) return 1;
+
+    if (strcmp(argv[1], "index") == 0) {
+        run_index(&log);
+    } else if (strcmp(argv[1], "query") == 0 && argc >= 5) {
+        int64_t from, to;
+        if (parse_bound(argv[3], INT64_MIN, &from) != 0 || parse_bound(argv[4], INT64_MAX, &to) != 0) {
+            seekable_log_close(&log);
+            return 1;
+        }
+        int threads = argc > 5 ? atoi(argv[5]) : 0;
+        if (threads <= 0) threads = platform_cpu_count();
+        thread_pool_t pool;
+        thread_pool_init(&pool, threads);
+
+        static char buffer[1 << 20];
+        setvbuf(stdout, buffer, _IOFBF, sizeof(buffer));
+        seekable_log_query_stats_t stats;
+        unsigned long long start = platform_time_ns();
+        rc = seekable_log_query(&log, from, to, &pool, print_line, NULL, &stats) == 0 ? 0 : 1;
+        fflush(stdout);
+        unsigned long long elapsed = platform_time_ns() - start;
+        thread_pool_shutdown(&pool);
+        fprintf(stderr, "[Main] %llu lines from %u of %u frames (%llu bytes inflated) in %.3f ms\n",
+                (unsigned long long)stats.lines, stats.frames_read, log.num_frames,
+                (unsigned long long)stats.bytes_inflated, (double)elapsed / 1e6);
+    } else {
+        fprintf(stderr, "Unknown command %s\n", argv[1]);
+        rc = 1;
+    }
+    seekable_log_close(&log);
+    return rc;
+}
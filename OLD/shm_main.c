@@ -0,0 +1,130 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include "latency_histogram.h"
+#include "platform.h"
+#include "shm_ring.h"
+
+/**
+ * Local relay over shared memory instead of loopback TCP:
+ *
+ *   shm_main serve <name>                      echo every frame back
+ *   shm_main bench <name> [frames] [words]     round trips against `serve`
+ *   shm_main inspect <segment>                 e.g. relay.c2s
+ */
+
+#define SHM_RING_BYTES  (4 * 1024 * 1024)
+#define BENCH_WINDOW    64
+
+static volatile sig_atomic_t g_keepRunning = 1;
+
+void handle_sigint(int sig)
+{
+    (void)sig; // unused
+    g_keepRunning = 0;
+}
+
+static void echo_frame(void *ctx, const frame_view_t *frame)
+{
+    transport_t *t = (transport_t *)ctx;
+    transport_send(t, frame->data, frame->length);
+}
+
+static int serve(const char *name, const frame_format_t *format)
+{
+    transport_t *t = transport_shm_open(name, 1, SHM_RING_BYTES, format);
+    if (!t) return 1;
+
+    printf("[Main] Serving on /%s.c2s -> /%s.s2c\n", name, name);
+    unsigned long long frames = 0;
+    while (g_keepRunning) {
+        int n = transport_receive(t, echo_frame, t, 500);
+        if (n < 0) {
+            printf("[Main] Client closed the rings\n");
+            break;
+        }
+        frames += (unsigned long long)n;
+    }
+    printf("[Main] Echoed %llu frames\n", frames);
+    transport_close(t);
+    return 0;
+}
+
+typedef struct bench_state_t {
+    latency_histogram_t histogram;
+    unsigned long long received;
+} bench_state_t;
+
+static void on_echo(void *ctx, const frame_view_t *frame)
+{
+    bench_state_t *state = (bench_state_t *)ctx;
+    unsigned long long sent;
+
+    if (frame->body_length >= sizeof(sent)) {
+        memcpy(&sent, frame->body, sizeof(sent));
+        latency_histogram_record(&state->histogram, platform_time_ns() - sent);
+    }
+    state->received++;
+}
+
+static int bench(const char *name, const frame_format_t *format,
+                 unsigned long long frames, unsigned words)
+{
+    uint8_t frame[0x10000];
+    bench_state_t state;
+
+    transport_t *t = transport_shm_open(name, 0, 0, format);
+    if (!t) return 1;
+
+    memset(&state, 0, sizeof(state));
+    latency_histogram_init(&state.histogram);
+    if (words < 2) words = 2;
+
+    unsigned long long sent = 0;
+    unsigned long long start = platform_time_ns();
+    while (g_keepRunning && state.received < frames) {
+        /* Bounded window so neither ring can fill while the other waits */
+        while (sent < frames && sent - state.received < BENCH_WINDOW) {
+            unsigned long long now = platform_time_ns();
+            uint8_t *body = frame + frame_header_size(format);
+            memcpy(body, &now, sizeof(now));
+            size_t len = frame_encode(format, frame, sizeof(frame), (uint32_t)sent,
+                                      body, words * 4);
+            if (len == 0 || transport_send(t, frame, len) != 0) {
+                g_keepRunning = 0;
+                break;
+            }
+            sent++;
+        }
+        if (transport_receive(t, on_echo, &state, 1000) < 0) break;
+    }
+    double elapsed = (double)(platform_time_ns() - start) / 1e9;
+
+    printf("[Main] %llu round trips in %.3f s (%.0f frames/s)\n",
+           state.received, elapsed, elapsed > 0 ? (double)state.received / elapsed : 0.0);
+    latency_histogram_print(&state.histogram, stdout, "Round trip");
+    transport_close(t);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s serve|bench|inspect <name> [frames] [words]\n", argv[0]);
+        return 2;
+    }
+    signal(SIGINT, handle_sigint);
+
+    frame_format_t format = frame_format_relay(FRAME_ENDIAN_BIG);
+    if (strcmp(argv[1], "serve") == 0) return serve(argv[2], &format);
+    if (strcmp(argv[1], "bench") == 0) {
+        unsigned long long frames = argc > 3 ? strtoull(argv[3], NULL, 10) : 1000000ULL;
+        unsigned words = argc > 4 ? (unsigned)atoi(argv[4]) : 16;
+        return bench(argv[2], &format, frames, words);
+    }
+    if (strcmp(argv[1], "inspect") == 0) return shm_ring_inspect(argv[2], stdout) == 0 ? 0 : 1;
+
+    fprintf(stderr, "unknown mode '%s'\n", argv[1]);
+    return 2;
+}
@@ -0,0 +1,572 @@
+#define _GNU_SOURCE
+#include "shm_ring.h"
+
+#if !defined(__linux__)
+#error "shm_ring.c uses futexes and is Linux only"
+#endif
+
+#include <errno.h>
+#include <fcntl.h>
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <linux/futex.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+
+#include "platform.h"
+
+/* =============================
+ * Record layout
+ * ============================= */
+
+/*
+ * Every record starts with this header and is padded to 16 bytes, so a
+ * header always fits in front of the end of the ring.
+ */
+typedef struct shm_record_t {
+    uint64_t commit;        /* absolute position + 1 once published */
+    uint32_t length;        /* payload bytes */
+    uint32_t type;
+} shm_record_t;
+
+#define SHM_RECORD_DATA     1
+#define SHM_RECORD_PADDING  2
+#define SHM_RECORD_ALIGN    16
+
+static inline uint64_t record_size(uint32_t length)
+{
+    return ((uint64_t)sizeof(shm_record_t) + length + SHM_RECORD_ALIGN - 1)
+         & ~(uint64_t)(SHM_RECORD_ALIGN - 1);
+}
+
+static inline shm_record_t *record_at(const shm_ring_t *ring, uint64_t position)
+{
+    return (shm_record_t *)(ring->data + (position & ring->mask));
+}
+
+/* =============================
+ * Futex doorbells
+ * ============================= */
+
+/* Not FUTEX_PRIVATE_FLAG: the word is shared between processes */
+static void futex_wait(uint32_t *word, uint32_t expected, int timeout_ms)
+{
+    struct timespec ts, *tsp = NULL;
+    if (timeout_ms >= 0) {
+        ts.tv_sec = timeout_ms / 1000;
+        ts.tv_nsec = (long)(timeout_ms % 1000) * 1000000L;
+        tsp = &ts;
+    }
+    syscall(SYS_futex, word, FUTEX_WAIT, expected, tsp, NULL, 0);
+}
+
+static void futex_wake(uint32_t *word, int count)
+{
+    syscall(SYS_futex, word, FUTEX_WAKE, count, NULL, NULL, 0);
+}
+
+static void wake_consumer(shm_ring_header_t *h)
+{
+    if (__atomic_load_n(&h->consumer_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&h->data_bell, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&h->data_bell, 1);
+    }
+}
+
+static void wake_producers(shm_ring_header_t *h)
+{
+    if (__atomic_load_n(&h->producers_waiting, __ATOMIC_SEQ_CST)) {
+        __atomic_add_fetch(&h->space_bell, 1, __ATOMIC_SEQ_CST);
+        futex_wake(&h->space_bell, INT_MAX);
+    }
+}
+
+/* Milliseconds left until `deadline_ns`, for waits that may be retried */
+static int remaining_ms(unsigned long long deadline_ns)
+{
+    unsigned long long now = platform_time_ns();
+    if (now >= deadline_ns) return 0;
+    return (int)((deadline_ns - now + 999999ULL) / 1000000ULL);
+}
+
+/* =============================
+ * Segment lifecycle
+ * ============================= */
+
+static void make_shm_name(char *out, const char *name)
+{
+    snprintf(out, SHM_RING_NAME_MAX, "%s%s", name[0] == '/' ? "" : "/", name);
+}
+
+static int map_segment(shm_ring_t *ring, int fd, size_t length, int prot)
+{
+    void *base = mmap(NULL, length, prot, MAP_SHARED | MAP_POPULATE, fd, 0);
+    if (base == MAP_FAILED) {
+        fprintf(stderr, "shm_ring: mmap of %zu bytes failed: %s\n", length, strerror(errno));
+        return -1;
+    }
+    ring->header = (shm_ring_header_t *)base;
+    ring->data = (uint8_t *)base + SHM_RING_DATA_OFFSET;
+    ring->map_length = length;
+    return 0;
+}
+
+int shm_ring_create(shm_ring_t *ring, const char *name, size_t capacity)
+{
+    uint64_t cap = 4096;
+
+    if (!ring || !name) return -1;
+    memset(ring, 0, sizeof(*ring));
+    make_shm_name(ring->name, name);
+
+    while (cap < capacity) cap <<= 1;
+
+    /* A stale segment from a crashed run would carry old positions */
+    shm_unlink(ring->name);
+    int fd = shm_open(ring->name, O_CREAT | O_EXCL | O_RDWR | O_CLOEXEC, 0600);
+    if (fd < 0) {
+        fprintf(stderr, "shm_ring_create: shm_open(%s) failed: %s\n", ring->name, strerror(errno));
+        return -1;
+    }
+    size_t length = SHM_RING_DATA_OFFSET + (size_t)cap;
+    if (ftruncate(fd, (off_t)length) != 0) {
+        fprintf(stderr, "shm_ring_create: ftruncate(%s) failed: %s\n", ring->name, strerror(errno));
+        close(fd);
+        shm_unlink(ring->name);
+        return -1;
+    }
+    int rc = map_segment(ring, fd, length, PROT_READ | PROT_WRITE);
+    close(fd);
+    if (rc != 0) {
+        shm_unlink(ring->name);
+        return -1;
+    }
+
+    shm_ring_header_t *h = ring->header;
+    h->version = SHM_RING_VERSION;
+    h->capacity = cap;
+    h->creator_pid = (uint32_t)getpid();
+    memcpy(h->name, ring->name, SHM_RING_NAME_MAX);
+    /* Attachers check the magic, publish it last */
+    __atomic_store_n(&h->magic, SHM_RING_MAGIC, __ATOMIC_RELEASE);
+
+    ring->mask = cap - 1;
+    ring->owner = 1;
+    return 0;
+}
+
+int shm_ring_attach(shm_ring_t *ring, const char *name)
+{
+    struct stat st;
+
+    if (!ring || !name) return -1;
+    memset(ring, 0, sizeof(*ring));
+    make_shm_name(ring->name, name);
+
+    int fd = shm_open(ring->name, O_RDWR | O_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "shm_ring_attach: shm_open(%s) failed: %s\n", ring->name, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || (size_t)st.st_size <= SHM_RING_DATA_OFFSET) {
+        fprintf(stderr, "shm_ring_attach: %s is not a ring segment\n", ring->name);
+        close(fd);
+        return -1;
+    }
+    int rc = map_segment(ring, fd, (size_t)st.st_size, PROT_READ | PROT_WRITE);
+    close(fd);
+    if (rc != 0) return -1;
+
+    shm_ring_header_t *h = ring->header;
+    if (__atomic_load_n(&h->magic, __ATOMIC_ACQUIRE) != SHM_RING_MAGIC ||
+        h->version != SHM_RING_VERSION ||
+        SHM_RING_DATA_OFFSET + h->capacity > ring->map_length) {
+        fprintf(stderr, "shm_ring_attach: %s has a bad header\n", ring->name);
+        munmap(ring->header, ring->map_length);
+        ring->header = NULL;
+        return -1;
+    }
+    ring->mask = h->capacity - 1;
+    return 0;
+}
+
+static void detach(shm_ring_t *ring)
+{
+    munmap(ring->header, ring->map_length);
+    if (ring->owner) shm_unlink(ring->name);
+    ring->header = NULL;
+    ring->data = NULL;
+}
+
+void shm_ring_close(shm_ring_t *ring)
+{
+    if (!ring || !ring->header) return;
+
+    shm_ring_header_t *h = ring->header;
+    __atomic_store_n(&h->closed, 1, __ATOMIC_SEQ_CST);
+    /* Unconditional: anyone asleep must notice the close */
+    __atomic_add_fetch(&h->data_bell, 1, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&h->space_bell, 1, __ATOMIC_SEQ_CST);
+    futex_wake(&h->data_bell, INT_MAX);
+    futex_wake(&h->space_bell, INT_MAX);
+    detach(ring);
+}
+
+/* =============================
+ * Producer side
+ * ============================= */
+
+void *shm_ring_reserve(shm_ring_t *ring, uint32_t length, shm_ring_reservation_t *reservation)
+{
+    shm_ring_header_t *h = ring->header;
+    const uint64_t capacity = ring->mask + 1;
+    const uint64_t size = record_size(length);
+
+    /* Padding in front of a record is always smaller than the record */
+    if (size > capacity / 2) return NULL;
+
+    uint64_t pos = __atomic_load_n(&h->reserve, __ATOMIC_RELAXED);
+    for (;;) {
+        uint64_t to_end = capacity - (pos & ring->mask);
+        uint64_t pad = (to_end < size) ? to_end : 0;
+        uint64_t read = __atomic_load_n(&h->read, __ATOMIC_ACQUIRE);
+
+        if (pos + pad + size - read > capacity) return NULL;
+        if (__atomic_compare_exchange_n(&h->reserve, &pos, pos + pad + size, 1,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            if (pad) {
+                shm_record_t *p = record_at(ring, pos);
+                p->length = (uint32_t)(pad - sizeof(shm_record_t));
+                p->type = SHM_RECORD_PADDING;
+                __atomic_store_n(&p->commit, pos + 1, __ATOMIC_RELEASE);
+                pos += pad;
+            }
+            shm_record_t *r = record_at(ring, pos);
+            r->length = length;
+            r->type = SHM_RECORD_DATA;
+            reservation->position = pos;
+            reservation->length = length;
+            return r + 1;
+        }
+        /* pos now holds the current reserve position, retry */
+    }
+}
+
+void shm_ring_commit(shm_ring_t *ring, const shm_ring_reservation_t *reservation)
+{
+    shm_ring_header_t *h = ring->header;
+    shm_record_t *r = record_at(ring, reservation->position);
+
+    __atomic_store_n(&r->commit, reservation->position + 1, __ATOMIC_RELEASE);
+    __atomic_add_fetch(&h->pushed, 1, __ATOMIC_RELAXED);
+    /*
+     * The commit must be visible before consumer_waiting is read, the
+     * mirror of shm_ring_wait() setting it before checking the record;
+     * otherwise both sides can miss each other and the consumer sleeps
+     * on a ready record.
+     */
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    wake_consumer(h);
+}
+
+int shm_ring_push(shm_ring_t *ring, const void *data, uint32_t length, int timeout_ms)
+{
+    shm_ring_header_t *h = ring->header;
+    shm_ring_reservation_t res;
+    unsigned long long deadline = 0;
+    int counted = 0;
+
+    if (record_size(length) > (ring->mask + 1) / 2) {
+        fprintf(stderr, "shm_ring_push: %u byte record does not fit in %s\n", length, ring->name);
+        return -1;
+    }
+    if (timeout_ms > 0) deadline = platform_time_ns() + (unsigned long long)timeout_ms * 1000000ULL;
+
+    for (;;) {
+        void *dst = shm_ring_reserve(ring, length, &res);
+        if (dst) {
+            memcpy(dst, data, length);
+            shm_ring_commit(ring, &res);
+            return 0;
+        }
+        if (__atomic_load_n(&h->closed, __ATOMIC_ACQUIRE)) return -1;
+        if (!counted) {
+            __atomic_add_fetch(&h->full_events, 1, __ATOMIC_RELAXED);
+            counted = 1;
+        }
+
+        int wait_ms = -1;
+        if (timeout_ms == 0) return -1;
+        if (timeout_ms > 0) {
+            wait_ms = remaining_ms(deadline);
+            if (wait_ms == 0) return -1;
+        }
+
+        /* Announce ourselves, then re-check before sleeping on the bell */
+        uint32_t seen = __atomic_load_n(&h->space_bell, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&h->producers_waiting, 1, __ATOMIC_SEQ_CST);
+        dst = shm_ring_reserve(ring, length, &res);
+        if (!dst) futex_wait(&h->space_bell, seen, wait_ms);
+        __atomic_sub_fetch(&h->producers_waiting, 1, __ATOMIC_SEQ_CST);
+        if (dst) {
+            memcpy(dst, data, length);
+            shm_ring_commit(ring, &res);
+            return 0;
+        }
+    }
+}
+
+/* =============================
+ * Consumer side
+ * ============================= */
+
+static int record_ready(const shm_ring_t *ring, uint64_t read)
+{
+    const shm_record_t *r = record_at(ring, read);
+    return __atomic_load_n(&r->commit, __ATOMIC_ACQUIRE) == read + 1;
+}
+
+size_t shm_ring_drain(shm_ring_t *ring, shm_ring_record_func_t callback, void *ctx,
+                      size_t max_records)
+{
+    shm_ring_header_t *h = ring->header;
+    uint64_t read = __atomic_load_n(&h->read, __ATOMIC_RELAXED);
+    uint64_t start = read;
+    size_t delivered = 0;
+
+    while (max_records == 0 || delivered < max_records) {
+        shm_record_t *r = record_at(ring, read);
+        if (__atomic_load_n(&r->commit, __ATOMIC_ACQUIRE) != read + 1) break;
+
+        if (r->type == SHM_RECORD_DATA) {
+            if (callback) callback(ctx, (const uint8_t *)(r + 1), r->length);
+            delivered++;
+        }
+        /*
+         * Zero the record before its space goes back to the producers. Next
+         * lap's headers can land anywhere in it, and a reserved but not yet
+         * committed one would otherwise show old payload bytes that might
+         * read as a commit. The lines were just touched, so this is cheap.
+         */
+        const uint64_t size = record_size(r->length);
+        memset(r, 0, size);
+        read += size;
+    }
+
+    if (read != start) {
+        /* Release the whole batch at once: one store to the shared line */
+        __atomic_store_n(&h->read, read, __ATOMIC_SEQ_CST);
+        __atomic_add_fetch(&h->drained, delivered, __ATOMIC_RELAXED);
+        wake_producers(h);
+    }
+    return delivered;
+}
+
+int shm_ring_wait(shm_ring_t *ring, int timeout_ms)
+{
+    shm_ring_header_t *h = ring->header;
+    uint64_t read = __atomic_load_n(&h->read, __ATOMIC_RELAXED);
+
+    if (record_ready(ring, read)) return 1;
+    if (__atomic_load_n(&h->closed, __ATOMIC_ACQUIRE) || timeout_ms == 0) return 0;
+
+    uint32_t seen = __atomic_load_n(&h->data_bell, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&h->consumer_waiting, 1, __ATOMIC_SEQ_CST);
+    if (!record_ready(ring, read)) futex_wait(&h->data_bell, seen, timeout_ms);
+    __atomic_store_n(&h->consumer_waiting, 0, __ATOMIC_SEQ_CST);
+    return record_ready(ring, read);
+}
+
+uint64_t shm_ring_used(const shm_ring_t *ring)
+{
+    return __atomic_load_n(&ring->header->reserve, __ATOMIC_ACQUIRE)
+         - __atomic_load_n(&ring->header->read, __ATOMIC_ACQUIRE);
+}
+
+/* =============================
+ * Inspection
+ * ============================= */
+
+int shm_ring_inspect(const char *name, FILE *out)
+{
+    shm_ring_t ring;
+    struct stat st;
+
+    memset(&ring, 0, sizeof(ring));
+    make_shm_name(ring.name, name);
+
+    int fd = shm_open(ring.name, O_RDONLY | O_CLOEXEC, 0);
+    if (fd < 0) {
+        fprintf(stderr, "shm_ring_inspect: shm_open(%s) failed: %s\n", ring.name, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0) {
+        close(fd);
+        return -1;
+    }
+    fprintf(out, "Segment %s: %lld bytes, mode %04o, owner uid %u\n",
+            ring.name, (long long)st.st_size, (unsigned)(st.st_mode & 07777), (unsigned)st.st_uid);
+    if ((size_t)st.st_size <= SHM_RING_DATA_OFFSET) {
+        fprintf(out, "  too small to hold a ring\n");
+        close(fd);
+        return -1;
+    }
+    int rc = map_segment(&ring, fd, (size_t)st.st_size, PROT_READ);
+    close(fd);
+    if (rc != 0) return -1;
+
+    const shm_ring_header_t *h = ring.header;
+    if (h->magic != SHM_RING_MAGIC) {
+        fprintf(out, "  not a ring (magic 0x%08X)\n", h->magic);
+        munmap(ring.header, ring.map_length);
+        return -1;
+    }
+    ring.mask = h->capacity - 1;
+
+    uint64_t reserve = __atomic_load_n(&h->reserve, __ATOMIC_ACQUIRE);
+    uint64_t read = __atomic_load_n(&h->read, __ATOMIC_ACQUIRE);
+    fprintf(out, "  version %u, capacity %llu, creator pid %u%s\n", h->version,
+            (unsigned long long)h->capacity, h->creator_pid, h->closed ? ", closed" : "");
+    fprintf(out, "  reserve %llu, read %llu, in use %llu bytes\n",
+            (unsigned long long)reserve, (unsigned long long)read,
+            (unsigned long long)(reserve - read));
+    fprintf(out, "  pushed %llu, drained %llu, full events %llu\n",
+            (unsigned long long)h->pushed, (unsigned long long)h->drained,
+            (unsigned long long)h->full_events);
+    fprintf(out, "  consumer %s, %u producer(s) waiting\n",
+            h->consumer_waiting ? "waiting" : "running", h->producers_waiting);
+
+    /* Walk the published records without consuming them */
+    uint64_t records = 0, padding = 0;
+    uint64_t pos = read;
+    while (pos < reserve && record_ready(&ring, pos)) {
+        const shm_record_t *r = record_at(&ring, pos);
+        if (r->type == SHM_RECORD_PADDING) {
+            padding++;
+        } else {
+            if (records == 0) {
+                uint32_t n = r->length < 32 ? r->length : 32;
+                const uint8_t *p = (const uint8_t *)(r + 1);
+                fprintf(out, "  first pending record (%u bytes):", r->length);
+                for (uint32_t i = 0; i < n; i++) fprintf(out, " %02X", p[i]);
+                fprintf(out, "%s\n", n < r->length ? " ..." : "");
+            }
+            records++;
+        }
+        pos += record_size(r->length);
+    }
+    fprintf(out, "  %llu pending record(s), %llu padding, %llu bytes reserved but unpublished\n",
+            (unsigned long long)records, (unsigned long long)padding,
+            (unsigned long long)(reserve - pos));
+
+    munmap(ring.header, ring.map_length);
+    return 0;
+}
+
+/* =============================
+ * Shared-memory transport
+ * ============================= */
+
+typedef struct shm_transport_t {
+    transport_t base;
+    shm_ring_t tx;
+    shm_ring_t rx;
+} shm_transport_t;
+
+typedef struct shm_deliver_t {
+    const frame_format_t *format;
+    frame_callback_t callback;
+    void *ctx;
+} shm_deliver_t;
+
+static void deliver_record(void *ctx, const uint8_t *data, uint32_t length)
+{
+    shm_deliver_t *d = (shm_deliver_t *)ctx;
+    frame_view_t view;
+
+    /* Producers push whole frames; anything else is dropped */
+    if (frame_view_decode(d->format, data, length, &view) == 0 && d->callback) {
+        d->callback(d->ctx, &view);
+    }
+}
+
+static int shm_send(transport_t *t, const void *frame, size_t len)
+{
+    shm_transport_t *s = (shm_transport_t *)t;
+    if (len > UINT32_MAX) return -1;
+    return shm_ring_push(&s->tx, frame, (uint32_t)len, -1);
+}
+
+static int shm_receive(transport_t *t, frame_callback_t callback, void *ctx, int timeout_ms)
+{
+    shm_transport_t *s = (shm_transport_t *)t;
+    shm_deliver_t d = { &t->format, callback, ctx };
+    unsigned long long deadline = 0;
+
+    if (timeout_ms > 0) deadline = platform_time_ns() + (unsigned long long)timeout_ms * 1000000ULL;
+
+    for (;;) {
+        size_t n = shm_ring_drain(&s->rx, deliver_record, &d, 0);
+        if (n > 0) return (int)n;
+        if (__atomic_load_n(&s->rx.header->closed, __ATOMIC_ACQUIRE)) {
+            /* Records published before the close were drained above */
+            return shm_ring_drain(&s->rx, deliver_record, &d, 0) > 0 ? 1 : -1;
+        }
+
+        int wait_ms = timeout_ms;
+        if (timeout_ms == 0) return 0;
+        if (timeout_ms > 0) {
+            wait_ms = remaining_ms(deadline);
+            if (wait_ms == 0) return 0;
+        }
+        shm_ring_wait(&s->rx, wait_ms);
+    }
+}
+
+static void shm_close(transport_t *t)
+{
+    shm_transport_t *s = (shm_transport_t *)t;
+    shm_ring_close(&s->tx);
+    shm_ring_close(&s->rx);
+    free(s);
+}
+
+static const transport_ops_t g_shm_ops = {
+    shm_send,
+    shm_receive,
+    shm_close
+};
+
+transport_t *transport_shm_open(const char *name, int create, size_t capacity,
+                                const frame_format_t *format)
+{
+    char c2s[SHM_RING_NAME_MAX], s2c[SHM_RING_NAME_MAX];
+    shm_transport_t *s = (shm_transport_t *)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+
+    snprintf(c2s, sizeof(c2s), "%s.c2s", name);
+    snprintf(s2c, sizeof(s2c), "%s.s2c", name);
+
+    /* The server receives on c2s and sends on s2c, the client the reverse */
+    int rc;
+    if (create) {
+        rc = shm_ring_create(&s->rx, c2s, capacity);
+        if (rc == 0 && (rc = shm_ring_create(&s->tx, s2c, capacity)) != 0) shm_ring_close(&s->rx);
+    } else {
+        rc = shm_ring_attach(&s->tx, c2s);
+        /* Only detach on failure, closing would tell the server we left */
+        if (rc == 0 && (rc = shm_ring_attach(&s->rx, s2c)) != 0) detach(&s->tx);
+    }
+    if (rc != 0) {
+        free(s);
+        return NULL;
+    }
+
+    s->base.ops = &g_shm_ops;
+    s->base.format = *format;
+    return &s->base;
+}
@@ -0,0 +1,177 @@
+#ifndef SHM_RING_H
+#define SHM_RING_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "frame_parser.h"
+#include "transport.h"
+
+/**
+ * Frame ring in POSIX shared memory (Linux only).
+ *
+ * One process creates a named segment with shm_open()/mmap(), others
+ * attach to it by name, and frames move between them without passing
+ * through the kernel. Any number of producers may push concurrently; a
+ * single consumer drains.
+ *
+ *   - Producers claim space by advancing `reserve` with a CAS, write the
+ *     record in place and publish it by storing its absolute position in
+ *     the record header (release). The consumer only trusts a header that
+ *     carries the position it expects, and zeroes each record before it
+ *     releases the space, so neither an old header nor old payload bytes
+ *     under a header that is reserved but not yet committed is ever
+ *     mistaken for a new record.
+ *   - A record that would straddle the end of the ring is preceded by a
+ *     padding record, so every frame is contiguous and can be handed to
+ *     the consumer in place.
+ *   - Doorbells are futex words in the shared header. Producers only make
+ *     the FUTEX_WAKE system call when the consumer has announced that it
+ *     is about to sleep, and the consumer only wakes producers that are
+ *     blocked on a full ring.
+ *
+ * The layout is fixed-size and position independent, so shm_ring_inspect()
+ * can dump any ring by name (the Linux counterpart of open_shared_win_mem.py).
+ */
+
+#define SHM_RING_MAGIC       0x53524E47U   /* "SRNG" */
+#define SHM_RING_VERSION     1
+#define SHM_RING_NAME_MAX    64
+
+/**
+ * Shared header at offset 0 of the segment; the data area starts at
+ * SHM_RING_DATA_OFFSET. Fields written by different sides live on
+ * different cache lines.
+ */
+typedef struct shm_ring_header_t {
+    uint32_t magic;
+    uint32_t version;
+    uint64_t capacity;              /* data bytes, power of two */
+    uint32_t creator_pid;
+    uint32_t closed;                /* set by either side on shutdown */
+    char name[SHM_RING_NAME_MAX];
+    uint8_t pad0[40];
+
+    /* Producer side */
+    uint64_t reserve;               /* next free absolute position */
+    uint64_t pushed;                /* records committed */
+    uint64_t full_events;           /* pushes that found the ring full */
+    uint32_t space_bell;            /* futex: bumped when space is released */
+    uint32_t producers_waiting;
+    uint8_t pad1[32];
+
+    /* Consumer side */
+    uint64_t read;                  /* next absolute position to consume */
+    uint64_t drained;               /* records consumed */
+    uint32_t data_bell;             /* futex: bumped on every commit */
+    uint32_t consumer_waiting;
+    uint8_t pad2[40];
+} shm_ring_header_t;
+
+#define SHM_RING_DATA_OFFSET 4096
+
+/**
+ * A mapped ring. Each process has its own shm_ring_t for the same segment.
+ */
+typedef struct shm_ring_t {
+    shm_ring_header_t *header;
+    uint8_t *data;
+    uint64_t mask;
+    size_t map_length;
+    int owner;                      /* created the segment, unlinks it on close */
+    char name[SHM_RING_NAME_MAX];
+} shm_ring_t;
+
+/**
+ * A claimed but not yet published record, see shm_ring_reserve().
+ */
+typedef struct shm_ring_reservation_t {
+    uint64_t position;
+    uint32_t length;
+} shm_ring_reservation_t;
+
+/**
+ * Called by shm_ring_drain() for every record. `data` points into the ring
+ * and is only valid during the call.
+ */
+typedef void (*shm_ring_record_func_t)(void *ctx, const uint8_t *data, uint32_t length);
+
+/**
+ * Create (or re-create) segment `name` with at least `capacity` data bytes,
+ * rounded up to a power of two. Returns 0 on success, nonzero on failure.
+ */
+int shm_ring_create(shm_ring_t *ring, const char *name, size_t capacity);
+
+/**
+ * Attach to an existing segment. Returns 0 on success, nonzero on failure.
+ */
+int shm_ring_attach(shm_ring_t *ring, const char *name);
+
+/**
+ * Unmap the segment, marking the ring closed. The creator also unlinks the
+ * name so the memory is released once every process has detached.
+ */
+void shm_ring_close(shm_ring_t *ring);
+
+/**
+ * Claim room for a `length` byte record and return where to write it, or
+ * NULL if the ring is currently full (or the record can never fit).
+ * Must be followed by shm_ring_commit().
+ */
+void *shm_ring_reserve(shm_ring_t *ring, uint32_t length, shm_ring_reservation_t *reservation);
+
+/**
+ * Publish a reserved record and ring the consumer's doorbell if it sleeps.
+ */
+void shm_ring_commit(shm_ring_t *ring, const shm_ring_reservation_t *reservation);
+
+/**
+ * Copy one record into the ring, waiting up to `timeout_ms` for space
+ * (-1 waits forever). Returns 0 on success, nonzero on timeout, if the
+ * record is too large or the ring was closed.
+ */
+int shm_ring_push(shm_ring_t *ring, const void *data, uint32_t length, int timeout_ms);
+
+/**
+ * Deliver up to `max_records` published records (0 for no limit) in
+ * order and release their space. Returns the number delivered.
+ */
+size_t shm_ring_drain(shm_ring_t *ring, shm_ring_record_func_t callback, void *ctx,
+                      size_t max_records);
+
+/**
+ * Sleep until a record is published, the ring is closed or `timeout_ms`
+ * passes (-1 waits forever). Returns nonzero if a record is ready.
+ */
+int shm_ring_wait(shm_ring_t *ring, int timeout_ms);
+
+/**
+ * Bytes published or reserved but not yet drained.
+ */
+uint64_t shm_ring_used(const shm_ring_t *ring);
+
+/**
+ * Print the header of segment `name` and a summary of pending records
+ * without consuming anything. Returns 0 on success, nonzero on failure.
+ */
+int shm_ring_inspect(const char *name, FILE *out);
+
+/**
+ * Shared-memory transport built from two rings, `<name>.c2s` and
+ * `<name>.s2c`. The server side (`create` nonzero) creates both with
+ * `capacity` bytes each; the client attaches. Frames are validated with
+ * `format` on receive and handed to the callback straight from the ring.
+ */
+transport_t *transport_shm_open(const char *name, int create, size_t capacity,
+                                const frame_format_t *format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SHM_RING_H
@@ -0,0 +1,192 @@
+#include "stats_counters.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+const char *const stat_names[STAT_COUNT] = {
+    "frames_in",
+    "frames_out",
+    "bytes_in",
+    "bytes_out",
+    "errors",
+    "invalid_frames",
+    "marker_mismatches",
+    "length_mismatches",
+    "resync_bytes",
+    "connections_opened",
+    "connections_closed",
+    "compress_decisions",
+    "compress_step_downs",
+    "compress_step_ups",
+    "compress_busy_decisions",
+    "compress_recompressions",
+    "compress_rung0_files", "compress_rung0_bytes_in", "compress_rung0_bytes_out", "compress_rung0_busy_us",
+    "compress_rung1_files", "compress_rung1_bytes_in", "compress_rung1_bytes_out", "compress_rung1_busy_us",
+    "compress_rung2_files", "compress_rung2_bytes_in", "compress_rung2_bytes_out", "compress_rung2_busy_us",
+    "compress_rung3_files", "compress_rung3_bytes_in", "compress_rung3_bytes_out", "compress_rung3_busy_us",
+    "compress_rung4_files", "compress_rung4_bytes_in", "compress_rung4_bytes_out", "compress_rung4_busy_us"
+};
+
+/* =============================
+ * Registry and shards
+ * ============================= */
+
+/* Never 0, so a thread's empty cache matches no registry */
+static uint64_t g_generation;
+
+int stats_registry_init(stats_registry_t *registry)
+{
+    memset(registry, 0, sizeof(*registry));
+    registry->generation = __atomic_add_fetch(&g_generation, 1, __ATOMIC_RELAXED);
+    registry->shards = (stats_shard_t *)aligned_alloc(64, sizeof(stats_shard_t) * STATS_MAX_SHARDS);
+    if (!registry->shards) {
+        fprintf(stderr, "stats_registry_init: failed to allocate shards\n");
+        return -1;
+    }
+    memset(registry->shards, 0, sizeof(stats_shard_t) * STATS_MAX_SHARDS);
+    return 0;
+}
+
+void stats_registry_destroy(stats_registry_t *registry)
+{
+    if (!registry || !registry->shards) return;
+    stats_exporter_stop(registry);
+    free(registry->shards);
+    registry->shards = NULL;
+}
+
+stats_shard_t *stats_register_shard(stats_registry_t *registry)
+{
+    int index = __atomic_fetch_add(&registry->num_shards, 1, __ATOMIC_ACQ_REL);
+    if (index >= STATS_MAX_SHARDS) {
+        fprintf(stderr, "stats_register_shard: more than %d threads\n", STATS_MAX_SHARDS);
+        return NULL;
+    }
+    return &registry->shards[index];
+}
+
+/*
+ * One cached shard per thread; re-registered if used with another registry.
+ * The generation tells a registry re-initialised at the same address from
+ * the one the shard came from. A failed registration is cached too
+ * (t_shard NULL), so a thread past STATS_MAX_SHARDS reports it once and
+ * then counts nothing.
+ */
+static __thread stats_registry_t *t_registry;
+static __thread uint64_t t_generation;
+static __thread stats_shard_t *t_shard;
+
+stats_shard_t *stats_local_shard(stats_registry_t *registry)
+{
+    if (t_registry != registry || t_generation != registry->generation) {
+        t_shard = stats_register_shard(registry);
+        t_registry = registry;
+        t_generation = registry->generation;
+    }
+    return t_shard;
+}
+
+/* =============================
+ * Reading
+ * ============================= */
+
+void stats_snapshot(stats_registry_t *registry, stats_snapshot_t *snapshot)
+{
+    int shards = __atomic_load_n(&registry->num_shards, __ATOMIC_ACQUIRE);
+    if (shards > STATS_MAX_SHARDS) shards = STATS_MAX_SHARDS;
+
+    memset(snapshot, 0, sizeof(*snapshot));
+    for (int s = 0; s < shards; s++) {
+        const stats_shard_t *shard = &registry->shards[s];
+        for (int id = 0; id < STAT_COUNT; id++) {
+            snapshot->values[id] += __atomic_load_n(&shard->values[id], __ATOMIC_RELAXED);
+        }
+    }
+    snapshot->taken_ns = platform_time_ns();
+}
+
+void stats_snapshot_print(const stats_snapshot_t *current, const stats_snapshot_t *previous,
+                          FILE *out)
+{
+    double seconds = 0.0;
+    if (previous && current->taken_ns > previous->taken_ns) {
+        seconds = (double)(current->taken_ns - previous->taken_ns) / 1e9;
+    }
+
+    fprintf(out, "[Stats]");
+    for (int id = 0; id < STAT_COMPRESS_DECISIONS; id++) {
+        fprintf(out, " %s=%llu", stat_names[id], (unsigned long long)current->values[id]);
+        if (seconds > 0.0 && (id == STAT_FRAMES_IN || id == STAT_BYTES_IN)) {
+            fprintf(out, " (%.0f/s)", (double)(current->values[id] - previous->values[id]) / seconds);
+        }
+    }
+    if (current->values[STAT_COMPRESS_DECISIONS] > 0) {
+        for (int id = STAT_COMPRESS_DECISIONS; id < STAT_COMPRESS_LEVELS_FIRST; id++) {
+            fprintf(out, " %s=%llu", stat_names[id], (unsigned long long)current->values[id]);
+        }
+        /* Throughput and ratio over everything each rung has compressed */
+        for (int rung = 0; rung < STATS_COMPRESS_LEVELS; rung++) {
+            const uint64_t files = current->values[STAT_COMPRESS_LEVEL(rung, STAT_LEVEL_FILES)];
+            const uint64_t in = current->values[STAT_COMPRESS_LEVEL(rung, STAT_LEVEL_BYTES_IN)];
+            const uint64_t out_bytes = current->values[STAT_COMPRESS_LEVEL(rung, STAT_LEVEL_BYTES_OUT)];
+            const uint64_t busy_us = current->values[STAT_COMPRESS_LEVEL(rung, STAT_LEVEL_BUSY_US)];
+            if (files == 0) continue;
+            fprintf(out, " compress_rung%d=%llu files (%.1f MB/s, %.2fx)", rung, (unsigned long long)files,
+                    busy_us ? (double)in / (double)busy_us : 0.0, out_bytes ? (double)in / (double)out_bytes : 0.0);
+        }
+    }
+    fprintf(out, "\n");
+}
+
+/* =============================
+ * Exporter
+ * ============================= */
+
+static void *exporter_thread(void *arg)
+{
+    stats_registry_t *registry = (stats_registry_t *)arg;
+    stats_snapshot_t current, previous;
+    int have_previous = 0;
+
+    while (__atomic_load_n(&registry->exporter_running, __ATOMIC_ACQUIRE)) {
+        /* Sleep in short steps so stop does not wait a whole interval */
+        unsigned int slept = 0;
+        while (slept < registry->interval_ms &&
+               __atomic_load_n(&registry->exporter_running, __ATOMIC_ACQUIRE)) {
+            unsigned int step = registry->interval_ms - slept < 50 ? registry->interval_ms - slept : 50;
+            platform_sleep_ms(step);
+            slept += step;
+        }
+        if (!__atomic_load_n(&registry->exporter_running, __ATOMIC_ACQUIRE)) break;
+
+        stats_snapshot(registry, &current);
+        registry->export_func(registry->export_ctx, &current, have_previous ? &previous : NULL);
+        previous = current;
+        have_previous = 1;
+    }
+    return NULL;
+}
+
+int stats_exporter_start(stats_registry_t *registry, unsigned int interval_ms,
+                         stats_export_func_t func, void *ctx)
+{
+    if (!registry || !func || registry->exporter_running) return -1;
+
+    registry->interval_ms = interval_ms > 0 ? interval_ms : 1000;
+    registry->export_func = func;
+    registry->export_ctx = ctx;
+    registry->exporter_running = 1;
+    if (platform_thread_create(&registry->exporter, exporter_thread, registry) != 0) {
+        fprintf(stderr, "stats_exporter_start: failed to start exporter thread\n");
+        registry->exporter_running = 0;
+        return -1;
+    }
+    return 0;
+}
+
+void stats_exporter_stop(stats_registry_t *registry)
+{
+    if (!registry->exporter_running) return;
+    __atomic_store_n(&registry->exporter_running, 0, __ATOMIC_RELEASE);
+    platform_thread_join(registry->exporter);
+}
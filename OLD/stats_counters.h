@@ -0,0 +1,164 @@
+#ifndef STATS_COUNTERS_H
+#define STATS_COUNTERS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "platform.h"
+
+/**
+ * Contention-free counters for the data path.
+ *
+ * update_stats() in threaded_ether_relay.py takes a lock for every
+ * increment. Here each thread owns a cache-line aligned shard and is its
+ * only writer, so an increment is a plain load and store to a line no
+ * other thread writes: no lock, no atomic read-modify-write, no false
+ * sharing. Readers sum the shards when they ask (stats_snapshot()), and an
+ * optional exporter thread does that on a fixed interval.
+ */
+
+/* Levels of the compression ladder, and counters kept for each */
+#define STATS_COMPRESS_LEVELS 5
+#define STATS_COMPRESS_FIELDS 4
+
+typedef enum stat_id_t {
+    STAT_FRAMES_IN = 0,
+    STAT_FRAMES_OUT,
+    STAT_BYTES_IN,
+    STAT_BYTES_OUT,
+    STAT_ERRORS,
+    STAT_INVALID_FRAMES,
+    STAT_MARKER_MISMATCHES,
+    STAT_LENGTH_MISMATCHES,
+    STAT_RESYNC_BYTES,
+    STAT_CONNECTIONS_OPENED,
+    STAT_CONNECTIONS_CLOSED,
+
+    /* Log compression level choices (compress_controller.h) */
+    STAT_COMPRESS_DECISIONS,
+    STAT_COMPRESS_STEP_DOWNS,
+    STAT_COMPRESS_STEP_UPS,
+    STAT_COMPRESS_BUSY_DECISIONS,
+    STAT_COMPRESS_RECOMPRESSIONS,
+    /* STATS_COMPRESS_FIELDS per level of the ladder, see STAT_COMPRESS_LEVEL() */
+    STAT_COMPRESS_LEVELS_FIRST,
+    STAT_COUNT = STAT_COMPRESS_LEVELS_FIRST + STATS_COMPRESS_LEVELS * STATS_COMPRESS_FIELDS
+} stat_id_t;
+
+enum { STAT_LEVEL_FILES = 0, STAT_LEVEL_BYTES_IN, STAT_LEVEL_BYTES_OUT, STAT_LEVEL_BUSY_US };
+
+/** Counter `field` (STAT_LEVEL_*) of rung `rung` of the compression ladder. */
+#define STAT_COMPRESS_LEVEL(rung, field) \
+    ((stat_id_t)(STAT_COMPRESS_LEVELS_FIRST + (rung) * STATS_COMPRESS_FIELDS + (field)))
+
+/** Counter names, indexed by stat_id_t. */
+extern const char *const stat_names[STAT_COUNT];
+
+#define STATS_MAX_SHARDS 256
+
+/* Rounded up to whole cache lines */
+#define STATS_SHARD_WORDS ((STAT_COUNT + 7) & ~7)
+
+typedef struct stats_shard_t {
+    uint64_t values[STATS_SHARD_WORDS];
+} __attribute__((aligned(64))) stats_shard_t;
+
+typedef struct stats_snapshot_t {
+    uint64_t values[STAT_COUNT];
+    unsigned long long taken_ns;
+} stats_snapshot_t;
+
+/**
+ * Called by the exporter with the new snapshot and the previous one (for
+ * rates). `previous` is NULL on the first call.
+ */
+typedef void (*stats_export_func_t)(void *ctx, const stats_snapshot_t *current,
+                                    const stats_snapshot_t *previous);
+
+typedef struct stats_registry_t {
+    stats_shard_t *shards;
+    int num_shards;                 /* claimed with an atomic add */
+    uint64_t generation;            /* unique per init, so a reused address is a new registry */
+
+    platform_thread_t exporter;
+    int exporter_running;
+    unsigned int interval_ms;
+    stats_export_func_t export_func;
+    void *export_ctx;
+} stats_registry_t;
+
+/**
+ * Allocate room for STATS_MAX_SHARDS shards. Returns 0 on success.
+ */
+int stats_registry_init(stats_registry_t *registry);
+
+/**
+ * Stop the exporter if running and free the shards.
+ */
+void stats_registry_destroy(stats_registry_t *registry);
+
+/**
+ * Claim a shard for the calling thread. Shards are never moved or
+ * reused, so the pointer stays valid until the registry is destroyed.
+ * Returns NULL once STATS_MAX_SHARDS are in use.
+ */
+stats_shard_t *stats_register_shard(stats_registry_t *registry);
+
+/**
+ * Shard of the calling thread, registered on first use. For threads such
+ * as pool workers that do not keep their own pointer. NULL if the
+ * registry was full; the failure is remembered, so it is reported once.
+ */
+stats_shard_t *stats_local_shard(stats_registry_t *registry);
+
+/**
+ * Add to a counter. Only the thread that owns `shard` may call this.
+ */
+static inline void stats_add(stats_shard_t *shard, stat_id_t id, uint64_t n)
+{
+    /* Single writer: a relaxed store is enough for readers to see whole values */
+    uint64_t v = __atomic_load_n(&shard->values[id], __ATOMIC_RELAXED);
+    __atomic_store_n(&shard->values[id], v + n, __ATOMIC_RELAXED);
+}
+
+static inline void stats_inc(stats_shard_t *shard, stat_id_t id)
+{
+    stats_add(shard, id, 1);
+}
+
+/**
+ * Sum every shard. Counters are read individually, so a snapshot taken
+ * while threads are counting may be slightly inconsistent across ids.
+ */
+void stats_snapshot(stats_registry_t *registry, stats_snapshot_t *snapshot);
+
+/**
+ * One line with totals and, given `previous`, per-second rates. The
+ * compression counters only appear once a decision has been made, with
+ * the throughput and ratio of each level that has compressed a file.
+ */
+void stats_snapshot_print(const stats_snapshot_t *current, const stats_snapshot_t *previous,
+                          FILE *out);
+
+/**
+ * Start a thread that takes a snapshot every `interval_ms` and passes it
+ * to `func`. Returns 0 on success.
+ */
+int stats_exporter_start(stats_registry_t *registry, unsigned int interval_ms,
+                         stats_export_func_t func, void *ctx);
+
+/**
+ * Stop and join the exporter thread.
+ */
+void stats_exporter_stop(stats_registry_t *registry);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // STATS_COUNTERS_H
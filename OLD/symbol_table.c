@@ -0,0 +1,491 @@
+#include "symbol_table.h"
+
+#include <errno.h>
+#include <fcntl.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "json_reader.h"
+
+/* Average keys per bucket of the perfect hash */
+#define PHASH_LOAD          3
+#define PHASH_MAX_DISPLACE  (1U << 20)
+#define PHASH_MAX_SEEDS     64
+
+/* =============================
+ * Building
+ * ============================= */
+
+typedef struct build_symbol_t {
+    int64_t value;
+    uint32_t name;
+} build_symbol_t;
+
+typedef struct build_table_t {
+    uint32_t name;
+    const char *name_str;           /* set once the string pool is final */
+    build_symbol_t *symbols;
+    uint32_t count;
+
+    symbol_file_entry_t entry;
+    uint32_t *names;
+    int64_t *keys;
+    uint32_t *disp;
+} build_table_t;
+
+typedef struct string_pool_t {
+    char *data;
+    size_t size;
+    size_t capacity;
+} string_pool_t;
+
+static long add_string(string_pool_t *pool, const char *str, size_t len)
+{
+    size_t n = json_string_copy(str, len, NULL, 0);
+    if (pool->size + n + 1 > pool->capacity) {
+        size_t grown = pool->capacity ? pool->capacity * 2 : 4096;
+        while (grown < pool->size + n + 1) grown *= 2;
+        char *data = (char *)realloc(pool->data, grown);
+        if (!data) return -1;
+        pool->data = data;
+        pool->capacity = grown;
+    }
+    if (pool->size + n + 1 > UINT32_MAX) return -1;
+
+    long offset = (long)pool->size;
+    json_string_copy(str, len, pool->data + pool->size, n + 1);
+    pool->size += n + 1;
+    return offset;
+}
+
+static int compare_symbols(const void *a, const void *b)
+{
+    int64_t x = ((const build_symbol_t *)a)->value, y = ((const build_symbol_t *)b)->value;
+    return (x > y) - (x < y);
+}
+
+static int compare_tables(const void *a, const void *b)
+{
+    return strcmp(((const build_table_t *)a)->name_str, ((const build_table_t *)b)->name_str);
+}
+
+static int build_dense(build_table_t *t, uint64_t range)
+{
+    t->entry.kind = SYMBOL_DENSE;
+    t->entry.min_value = t->count ? t->symbols[0].value : 0;
+    t->entry.size = (uint32_t)range;
+    t->names = (uint32_t *)calloc(range + 1, sizeof(uint32_t));
+    if (!t->names) return -1;
+    for (uint32_t i = 0; i < t->count; i++) {
+        t->names[(uint64_t)t->symbols[i].value - (uint64_t)t->entry.min_value] = t->symbols[i].name;
+    }
+    return 0;
+}
+
+/*
+ * Hash and displace: hash the keys into n / PHASH_LOAD buckets, then place
+ * buckets largest first, trying displacements until every key of the
+ * bucket lands on a free slot. n keys fill exactly n slots.
+ */
+static int build_phash(build_table_t *t)
+{
+    const uint32_t n = t->count;
+    const uint32_t buckets = n / PHASH_LOAD + 1;
+    uint64_t *hashes = (uint64_t *)malloc(sizeof(uint64_t) * n);
+    uint32_t *order = (uint32_t *)malloc(sizeof(uint32_t) * n);
+    uint32_t *start = (uint32_t *)calloc(buckets + 1, sizeof(uint32_t));
+    uint32_t *by_size = (uint32_t *)malloc(sizeof(uint32_t) * buckets);
+    uint32_t *size_count = (uint32_t *)calloc(n + 2, sizeof(uint32_t));
+    uint32_t *tried = (uint32_t *)malloc(sizeof(uint32_t) * n);
+    uint8_t *used = (uint8_t *)malloc(n);
+    int rc = -1;
+
+    t->entry.kind = SYMBOL_PHASH;
+    t->entry.size = n;
+    t->entry.buckets = buckets;
+    t->disp = (uint32_t *)calloc(buckets, sizeof(uint32_t));
+    t->keys = (int64_t *)malloc(sizeof(int64_t) * n);
+    t->names = (uint32_t *)calloc(n + 1, sizeof(uint32_t));
+    if (!hashes || !order || !start || !by_size || !size_count || !tried || !used ||
+        !t->disp || !t->keys || !t->names) {
+        goto done;
+    }
+
+    for (uint32_t attempt = 0; attempt < PHASH_MAX_SEEDS && rc != 0; attempt++) {
+        const uint64_t seed = symbol_hash(0x5EED000000000000ULL + attempt);
+
+        /* Group keys by bucket (counting sort) */
+        memset(start, 0, sizeof(uint32_t) * (buckets + 1));
+        for (uint32_t i = 0; i < n; i++) {
+            hashes[i] = symbol_hash((uint64_t)t->symbols[i].value ^ seed);
+            start[symbol_bucket(hashes[i], buckets) + 1]++;
+        }
+        for (uint32_t b = 0; b < buckets; b++) start[b + 1] += start[b];
+        for (uint32_t i = 0; i < n; i++) order[start[symbol_bucket(hashes[i], buckets)]++] = i;
+        for (uint32_t b = buckets; b > 0; b--) start[b] = start[b - 1];
+        start[0] = 0;
+
+        /* Largest buckets first, while most slots are free */
+        memset(size_count, 0, sizeof(uint32_t) * (n + 2));
+        for (uint32_t b = 0; b < buckets; b++) size_count[n - (start[b + 1] - start[b])]++;
+        for (uint32_t s = 1; s <= n; s++) size_count[s] += size_count[s - 1];
+        for (uint32_t b = buckets; b-- > 0;) {
+            by_size[--size_count[n - (start[b + 1] - start[b])]] = b;
+        }
+
+        memset(used, 0, n);
+        memset(t->disp, 0, sizeof(uint32_t) * buckets);
+        rc = 0;
+        for (uint32_t k = 0; k < buckets && rc == 0; k++) {
+            const uint32_t b = by_size[k];
+            const uint32_t first = start[b], count = start[b + 1] - start[b];
+            uint32_t d;
+
+            if (count == 0) break;
+            for (d = 0; d < PHASH_MAX_DISPLACE; d++) {
+                uint32_t j;
+                for (j = 0; j < count; j++) {
+                    uint32_t slot = symbol_slot(hashes[order[first + j]], d, n);
+                    uint32_t m = 0;
+                    if (used[slot]) break;
+                    while (m < j && tried[m] != slot) m++;
+                    if (m < j) break;
+                    tried[j] = slot;
+                }
+                if (j == count) break;
+            }
+            if (d == PHASH_MAX_DISPLACE) {
+                rc = -1;
+                break;
+            }
+            t->disp[b] = d;
+            for (uint32_t j = 0; j < count; j++) {
+                const build_symbol_t *s = &t->symbols[order[first + j]];
+                used[tried[j]] = 1;
+                t->keys[tried[j]] = s->value;
+                t->names[tried[j]] = s->name;
+            }
+        }
+        t->entry.seed = seed;
+    }
+
+done:
+    free(hashes);
+    free(order);
+    free(start);
+    free(by_size);
+    free(size_count);
+    free(tried);
+    free(used);
+    return rc;
+}
+
+static int parse_value(const char *key, size_t len, int64_t *value)
+{
+    char buf[32];
+    char *end;
+
+    if (len == 0 || len >= sizeof(buf)) return -1;
+    memcpy(buf, key, len);
+    buf[len] = '\0';
+    errno = 0;
+    *value = strtoll(buf, &end, 0);
+    return errno == 0 && *end == '\0' ? 0 : -1;
+}
+
+static int collect_tables(const json_node_t *root, build_table_t *tables, string_pool_t *pool)
+{
+    uint32_t t = 0;
+
+    for (const json_node_t *map = root->child; map; map = map->next, t++) {
+        build_table_t *table = &tables[t];
+        long name = add_string(pool, map->key, map->key_len);
+        uint32_t count = 0;
+
+        if (name < 0) return -1;
+        table->name = (uint32_t)name;
+        if (map->type != JSON_OBJECT) {
+            fprintf(stderr, "symbol_file_build_json: %.*s is not an object\n", (int)map->key_len, map->key);
+            return -1;
+        }
+        for (const json_node_t *s = map->child; s; s = s->next) count++;
+        table->symbols = (build_symbol_t *)malloc(sizeof(build_symbol_t) * (count ? count : 1));
+        if (!table->symbols) return -1;
+
+        for (const json_node_t *s = map->child; s; s = s->next) {
+            build_symbol_t *sym = &table->symbols[table->count];
+            long symbol_name;
+            if (s->type != JSON_STRING || parse_value(s->key, s->key_len, &sym->value) != 0) {
+                fprintf(stderr, "symbol_file_build_json: %.*s: bad entry \"%.*s\"\n",
+                        (int)map->key_len, map->key, (int)s->key_len, s->key);
+                return -1;
+            }
+            symbol_name = add_string(pool, s->str, s->str_len);
+            if (symbol_name < 0) return -1;
+            sym->name = (uint32_t)symbol_name;
+            table->count++;
+        }
+
+        qsort(table->symbols, table->count, sizeof(build_symbol_t), compare_symbols);
+        for (uint32_t i = 1; i < table->count; i++) {
+            if (table->symbols[i].value == table->symbols[i - 1].value) {
+                fprintf(stderr, "symbol_file_build_json: %.*s: value %lld listed twice\n",
+                        (int)map->key_len, map->key, (long long)table->symbols[i].value);
+                return -1;
+            }
+        }
+    }
+    return 0;
+}
+
+static uint64_t align8(uint64_t n)
+{
+    return (n + 7) & ~7ULL;
+}
+
+static int write_image(const char *path, const void *image, size_t size)
+{
+    char tmp[4096];
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+
+    FILE *f = fopen(tmp, "wb");
+    if (!f) {
+        fprintf(stderr, "symbol_file_build_json: cannot create %s: %s\n", tmp, strerror(errno));
+        return -1;
+    }
+    int rc = fwrite(image, 1, size, f) == size ? 0 : -1;
+    if (fclose(f) != 0) rc = -1;
+    if (rc == 0 && rename(tmp, path) != 0) rc = -1;
+    if (rc != 0) {
+        fprintf(stderr, "symbol_file_build_json: writing %s failed: %s\n", path, strerror(errno));
+        unlink(tmp);
+    }
+    return rc;
+}
+
+int symbol_file_build_json(const char *json, size_t len, const char *path)
+{
+    const char *error = NULL;
+    size_t error_offset = 0;
+    string_pool_t pool = { NULL, 0, 0 };
+    build_table_t *tables = NULL;
+    uint8_t *image = NULL;
+    uint32_t num_tables = 0;
+    int rc = -1;
+
+    json_node_t *root = json_parse(json, len, &error, &error_offset);
+    if (!root) {
+        fprintf(stderr, "symbol_file_build_json: %s at offset %zu\n", error, error_offset);
+        return -1;
+    }
+    if (root->type != JSON_OBJECT) {
+        fprintf(stderr, "symbol_file_build_json: expected an object of symbol maps\n");
+        goto done;
+    }
+
+    for (const json_node_t *m = root->child; m; m = m->next) num_tables++;
+    tables = (build_table_t *)calloc(num_tables ? num_tables : 1, sizeof(build_table_t));
+    if (!tables || add_string(&pool, "", 0) != 0) goto done;
+    if (collect_tables(root, tables, &pool) != 0) goto done;
+
+    for (uint32_t t = 0; t < num_tables; t++) {
+        build_table_t *table = &tables[t];
+        uint64_t range = table->count ? (uint64_t)table->symbols[table->count - 1].value -
+                                        (uint64_t)table->symbols[0].value + 1 : 0;
+
+        table->name_str = pool.data + table->name;
+        table->entry.name = table->name;
+        table->entry.num_symbols = table->count;
+        /* Dense while the array stays within a few entries per symbol */
+        int built = (table->count == 0 || (range != 0 && range <= 4ULL * table->count + 64))
+                  ? build_dense(table, range)
+                  : build_phash(table);
+        if (built != 0) {
+            fprintf(stderr, "symbol_file_build_json: cannot build table %s\n", table->name_str);
+            goto done;
+        }
+    }
+    qsort(tables, num_tables, sizeof(build_table_t), compare_tables);
+
+    /* Lay out: header, directory, per-table arrays, strings */
+    uint64_t offset = align8(sizeof(symbol_file_header_t));
+    const uint64_t tables_offset = offset;
+    offset = align8(offset + sizeof(symbol_file_entry_t) * num_tables);
+    for (uint32_t t = 0; t < num_tables; t++) {
+        symbol_file_entry_t *e = &tables[t].entry;
+        e->names_offset = offset;
+        offset = align8(offset + sizeof(uint32_t) * ((uint64_t)e->size + 1));
+        if (e->kind == SYMBOL_PHASH) {
+            e->keys_offset = offset;
+            offset = align8(offset + sizeof(int64_t) * e->size);
+            e->disp_offset = offset;
+            offset = align8(offset + sizeof(uint32_t) * e->buckets);
+        }
+    }
+    const uint64_t strings_offset = offset;
+    const uint64_t file_size = strings_offset + pool.size;
+
+    image = (uint8_t *)calloc(1, file_size);
+    if (!image) goto done;
+
+    symbol_file_header_t *header = (symbol_file_header_t *)image;
+    memcpy(header->magic, SYMBOL_FILE_MAGIC, sizeof(header->magic));
+    header->byte_order = SYMBOL_BYTE_ORDER;
+    header->num_tables = num_tables;
+    header->file_size = file_size;
+    header->tables_offset = tables_offset;
+    header->strings_offset = strings_offset;
+    header->strings_size = pool.size;
+
+    for (uint32_t t = 0; t < num_tables; t++) {
+        const build_table_t *table = &tables[t];
+        const symbol_file_entry_t *e = &table->entry;
+        memcpy(image + tables_offset + sizeof(*e) * t, e, sizeof(*e));
+        memcpy(image + e->names_offset, table->names, sizeof(uint32_t) * ((size_t)e->size + 1));
+        if (e->kind == SYMBOL_PHASH) {
+            memcpy(image + e->keys_offset, table->keys, sizeof(int64_t) * e->size);
+            memcpy(image + e->disp_offset, table->disp, sizeof(uint32_t) * e->buckets);
+        }
+    }
+    memcpy(image + strings_offset, pool.data, pool.size);
+
+    rc = write_image(path, image, (size_t)file_size);
+
+done:
+    for (uint32_t t = 0; tables && t < num_tables; t++) {
+        free(tables[t].symbols);
+        free(tables[t].names);
+        free(tables[t].keys);
+        free(tables[t].disp);
+    }
+    free(tables);
+    free(image);
+    free(pool.data);
+    json_free(root);
+    return rc;
+}
+
+/* =============================
+ * Mapping
+ * ============================= */
+
+static int in_file(uint64_t offset, uint64_t length, uint64_t align, size_t file_size)
+{
+    return offset % align == 0 && offset <= file_size && length <= file_size - offset;
+}
+
+static int check_entry(const uint8_t *base, size_t size, const symbol_file_header_t *h,
+                       const symbol_file_entry_t *e)
+{
+    if (e->name >= h->strings_size) return -1;
+    if (e->kind != SYMBOL_DENSE && e->kind != SYMBOL_PHASH) return -1;
+    if (!in_file(e->names_offset, 4ULL * ((uint64_t)e->size + 1), 4, size)) return -1;
+    if (e->kind == SYMBOL_PHASH) {
+        if (e->size == 0 || e->buckets == 0) return -1;
+        if (!in_file(e->keys_offset, 8ULL * e->size, 8, size)) return -1;
+        if (!in_file(e->disp_offset, 4ULL * e->buckets, 4, size)) return -1;
+    }
+
+    /* One pass over the name offsets so lookups never need a bounds check */
+    const uint32_t *names = (const uint32_t *)(base + e->names_offset);
+    for (uint64_t i = 0; i <= e->size; i++) {
+        if (names[i] >= h->strings_size) return -1;
+    }
+    return names[e->size] == 0 ? 0 : -1;
+}
+
+int symbol_file_open(symbol_file_t *file, const char *path)
+{
+    struct stat st;
+
+    memset(file, 0, sizeof(*file));
+    int fd = open(path, O_RDONLY | O_CLOEXEC);
+    if (fd < 0) {
+        fprintf(stderr, "symbol_file_open: cannot open %s: %s\n", path, strerror(errno));
+        return -1;
+    }
+    if (fstat(fd, &st) != 0 || st.st_size < (off_t)sizeof(symbol_file_header_t)) {
+        fprintf(stderr, "symbol_file_open: %s is too small\n", path);
+        close(fd);
+        return -1;
+    }
+
+    void *map = mmap(NULL, (size_t)st.st_size, PROT_READ, MAP_SHARED, fd, 0);
+    close(fd);
+    if (map == MAP_FAILED) {
+        fprintf(stderr, "symbol_file_open: mmap of %s failed: %s\n", path, strerror(errno));
+        return -1;
+    }
+    file->map = map;
+    file->map_size = (size_t)st.st_size;
+
+    const uint8_t *base = (const uint8_t *)map;
+    const symbol_file_header_t *h = (const symbol_file_header_t *)map;
+    if (memcmp(h->magic, SYMBOL_FILE_MAGIC, sizeof(h->magic)) != 0 ||
+        h->byte_order != SYMBOL_BYTE_ORDER || h->file_size != file->map_size ||
+        !in_file(h->tables_offset, sizeof(symbol_file_entry_t) * (uint64_t)h->num_tables, 8, file->map_size) ||
+        !in_file(h->strings_offset, h->strings_size, 1, file->map_size) ||
+        h->strings_size == 0 || base[h->strings_offset] != '\0' ||
+        base[h->strings_offset + h->strings_size - 1] != '\0') {
+        fprintf(stderr, "symbol_file_open: %s is not a symbol table file for this host\n", path);
+        symbol_file_close(file);
+        return -1;
+    }
+
+    file->tables = (symbol_table_t *)calloc(h->num_tables ? h->num_tables : 1, sizeof(symbol_table_t));
+    if (!file->tables) {
+        symbol_file_close(file);
+        return -1;
+    }
+
+    const char *strings = (const char *)(base + h->strings_offset);
+    const symbol_file_entry_t *entries = (const symbol_file_entry_t *)(base + h->tables_offset);
+    for (uint32_t t = 0; t < h->num_tables; t++) {
+        const symbol_file_entry_t *e = &entries[t];
+        symbol_table_t *table = &file->tables[t];
+
+        if (check_entry(base, file->map_size, h, e) != 0) {
+            fprintf(stderr, "symbol_file_open: %s: table %u is corrupt\n", path, t);
+            symbol_file_close(file);
+            return -1;
+        }
+        table->name = strings + e->name;
+        table->strings = strings;
+        table->names = (const uint32_t *)(base + e->names_offset);
+        table->keys = e->kind == SYMBOL_PHASH ? (const int64_t *)(base + e->keys_offset) : NULL;
+        table->disp = e->kind == SYMBOL_PHASH ? (const uint32_t *)(base + e->disp_offset) : NULL;
+        table->min_value = e->min_value;
+        table->seed = e->seed;
+        table->kind = e->kind;
+        table->size = e->size;
+        table->buckets = e->buckets;
+        table->num_symbols = e->num_symbols;
+    }
+    file->num_tables = h->num_tables;
+    return 0;
+}
+
+void symbol_file_close(symbol_file_t *file)
+{
+    if (file->map) munmap(file->map, file->map_size);
+    free(file->tables);
+    memset(file, 0, sizeof(*file));
+}
+
+const symbol_table_t *symbol_file_find(const symbol_file_t *file, const char *name)
+{
+    uint32_t lo = 0, hi = file->num_tables;
+
+    while (lo < hi) {
+        uint32_t mid = lo + (hi - lo) / 2;
+        int cmp = strcmp(file->tables[mid].name, name);
+        if (cmp == 0) return &file->tables[mid];
+        if (cmp < 0) lo = mid + 1;
+        else hi = mid;
+    }
+    return NULL;
+}
@@ -0,0 +1,161 @@
+#ifndef SYMBOL_TABLE_H
+#define SYMBOL_TABLE_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * Read-only value -> name tables for decoded fields, the native side of
+ * StructParser.associate_field_symbols() / get_symbol().
+ *
+ * symbol_file_build_json() compiles the maps exported with
+ * StructParser.symbols_to_json() into one binary file; symbol_file_open()
+ * maps it and is ready after validating a few offsets. Each "struct.field"
+ * map becomes one of:
+ *  - SYMBOL_DENSE: values span a small range, names[value - min] directly;
+ *  - SYMBOL_PHASH: a minimal perfect hash (hash and displace): the
+ *    bucket's displacement picks the one slot the value can occupy, and a
+ *    single key compare confirms it.
+ * Neither lookup loops or branches on the value: out-of-range indexes are
+ * clamped to a sentinel and the key check is a select, so misses cost
+ * the same as hits.
+ *
+ * The file is written in host byte order and rejected elsewhere.
+ */
+
+#define SYMBOL_FILE_MAGIC   "SYMTAB01"
+#define SYMBOL_BYTE_ORDER   0x01020304U
+
+typedef enum symbol_kind_t {
+    SYMBOL_DENSE = 0,
+    SYMBOL_PHASH = 1
+} symbol_kind_t;
+
+/* ----- On-disk format (all offsets from the start of the file) ----- */
+
+typedef struct symbol_file_header_t {
+    char magic[8];
+    uint32_t byte_order;
+    uint32_t num_tables;
+    uint64_t file_size;
+    uint64_t tables_offset;         /* symbol_file_entry_t[num_tables], sorted by name */
+    uint64_t strings_offset;        /* NUL-terminated names; offset 0 is "" (no symbol) */
+    uint64_t strings_size;
+} symbol_file_header_t;
+
+typedef struct symbol_file_entry_t {
+    uint32_t name;                  /* "struct.field", offset into strings */
+    uint32_t kind;
+    int64_t min_value;              /* dense: value of names[0] */
+    uint64_t seed;                  /* phash: hash seed */
+    uint32_t size;                  /* dense: value range; phash: slots */
+    uint32_t buckets;               /* phash */
+    uint32_t num_symbols;
+    uint32_t reserved;
+    uint64_t names_offset;          /* uint32_t[size + 1]; names[size] is 0 */
+    uint64_t keys_offset;           /* phash: int64_t[size] */
+    uint64_t disp_offset;           /* phash: uint32_t[buckets] */
+} symbol_file_entry_t;
+
+/* ----- Mapped tables ----- */
+
+typedef struct symbol_table_t {
+    const char *name;
+    const char *strings;
+    const uint32_t *names;
+    const int64_t *keys;
+    const uint32_t *disp;
+    int64_t min_value;
+    uint64_t seed;
+    uint32_t kind;
+    uint32_t size;
+    uint32_t buckets;
+    uint32_t num_symbols;
+} symbol_table_t;
+
+typedef struct symbol_file_t {
+    void *map;
+    size_t map_size;
+    uint32_t num_tables;
+    symbol_table_t *tables;         /* sorted by name */
+} symbol_file_t;
+
+/**
+ * Compile a symbol map JSON document ({"struct.field": {"value": "NAME",
+ * ...}, ...}) into a table file at `path`. The file is written under a
+ * temporary name and renamed, so readers never map a partial file.
+ * Returns 0 on success.
+ */
+int symbol_file_build_json(const char *json, size_t len, const char *path);
+
+/**
+ * Map a table file read-only. Returns 0 on success.
+ */
+int symbol_file_open(symbol_file_t *file, const char *path);
+
+/**
+ * Unmap the file. Names returned by lookups become invalid.
+ */
+void symbol_file_close(symbol_file_t *file);
+
+/**
+ * Table for "struct.field", or NULL.
+ */
+const symbol_table_t *symbol_file_find(const symbol_file_t *file, const char *name);
+
+/* splitmix64 finaliser */
+static inline uint64_t symbol_hash(uint64_t x)
+{
+    x ^= x >> 30;
+    x *= 0xBF58476D1CE4E5B9ULL;
+    x ^= x >> 27;
+    x *= 0x94D049BB133111EBULL;
+    x ^= x >> 31;
+    return x;
+}
+
+/* Multiply-shift range reduction: maps 32 hash bits onto [0, n) */
+static inline uint32_t symbol_reduce(uint64_t h, uint32_t n)
+{
+    return (uint32_t)(((h >> 32) * n) >> 32);
+}
+
+static inline uint32_t symbol_bucket(uint64_t h, uint32_t buckets)
+{
+    return symbol_reduce(h, buckets);
+}
+
+static inline uint32_t symbol_slot(uint64_t h, uint32_t displacement, uint32_t slots)
+{
+    return symbol_reduce(symbol_hash(h ^ ((uint64_t)displacement * 0x9E3779B97F4A7C15ULL)), slots);
+}
+
+/**
+ * Name for `value`, or NULL if the map has none.
+ */
+static inline const char *symbol_lookup(const symbol_table_t *table, int64_t value)
+{
+    uint32_t name;
+
+    /* Per-table, not per-value: always predicted */
+    if (table->kind == SYMBOL_DENSE) {
+        uint64_t i = (uint64_t)value - (uint64_t)table->min_value;
+        i = i < table->size ? i : table->size;
+        name = table->names[i];
+    } else {
+        uint64_t h = symbol_hash((uint64_t)value ^ table->seed);
+        uint32_t slot = symbol_slot(h, table->disp[symbol_bucket(h, table->buckets)], table->size);
+        name = table->keys[slot] == value ? table->names[slot] : 0;
+    }
+    return name ? table->strings + name : NULL;
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // SYMBOL_TABLE_H
@@ -0,0 +1,153 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "platform.h"
+#include "symbol_table.h"
+#include "xoshiro.h"
+
+/**
+ * Build and query native symbol tables:
+ *
+ *   symtab_main build <symbols.json> <tables.bin>
+ *   symtab_main lookup <tables.bin> <struct.field> <value>...
+ *   symtab_main dump <tables.bin>
+ *   symtab_main bench <tables.bin> <struct.field> [lookups]
+ *
+ * symbols.json is what StructParser.symbols_to_json() returns.
+ */
+
+static char *read_file(const char *path, size_t *len)
+{
+    FILE *f = fopen(path, "rb");
+    size_t cap = 1 << 16, n = 0, got;
+    char *buf;
+
+    if (!f) {
+        fprintf(stderr, "Cannot open %s\n", path);
+        return NULL;
+    }
+    buf = (char *)malloc(cap);
+    while (buf && (got = fread(buf + n, 1, cap - n, f)) > 0) {
+        n += got;
+        if (n == cap) {
+            char *bigger = (char *)realloc(buf, cap * 2);
+            if (!bigger) {
+                free(buf);
+                buf = NULL;
+                break;
+            }
+            buf = bigger;
+            cap *= 2;
+        }
+    }
+    fclose(f);
+    *len = n;
+    return buf;
+}
+
+static int run_build(const char *json_path, const char *out_path)
+{
+    size_t len = 0;
+    char *json = read_file(json_path, &len);
+    if (!json) return 1;
+
+    unsigned long long start = platform_time_ns();
+    int rc = symbol_file_build_json(json, len, out_path);
+    free(json);
+    if (rc != 0) return 1;
+
+    symbol_file_t file;
+    if (symbol_file_open(&file, out_path) != 0) return 1;
+    printf("[Main] %u tables written to %s (%zu bytes) in %.3f ms\n", file.num_tables, out_path,
+           file.map_size, (double)(platform_time_ns() - start) / 1e6);
+    symbol_file_close(&file);
+    return 0;
+}
+
+static void run_dump(const symbol_file_t *file)
+{
+    for (uint32_t t = 0; t < file->num_tables; t++) {
+        const symbol_table_t *table = &file->tables[t];
+        printf("%s: %u symbols, %s", table->name, table->num_symbols,
+               table->kind == SYMBOL_DENSE ? "dense" : "perfect hash");
+        if (table->kind == SYMBOL_DENSE) printf(" [%lld, +%u)\n", (long long)table->min_value, table->size);
+        else printf(" (%u slots, %u buckets)\n", table->size, table->buckets);
+    }
+}
+
+/* Looks up a random mix of known values and misses */
+static int run_bench(const symbol_table_t *table, unsigned long long lookups)
+{
+    enum { SAMPLE = 4096 };
+    int64_t values[SAMPLE];
+    xoshiro_t rng;
+    uint32_t known = 0;
+
+    xoshiro_seed(&rng, 42);
+    for (uint32_t i = 0; i < SAMPLE; i++) {
+        uint64_t r = xoshiro_next(&rng);
+        if (table->kind == SYMBOL_DENSE) {
+            values[i] = table->min_value + (int64_t)(r % ((uint64_t)table->size + 8));
+        } else {
+            /* Half hits from the key array, half random misses */
+            values[i] = (r & 1) ? table->keys[(r >> 1) % table->size] : (int64_t)r;
+        }
+    }
+
+    unsigned long long start = platform_time_ns();
+    for (unsigned long long i = 0; i < lookups; i++) {
+        known += symbol_lookup(table, values[i & (SAMPLE - 1)]) != NULL;
+    }
+    unsigned long long elapsed = platform_time_ns() - start;
+
+    printf("[Main] %llu lookups in %.3f ms: %.2f ns/lookup, %u hits\n", lookups,
+           (double)elapsed / 1e6, (double)elapsed / (double)lookups, known);
+    return 0;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc < 3) {
+        fprintf(stderr, "usage: %s build <symbols.json> <tables.bin>\n", argv[0]);
+        fprintf(stderr, "       %s lookup <tables.bin> <struct.field> <value>...\n", argv[0]);
+        fprintf(stderr, "       %s dump <tables.bin>\n", argv[0]);
+        fprintf(stderr, "       %s bench <tables.bin> <struct.field> [lookups]\n", argv[0]);
+        return 1;
+    }
+    if (strcmp(argv[1], "build") == 0) {
+        if (argc < 4) {
+            fprintf(stderr, "build needs <symbols.json> <tables.bin>\n");
+            return 1;
+        }
+        return run_build(argv[2], argv[3]);
+    }
+
+    symbol_file_t file;
+    if (symbol_file_open(&file, argv[2]) != 0) return 1;
+
+    int rc = 0;
+    if (strcmp(argv[1], "dump") == 0) {
+        run_dump(&file);
+    } else if (argc < 4) {
+        fprintf(stderr, "%s needs <struct.field>\n", argv[1]);
+        rc = 1;
+    } else {
+        const symbol_table_t *table = symbol_file_find(&file, argv[3]);
+        if (!table) {
+            fprintf(stderr, "No symbols for %s\n", argv[3]);
+            rc = 1;
+        } else if (strcmp(argv[1], "lookup") == 0) {
+            for (int i = 4; i < argc; i++) {
+                const char *name = symbol_lookup(table, strtoll(argv[i], NULL, 0));
+                printf("%s = %s\n", argv[i], name ? name : "(none)");
+            }
+        } else if (strcmp(argv[1], "bench") == 0) {
+            rc = run_bench(table, argc > 4 ? strtoull(argv[4], NULL, 0) : 100000000ULL);
+        } else {
+            fprintf(stderr, "Unknown command %s\n", argv[1]);
+            rc = 1;
+        }
+    }
+    symbol_file_close(&file);
+    return rc;
+}
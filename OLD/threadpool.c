@@ -4,12 +4,18 @@
 
 /* Forward declarations for internal functions */
 static void queue_init(task_queue_t *q);
-static void queue_destroy(task_queue_t *q);
-static void queue_push(task_queue_t *q, task_func_t func, void *arg);
+static void queue_destroy(task_queue_t *q, object_pool_t *nodes);
+static int queue_push(task_queue_t *q, object_pool_t *nodes, task_func_t func, void *arg);
 static task_node_t* queue_pop(task_queue_t *q);
 
 static void* worker_thread(void *arg);
 
+/* Scratch arena of the pool worker running on this thread */
+static __thread arena_t *t_scratch;
+
+/* Its registration with the pool's epoch domain */
+static __thread ebr_thread_t *t_reclaimer;
+
 /* =============================
  * Public API Implementations
  * ============================= */
@@ -25,14 +31,51 @@ void thread_pool_init(thread_pool_t *pool, int num_threads)
         return;
     }
 
+    if (object_pool_init(&pool->nodes, sizeof(task_node_t), 0) != 0) {
+        fprintf(stderr, "thread_pool_init: failed to set up the task node pool\n");
+        free(pool->threads);
+        pool->threads = NULL;
+        return;
+    }
+    if (ebr_init(&pool->reclaim) != 0) {
+        fprintf(stderr, "thread_pool_init: failed to set up the epoch domain\n");
+        object_pool_destroy(&pool->nodes);
+        free(pool->threads);
+        pool->threads = NULL;
+        return;
+    }
+
+    /* Registered up front, so a worker can never start without one */
+    int registered = 0;
+    pool->started = 0;
+    pool->reclaimers = (ebr_thread_t **)calloc((size_t)num_threads, sizeof(ebr_thread_t *));
+    while (pool->reclaimers && registered < num_threads &&
+           (pool->reclaimers[registered] = ebr_register(&pool->reclaim)) != NULL) {
+        registered++;
+    }
+    if (registered < num_threads) {
+        fprintf(stderr, "thread_pool_init: failed to register workers with the epoch domain\n");
+        for (int i = 0; i < registered; i++) ebr_unregister(pool->reclaimers[i]);
+        free(pool->reclaimers);
+        pool->reclaimers = NULL;
+        ebr_destroy(&pool->reclaim);
+        object_pool_destroy(&pool->nodes);
+        free(pool->threads);
+        pool->threads = NULL;
+        return;
+    }
+
     queue_init(&pool->queue);
     pool->keep_running = 1; // set to 1 so threads keep running
 
     /* Create worker threads */
     for (int i = 0; i < num_threads; i++) {
         if (platform_thread_create(&pool->threads[i], worker_thread, pool) != 0) {
-            fprintf(stderr, "Error creating thread %d\n", i);
-            // In production code, you might handle partial creation
+            /* Carry on with the ones that started; the rest give back their registrations */
+            fprintf(stderr, "Error creating thread %d, running with %d\n", i, i);
+            for (int j = i; j < num_threads; j++) ebr_unregister(pool->reclaimers[j]);
+            pool->num_threads = i;
+            break;
         }
     }
 }
@@ -41,18 +84,21 @@ void thread_pool_shutdown(thread_pool_t *pool)
 {
     if (!pool || !pool->threads) return;
 
-    /* Tell workers to stop */
-    pool->keep_running = 0;
+    /* Tell workers to stop; they read the flag outside the lock too */
+    __atomic_store_n(&pool->keep_running, 0, __ATOMIC_RELEASE);
 
     /* Wake up all threads waiting for tasks */
     platform_mutex_lock(&pool->queue.lock);
     platform_cond_broadcast(&pool->queue.cond);
     platform_mutex_unlock(&pool->queue.lock);
 
-    /* Join all threads */
+    /* Join all threads, then give back their registrations */
     for (int i = 0; i < pool->num_threads; i++) {
         platform_thread_join(pool->threads[i]);
+        ebr_unregister(pool->reclaimers[i]);
     }
+    free(pool->reclaimers);
+    pool->reclaimers = NULL;
 
     /* Clean up thread array */
     free(pool->threads);
@@ -60,13 +106,27 @@ void thread_pool_shutdown(thread_pool_t *pool)
     pool->num_threads = 0;
 
     /* Clean up the queue */
-    queue_destroy(&pool->queue);
+    queue_destroy(&pool->queue, &pool->nodes);
+    object_pool_destroy(&pool->nodes);
+
+    /* Every worker has left, so whatever is still retired can go */
+    ebr_destroy(&pool->reclaim);
 }
 
-void thread_pool_add_task(thread_pool_t *pool, task_func_t func, void *arg)
+int thread_pool_add_task(thread_pool_t *pool, task_func_t func, void *arg)
 {
-    if (!pool) return;
-    queue_push(&pool->queue, func, arg);
+    if (!pool || !pool->threads || pool->num_threads == 0) return -1;
+    return queue_push(&pool->queue, &pool->nodes, func, arg);
+}
+
+arena_t *thread_pool_scratch(void)
+{
+    return t_scratch;
+}
+
+ebr_thread_t *thread_pool_reclaimer(void)
+{
+    return t_reclaimer;
 }
 
 /* =============================
@@ -77,16 +137,23 @@ static void* worker_thread(void *arg)
     thread_pool_t *pool = (thread_pool_t *)arg;
     if (!pool) return NULL;
 
-    while (pool->keep_running) {
+    ebr_thread_t *reclaimer = pool->reclaimers[__atomic_fetch_add(&pool->started, 1, __ATOMIC_RELAXED)];
+    t_reclaimer = reclaimer;
+
+    arena_t scratch;
+    arena_init(&scratch);
+    t_scratch = &scratch;
+
+    while (__atomic_load_n(&pool->keep_running, __ATOMIC_ACQUIRE)) {
         platform_mutex_lock(&pool->queue.lock);
 
         /* Wait for a task if queue is empty and still running */
-        while (pool->queue.front == NULL && pool->keep_running) {
+        while (pool->queue.front == NULL && __atomic_load_n(&pool->keep_running, __ATOMIC_ACQUIRE)) {
             platform_cond_wait(&pool->queue.cond, &pool->queue.lock);
             /* If we were signalled to stop, break out */
-            if (!pool->keep_running) {
+            if (!__atomic_load_n(&pool->keep_running, __ATOMIC_ACQUIRE)) {
                 platform_mutex_unlock(&pool->queue.lock);
-                return NULL;
+                goto done;
             }
         }
 
@@ -94,12 +161,25 @@ static void* worker_thread(void *arg)
         task_node_t *task = queue_pop(&pool->queue);
         platform_mutex_unlock(&pool->queue.lock);
 
-        /* Run the task */
+        /*
+         * Run the task inside a critical region, so it can read lock-free
+         * structures as it likes; leaving it between tasks is the
+         * worker's quiescent state. Then drop whatever the task left in
+         * the scratch arena.
+         */
         if (task) {
+            ebr_enter(reclaimer);
             task->func(task->arg);
-            free(task);
+            ebr_exit(reclaimer);
+            object_pool_free(&pool->nodes, task);
+            arena_reset(&scratch);
         }
     }
+
+done:
+    t_scratch = NULL;
+    arena_destroy(&scratch);
+    t_reclaimer = NULL;
     return NULL;
 }
 
@@ -114,14 +194,14 @@ static void queue_init(task_queue_t *q)
     platform_cond_init(&q->cond);
 }
 
-static void queue_destroy(task_queue_t *q)
+static void queue_destroy(task_queue_t *q, object_pool_t *nodes)
 {
     /* Free any remaining tasks in the queue */
     task_node_t *temp;
     while (q->front) {
         temp = q->front;
         q->front = q->front->next;
-        free(temp);
+        object_pool_free(nodes, temp);
     }
     q->rear = NULL;
 
@@ -129,12 +209,12 @@ static void queue_destroy(task_queue_t *q)
     platform_cond_destroy(&q->cond);
 }
 
-static void queue_push(task_queue_t *q, task_func_t func, void *arg)
+static int queue_push(task_queue_t *q, object_pool_t *nodes, task_func_t func, void *arg)
 {
-    task_node_t *node = (task_node_t *)malloc(sizeof(task_node_t));
+    task_node_t *node = (task_node_t *)object_pool_alloc(nodes);
     if (!node) {
         fprintf(stderr, "queue_push: failed to allocate task_node\n");
-        return;
+        return -1;
     }
     node->func = func;
     node->arg = arg;
@@ -154,6 +234,7 @@ static void queue_push(task_queue_t *q, task_func_t func, void *arg)
     platform_cond_signal(&q->cond);
 
     platform_mutex_unlock(&q->lock);
+    return 0;
 }
 
 static task_node_t* queue_pop(task_queue_t *q)
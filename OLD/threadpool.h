@@ -5,7 +5,10 @@
 extern "C" {
 #endif
 
+#include "arena.h"
+#include "object_pool.h"
 #include "platform.h"
+#include "reclaim.h"
 
 /**
  * Function pointer type for tasks the thread pool will execute.
@@ -36,19 +39,29 @@ typedef struct task_queue_t {
  *  - `threads` is an array of platform_thread_t handles.
  *  - `num_threads` is the fixed size of the pool.
  *  - `queue` is the task queue shared by all worker threads.
- *  - `keep_running` is a flag controlling the worker threads' shutdown logic.
+ *  - `nodes` supplies the queue's task nodes.
+ *  - `reclaim` is the epoch domain every worker is registered with.
+ *  - `reclaimers` holds the workers' registrations, made before they start.
+ *  - `keep_running` is a flag controlling the worker threads' shutdown logic,
+ *    accessed with __atomic builtins since workers poll it unlocked.
  */
 typedef struct thread_pool_t {
     platform_thread_t *threads;
     int num_threads;
 
     task_queue_t queue;
-    volatile int keep_running;
+    object_pool_t nodes;
+    ebr_t reclaim;
+    ebr_thread_t **reclaimers;
+    int started;                    /* workers that have taken their registration */
+    int keep_running;
 } thread_pool_t;
 
 /**
  * Initialises the thread pool with a given number of threads.
- * On success, spawns those threads, each waiting for tasks.
+ * On success, spawns those threads, each waiting for tasks. On failure
+ * nothing is left running and `threads` is NULL; if only some threads
+ * could be created, `num_threads` is lowered to those.
  */
 void thread_pool_init(thread_pool_t *pool, int num_threads);
 
@@ -60,9 +73,31 @@ void thread_pool_init(thread_pool_t *pool, int num_threads);
 void thread_pool_shutdown(thread_pool_t *pool);
 
 /**
- * Add a new task to the thread pool's queue.
+ * Add a new task to the thread pool's queue. Returns 0, or -1 if it
+ * could not be queued (out of memory, or the pool has no threads); the
+ * caller then still owns `arg` and should run the task itself or undo
+ * whatever it counted on the task doing.
  */
-void thread_pool_add_task(thread_pool_t *pool, task_func_t func, void *arg);
+int thread_pool_add_task(thread_pool_t *pool, task_func_t func, void *arg);
+
+/**
+ * Scratch arena of the calling pool worker, or NULL on any other thread.
+ * A task may allocate its temporaries here instead of with malloc: the
+ * worker resets the arena when the task returns, so nothing allocated in
+ * it may outlive the task.
+ */
+arena_t *thread_pool_scratch(void);
+
+/**
+ * Epoch registration of the calling pool worker, or NULL on any other
+ * thread. The worker is inside a critical region of its pool's domain
+ * for the whole of each task and outside it between tasks, so a task can
+ * read lock-free structures without ebr_enter()/ebr_exit() and retire
+ * what it unlinks with ebr_retire(thread_pool_reclaimer(), ...). A task
+ * that runs for long should call ebr_quiescent() now and then, since it
+ * holds back every free while it runs.
+ */
+ebr_thread_t *thread_pool_reclaimer(void);
 
 #ifdef __cplusplus
 }
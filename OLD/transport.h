@@ -0,0 +1,79 @@
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+
+#include "frame_parser.h"
+
+/**
+ * Frame transport between two peers.
+ *
+ * Producers and consumers of relay frames talk to a transport_t and do not
+ * care whether the other side is across the network (TCP socket) or in
+ * another process on the same host (shared-memory ring, see shm_ring.h).
+ * Frames handed to the receive callback are complete and validated; their
+ * memory is only valid during the callback.
+ */
+
+typedef struct transport_t transport_t;
+
+typedef struct transport_ops_t {
+    int (*send)(transport_t *t, const void *frame, size_t len);
+    int (*receive)(transport_t *t, frame_callback_t callback, void *ctx, int timeout_ms);
+    void (*close)(transport_t *t);
+} transport_ops_t;
+
+struct transport_t {
+    const transport_ops_t *ops;
+    frame_format_t format;
+};
+
+/**
+ * Send one complete frame. Blocks while the peer is not keeping up.
+ * Returns 0 on success, nonzero if the transport has failed.
+ */
+static inline int transport_send(transport_t *t, const void *frame, size_t len)
+{
+    return t->ops->send(t, frame, len);
+}
+
+/**
+ * Deliver every frame that arrives within `timeout_ms` (0 polls, -1 waits
+ * for at least one). Returns the number of frames delivered, or -1 when
+ * the peer has gone.
+ */
+static inline int transport_receive(transport_t *t, frame_callback_t callback, void *ctx,
+                                    int timeout_ms)
+{
+    return t->ops->receive(t, callback, ctx, timeout_ms);
+}
+
+/**
+ * Close and free the transport.
+ */
+static inline void transport_close(transport_t *t)
+{
+    if (t) t->ops->close(t);
+}
+
+/**
+ * TCP client transport. Returns NULL on failure.
+ */
+transport_t *transport_socket_connect(const char *host, unsigned short port,
+                                      const frame_format_t *format);
+
+/**
+ * Wrap an already connected stream socket (e.g. from accept()). The
+ * transport takes ownership of `fd`.
+ */
+transport_t *transport_socket_from_fd(int fd, const frame_format_t *format);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // TRANSPORT_H
@@ -0,0 +1,134 @@
+#include "transport.h"
+
+#include <errno.h>
+#include <netdb.h>
+#include <poll.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+
+/* =============================
+ * Socket transport
+ * ============================= */
+
+typedef struct socket_transport_t {
+    transport_t base;
+    int fd;
+    frame_parser_t parser;
+} socket_transport_t;
+
+static int socket_send(transport_t *t, const void *frame, size_t len)
+{
+    socket_transport_t *s = (socket_transport_t *)t;
+    const char *p = (const char *)frame;
+
+    while (len > 0) {
+        ssize_t n = send(s->fd, p, len, MSG_NOSIGNAL);
+        if (n < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        p += n;
+        len -= (size_t)n;
+    }
+    return 0;
+}
+
+static int socket_receive(transport_t *t, frame_callback_t callback, void *ctx, int timeout_ms)
+{
+    socket_transport_t *s = (socket_transport_t *)t;
+    struct pollfd pfd = { s->fd, POLLIN, 0 };
+    int delivered = 0;
+    int wait = timeout_ms;
+
+    for (;;) {
+        int rc = poll(&pfd, 1, wait);
+        if (rc < 0) {
+            if (errno == EINTR) continue;
+            return -1;
+        }
+        if (rc == 0) return delivered;
+
+        size_t available;
+        uint8_t *dst = frame_parser_write_ptr(&s->parser, &available);
+        ssize_t n = recv(s->fd, dst, available, 0);
+        if (n == 0) return delivered > 0 ? delivered : -1;
+        if (n < 0) {
+            if (errno == EINTR || errno == EAGAIN) continue;
+            return -1;
+        }
+        delivered += (int)frame_parser_commit(&s->parser, (size_t)n, callback, ctx);
+
+        /* Once something was delivered, only drain what is already queued */
+        if (delivered > 0) wait = 0;
+    }
+}
+
+static void socket_close(transport_t *t)
+{
+    socket_transport_t *s = (socket_transport_t *)t;
+    close(s->fd);
+    frame_parser_destroy(&s->parser);
+    free(s);
+}
+
+static const transport_ops_t g_socket_ops = {
+    socket_send,
+    socket_receive,
+    socket_close
+};
+
+transport_t *transport_socket_from_fd(int fd, const frame_format_t *format)
+{
+    socket_transport_t *s = (socket_transport_t *)calloc(1, sizeof(*s));
+    if (!s) return NULL;
+
+    if (frame_parser_init(&s->parser, format) != 0) {
+        free(s);
+        return NULL;
+    }
+    s->base.ops = &g_socket_ops;
+    s->base.format = *format;
+    s->fd = fd;
+
+    int one = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+    return &s->base;
+}
+
+transport_t *transport_socket_connect(const char *host, unsigned short port,
+                                      const frame_format_t *format)
+{
+    struct addrinfo hints, *res = NULL;
+    char service[8];
+
+    memset(&hints, 0, sizeof(hints));
+    hints.ai_socktype = SOCK_STREAM;
+    snprintf(service, sizeof(service), "%u", port);
+    if (getaddrinfo(host, service, &hints, &res) != 0) {
+        fprintf(stderr, "transport_socket_connect: cannot resolve %s\n", host);
+        return NULL;
+    }
+
+    int fd = -1;
+    for (struct addrinfo *ai = res; ai; ai = ai->ai_next) {
+        fd = socket(ai->ai_family, ai->ai_socktype | SOCK_CLOEXEC, ai->ai_protocol);
+        if (fd < 0) continue;
+        if (connect(fd, ai->ai_addr, ai->ai_addrlen) == 0) break;
+        close(fd);
+        fd = -1;
+    }
+    freeaddrinfo(res);
+    if (fd < 0) {
+        fprintf(stderr, "transport_socket_connect: cannot connect to %s:%u\n", host, port);
+        return NULL;
+    }
+
+    transport_t *t = transport_socket_from_fd(fd, format);
+    if (!t) close(fd);
+    return t;
+}
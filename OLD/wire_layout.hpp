@@ -0,0 +1,694 @@
+#ifndef WIRE_LAYOUT_HPP
+#define WIRE_LAYOUT_HPP
+
+/**
+ * Compile-time wire layouts (C++20).
+ *
+ * Declare a layout once and get offsets, masks, shifts, field accessors,
+ * whole-record encode/decode and the StructParser JSON from it:
+ *
+ *   using bit_fields_t = wire::layout<"bit_fields_t", wire::endian::little,
+ *       wire::bits<"msg_type", unsigned char, 4>,
+ *       wire::bits<"msg_source", unsigned char, 4>,
+ *       wire::scalar<"counter", unsigned char>,
+ *       wire::scalar<"length", unsigned short>>;
+ *
+ *   auto len = bit_fields_t::get<"length">(buf);
+ *   bit_fields_t::set<"msg_type">(buf, 3);
+ *   std::string json = wire::to_json<bit_fields_t>();
+ *
+ * Placement follows StructParser (bit_field_scanner.py) exactly, so the
+ * JSON matches what parse_struct() + to_json() produce for the same C
+ * typedef (`wire_layout_main check` compares the two):
+ *  - bit-fields are packed back to back from bit 0;
+ *  - scalars and arrays are aligned to their element size;
+ *  - nested layouts are aligned to their total size.
+ * StructParser places every bit-field before every other field whatever
+ * the declaration order, so layouts must declare bit-fields first. Like
+ * StructParser, the JSON spells types char/short/int/long by size and
+ * gives their signedness as a separate "signed" member.
+ *
+ * Byte order follows endian.c and bitfield_decoder.h: little puts bit 0
+ * in the least significant bit of byte 0, big in the most significant
+ * bit, with multi-byte values in that order. Nested layouts are read in
+ * the byte order of the outermost layout.
+ *
+ * Accessors are constexpr and fully inlined: with a constant index every
+ * offset, shift and mask folds into the generated load.
+ */
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <tuple>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace wire {
+
+enum class endian { little, big };
+
+/* =============================
+ * Names as template arguments
+ * ============================= */
+
+template <std::size_t N>
+struct fixed_string {
+    char value[N]{};
+
+    constexpr fixed_string(const char (&s)[N]) { std::copy_n(s, N, value); }
+    constexpr std::size_t size() const { return N - 1; }
+    constexpr const char *c_str() const { return value; }
+
+    template <std::size_t M>
+    constexpr bool operator==(const fixed_string<M> &other) const
+    {
+        if (N != M) return false;
+        for (std::size_t i = 0; i < N; i++) {
+            if (value[i] != other.value[i]) return false;
+        }
+        return true;
+    }
+};
+
+/* =============================
+ * Field kinds
+ * ============================= */
+
+enum class kind { bits, scalar, array, nested, nested_array };
+
+namespace detail {
+
+/* StructParser spells primitive types char/short/int/long (8/16/32/64 bits), signed or not */
+template <typename T>
+constexpr const char *type_name()
+{
+    static_assert(std::is_integral_v<T> && !std::is_same_v<T, bool>, "wire fields are integers");
+    if constexpr (sizeof(T) == 1) return "char";
+    else if constexpr (sizeof(T) == 2) return "short";
+    else if constexpr (sizeof(T) == 4) return "int";
+    else return "long";
+}
+
+} // namespace detail
+
+/** Bit-field `T name : Width;` */
+template <fixed_string Name, typename T, unsigned Width>
+struct bits {
+    static_assert(Width > 0 && Width <= sizeof(T) * 8, "bit-field wider than its type");
+    static constexpr auto name = Name;
+    static constexpr kind field_kind = kind::bits;
+    using type = T;
+    static constexpr std::size_t element_bits = Width;
+    static constexpr std::size_t count = 1;
+    static constexpr const char *type_name() { return detail::type_name<T>(); }
+};
+
+/** Primitive `T name;` */
+template <fixed_string Name, typename T>
+struct scalar {
+    static constexpr auto name = Name;
+    static constexpr kind field_kind = kind::scalar;
+    using type = T;
+    static constexpr std::size_t element_bits = sizeof(T) * 8;
+    static constexpr std::size_t count = 1;
+    static constexpr const char *type_name() { return detail::type_name<T>(); }
+};
+
+/** Primitive array `T name[N];` */
+template <fixed_string Name, typename T, std::size_t N>
+struct array {
+    static_assert(N > 0, "empty array");
+    static constexpr auto name = Name;
+    static constexpr kind field_kind = kind::array;
+    using type = T;
+    static constexpr std::size_t element_bits = sizeof(T) * 8;
+    static constexpr std::size_t count = N;
+    static constexpr const char *type_name() { return detail::type_name<T>(); }
+};
+
+/** Nested struct `L name;` */
+template <fixed_string Name, typename L>
+struct nested {
+    static constexpr auto name = Name;
+    static constexpr kind field_kind = kind::nested;
+    using layout_type = L;
+    static constexpr std::size_t element_bits = L::total_bits;
+    static constexpr std::size_t count = 1;
+    static constexpr const char *type_name() { return L::name.c_str(); }
+};
+
+/** Nested struct array `L name[N];` */
+template <fixed_string Name, typename L, std::size_t N>
+struct nested_array {
+    static_assert(N > 0, "empty array");
+    static constexpr auto name = Name;
+    static constexpr kind field_kind = kind::nested_array;
+    using layout_type = L;
+    static constexpr std::size_t element_bits = L::total_bits;
+    static constexpr std::size_t count = N;
+    static constexpr const char *type_name() { return L::name.c_str(); }
+};
+
+/* =============================
+ * Bit access
+ * ============================= */
+
+namespace detail {
+
+constexpr std::uint64_t low_mask(std::size_t width)
+{
+    return width >= 64 ? ~0ULL : (1ULL << width) - 1;
+}
+
+/* Bytes spanned by `width` bits starting at `bit` (at most 8) */
+constexpr unsigned span_bytes(std::size_t bit, std::size_t width)
+{
+    return (unsigned)((bit % 8 + width + 7) / 8);
+}
+
+template <endian E>
+constexpr unsigned shift_of(std::size_t bit, std::size_t width)
+{
+    const unsigned n = span_bytes(bit, width);
+    return E == endian::little ? (unsigned)(bit % 8) : (unsigned)(8 * n - bit % 8 - width);
+}
+
+template <endian E>
+constexpr std::uint64_t load(const std::uint8_t *p, unsigned n)
+{
+    std::uint64_t v = 0;
+    for (unsigned i = 0; i < n; i++) {
+        v |= (std::uint64_t)p[i] << (E == endian::little ? 8 * i : 8 * (n - 1 - i));
+    }
+    return v;
+}
+
+template <endian E>
+constexpr void store(std::uint8_t *p, unsigned n, std::uint64_t v)
+{
+    for (unsigned i = 0; i < n; i++) {
+        p[i] = (std::uint8_t)(v >> (E == endian::little ? 8 * i : 8 * (n - 1 - i)));
+    }
+}
+
+template <typename T, endian E>
+constexpr T read(const std::uint8_t *data, std::size_t bit, std::size_t width)
+{
+    const unsigned n = span_bytes(bit, width);
+    std::uint64_t v = (load<E>(data + bit / 8, n) >> shift_of<E>(bit, width)) & low_mask(width);
+    if constexpr (std::is_signed_v<T>) {
+        const std::uint64_t sign = 1ULL << (width - 1);
+        v = (v ^ sign) - sign;
+    }
+    return (T)v;
+}
+
+template <typename T, endian E>
+constexpr void write(std::uint8_t *data, std::size_t bit, std::size_t width, T value)
+{
+    const unsigned n = span_bytes(bit, width);
+    const unsigned shift = shift_of<E>(bit, width);
+    const std::uint64_t mask = low_mask(width) << shift;
+    std::uint64_t v = load<E>(data + bit / 8, n);
+    v = (v & ~mask) | (((std::uint64_t)value << shift) & mask);
+    store<E>(data + bit / 8, n, v);
+}
+
+template <typename F, typename = void>
+struct value_of {
+    using type = typename F::type;
+};
+
+template <typename F>
+struct value_of<F, std::enable_if_t<F::field_kind == kind::array>> {
+    using type = std::array<typename F::type, F::count>;
+};
+
+template <typename F>
+struct value_of<F, std::enable_if_t<F::field_kind == kind::nested>> {
+    using type = typename F::layout_type::record;
+};
+
+template <typename F>
+struct value_of<F, std::enable_if_t<F::field_kind == kind::nested_array>> {
+    using type = std::array<typename F::layout_type::record, F::count>;
+};
+
+} // namespace detail
+
+template <typename L, endian E, typename Byte>
+class ref;
+
+/* =============================
+ * Layout
+ * ============================= */
+
+template <fixed_string Name, endian E, typename... Fields>
+struct layout {
+    static constexpr auto name = Name;
+    static constexpr endian byte_order = E;
+    static constexpr std::size_t num_fields = sizeof...(Fields);
+    static constexpr std::size_t npos = ~(std::size_t)0;
+
+    using field_list = std::tuple<Fields...>;
+    template <std::size_t I>
+    using field_at = std::tuple_element_t<I, field_list>;
+
+    /** Decoded form of the whole layout, one tuple element per field. */
+    using record = std::tuple<typename detail::value_of<Fields>::type...>;
+
+private:
+    struct placement {
+        std::array<std::size_t, sizeof...(Fields)> offset{};
+        std::size_t total = 0;
+    };
+
+    static constexpr placement place()
+    {
+        placement p{};
+        std::size_t bit = 0, i = 0;
+        auto one = [&](kind k, std::size_t element_bits, std::size_t count) {
+            if (k != kind::bits && bit % element_bits != 0) bit += element_bits - bit % element_bits;
+            p.offset[i++] = bit;
+            bit += element_bits * count;
+        };
+        (one(Fields::field_kind, Fields::element_bits, Fields::count), ...);
+        p.total = bit;
+        return p;
+    }
+
+    static constexpr placement placed = place();
+
+    static constexpr bool bits_first()
+    {
+        bool seen_other = false, ok = true;
+        ((Fields::field_kind == kind::bits ? (ok = ok && !seen_other) : (seen_other = true)), ...);
+        return ok;
+    }
+
+    static constexpr bool names_unique()
+    {
+        constexpr std::array<std::pair<const char *, std::size_t>, sizeof...(Fields)> names = {
+            std::pair<const char *, std::size_t>{ Fields::name.c_str(), Fields::name.size() }...
+        };
+        for (std::size_t a = 0; a < names.size(); a++) {
+            for (std::size_t b = a + 1; b < names.size(); b++) {
+                if (std::string_view(names[a].first, names[a].second) ==
+                    std::string_view(names[b].first, names[b].second)) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    static constexpr bool fits_one_load()
+    {
+        for (std::size_t i = 0; i < sizeof...(Fields); i++) {
+            constexpr std::array<std::pair<kind, std::size_t>, sizeof...(Fields)> f = {
+                std::pair<kind, std::size_t>{ Fields::field_kind, Fields::element_bits }...
+            };
+            if (f[i].first != kind::nested && f[i].first != kind::nested_array &&
+                detail::span_bytes(placed.offset[i], f[i].second) > 8) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    static_assert(sizeof...(Fields) > 0, "layout without fields");
+    static_assert(bits_first(), "StructParser places bit-fields first: declare them first");
+    static_assert(names_unique(), "duplicate field name");
+    static_assert(fits_one_load(), "a field spans more than 8 bytes");
+
+public:
+    static constexpr std::size_t total_bits = placed.total;
+    static constexpr std::size_t total_bytes = (total_bits + 7) / 8;
+
+    template <fixed_string F>
+    static constexpr std::size_t index_of()
+    {
+        constexpr bool match[] = { (Fields::name == F)... };
+        for (std::size_t i = 0; i < sizeof...(Fields); i++) {
+            if (match[i]) return i;
+        }
+        return npos;
+    }
+
+    template <fixed_string F>
+    static constexpr std::size_t checked_index()
+    {
+        constexpr std::size_t i = index_of<F>();
+        static_assert(i != npos, "no such field");
+        return i;
+    }
+
+    template <fixed_string F>
+    using field = field_at<checked_index<F>()>;
+
+    /** Bit offset of the field (of element 0 for arrays). */
+    template <fixed_string F>
+    static constexpr std::size_t bit_offset = placed.offset[checked_index<F>()];
+
+    /** Bits per element. */
+    template <fixed_string F>
+    static constexpr std::size_t width = field<F>::element_bits;
+
+    /** Right shift that brings element 0 down after its load. */
+    template <fixed_string F>
+    static constexpr unsigned shift = detail::shift_of<E>(bit_offset<F>, width<F>);
+
+    /** Mask of one element after the shift. */
+    template <fixed_string F>
+    static constexpr std::uint64_t mask = detail::low_mask(width<F>);
+
+    /** Bit offset of the i-th field. */
+    static constexpr std::size_t offset_at(std::size_t i) { return placed.offset[i]; }
+
+    /* ----- accessors over a whole buffer ----- */
+
+    template <fixed_string F>
+    static constexpr auto get(const std::uint8_t *data, std::size_t index = 0)
+    {
+        return ref<layout, E, const std::uint8_t>(data).template get<F>(index);
+    }
+
+    template <fixed_string F>
+    static constexpr void set(std::uint8_t *data, typename field<F>::type value, std::size_t index = 0)
+    {
+        ref<layout, E, std::uint8_t>(data).template set<F>(value, index);
+    }
+
+    template <fixed_string F>
+    static constexpr auto at(const std::uint8_t *data, std::size_t index = 0)
+    {
+        return ref<layout, E, const std::uint8_t>(data).template at<F>(index);
+    }
+
+    template <fixed_string F>
+    static constexpr auto at(std::uint8_t *data, std::size_t index = 0)
+    {
+        return ref<layout, E, std::uint8_t>(data).template at<F>(index);
+    }
+
+    /* ----- whole records ----- */
+
+    static constexpr record decode(const std::uint8_t *data) { return decode_at<E>(data, 0); }
+
+    /** Writes all `total_bytes`; bits not covered by a field are zeroed. */
+    static constexpr void encode(const record &value, std::uint8_t *data)
+    {
+        for (std::size_t i = 0; i < total_bytes; i++) data[i] = 0;
+        encode_at<E>(value, data, 0);
+    }
+
+    template <endian BO>
+    static constexpr record decode_at(const std::uint8_t *data, std::size_t base)
+    {
+        return [&]<std::size_t... I>(std::index_sequence<I...>) {
+            return record{ decode_field<BO, I>(data, base)... };
+        }(std::index_sequence_for<Fields...>{});
+    }
+
+    template <endian BO>
+    static constexpr void encode_at(const record &value, std::uint8_t *data, std::size_t base)
+    {
+        [&]<std::size_t... I>(std::index_sequence<I...>) {
+            (encode_field<BO, I>(std::get<I>(value), data, base), ...);
+        }(std::index_sequence_for<Fields...>{});
+    }
+
+private:
+    template <endian BO, std::size_t I>
+    static constexpr auto decode_field(const std::uint8_t *data, std::size_t base)
+    {
+        using F = field_at<I>;
+        const std::size_t bit = base + placed.offset[I];
+
+        if constexpr (F::field_kind == kind::bits || F::field_kind == kind::scalar) {
+            return detail::read<typename F::type, BO>(data, bit, F::element_bits);
+        } else if constexpr (F::field_kind == kind::array) {
+            typename detail::value_of<F>::type out{};
+            for (std::size_t i = 0; i < F::count; i++) {
+                out[i] = detail::read<typename F::type, BO>(data, bit + i * F::element_bits, F::element_bits);
+            }
+            return out;
+        } else if constexpr (F::field_kind == kind::nested) {
+            return F::layout_type::template decode_at<BO>(data, bit);
+        } else {
+            typename detail::value_of<F>::type out{};
+            for (std::size_t i = 0; i < F::count; i++) {
+                out[i] = F::layout_type::template decode_at<BO>(data, bit + i * F::element_bits);
+            }
+            return out;
+        }
+    }
+
+    template <endian BO, std::size_t I, typename V>
+    static constexpr void encode_field(const V &value, std::uint8_t *data, std::size_t base)
+    {
+        using F = field_at<I>;
+        const std::size_t bit = base + placed.offset[I];
+
+        if constexpr (F::field_kind == kind::bits || F::field_kind == kind::scalar) {
+            detail::write<typename F::type, BO>(data, bit, F::element_bits, value);
+        } else if constexpr (F::field_kind == kind::array) {
+            for (std::size_t i = 0; i < F::count; i++) {
+                detail::write<typename F::type, BO>(data, bit + i * F::element_bits, F::element_bits, value[i]);
+            }
+        } else if constexpr (F::field_kind == kind::nested) {
+            F::layout_type::template encode_at<BO>(value, data, bit);
+        } else {
+            for (std::size_t i = 0; i < F::count; i++) {
+                F::layout_type::template encode_at<BO>(value[i], data, bit + i * F::element_bits);
+            }
+        }
+    }
+};
+
+/* =============================
+ * Field references
+ * ============================= */
+
+/**
+ * A layout placed at `base_bit` of a buffer, read in byte order `E`.
+ * `Byte` is const for read-only access. at<>() descends into nested
+ * fields keeping the outer byte order.
+ */
+template <typename L, endian E, typename Byte>
+class ref {
+public:
+    constexpr explicit ref(Byte *data, std::size_t base_bit = 0) : data_(data), base_(base_bit) {}
+
+    template <fixed_string F>
+    constexpr typename L::template field<F>::type get(std::size_t index = 0) const
+    {
+        using Fd = typename L::template field<F>;
+        static_assert(Fd::field_kind == kind::bits || Fd::field_kind == kind::scalar ||
+                      Fd::field_kind == kind::array, "use at<>() for nested fields");
+        return detail::read<typename Fd::type, E>(
+            data_, base_ + L::template bit_offset<F> + index * Fd::element_bits, Fd::element_bits);
+    }
+
+    template <fixed_string F>
+    constexpr void set(typename L::template field<F>::type value, std::size_t index = 0) const
+    {
+        using Fd = typename L::template field<F>;
+        static_assert(!std::is_const_v<Byte>, "read-only reference");
+        static_assert(Fd::field_kind == kind::bits || Fd::field_kind == kind::scalar ||
+                      Fd::field_kind == kind::array, "use at<>() for nested fields");
+        detail::write<typename Fd::type, E>(
+            data_, base_ + L::template bit_offset<F> + index * Fd::element_bits, Fd::element_bits, value);
+    }
+
+    template <fixed_string F>
+    constexpr auto at(std::size_t index = 0) const
+    {
+        using Fd = typename L::template field<F>;
+        static_assert(Fd::field_kind == kind::nested || Fd::field_kind == kind::nested_array,
+                      "at<>() is for nested fields");
+        return ref<typename Fd::layout_type, E, Byte>(
+            data_, base_ + L::template bit_offset<F> + index * Fd::element_bits);
+    }
+
+    constexpr typename L::record decode() const { return L::template decode_at<E>(data_, base_); }
+
+private:
+    Byte *data_;
+    std::size_t base_;
+};
+
+/* =============================
+ * StructParser JSON
+ * ============================= */
+
+namespace detail {
+
+/* Just enough of a JSON tree to reproduce json.dumps(indent=4) */
+struct json_value {
+    enum class type { string, number, object, list } t = type::object;
+    std::string text;
+    std::vector<std::pair<std::string, json_value>> members;    /* object or list */
+
+    static json_value str(std::string s) { json_value v; v.t = type::string; v.text = std::move(s); return v; }
+    static json_value num(std::size_t n) { json_value v; v.t = type::number; v.text = std::to_string(n); return v; }
+    static json_value boolean(bool b) { json_value v; v.t = type::number; v.text = b ? "true" : "false"; return v; }
+    static json_value list() { json_value v; v.t = type::list; return v; }
+
+    void add(const char *key, json_value v) { members.emplace_back(key, std::move(v)); }
+};
+
+inline void quote(std::string &out, const std::string &s)
+{
+    static const char hex[] = "0123456789abcdef";
+    out += '"';
+    for (unsigned char c : s) {
+        if (c == '"' || c == '\\') {
+            out += '\\';
+            out += (char)c;
+        } else if (c < 0x20 || c >= 0x7F) {
+            out += "\\u00";
+            out += hex[c >> 4];
+            out += hex[c & 15];
+        } else {
+            out += (char)c;
+        }
+    }
+    out += '"';
+}
+
+inline void dump(std::string &out, const json_value &v, int depth)
+{
+    const std::string pad((std::size_t)(depth + 1) * 4, ' ');
+    switch (v.t) {
+    case json_value::type::string:
+        quote(out, v.text);
+        return;
+    case json_value::type::number:
+        out += v.text;
+        return;
+    case json_value::type::object:
+    case json_value::type::list: {
+        const bool object = v.t == json_value::type::object;
+        if (v.members.empty()) {
+            out += object ? "{}" : "[]";
+            return;
+        }
+        out += object ? "{\n" : "[\n";
+        for (std::size_t i = 0; i < v.members.size(); i++) {
+            out += pad;
+            if (object) {
+                quote(out, v.members[i].first);
+                out += ": ";
+            }
+            dump(out, v.members[i].second, depth + 1);
+            out += i + 1 < v.members.size() ? ",\n" : "\n";
+        }
+        out.append((std::size_t)depth * 4, ' ');
+        out += object ? '}' : ']';
+        return;
+    }
+    }
+}
+
+/* hex() of ((1 << width) - 1) << offset, which may exceed 64 bits */
+inline std::string mask_hex(std::size_t offset, std::size_t width)
+{
+    static const char hex[] = "0123456789abcdef";
+    const std::size_t top = offset + width;
+    std::string s = "0x";
+
+    if (width == 0) return "0x0";
+    for (std::size_t d = (top + 3) / 4; d-- > 0;) {
+        unsigned nibble = 0;
+        for (unsigned b = 0; b < 4; b++) {
+            std::size_t bit = d * 4 + b;
+            if (bit >= offset && bit < top) nibble |= 1U << b;
+        }
+        s += hex[nibble];
+    }
+    return s;
+}
+
+template <typename L>
+json_value layout_json();
+
+template <typename L, std::size_t I>
+json_value field_json()
+{
+    using F = typename L::template field_at<I>;
+    const std::size_t offset = L::offset_at(I);
+    const std::size_t field_bits = F::element_bits * F::count;
+    json_value f;
+
+    f.add("name", json_value::str(F::name.c_str()));
+    f.add("type", json_value::str(F::type_name()));
+    f.add("bit_offset", json_value::num(offset));
+    if constexpr (F::field_kind != kind::nested && F::field_kind != kind::nested_array) {
+        f.add("signed", json_value::boolean(std::is_signed_v<typename F::type>));
+    }
+
+    if constexpr (F::field_kind == kind::nested || F::field_kind == kind::nested_array) {
+        f.add("nested", layout_json<typename F::layout_type>());
+        if constexpr (F::field_kind == kind::nested_array) f.add("array_length", json_value::num(F::count));
+        f.add("total_bits", json_value::num(field_bits));
+    } else if constexpr (F::field_kind == kind::bits) {
+        f.add("bit_width", json_value::num(F::element_bits));
+        f.add("mask", json_value::str(mask_hex(offset, field_bits)));
+    } else if constexpr (F::field_kind == kind::array) {
+        f.add("array_length", json_value::num(F::count));
+        f.add("element_size", json_value::num(F::element_bits));
+        f.add("total_bits", json_value::num(field_bits));
+    } else {
+        f.add("size", json_value::num(F::element_bits));
+    }
+
+    /* StructParser adds a mask to every field of layouts up to 64 bits */
+    if (L::total_bits <= 64 && F::field_kind != kind::bits) {
+        f.add("mask", json_value::str(mask_hex(offset, field_bits)));
+    }
+    return f;
+}
+
+template <typename L>
+json_value layout_json()
+{
+    json_value root, fields = json_value::list(), by_name;
+
+    root.add("struct_name", json_value::str(L::name.c_str()));
+    root.add("endianness", json_value::str(L::byte_order == endian::little ? "little" : "big"));
+    root.add("total_bits", json_value::num(L::total_bits));
+    root.add("total_bytes", json_value::num(L::total_bytes));
+
+    [&]<std::size_t... I>(std::index_sequence<I...>) {
+        (fields.members.emplace_back(std::string(), field_json<L, I>()), ...);
+        (by_name.members.emplace_back(L::template field_at<I>::name.c_str(), field_json<L, I>()), ...);
+    }(std::make_index_sequence<L::num_fields>{});
+
+    root.add("fields", std::move(fields));
+    root.add("fields_by_name", std::move(by_name));
+    return root;
+}
+
+} // namespace detail
+
+/**
+ * The layout in the form StructParser.to_json() writes, ready for
+ * StructParser.import_from_json() or bitfield_layout_load_json().
+ */
+template <typename L>
+std::string to_json()
+{
+    std::string out;
+    detail::dump(out, detail::layout_json<L>(), 0);
+    return out;
+}
+
+} // namespace wire
+
+#endif // WIRE_LAYOUT_HPP
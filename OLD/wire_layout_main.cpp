@@ -0,0 +1,166 @@
+#include <cstdio>
+#include <cstring>
+#include <string>
+#include "wire_layout.hpp"
+
+/**
+ * Layouts declared once with wire_layout.hpp, exported for the Python
+ * tools:
+ *
+ *   wire_layout_main [layout]     (bit_fields_t, net_header_t, message_t; default all)
+ *   wire_layout_main check [dir]  (dir holds bit_field_scanner.py; default .)
+ *
+ * Prints each layout in StructParser.to_json() form, ready for
+ * StructParser.import_from_json() or bitfield_main. "check" runs
+ * StructParser on the C typedef of each layout through python3 and
+ * reports any difference from wire::to_json().
+ */
+
+/* struct BitFields from endian.c */
+using bit_fields_t = wire::layout<"bit_fields_t", wire::endian::little,
+    wire::bits<"msg_type", unsigned char, 4>,
+    wire::bits<"msg_source", unsigned char, 4>,
+    wire::scalar<"counter", unsigned char>,
+    wire::scalar<"length", unsigned short>>;
+
+/* The same header in network byte order, inside a larger message */
+using net_header_t = wire::layout<"net_header_t", wire::endian::big,
+    wire::bits<"msg_type", unsigned char, 4>,
+    wire::bits<"msg_source", unsigned char, 4>,
+    wire::scalar<"counter", unsigned char>,
+    wire::scalar<"length", unsigned short>>;
+
+using message_t = wire::layout<"message_t", wire::endian::big,
+    wire::nested<"header", net_header_t>,
+    wire::array<"payload", unsigned char, 8>,
+    wire::scalar<"checksum", unsigned int>>;
+
+/* endian.c's test vectors, checked by the compiler */
+static_assert(bit_fields_t::total_bytes == 4);
+static_assert(bit_fields_t::bit_offset<"length"> == 16);
+static_assert(bit_fields_t::shift<"msg_source"> == 4);
+static_assert(bit_fields_t::mask<"msg_source"> == 0xF);
+static_assert(net_header_t::shift<"msg_source"> == 0);
+static_assert(message_t::bit_offset<"checksum"> == 96);
+
+constexpr std::array<std::uint8_t, 4> encode_test1()
+{
+    std::array<std::uint8_t, 4> buf{};
+    bit_fields_t::encode({ 0x3, 0x6, 0x78, 0xABCD }, buf.data());
+    return buf;
+}
+
+static_assert(encode_test1() == std::array<std::uint8_t, 4>{ 0x63, 0x78, 0xCD, 0xAB });
+static_assert(bit_fields_t::get<"length">(encode_test1().data()) == 0xABCD);
+
+constexpr std::array<std::uint8_t, 4> encode_test2()
+{
+    std::array<std::uint8_t, 4> buf{};
+    bit_fields_t::set<"msg_type">(buf.data(), 0xF);
+    return buf;
+}
+
+static_assert(encode_test2() == std::array<std::uint8_t, 4>{ 0x0F, 0x00, 0x00, 0x00 });
+
+template <typename L>
+static void print_layout(const char *wanted)
+{
+    if (wanted && std::strcmp(wanted, L::name.c_str()) != 0) return;
+    std::printf("%s\n", wire::to_json<L>().c_str());
+}
+
+/* =============================
+ * Check against StructParser
+ * ============================= */
+
+/* The typedefs the layouts stand for, each after those it nests */
+static const char bit_fields_c[] =
+    "typedef struct { unsigned char msg_type: 4; unsigned char msg_source: 4; "
+    "unsigned char counter; unsigned short length; } bit_fields_t;";
+static const char net_header_c[] =
+    "typedef struct { unsigned char msg_type: 4; unsigned char msg_source: 4; "
+    "unsigned char counter; unsigned short length; } net_header_t;";
+static const char message_c[] =
+    "typedef struct { net_header_t header; unsigned char payload[8]; unsigned int checksum; } message_t;";
+
+/* StructParser.to_json() of the last typedef, parsed after the others; empty if python3 failed */
+static std::string struct_parser_json(const char *dir, const char *byte_order, const char *const *typedefs,
+                                      int count, const char *name)
+{
+    std::string command = "python3 -c 'import sys; sys.path.insert(0, \"";
+    command += dir;
+    command += "\"); from bit_field_scanner import StructParser; p = StructParser(\"";
+    command += byte_order;
+    /* Plain char as this compiler has it, as the "signed" member of to_json() does */
+    command += std::is_signed_v<char> ? "\", char_signed=True); " : "\", char_signed=False); ";
+    for (int i = 0; i < count; i++) {
+        command += "p.parse_struct(\"";
+        command += typedefs[i];
+        command += "\"); ";
+    }
+    command += "print(p.to_json(\"";
+    command += name;
+    command += "\"))'";
+
+    std::string out;
+    FILE *pipe = popen(command.c_str(), "r");
+    if (!pipe) return out;
+    char buffer[4096];
+    std::size_t got;
+    while ((got = std::fread(buffer, 1, sizeof(buffer), pipe)) > 0) out.append(buffer, got);
+    if (pclose(pipe) != 0) out.clear();
+    return out;
+}
+
+template <typename L>
+static int check_layout(const char *dir, const char *const *typedefs, int count)
+{
+    const char *byte_order = L::byte_order == wire::endian::little ? "little" : "big";
+    const std::string expected = struct_parser_json(dir, byte_order, typedefs, count, L::name.c_str());
+    const std::string got = wire::to_json<L>() + "\n";
+
+    if (expected.empty()) {
+        std::fprintf(stderr, "[Check] %s: StructParser failed (python3 and %s/bit_field_scanner.py needed)\n",
+                     L::name.c_str(), dir);
+        return 1;
+    }
+    if (got == expected) {
+        std::printf("[Check] %s: matches StructParser\n", L::name.c_str());
+        return 0;
+    }
+
+    /* First line that differs */
+    std::size_t pos = 0, line = 1;
+    while (pos < got.size() && pos < expected.size() && got[pos] == expected[pos]) {
+        if (got[pos++] == '\n') line++;
+    }
+    std::size_t start = got.rfind('\n', pos ? pos - 1 : 0);
+    start = start == std::string::npos || pos == 0 ? 0 : start + 1;
+    std::size_t got_end = got.find('\n', start), expected_end = expected.find('\n', start);
+    std::printf("[Check] %s: differs at line %zu\n  to_json:      %s\n  StructParser: %s\n", L::name.c_str(), line,
+                got.substr(start, got_end - start).c_str(), expected.substr(start, expected_end - start).c_str());
+    return 1;
+}
+
+static int run_check(const char *dir)
+{
+    const char *const bit_fields[] = { bit_fields_c };
+    const char *const net_header[] = { net_header_c };
+    const char *const message[] = { net_header_c, message_c };
+    int rc = check_layout<bit_fields_t>(dir, bit_fields, 1);
+    rc |= check_layout<net_header_t>(dir, net_header, 1);
+    rc |= check_layout<message_t>(dir, message, 2);
+    return rc;
+}
+
+int main(int argc, char **argv)
+{
+    if (argc > 1 && std::strcmp(argv[1], "check") == 0) return run_check(argc > 2 ? argv[2] : ".");
+
+    const char *wanted = argc > 1 ? argv[1] : nullptr;
+
+    print_layout<bit_fields_t>(wanted);
+    print_layout<net_header_t>(wanted);
+    print_layout<message_t>(wanted);
+    return 0;
+}
@@ -0,0 +1,88 @@
+#ifndef XOSHIRO_H
+#define XOSHIRO_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include <stddef.h>
+#include <stdint.h>
+#include <string.h>
+
+/**
+ * xoshiro256** (Blackman & Vigna): a small, fast, non-cryptographic PRNG.
+ * Roughly 1ns per 64-bit output, so payload fills run at memory speed,
+ * unlike per-word random.randint() in threaded_ether_relay.py.
+ *
+ * State is per caller; give each thread its own xoshiro_t.
+ */
+typedef struct xoshiro_t {
+    uint64_t s[4];
+} xoshiro_t;
+
+static inline uint64_t xoshiro_rotl(uint64_t x, int k)
+{
+    return (x << k) | (x >> (64 - k));
+}
+
+/**
+ * Seed via splitmix64 so that nearby seeds give unrelated streams.
+ */
+static inline void xoshiro_seed(xoshiro_t *rng, uint64_t seed)
+{
+    for (int i = 0; i < 4; i++) {
+        uint64_t z = (seed += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        rng->s[i] = z ^ (z >> 31);
+    }
+}
+
+static inline uint64_t xoshiro_next(xoshiro_t *rng)
+{
+    uint64_t *s = rng->s;
+    const uint64_t result = xoshiro_rotl(s[1] * 5, 7) * 9;
+    const uint64_t t = s[1] << 17;
+
+    s[2] ^= s[0];
+    s[3] ^= s[1];
+    s[1] ^= s[2];
+    s[0] ^= s[3];
+    s[2] ^= t;
+    s[3] = xoshiro_rotl(s[3], 45);
+    return result;
+}
+
+/**
+ * Uniform value in [lo, hi] (inclusive) using Lemire's multiply-shift,
+ * which avoids a division on the hot path.
+ */
+static inline uint32_t xoshiro_range(xoshiro_t *rng, uint32_t lo, uint32_t hi)
+{
+    uint64_t span = (uint64_t)hi - lo + 1;
+    return lo + (uint32_t)(((xoshiro_next(rng) >> 32) * span) >> 32);
+}
+
+/**
+ * Fill `len` bytes with random data, eight bytes per step.
+ */
+static inline void xoshiro_fill(xoshiro_t *rng, void *dst, size_t len)
+{
+    uint8_t *p = (uint8_t *)dst;
+    while (len >= 8) {
+        uint64_t v = xoshiro_next(rng);
+        memcpy(p, &v, 8);
+        p += 8;
+        len -= 8;
+    }
+    if (len) {
+        uint64_t v = xoshiro_next(rng);
+        memcpy(p, &v, len);
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // XOSHIRO_H
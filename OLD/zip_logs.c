@@ -4,6 +4,13 @@
 #include <zlib.h>  // For compression
 #include <pthread.h>  // For threading
 #include <queue.h>  // Your existing thread-safe queue implementation
+#include <sys/stat.h>
+#include "zip_logs.h"
+#include "compress_controller.h"  // Level from the backlog
+#include "log_dict.h"  // Trained dictionaries for small segments
+#include "log_reader.h"  // Rotation sets, to measure the backlog
+#include "platform.h"
+#include "seekable_log.h"  // Framed .gz with a time index
 
 extern bool shutdown_signalled();
 extern void sleep_ms(int ms);
@@ -11,49 +18,186 @@ extern void sleep_ms(int ms);
 // Queue holding logs that need compression
 extern thread_safe_queue_t log_compression_queue;
 
+// Dictionaries are trained into LOG_DICT_DIR with `logdict_main train`; with
+// none there, every log becomes a seekable .gz as before. log_reader and
+// log_grep look for them in the same place to read the .zd segments back.
+
+// Compresses a small log with its service's newest dictionary into <log>.zd.
+// Returns 1 if it was not small or has no dictionary, 0 on success, -1 on failure.
+static int compress_with_dictionary(const log_dict_store_t *dicts, const char *log_filename, int level) {
+    struct stat st;
+    char service[LOG_DICT_SERVICE_MAX];
+    if (stat(log_filename, &st) != 0 || st.st_size > LOG_DICT_SMALL_SEGMENT) return 1;
+    if (log_dict_service(log_filename, service, sizeof(service)) != 0) return 1;
+    const log_dict_t *dict = log_dict_store_latest(dicts, service);
+    if (!dict) return 1;
+
+    char compressed_filename[256];
+    snprintf(compressed_filename, sizeof(compressed_filename), "%s%s", log_filename, LOG_DICT_EXT);
+    if (log_dict_compress_file(dict, log_filename, compressed_filename, level) != 0) {
+        logger_log(LOG_ERROR, "Error writing compressed log: %s", compressed_filename);
+        remove(compressed_filename);
+        return -1;
+    }
+    logger_log(LOG_INFO, "Compressed %s with dictionary %s.%u", log_filename, dict->service, dict->version);
+    return 0;
+}
+
+void log_compression_enqueue(void *ctx, const char *path) {
+    (void)ctx;
+    if (!queue_push(&log_compression_queue, path)) {
+        logger_log(LOG_ERROR, "Cannot queue %s for compression", path);
+    }
+}
+
+// Logs compressed below the top level, oldest first, to recompress when idle
+#define RECOMPRESS_SLOTS 64
+static char recompress_paths[RECOMPRESS_SLOTS][256];
+static int recompress_head, recompress_count;
+
+static uint64_t file_size(const char *path) {
+    struct stat st;
+    return stat(path, &st) == 0 ? (uint64_t)st.st_size : 0;
+}
+
+// Uncompressed bytes of rotated logs in the same set as `log_filename` still
+// waiting for this thread, the one being compressed included. Queue entries
+// are rotated names, which discover only themselves; the set is found from
+// the live name, so this works after `log_filename` is gone, too.
+static uint64_t backlog_bytes(const char *log_filename) {
+    char live[LOG_PATH_MAX];
+    log_set_t set;
+    uint64_t total = 0;
+    if (log_filename[0] == '\0') return 0;
+    // Not part of a rotation set (a capture segment, say): just the file itself
+    if (log_set_live_name(log_filename, live, sizeof(live)) != 1) return file_size(log_filename);
+    if (log_set_discover(&set, live) != 0) return 0;
+    for (size_t i = 0; i < set.count; i++) {
+        if (!set.segments[i].compressed && set.segments[i].stamp[0]) total += file_size(set.segments[i].path);
+    }
+    log_set_free(&set);
+    return total;
+}
+
+static void remember_for_recompression(const char *compressed_filename) {
+    if (recompress_count == RECOMPRESS_SLOTS) {
+        // Full: the oldest gives way
+        recompress_head = (recompress_head + 1) % RECOMPRESS_SLOTS;
+        recompress_count--;
+    }
+    int slot = (recompress_head + recompress_count) % RECOMPRESS_SLOTS;
+    snprintf(recompress_paths[slot], sizeof(recompress_paths[slot]), "%s", compressed_filename);
+    recompress_count++;
+}
+
+// Rewrites the oldest remembered .gz at `level`, keeping it only if smaller
+static void recompress_oldest(compress_controller_t *ctl, int level) {
+    char path[256], tmp[256 + 8];
+    snprintf(path, sizeof(path), "%s", recompress_paths[recompress_head]);
+    recompress_head = (recompress_head + 1) % RECOMPRESS_SLOTS;
+    recompress_count--;
+
+    snprintf(tmp, sizeof(tmp), "%s.tmp", path);
+    uint64_t old_size = file_size(path);
+    if (old_size == 0) return;  // deleted or moved since
+    unsigned long long start = platform_time_ns();
+    if (seekable_log_compress_file(path, tmp, SEEKABLE_LOG_DEFAULT_FRAME, level) != 0) {
+        remove(tmp);
+        return;
+    }
+    uint64_t new_size = file_size(tmp);
+    if (new_size == 0 || new_size >= old_size || rename(tmp, path) != 0) {
+        remove(tmp);
+        return;
+    }
+    compress_controller_recompressed(ctl, old_size, new_size);
+    logger_log(LOG_INFO, "Recompressed %s at level %d: %llu -> %llu bytes (%.1f ms)", path, level,
+               (unsigned long long)old_size, (unsigned long long)new_size,
+               (double)(platform_time_ns() - start) / 1e6);
+}
+
+// Takes the policy from the current config snapshot, if there is a store
+static void apply_config(compress_controller_t *ctl, config_store_t *store, ebr_thread_t *self) {
+    if (!store || !self) return;
+    ebr_enter(self);
+    const config_t *config = config_current(store);
+    compress_controller_set_policy(ctl, config->compress_drain_s, config->compress_busy_load,
+                                   config->compress_idle_load);
+    ebr_exit(self);
+}
+
 void* log_compression_thread(void* arg) {
+    const log_compression_args_t *args = (const log_compression_args_t *)arg;
     char log_filename[256];
+    char last_filename[256] = "";
+    log_dict_store_t dicts;
+    compress_controller_t ctl;
+    ebr_thread_t *self = NULL;
+
+    compress_controller_init(&ctl, 0);
+    if (args && args->stats) compress_controller_publish(&ctl, stats_register_shard(args->stats));
+    // Snapshots may only be read inside this thread's critical region
+    if (args && args->config) {
+        self = ebr_register(args->config->ebr);
+        if (!self) logger_log(LOG_ERROR, "Cannot follow the config, using the default compression policy");
+    }
+    config_store_t *store = args ? args->config : NULL;
+
+    if (log_dict_store_load(&dicts, LOG_DICT_DIR) != 0) {
+        logger_log(LOG_ERROR, "Cannot load dictionaries from %s, using gzip only", LOG_DICT_DIR);
+    }
 
     while (!shutdown_signalled()) {
+        apply_config(&ctl, store, self);
+
         // Wait for a log file to appear in the queue
         if (!queue_pop(&log_compression_queue, log_filename, sizeof(log_filename))) {
+            // Nothing waiting: spend idle CPU on shrinking older logs
+            int idle_level = recompress_count > 0
+                ? compress_controller_idle(&ctl, backlog_bytes(last_filename), platform_cpu_load()) : 0;
+            if (idle_level > 0) {
+                recompress_oldest(&ctl, idle_level);
+                continue;
+            }
             sleep_ms(500);  // No logs to process, sleep and check again
             continue;
         }
+        snprintf(last_filename, sizeof(last_filename), "%s", log_filename);
 
-        logger_log(LOG_INFO, "Compressing log: %s", log_filename);
+        // Faster levels while a backlog builds up, or the CPUs are busy
+        uint64_t backlog = backlog_bytes(log_filename);
+        int level = compress_controller_choose(&ctl, backlog, platform_cpu_load());
+        logger_log(LOG_INFO, "Compressing log: %s at level %d (backlog %llu bytes)", log_filename, level,
+                   (unsigned long long)backlog);
+        uint64_t size = file_size(log_filename);
+        unsigned long long start = platform_time_ns();
+
+        // Small logs gain most from a dictionary; fall back to gzip without one
+        int rc = compress_with_dictionary(&dicts, log_filename, level);
+        if (rc < 0) continue;
+        if (rc == 0) {
+            char zd_filename[256];
+            snprintf(zd_filename, sizeof(zd_filename), "%s%s", log_filename, LOG_DICT_EXT);
+            compress_controller_record(&ctl, level, size, file_size(zd_filename), platform_time_ns() - start);
+            if (remove(log_filename) != 0) logger_log(LOG_ERROR, "Failed to delete original log: %s", log_filename);
+            continue;
+        }
 
         // Construct compressed filename
         char compressed_filename[256];
         snprintf(compressed_filename, sizeof(compressed_filename), "%s.gz", log_filename);
 
-        // Open input and output files
-        FILE* in = fopen(log_filename, "rb");
-        if (!in) {
-            logger_log(LOG_ERROR, "Failed to open log file: %s", log_filename);
-            continue;
-        }
-
-        gzFile out = gzopen(compressed_filename, "wb");
-        if (!out) {
-            logger_log(LOG_ERROR, "Failed to create compressed log: %s", compressed_filename);
-            fclose(in);
+        // Compress the log into independent frames plus a time index; the result
+        // is still a plain .gz for zcat, and seekable_log_query() can read a
+        // time range without inflating the rest
+        if (seekable_log_compress_file(log_filename, compressed_filename,
+                                       SEEKABLE_LOG_DEFAULT_FRAME, level) != 0) {
+            logger_log(LOG_ERROR, "Error writing compressed log: %s", compressed_filename);
+            remove(compressed_filename);
             continue;
         }
-
-        // Compress the log
-        char buffer[8192];
-        size_t bytes_read;
-        while ((bytes_read = fread(buffer, 1, sizeof(buffer), in)) > 0) {
-            if (gzwrite(out, buffer, bytes_read) != (int)bytes_read) {
-                logger_log(LOG_ERROR, "Error writing compressed log: %s", compressed_filename);
-                break;
-            }
-        }
-
-        // Close files
-        fclose(in);
-        gzclose(out);
+        compress_controller_record(&ctl, level, size, file_size(compressed_filename), platform_time_ns() - start);
+        if (level < ctl.rungs[COMPRESS_CONTROLLER_RUNGS - 1].level) remember_for_recompression(compressed_filename);
 
         // Remove original log file after successful compression
         if (remove(log_filename) == 0) {
@@ -63,6 +207,9 @@ void* log_compression_thread(void* arg) {
         }
     }
 
+    log_dict_store_free(&dicts);
+    if (self) ebr_unregister(self);
+    compress_controller_print(&ctl, stderr);
     logger_log(LOG_INFO, "Log compression thread exiting.");
     return NULL;
 }
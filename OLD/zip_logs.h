@@ -0,0 +1,47 @@
+#ifndef ZIP_LOGS_H
+#define ZIP_LOGS_H
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#include "config.h"
+#include "stats_counters.h"
+
+/**
+ * Background compression of rotated logs (zip_logs.c).
+ *
+ * log_compression_thread() takes paths off the host program's
+ * log_compression_queue, picks a level for each from the backlog
+ * (compress_controller.h), writes a seekable .gz or, for small logs with
+ * a trained dictionary, a .zd, and removes the original.
+ */
+
+typedef struct log_compression_args_t {
+    /* Level choices are counted here; NULL for none */
+    stats_registry_t *stats;
+    /*
+     * Compression policy (drain target and load thresholds), read again
+     * before every log so a reload takes effect on the next one; NULL for
+     * the compress_controller defaults
+     */
+    config_store_t *config;
+} log_compression_args_t;
+
+/**
+ * Thread body; `arg` is a log_compression_args_t, or NULL for the
+ * defaults. It must outlive the thread.
+ */
+void *log_compression_thread(void *arg);
+
+/**
+ * Queue a finished file for the thread. Has the shape of
+ * pcap_segment_func_t, so it can be a pcap writer's on_segment.
+ */
+void log_compression_enqueue(void *ctx, const char *path);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif // ZIP_LOGS_H